@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/API/POSIX/fcntl.h>
+#include <Kernel/API/POSIX/sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IO_RING_CLOEXEC O_CLOEXEC
+
+#define IO_RING_MAX_ENTRIES 4096
+
+#define IO_RING_OP_NOP 0
+#define IO_RING_OP_READ 1
+#define IO_RING_OP_WRITE 2
+#define IO_RING_OP_RECV 3
+#define IO_RING_OP_SEND 4
+#define IO_RING_OP_ACCEPT 5
+#define IO_RING_OP_FSYNC 6
+#define IO_RING_OP_TIMEOUT 7
+
+// Passed as the offset of a read or write to use (and advance) the file's current position.
+#define IO_RING_CURRENT_POSITION ((uint64_t)-1)
+
+// Filled in by io_ring_setup(). The ring is mapped by passing `ring_size` and the ring's file
+// descriptor to mmap() with MAP_SHARED. The mapping starts with a struct io_ring_header, and
+// holds `sq_entries` submissions at `sq_offset` and `cq_entries` completions at `cq_offset`.
+struct io_ring_params {
+    uint32_t sq_entries; // Always a power of two.
+    uint32_t cq_entries; // Always a power of two.
+    uint64_t ring_size;
+    uint64_t sq_offset;
+    uint64_t cq_offset;
+};
+
+// All four counters are free-running; the position in their queue is `counter & (entries - 1)`.
+// `sq_tail` and `cq_head` are only ever written by userspace, which has to store them with
+// release semantics, and load `sq_head` and `cq_tail` with acquire semantics.
+struct io_ring_header {
+    uint32_t sq_head __attribute__((aligned(64)));
+    uint32_t sq_tail __attribute__((aligned(64)));
+    uint32_t cq_head __attribute__((aligned(64)));
+    uint32_t cq_tail __attribute__((aligned(64)));
+    // Number of completions that were lost because userspace reported a bogus `cq_head`.
+    uint32_t cq_overflow __attribute__((aligned(64)));
+};
+
+struct io_ring_submission {
+    uint8_t opcode;
+    uint8_t flags; // Must be 0.
+    uint16_t reserved;
+    int32_t fd;
+    // READ and WRITE: the file offset, or IO_RING_CURRENT_POSITION.
+    uint64_t offset;
+    // READ, WRITE, RECV and SEND: the buffer. TIMEOUT: a struct timespec with the relative timeout.
+    uint64_t address;
+    uint32_t length;
+    // RECV and SEND: MSG_* flags. ACCEPT: SOCK_NONBLOCK and SOCK_CLOEXEC.
+    uint32_t op_flags;
+    uint64_t user_data;
+};
+
+struct io_ring_completion {
+    uint64_t user_data;
+    // What the equivalent syscall would have returned, or a negated errno value.
+    int64_t result;
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -24,6 +24,7 @@ extern "C" {
 #define MAP_RANDOMIZED 0x100
 #define MAP_PURGEABLE 0x200
 #define MAP_FIXED_NOREPLACE 0x400
+#define MAP_HUGEPAGE 0x800
 
 #define PROT_READ 0x1
 #define PROT_WRITE 0x2
@@ -39,6 +40,8 @@ extern "C" {
 #define MADV_WILLNEED 0x4
 #define MADV_SEQUENTIAL 0x5
 #define MADV_RANDOM 0x6
+#define MADV_HUGEPAGE 0x7
+#define MADV_NOHUGEPAGE 0x8
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_madvise.html
 #define POSIX_MADV_NORMAL MADV_NORMAL
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+
+namespace Kernel {
+
+// A performance event stream is a file descriptor returned by profiling_stream(2). Mapping it
+// with MAP_SHARED gives access to a set of single-producer, single-consumer ring buffers, one
+// per CPU, which the kernel appends events to while profiling is enabled.
+//
+// The mapping starts with a PerformanceEventStreamHeader. Ring `i` then starts at
+// `first_ring_offset + i * ring_stride`, with its PerformanceEventRingHeader followed by the
+// ring data at `data_offset` bytes from the start of the ring.
+
+static constexpr u32 performance_event_stream_magic = 0x50455653; // "PEVS"
+static constexpr u32 performance_event_stream_version = 1;
+
+struct PerformanceEventStreamHeader {
+    u32 magic;
+    u32 version;
+    u32 cpu_count;
+    u32 reserved;
+    u64 total_size;
+    u64 first_ring_offset;
+    u64 ring_stride;
+    u64 data_offset;
+    u64 data_size; // Always a power of two.
+};
+
+struct PerformanceEventRingHeader {
+    // Free-running byte counters; the position in the ring is `counter & (data_size - 1)`.
+    // `head` is only ever written by the kernel, and `tail` only by the consumer. The consumer
+    // must load `head` with acquire semantics, and store `tail` with release semantics after
+    // it's done with a record, as the kernel may overwrite the space immediately afterwards.
+    alignas(64) u64 head;
+    alignas(64) u64 tail;
+    // Number of events that didn't fit into the ring since it was created.
+    alignas(64) u64 dropped_events;
+};
+
+// Records are 8-byte aligned, and never wrap around the end of the ring. If a record doesn't fit
+// into the remaining space before the end, a padding record (of type 0) is written to fill it up.
+struct [[gnu::packed]] PerformanceEventRecord {
+    u32 size; // Total size of this record, including the stack and the name.
+    u32 type; // One of the PERF_EVENT_* types, or 0 for padding.
+    u32 pid;
+    u32 tid;
+    u64 timestamp;
+    u64 arg1;
+    u64 arg2;
+    u32 lost_samples;
+    u16 stack_size;
+    u16 name_length;
+    // Followed by `stack_size` u64 return addresses, and then `name_length` bytes of
+    // (not null-terminated) name.
+};
+
+static_assert(sizeof(PerformanceEventRecord) % 8 == 0);
+
+// Files written by `profile --stream` start with this header, followed by the records from all
+// rings, with padding records removed.
+static constexpr u64 performance_event_stream_file_magic = 0x4d52545346524550ull; // "PERFSTRM"
+
+struct [[gnu::packed]] PerformanceEventStreamFileHeader {
+    u64 magic;
+    u32 version;
+    u32 cpu_count;
+};
+
+}
@@ -19,6 +19,8 @@ constexpr int syscall_vector = 0x82;
 
 extern "C" {
 struct pollfd;
+struct epoll_event;
+struct io_ring_params;
 struct timeval;
 struct timespec;
 struct sockaddr;
@@ -70,6 +72,9 @@ enum class NeedsBigProcessLock {
     S(dump_backtrace, NeedsBigProcessLock::No)             \
     S(dup2, NeedsBigProcessLock::No)                       \
     S(emuctl, NeedsBigProcessLock::No)                     \
+    S(epoll_create, NeedsBigProcessLock::No)               \
+    S(epoll_ctl, NeedsBigProcessLock::No)                  \
+    S(epoll_wait, NeedsBigProcessLock::No)                 \
     S(execve, NeedsBigProcessLock::Yes)                    \
     S(exit, NeedsBigProcessLock::Yes)                      \
     S(exit_thread, NeedsBigProcessLock::Yes)               \
@@ -113,6 +118,8 @@ enum class NeedsBigProcessLock {
     S(getuid, NeedsBigProcessLock::No)                     \
     S(inode_watcher_add_watch, NeedsBigProcessLock::No)    \
     S(inode_watcher_remove_watch, NeedsBigProcessLock::No) \
+    S(io_ring_enter, NeedsBigProcessLock::Yes)             \
+    S(io_ring_setup, NeedsBigProcessLock::No)              \
     S(ioctl, NeedsBigProcessLock::Yes)                     \
     S(join_thread, NeedsBigProcessLock::Yes)               \
     S(jail_create, NeedsBigProcessLock::No)                \
@@ -139,10 +146,12 @@ enum class NeedsBigProcessLock {
     S(pledge, NeedsBigProcessLock::No)                     \
     S(poll, NeedsBigProcessLock::No)                       \
     S(posix_fallocate, NeedsBigProcessLock::No)            \
+    S(posix_spawn, NeedsBigProcessLock::No)                \
     S(prctl, NeedsBigProcessLock::No)                      \
     S(profiling_disable, NeedsBigProcessLock::Yes)         \
     S(profiling_enable, NeedsBigProcessLock::Yes)          \
     S(profiling_free_buffer, NeedsBigProcessLock::Yes)     \
+    S(profiling_stream, NeedsBigProcessLock::Yes)          \
     S(ptrace, NeedsBigProcessLock::Yes)                    \
     S(purge, NeedsBigProcessLock::Yes)                     \
     S(read, NeedsBigProcessLock::Yes)                      \
@@ -158,6 +167,7 @@ enum class NeedsBigProcessLock {
     S(scheduler_get_parameters, NeedsBigProcessLock::No)   \
     S(scheduler_set_parameters, NeedsBigProcessLock::No)   \
     S(sendfd, NeedsBigProcessLock::No)                     \
+    S(sendfile, NeedsBigProcessLock::Yes)                  \
     S(sendmsg, NeedsBigProcessLock::Yes)                   \
     S(set_mmap_name, NeedsBigProcessLock::No)              \
     S(setegid, NeedsBigProcessLock::No)                    \
@@ -265,6 +275,21 @@ struct SC_poll_params {
     u32 const* sigmask;
 };
 
+struct SC_epoll_wait_params {
+    int epoll_fd;
+    struct epoll_event* events;
+    int max_events;
+    const struct timespec* timeout;
+    u32 const* sigmask;
+};
+
+struct SC_io_ring_enter_params {
+    int ring_fd;
+    u32 to_submit;
+    u32 min_complete;
+    const struct timespec* timeout;
+};
+
 struct SC_clock_nanosleep_params {
     int clock_id;
     int flags;
@@ -392,6 +417,33 @@ struct SC_execve_params {
     StringListArgument environment;
 };
 
+struct SpawnFileAction {
+    enum class Type : u32 {
+        Open,
+        Close,
+        Dup2,
+        Chdir,
+        Fchdir,
+    };
+    Type type;
+    int fd;              // Open: the fd the opened file ends up as. Close, Fchdir: the fd. Dup2: the new fd.
+    int old_fd;          // Dup2
+    int flags;           // Open
+    u32 mode;            // Open
+    StringArgument path; // Open, Chdir
+};
+
+struct SC_posix_spawn_params {
+    StringArgument path;
+    StringListArgument arguments;
+    StringListArgument environment;
+    SpawnFileAction const* file_actions;
+    size_t file_actions_count;
+    bool set_signal_mask;
+    u32 signal_mask;
+    u32 default_signals; // Signals that the child should handle in the default way, even if we ignore them.
+};
+
 struct SC_readlink_params {
     StringArgument path;
     MutableBufferArgument<char, size_t> buffer;
@@ -28,6 +28,14 @@ enum class BufferType {
 
 class Queue {
 public:
+    // NOTE: This is also the layout of the entries in an indirect descriptor table.
+    struct [[gnu::packed]] QueueDescriptor {
+        u64 address;
+        u32 length;
+        u16 flags;
+        u16 next;
+    };
+
     static ErrorOr<NonnullOwnPtr<Queue>> try_create(u16 queue_size, u16 notify_offset);
 
     ~Queue();
@@ -63,12 +71,6 @@ private:
         auto offset = FlatPtr(ptr) - m_queue_region->vaddr().get();
         return m_queue_region->physical_page(0)->paddr().offset(offset);
     }
-    struct [[gnu::packed]] QueueDescriptor {
-        u64 address;
-        u32 length;
-        u16 flags;
-        u16 next;
-    };
 
     struct [[gnu::packed]] QueueDriver {
         u16 flags;
@@ -155,6 +157,9 @@ public:
     [[nodiscard]] bool is_empty() const { return m_chain_length == 0; }
     [[nodiscard]] size_t length() const { return m_chain_length; }
     bool add_buffer_to_chain(PhysicalAddress buffer_start, size_t buffer_length, BufferType buffer_type);
+    // Adds a single descriptor that refers to a table of `descriptor_count` descriptors, which the device then
+    // treats as if they were chained one after another. Needs VIRTIO_F_INDIRECT_DESC, and must be the only buffer in the chain.
+    bool add_indirect_table_to_chain(PhysicalAddress table_start, size_t descriptor_count);
     void submit_to_queue();
     void release_buffer_slots_to_queue();
 
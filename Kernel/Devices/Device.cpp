@@ -71,6 +71,11 @@ ErrorOr<NonnullRefPtr<OpenFileDescription>> Device::open(int options)
 
 void Device::process_next_queued_request(Badge<AsyncDeviceRequest>, AsyncDeviceRequest const& completed_request)
 {
+    if (can_process_requests_concurrently()) {
+        evaluate_block_conditions();
+        return;
+    }
+
     SpinlockLocker lock(m_requests_lock);
     VERIFY(!m_requests.is_empty());
     VERIFY(m_requests.first().ptr() == &completed_request);
@@ -51,11 +51,19 @@ public:
     virtual bool is_openable_by_jailed_processes() const { return false; }
     void process_next_queued_request(Badge<AsyncDeviceRequest>, AsyncDeviceRequest const&);
 
+    // Devices that can have many requests in flight at once (e.g. NVMe with its per-processor queues)
+    // override this so that requests are started right away instead of one after another.
+    virtual bool can_process_requests_concurrently() const { return false; }
+
     template<typename AsyncRequestType, typename... Args>
     ErrorOr<NonnullLockRefPtr<AsyncRequestType>> try_make_request(Args&&... args)
     {
         auto request = TRY(adopt_nonnull_lock_ref_or_enomem(new (nothrow) AsyncRequestType(*this, forward<Args>(args)...)));
         SpinlockLocker lock(m_requests_lock);
+        if (can_process_requests_concurrently()) {
+            request->do_start(move(lock));
+            return request;
+        }
         bool was_empty = m_requests.is_empty();
         TRY(m_requests.try_append(request));
         if (was_empty)
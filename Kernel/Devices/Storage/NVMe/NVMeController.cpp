@@ -35,8 +35,9 @@ UNMAP_AFTER_INIT NVMeController::NVMeController(const PCI::DeviceIdentifier& dev
 
 UNMAP_AFTER_INIT ErrorOr<void> NVMeController::initialize(bool is_queue_polled)
 {
-    // Nr of queues = one queue per core
-    auto nr_of_queues = Processor::count();
+    // Nr of queues = one queue per core, if the controller has enough of them
+    // NOTE: Interrupt vectors are numbered with a u8, and the admin queue needs one too.
+    u16 nr_of_queues = min(Processor::count(), NumericLimits<u8>::max() - 1);
     auto queue_type = is_queue_polled ? QueueType::Polled : QueueType::IRQ;
 
     PCI::enable_memory_space(device_identifier());
@@ -63,6 +64,9 @@ UNMAP_AFTER_INIT ErrorOr<void> NVMeController::initialize(bool is_queue_polled)
     dbgln_if(NVME_DEBUG, "NVMe: IO queue depth is: {}", IO_QUEUE_SIZE);
 
     TRY(identify_and_init_controller());
+    nr_of_queues = negotiate_io_queue_count(nr_of_queues);
+    dmesgln_pci(*this, "Using {} IO queue(s) for {} processor(s)", nr_of_queues, Processor::count());
+
     // Create an IO queue per core
     for (u32 cpuid = 0; cpuid < nr_of_queues; ++cpuid) {
         // qid is zero is used for admin queue
@@ -276,6 +280,25 @@ ErrorOr<void> NVMeController::identify_and_init_controller()
     return {};
 }
 
+UNMAP_AFTER_INIT u16 NVMeController::negotiate_io_queue_count(u16 requested_count)
+{
+    NVMeSubmission sub {};
+    u32 allocated = 0;
+    sub.op = OP_ADMIN_SET_FEATURES;
+    sub.generic.cdw10 = AK::convert_between_host_and_little_endian(FEATURE_NUMBER_OF_QUEUES);
+    // Both queue counts are 0 based
+    sub.generic.cdw11 = AK::convert_between_host_and_little_endian(static_cast<u32>((requested_count - 1) | ((requested_count - 1) << 16)));
+    auto status = submit_admin_command(sub, true, &allocated);
+    if (status) {
+        dmesgln_pci(*this, "Failed to set the number of queues, falling back to a single IO queue");
+        return 1;
+    }
+
+    // The controller may give us fewer (or more) queues than we asked for.
+    allocated = AK::convert_between_host_and_little_endian(allocated);
+    return min(requested_count, min(NUMBER_OF_SUBMISSION_QUEUES(allocated), NUMBER_OF_COMPLETION_QUEUES(allocated)));
+}
+
 UNMAP_AFTER_INIT Tuple<u64, u8> NVMeController::get_ns_features(IdentifyNamespace& identify_data_struct)
 {
     auto flbas = identify_data_struct.flbas & FLBA_SIZE_MASK;
@@ -118,12 +118,24 @@ static constexpr u8 FLBA_SIZE_MASK = 0xf;
 static constexpr u8 LBA_FORMAT_SUPPORT_INDEX = 128;
 static constexpr u32 LBA_SIZE_MASK = 0x00ff0000;
 
+// FEATURES
+static constexpr u8 FEATURE_NUMBER_OF_QUEUES = 0x7;
+static constexpr u16 NUMBER_OF_SUBMISSION_QUEUES(u32 x)
+{
+    return (x & 0xffff) + 1;
+}
+static constexpr u16 NUMBER_OF_COMPLETION_QUEUES(u32 x)
+{
+    return (x >> 16) + 1;
+}
+
 // OPCODES
 // ADMIN COMMAND SET
 enum AdminCommandOpCode {
     OP_ADMIN_CREATE_COMPLETION_QUEUE = 0x5,
     OP_ADMIN_CREATE_SUBMISSION_QUEUE = 0x1,
     OP_ADMIN_IDENTIFY = 0x6,
+    OP_ADMIN_SET_FEATURES = 0x9,
     OP_ADMIN_DBBUF_CONFIG = 0x7C,
 };
 
@@ -14,23 +14,26 @@
 namespace Kernel {
 ErrorOr<NonnullLockRefPtr<NVMeQueue>> NVMeQueue::try_create(NVMeController& device, u16 qid, u8 irq, u32 q_depth, OwnPtr<Memory::Region> cq_dma_region, OwnPtr<Memory::Region> sq_dma_region, Doorbell db_regs, QueueType queue_type)
 {
-    // Note: Allocate DMA region for RW operation. For now the requests don't exceed more than 4096 bytes (Storage device takes care of it)
-    RefPtr<Memory::PhysicalPage> rw_dma_page;
-    auto rw_dma_region = TRY(MM.allocate_dma_buffer_page("NVMe Queue Read/Write DMA"sv, Memory::Region::Access::ReadWrite, rw_dma_page));
+    // Note: Allocate a DMA page for every command slot of an IO queue, so that all of them can be in flight at once.
+    //       For now the requests don't exceed more than 4096 bytes (Storage device takes care of it).
+    //       The admin queue only ever uses the buffers passed in with its commands.
+    auto rw_dma_page_count = (qid == 0) ? 1 : q_depth;
+    Vector<NonnullRefPtr<Memory::PhysicalPage>> rw_dma_pages;
+    auto rw_dma_region = TRY(MM.allocate_dma_buffer_pages(rw_dma_page_count * PAGE_SIZE, "NVMe Queue Read/Write DMA"sv, Memory::Region::Access::ReadWrite, rw_dma_pages));
 
-    if (rw_dma_page.is_null())
+    if (rw_dma_pages.size() != rw_dma_page_count)
         return ENOMEM;
 
     if (queue_type == QueueType::Polled) {
-        auto queue = NVMePollQueue::try_create(move(rw_dma_region), rw_dma_page.release_nonnull(), qid, q_depth, move(cq_dma_region), move(sq_dma_region), move(db_regs));
+        auto queue = NVMePollQueue::try_create(move(rw_dma_region), move(rw_dma_pages), qid, q_depth, move(cq_dma_region), move(sq_dma_region), move(db_regs));
         return queue;
     }
 
-    auto queue = NVMeInterruptQueue::try_create(device, move(rw_dma_region), rw_dma_page.release_nonnull(), qid, irq, q_depth, move(cq_dma_region), move(sq_dma_region), move(db_regs));
+    auto queue = NVMeInterruptQueue::try_create(device, move(rw_dma_region), move(rw_dma_pages), qid, irq, q_depth, move(cq_dma_region), move(sq_dma_region), move(db_regs));
     return queue;
 }
 
-UNMAP_AFTER_INIT NVMeQueue::NVMeQueue(NonnullOwnPtr<Memory::Region> rw_dma_region, Memory::PhysicalPage const& rw_dma_page, u16 qid, u32 q_depth, OwnPtr<Memory::Region> cq_dma_region, OwnPtr<Memory::Region> sq_dma_region, Doorbell db_regs)
+UNMAP_AFTER_INIT NVMeQueue::NVMeQueue(NonnullOwnPtr<Memory::Region> rw_dma_region, Vector<NonnullRefPtr<Memory::PhysicalPage>> rw_dma_pages, u16 qid, u32 q_depth, OwnPtr<Memory::Region> cq_dma_region, OwnPtr<Memory::Region> sq_dma_region, Doorbell db_regs)
     : m_rw_dma_region(move(rw_dma_region))
     , m_qid(qid)
     , m_admin_queue(qid == 0)
@@ -38,10 +41,11 @@ UNMAP_AFTER_INIT NVMeQueue::NVMeQueue(NonnullOwnPtr<Memory::Region> rw_dma_regio
     , m_cq_dma_region(move(cq_dma_region))
     , m_sq_dma_region(move(sq_dma_region))
     , m_db_regs(move(db_regs))
-    , m_rw_dma_page(rw_dma_page)
+    , m_rw_dma_pages(move(rw_dma_pages))
 
 {
     m_requests.try_ensure_capacity(q_depth).release_value_but_fixme_should_propagate_errors();
+    m_pending_requests.try_ensure_capacity(q_depth).release_value_but_fixme_should_propagate_errors();
     m_sqe_array = { reinterpret_cast<NVMeSubmission*>(m_sq_dma_region->vaddr().as_ptr()), m_qdepth };
     m_cqe_array = { reinterpret_cast<NVMeCompletion*>(m_cq_dma_region->vaddr().as_ptr()), m_qdepth };
 }
@@ -69,16 +73,18 @@ u32 NVMeQueue::process_cq()
     while (cqe_available()) {
         u16 status;
         u16 cmdid;
+        u32 command_specific;
         ++nr_of_processed_cqes;
         status = CQ_STATUS_FIELD(m_cqe_array[m_cq_head].status);
         cmdid = m_cqe_array[m_cq_head].command_id;
+        command_specific = m_cqe_array[m_cq_head].cmd_spec;
         dbgln_if(NVME_DEBUG, "NVMe: Completion with status {:x} and command identifier {}. CQ_HEAD: {}", status, cmdid, m_cq_head);
 
         if (!m_requests.contains(cmdid)) {
             dmesgln("Bogus cmd id: {}", cmdid);
             VERIFY_NOT_REACHED();
         }
-        complete_current_request(cmdid, status);
+        complete_current_request(cmdid, status, command_specific);
         update_cqe_head();
     }
     if (nr_of_processed_cqes) {
@@ -87,7 +93,7 @@ u32 NVMeQueue::process_cq()
     return nr_of_processed_cqes;
 }
 
-void NVMeQueue::submit_sqe(NVMeSubmission& sub)
+void NVMeQueue::write_sqe(NVMeSubmission& sub)
 {
     SpinlockLocker lock(m_sq_lock);
 
@@ -101,22 +107,70 @@ void NVMeQueue::submit_sqe(NVMeSubmission& sub)
     }
 
     dbgln_if(NVME_DEBUG, "NVMe: Submission with command identifier {}. SQ_TAIL: {}", sub.cmdid, m_sq_tail);
+}
+
+void NVMeQueue::ring_sq_doorbell()
+{
+    SpinlockLocker lock(m_sq_lock);
     update_sq_doorbell();
 }
 
-u16 NVMeQueue::submit_sync_sqe(NVMeSubmission& sub)
+void NVMeQueue::submit_sqe(NVMeSubmission& sub)
+{
+    write_sqe(sub);
+    ring_sq_doorbell();
+}
+
+Optional<u16> NVMeQueue::try_allocate_cid(NVMeIO io)
+{
+    VERIFY(m_request_lock.is_locked());
+
+    // NOTE: One entry of the submission queue always has to stay empty, as the controller
+    //       can't tell a full queue from an empty one otherwise.
+    if (m_in_flight_count + 1 >= m_qdepth)
+        return {};
+
+    for (u32 i = 0; i < m_qdepth; ++i) {
+        u16 cid = (m_next_cid + i) % m_qdepth;
+        auto it = m_requests.find(cid);
+        if (it != m_requests.end() && it->value.used)
+            continue;
+        m_next_cid = (cid + 1) % m_qdepth;
+        ++m_in_flight_count;
+        io.used = true;
+        m_requests.set(cid, move(io));
+        return cid;
+    }
+    return {};
+}
+
+bool NVMeQueue::has_pending_requests()
+{
+    SpinlockLocker lock(m_request_lock);
+    return !m_pending_requests.is_empty();
+}
+
+bool NVMeQueue::has_in_flight_commands()
+{
+    SpinlockLocker lock(m_request_lock);
+    return m_in_flight_count > 0;
+}
+
+u16 NVMeQueue::submit_sync_sqe(NVMeSubmission& sub, u32* command_specific)
 {
-    // For now let's use sq tail as a unique command id.
     u16 cmd_status;
-    u16 cid = get_request_cid();
-    sub.cmdid = cid;
 
     {
         SpinlockLocker req_lock(m_request_lock);
-
-        if (m_requests.contains(sub.cmdid) && m_requests.get(sub.cmdid).release_value().used)
-            VERIFY_NOT_REACHED();
-        m_requests.set(sub.cmdid, { nullptr, true, [this, &cmd_status](u16 status) mutable { cmd_status = status; m_sync_wait_queue.wake_all(); } });
+        auto cid = try_allocate_cid({ nullptr, true, [this, &cmd_status, command_specific](u16 status, u32 result) mutable {
+            cmd_status = status;
+            if (command_specific)
+                *command_specific = result;
+            m_sync_wait_queue.wake_all();
+        } });
+        // NOTE: Sync submissions are only used during initialization, before the queue sees any other traffic.
+        VERIFY(cid.has_value());
+        sub.cmdid = cid.value();
     }
     submit_sqe(sub);
 
@@ -126,54 +180,114 @@ u16 NVMeQueue::submit_sync_sqe(NVMeSubmission& sub)
     return cmd_status;
 }
 
-void NVMeQueue::read(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count)
+bool NVMeQueue::write_io_submission(AsyncBlockDeviceRequest& request, u16 nsid, u16 cmdid)
 {
     NVMeSubmission sub {};
-    sub.op = OP_NVME_READ;
+    sub.op = (request.request_type() == AsyncBlockDeviceRequest::Read) ? OP_NVME_READ : OP_NVME_WRITE;
     sub.rw.nsid = nsid;
-    sub.rw.slba = AK::convert_between_host_and_little_endian(index);
+    sub.rw.slba = AK::convert_between_host_and_little_endian(request.block_index());
     // No. of lbas is 0 based
-    sub.rw.length = AK::convert_between_host_and_little_endian((count - 1) & 0xFFFF);
-    sub.rw.data_ptr.prp1 = reinterpret_cast<u64>(AK::convert_between_host_and_little_endian(m_rw_dma_page->paddr().as_ptr()));
-    sub.cmdid = get_request_cid();
+    sub.rw.length = AK::convert_between_host_and_little_endian((request.block_count() - 1) & 0xFFFF);
+    sub.rw.data_ptr.prp1 = reinterpret_cast<u64>(AK::convert_between_host_and_little_endian(m_rw_dma_pages[cmdid]->paddr().as_ptr()));
+    sub.cmdid = cmdid;
 
+    if (request.request_type() == AsyncBlockDeviceRequest::Write) {
+        if (auto result = request.read_from_buffer(request.buffer(), rw_dma_buffer(cmdid), request.buffer_size()); result.is_error()) {
+            finish_command(cmdid, 0, 0, AsyncDeviceRequest::MemoryFault);
+            return false;
+        }
+    }
+
+    full_memory_barrier();
+    write_sqe(sub);
+    return true;
+}
+
+void NVMeQueue::submit_request(AsyncBlockDeviceRequest& request, u16 nsid)
+{
+    Optional<u16> cid;
     {
         SpinlockLocker req_lock(m_request_lock);
-        if (m_requests.contains(sub.cmdid) && m_requests.get(sub.cmdid).release_value().used)
-            VERIFY_NOT_REACHED();
-        m_requests.set(sub.cmdid, { request, true, nullptr });
+        // Don't overtake requests that are already waiting for a free slot.
+        if (m_pending_requests.is_empty())
+            cid = try_allocate_cid({ request, true, nullptr });
+        if (!cid.has_value()) {
+            if (m_pending_requests.try_append({ request, nsid }).is_error()) {
+                req_lock.unlock();
+                request.complete(AsyncDeviceRequest::OutOfMemory);
+            }
+            return;
+        }
     }
 
-    full_memory_barrier();
-    submit_sqe(sub);
+    if (write_io_submission(request, nsid, cid.value()))
+        ring_sq_doorbell();
 }
 
-void NVMeQueue::write(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count)
+void NVMeQueue::submit_pending_requests()
 {
-    NVMeSubmission sub {};
+    size_t submitted_count = 0;
+    for (;;) {
+        LockRefPtr<AsyncBlockDeviceRequest> request;
+        u16 nsid;
+        u16 cid;
+        {
+            SpinlockLocker req_lock(m_request_lock);
+            if (m_pending_requests.is_empty())
+                break;
+            auto maybe_cid = try_allocate_cid({ *m_pending_requests.first().request, true, nullptr });
+            if (!maybe_cid.has_value())
+                break;
+            auto pending_request = m_pending_requests.take_first();
+            request = move(pending_request.request);
+            nsid = pending_request.nsid;
+            cid = maybe_cid.value();
+        }
+        if (write_io_submission(*request, nsid, cid))
+            ++submitted_count;
+    }
 
-    sub.op = OP_NVME_WRITE;
-    sub.rw.nsid = nsid;
-    sub.rw.slba = AK::convert_between_host_and_little_endian(index);
-    // No. of lbas is 0 based
-    sub.rw.length = AK::convert_between_host_and_little_endian((count - 1) & 0xFFFF);
-    sub.rw.data_ptr.prp1 = reinterpret_cast<u64>(AK::convert_between_host_and_little_endian(m_rw_dma_page->paddr().as_ptr()));
-    sub.cmdid = get_request_cid();
+    // Let the controller know about the whole batch with a single doorbell write.
+    if (submitted_count > 0)
+        ring_sq_doorbell();
+}
 
+void NVMeQueue::finish_command(u16 cmdid, u16 status, u32 command_specific, Optional<AsyncDeviceRequest::RequestResult> result_override)
+{
+    RefPtr<AsyncBlockDeviceRequest> request;
     {
-        SpinlockLocker req_lock(m_request_lock);
-        if (m_requests.contains(sub.cmdid) && m_requests.get(sub.cmdid).release_value().used)
-            VERIFY_NOT_REACHED();
-        m_requests.set(sub.cmdid, { request, true, nullptr });
+        SpinlockLocker lock(m_request_lock);
+        request = m_requests.get(cmdid).release_value().request;
     }
 
-    if (auto result = request.read_from_buffer(request.buffer(), m_rw_dma_region->vaddr().as_ptr(), request.buffer_size()); result.is_error()) {
-        complete_current_request(sub.cmdid, AsyncDeviceRequest::MemoryFault);
-        return;
+    // NOTE: The slot stays reserved while we copy the data out of its DMA buffer, so nobody can reuse it yet.
+    auto request_result = AsyncDeviceRequest::Success;
+    if (result_override.has_value()) {
+        request_result = result_override.value();
+    } else if (request) {
+        if (status) {
+            request_result = AsyncBlockDeviceRequest::Failure;
+        } else if (request->request_type() == AsyncBlockDeviceRequest::RequestType::Read) {
+            if (auto result = request->write_to_buffer(request->buffer(), rw_dma_buffer(cmdid), request->buffer_size()); result.is_error())
+                request_result = AsyncBlockDeviceRequest::MemoryFault;
+        }
     }
 
-    full_memory_barrier();
-    submit_sqe(sub);
+    Function<void(u16, u32)> end_io_handler;
+    {
+        SpinlockLocker lock(m_request_lock);
+        auto& request_pdu = m_requests.get(cmdid).release_value();
+        end_io_handler = move(request_pdu.end_io_handler);
+        request_pdu.clear();
+        --m_in_flight_count;
+    }
+
+    // There can be submission without any request associated with it such as with
+    // admin queue commands during init.
+    if (request)
+        request->complete(request_result);
+    if (end_io_handler)
+        end_io_handler(status, command_specific);
 }
 
 UNMAP_AFTER_INIT NVMeQueue::~NVMeQueue() = default;
@@ -11,6 +11,7 @@
 #include <AK/OwnPtr.h>
 #include <AK/Types.h>
 #include <Kernel/Bus/PCI/Device.h>
+#include <Kernel/Devices/AsyncDeviceRequest.h>
 #include <Kernel/Devices/Storage/NVMe/NVMeDefinitions.h>
 #include <Kernel/Interrupts/IRQHandler.h>
 #include <Kernel/Library/LockRefPtr.h>
@@ -48,7 +49,7 @@ struct NVMeIO {
     }
     RefPtr<AsyncBlockDeviceRequest> request;
     bool used = false;
-    Function<void(u16 status)> end_io_handler;
+    Function<void(u16 status, u32 command_specific)> end_io_handler;
 };
 
 class NVMeController;
@@ -56,15 +57,28 @@ class NVMeQueue : public AtomicRefCounted<NVMeQueue> {
 public:
     static ErrorOr<NonnullLockRefPtr<NVMeQueue>> try_create(NVMeController& device, u16 qid, u8 irq, u32 q_depth, OwnPtr<Memory::Region> cq_dma_region, OwnPtr<Memory::Region> sq_dma_region, Doorbell db_regs, QueueType queue_type);
     bool is_admin_queue() { return m_admin_queue; }
-    u16 submit_sync_sqe(NVMeSubmission&);
-    void read(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count);
-    void write(AsyncBlockDeviceRequest& request, u16 nsid, u64 index, u32 count);
-    virtual void submit_sqe(NVMeSubmission&);
+    u16 submit_sync_sqe(NVMeSubmission&, u32* command_specific = nullptr);
+    void submit_request(AsyncBlockDeviceRequest& request, u16 nsid);
+    void submit_sqe(NVMeSubmission&);
     virtual ~NVMeQueue();
 
 protected:
     u32 process_cq();
 
+    // Writes the entry into the submission queue, but leaves it to the caller to ring the doorbell.
+    void write_sqe(NVMeSubmission&);
+    virtual void ring_sq_doorbell();
+
+    // Submits as many of the requests waiting for a free command slot as possible, with a single doorbell write.
+    void submit_pending_requests();
+    bool has_pending_requests();
+    bool has_in_flight_commands();
+
+    // Copies out the data of a completed command, releases its slot and completes the request.
+    void finish_command(u16 cmdid, u16 status, u32 command_specific, Optional<AsyncDeviceRequest::RequestResult> result_override = {});
+
+    u8* rw_dma_buffer(u16 cmdid) { return m_rw_dma_region->vaddr().offset(cmdid * PAGE_SIZE).as_ptr(); }
+
     // Updates the shadow buffer and returns if mmio is needed
     bool update_shadow_buf(u16 new_value, u32* dbbuf, u32* ei)
     {
@@ -85,25 +99,21 @@ protected:
             m_db_regs.mmio_reg->sq_tail = m_sq_tail;
     }
 
-    NVMeQueue(NonnullOwnPtr<Memory::Region> rw_dma_region, Memory::PhysicalPage const& rw_dma_page, u16 qid, u32 q_depth, OwnPtr<Memory::Region> cq_dma_region, OwnPtr<Memory::Region> sq_dma_region, Doorbell db_regs);
-
-    [[nodiscard]] u32 get_request_cid()
-    {
-        u32 expected_tag = m_tag.load(AK::memory_order_acquire);
-
-        for (;;) {
-            u32 cid = expected_tag + 1;
-            if (cid == m_qdepth)
-                cid = 0;
-            if (m_tag.compare_exchange_strong(expected_tag, cid, AK::memory_order_acquire))
-                return cid;
-        }
-    }
+    NVMeQueue(NonnullOwnPtr<Memory::Region> rw_dma_region, Vector<NonnullRefPtr<Memory::PhysicalPage>> rw_dma_pages, u16 qid, u32 q_depth, OwnPtr<Memory::Region> cq_dma_region, OwnPtr<Memory::Region> sq_dma_region, Doorbell db_regs);
 
 private:
+    struct PendingRequest {
+        NonnullLockRefPtr<AsyncBlockDeviceRequest> request;
+        u16 nsid;
+    };
+
+    // Must be called with m_request_lock held.
+    Optional<u16> try_allocate_cid(NVMeIO);
+    bool write_io_submission(AsyncBlockDeviceRequest&, u16 nsid, u16 cmdid);
+
     bool cqe_available();
     void update_cqe_head();
-    virtual void complete_current_request(u16 cmdid, u16 status) = 0;
+    virtual void complete_current_request(u16 cmdid, u16 status, u32 command_specific) = 0;
     void update_cq_doorbell()
     {
         full_memory_barrier();
@@ -125,7 +135,9 @@ private:
     u16 m_cq_head {};
     bool m_admin_queue { false };
     u32 m_qdepth {};
-    Atomic<u32> m_tag { 0 }; // used for the cid in a submission queue entry
+    u16 m_next_cid { 0 };
+    u32 m_in_flight_count { 0 };
+    Vector<PendingRequest> m_pending_requests;
     Spinlock<LockRank::Interrupts> m_sq_lock {};
     OwnPtr<Memory::Region> m_cq_dma_region;
     Span<NVMeSubmission> m_sqe_array;
@@ -133,6 +145,7 @@ private:
     Span<NVMeCompletion> m_cqe_array;
     WaitQueue m_sync_wait_queue;
     Doorbell m_db_regs;
-    NonnullRefPtr<Memory::PhysicalPage const> const m_rw_dma_page;
+    // One page per command slot, so every command in flight has its own bounce buffer.
+    Vector<NonnullRefPtr<Memory::PhysicalPage>> const m_rw_dma_pages;
 };
 }
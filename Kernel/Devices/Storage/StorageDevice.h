@@ -38,6 +38,7 @@ public:
         ATA,
         NVMe,
         SD,
+        VirtIO,
     };
 
     // Note: The most reliable way to address this device from userspace interfaces,
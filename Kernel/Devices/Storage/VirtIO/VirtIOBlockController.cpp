@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Arch/Processor.h>
+#include <Kernel/Bus/PCI/IDs.h>
+#include <Kernel/Bus/VirtIO/Transport/PCIe/TransportLink.h>
+#include <Kernel/Debug.h>
+#include <Kernel/Devices/Storage/StorageManagement.h>
+#include <Kernel/Devices/Storage/VirtIO/VirtIOBlockController.h>
+#include <Kernel/Devices/Storage/VirtIO/VirtIOBlockDevice.h>
+#include <Kernel/Tasks/WorkQueue.h>
+
+namespace Kernel {
+
+namespace VirtIO {
+
+// https://docs.oasis-open.org/virtio/virtio/v1.2/csd01/virtio-v1.2-csd01.html#x1-2790002
+
+static constexpr u64 VIRTIO_BLK_F_SIZE_MAX = (1ull << 1); // Maximum size of any single segment is in size_max.
+static constexpr u64 VIRTIO_BLK_F_SEG_MAX = (1ull << 2);  // Maximum number of segments in a request is in seg_max.
+static constexpr u64 VIRTIO_BLK_F_RO = (1ull << 5);       // Device is read-only.
+static constexpr u64 VIRTIO_BLK_F_BLK_SIZE = (1ull << 6); // Block size of disk is in blk_size.
+static constexpr u64 VIRTIO_BLK_F_MQ = (1ull << 12);      // Device supports multiqueue.
+
+static constexpr u32 VIRTIO_BLK_T_IN = 0;
+static constexpr u32 VIRTIO_BLK_T_OUT = 1;
+
+static constexpr u8 VIRTIO_BLK_S_OK = 0;
+
+// Sector numbers are always in units of 512 bytes, regardless of the block size.
+static constexpr size_t VIRTIO_BLK_SECTOR_SIZE = 512;
+
+struct [[gnu::packed]] VirtIOBlockConfig {
+    LittleEndian<u64> capacity;
+    LittleEndian<u32> size_max;
+    LittleEndian<u32> seg_max;
+    LittleEndian<u16> cylinders;
+    u8 heads;
+    u8 sectors;
+    LittleEndian<u32> blk_size;
+    u8 physical_block_exp;
+    u8 alignment_offset;
+    LittleEndian<u16> min_io_size;
+    LittleEndian<u32> opt_io_size;
+    u8 writeback;
+    u8 unused0;
+    LittleEndian<u16> num_queues;
+};
+
+struct [[gnu::packed]] VirtIOBlockRequestHeader {
+    LittleEndian<u32> type;
+    LittleEndian<u32> reserved;
+    LittleEndian<u64> sector;
+};
+
+}
+
+using namespace VirtIO;
+
+// Every slot has a fixed area for its indirect descriptor table, the request header and the status byte.
+static constexpr size_t slot_descriptor_area_size = 512;
+static constexpr size_t slot_header_offset = 384;
+static constexpr size_t slot_status_offset = slot_header_offset + sizeof(VirtIOBlockRequestHeader);
+static_assert(slot_status_offset < slot_descriptor_area_size);
+
+UNMAP_AFTER_INIT bool VirtIOBlockController::probe(PCI::DeviceIdentifier const& device_identifier)
+{
+    if (device_identifier.hardware_id().vendor_id != PCI::VendorID::VirtIO)
+        return false;
+    return device_identifier.hardware_id().device_id == PCI::DeviceID::VirtIOBlockDevice;
+}
+
+UNMAP_AFTER_INIT ErrorOr<NonnullRefPtr<VirtIOBlockController>> VirtIOBlockController::try_initialize(PCI::DeviceIdentifier const& device_identifier)
+{
+    auto pci_transport_link = TRY(VirtIO::PCIeTransportLink::create(device_identifier));
+    auto controller = TRY(adopt_nonnull_ref_or_enomem(new (nothrow) VirtIOBlockController(move(pci_transport_link), StorageManagement::generate_relative_virtio_controller_id({}))));
+    TRY(controller->initialize_virtio_resources());
+    return controller;
+}
+
+UNMAP_AFTER_INIT VirtIOBlockController::VirtIOBlockController(NonnullOwnPtr<VirtIO::TransportEntity> transport_entity, u32 hardware_relative_controller_id)
+    : StorageController(hardware_relative_controller_id)
+    , VirtIO::Device(move(transport_entity))
+{
+}
+
+LockRefPtr<StorageDevice> VirtIOBlockController::device(u32 index) const
+{
+    if (index != 0)
+        return {};
+    return m_device;
+}
+
+UNMAP_AFTER_INIT ErrorOr<void> VirtIOBlockController::initialize_virtio_resources()
+{
+    TRY(Device::initialize_virtio_resources());
+    m_device_config = TRY(transport_entity().get_config(VirtIO::ConfigurationType::Device));
+
+    TRY(negotiate_features([&](u64 supported_features) {
+        u64 negotiated = 0;
+        for (auto feature : { VIRTIO_BLK_F_SIZE_MAX, VIRTIO_BLK_F_SEG_MAX, VIRTIO_BLK_F_RO, VIRTIO_BLK_F_BLK_SIZE, VIRTIO_BLK_F_MQ, VIRTIO_F_INDIRECT_DESC }) {
+            if (is_feature_set(supported_features, feature))
+                negotiated |= feature;
+        }
+        return negotiated;
+    }));
+    m_uses_indirect_descriptors = is_feature_accepted(VIRTIO_F_INDIRECT_DESC);
+    m_is_read_only = is_feature_accepted(VIRTIO_BLK_F_RO);
+
+    u64 capacity = 0;
+    u32 size_max = 0;
+    u32 seg_max = 0;
+    u16 num_queues = 1;
+    transport_entity().read_config_atomic([&]() {
+        capacity = transport_entity().config_read32(*m_device_config, offsetof(VirtIOBlockConfig, capacity))
+            | (static_cast<u64>(transport_entity().config_read32(*m_device_config, offsetof(VirtIOBlockConfig, capacity) + 4)) << 32);
+        if (is_feature_accepted(VIRTIO_BLK_F_SIZE_MAX))
+            size_max = transport_entity().config_read32(*m_device_config, offsetof(VirtIOBlockConfig, size_max));
+        if (is_feature_accepted(VIRTIO_BLK_F_SEG_MAX))
+            seg_max = transport_entity().config_read32(*m_device_config, offsetof(VirtIOBlockConfig, seg_max));
+        if (is_feature_accepted(VIRTIO_BLK_F_BLK_SIZE))
+            m_block_size = transport_entity().config_read32(*m_device_config, offsetof(VirtIOBlockConfig, blk_size));
+        if (is_feature_accepted(VIRTIO_BLK_F_MQ))
+            num_queues = max<u16>(1, transport_entity().config_read16(*m_device_config, offsetof(VirtIOBlockConfig, num_queues)));
+    });
+
+    if (m_block_size < VIRTIO_BLK_SECTOR_SIZE || m_block_size > PAGE_SIZE || !is_power_of_two(m_block_size)) {
+        dmesgln("{}: Unsupported block size {}", class_name(), m_block_size);
+        return ENOTSUP;
+    }
+    if (size_max != 0 && size_max < PAGE_SIZE) {
+        dmesgln("{}: Segments of at most {} bytes are not supported", class_name(), size_max);
+        return ENOTSUP;
+    }
+
+    // There's no point in having more queues than processors that could submit to them.
+    u16 queue_count = min<u16>(num_queues, Processor::count());
+    TRY(setup_queues(queue_count));
+
+    size_t pages_per_slot = max_pages_per_slot;
+    if (seg_max != 0)
+        pages_per_slot = clamp<size_t>(seg_max, 1, max_pages_per_slot);
+
+    for (u16 queue_index = 0; queue_index < queue_count; ++queue_index) {
+        // Without indirect descriptors, every part of a request takes up a descriptor in the queue itself.
+        size_t descriptors_per_slot = m_uses_indirect_descriptors ? 1 : pages_per_slot + 2;
+        size_t slot_count = min(max_slots_per_queue, get_queue(queue_index).size() / descriptors_per_slot);
+        if (slot_count == 0) {
+            dmesgln("{}: Queue {} is too small", class_name(), queue_index);
+            return ENOTSUP;
+        }
+        TRY(create_request_queue(queue_index, slot_count, pages_per_slot));
+    }
+
+    finish_init();
+
+    u64 block_count = capacity / (m_block_size / VIRTIO_BLK_SECTOR_SIZE);
+    dmesgln("{}: {} blocks of {} bytes, {} queue(s){}{}", class_name(), block_count, m_block_size, queue_count,
+        m_uses_indirect_descriptors ? ", indirect descriptors"sv : ""sv, m_is_read_only ? ", read-only"sv : ""sv);
+    m_device = TRY(VirtIOBlockDevice::try_create(*this, m_block_size, block_count));
+    return {};
+}
+
+UNMAP_AFTER_INIT ErrorOr<void> VirtIOBlockController::create_request_queue(u16 queue_index, size_t slot_count, size_t pages_per_slot)
+{
+    auto descriptor_region = TRY(MM.allocate_contiguous_kernel_region(TRY(Memory::page_round_up(slot_count * slot_descriptor_area_size)), "VirtIO Block Descriptors"sv, Memory::Region::Access::ReadWrite));
+    Vector<NonnullRefPtr<Memory::PhysicalPage>> data_pages;
+    auto data_region = TRY(MM.allocate_dma_buffer_pages(slot_count * pages_per_slot * PAGE_SIZE, "VirtIO Block DMA"sv, Memory::Region::Access::ReadWrite, data_pages));
+
+    auto queue = TRY(adopt_nonnull_own_or_enomem(new (nothrow) RequestQueue { queue_index, pages_per_slot, move(descriptor_region), move(data_region), move(data_pages), {}, {}, {}, {} }));
+    TRY(queue->slots.try_resize(slot_count));
+    TRY(queue->free_slots.try_ensure_capacity(slot_count));
+    for (size_t i = 0; i < slot_count; ++i)
+        queue->free_slots.unchecked_append(slot_count - i - 1);
+    TRY(m_request_queues.try_append(move(queue)));
+    return {};
+}
+
+ErrorOr<void> VirtIOBlockController::handle_device_config_change()
+{
+    // NOTE: The capacity may change (e.g. when the host resizes the image), but we don't support resizing storage devices.
+    dbgln_if(VIRTIO_DEBUG, "{}: Ignoring device configuration change", class_name());
+    return {};
+}
+
+bool VirtIOBlockController::try_merge_into_slot(RequestQueue& queue, Slot& slot, AsyncBlockDeviceRequest& request) const
+{
+    VERIFY(queue.lock.is_locked());
+    if (slot.requests.is_empty()) {
+        slot.requests.unchecked_append(request);
+        slot.first_block = request.block_index();
+        slot.byte_count = request.block_count() * m_block_size;
+        return true;
+    }
+
+    auto& first_request = *slot.requests.first();
+    if (slot.requests.size() == max_requests_per_slot || request.request_type() != first_request.request_type())
+        return false;
+    if (request.block_index() != slot.first_block + slot.byte_count / m_block_size)
+        return false;
+    size_t request_byte_count = request.block_count() * m_block_size;
+    if (slot.byte_count + request_byte_count > queue.pages_per_slot * PAGE_SIZE)
+        return false;
+
+    slot.requests.unchecked_append(request);
+    slot.byte_count += request_byte_count;
+    return true;
+}
+
+void VirtIOBlockController::start_request(Badge<VirtIOBlockDevice>, AsyncBlockDeviceRequest& request)
+{
+    if (request.request_type() == AsyncBlockDeviceRequest::Write && m_is_read_only) {
+        request.complete(AsyncDeviceRequest::Failure);
+        return;
+    }
+
+    auto& queue = *m_request_queues[Processor::current_id() % m_request_queues.size()];
+    VERIFY(request.block_count() * m_block_size <= queue.pages_per_slot * PAGE_SIZE);
+
+    Optional<u16> slot_index;
+    {
+        SpinlockLocker lock(queue.lock);
+        // Don't overtake requests that are already waiting for a free slot. Waiting here is also what gives
+        // requests for adjacent blocks the chance to be merged.
+        if (queue.pending_requests.is_empty() && !queue.free_slots.is_empty()) {
+            slot_index = queue.free_slots.take_last();
+            VERIFY(try_merge_into_slot(queue, queue.slots[slot_index.value()], request));
+        } else if (queue.pending_requests.try_append(request).is_error()) {
+            lock.unlock();
+            request.complete(AsyncDeviceRequest::OutOfMemory);
+            return;
+        }
+    }
+
+    if (slot_index.has_value())
+        submit_slot(queue, slot_index.value());
+}
+
+void VirtIOBlockController::submit_pending_requests(RequestQueue& queue)
+{
+    for (;;) {
+        u16 slot_index;
+        {
+            SpinlockLocker lock(queue.lock);
+            if (queue.pending_requests.is_empty() || queue.free_slots.is_empty())
+                return;
+            slot_index = queue.free_slots.take_last();
+            auto& slot = queue.slots[slot_index];
+            VERIFY(try_merge_into_slot(queue, slot, *queue.pending_requests.take_first()));
+
+            // Keep pulling in whatever continues where the slot currently ends.
+            bool merged_any;
+            do {
+                merged_any = false;
+                for (size_t i = 0; i < queue.pending_requests.size(); ++i) {
+                    if (try_merge_into_slot(queue, slot, *queue.pending_requests[i])) {
+                        queue.pending_requests.remove(i);
+                        merged_any = true;
+                        break;
+                    }
+                }
+            } while (merged_any);
+        }
+        submit_slot(queue, slot_index);
+    }
+}
+
+void VirtIOBlockController::submit_slot(RequestQueue& queue, u16 slot_index)
+{
+    auto& slot = queue.slots[slot_index];
+    auto type = slot.requests.first()->request_type();
+    auto* data = slot_data(queue, slot_index);
+
+    if (type == AsyncBlockDeviceRequest::Write) {
+        size_t offset = 0;
+        for (size_t i = 0; i < slot.requests.size(); ++i) {
+            auto& request = *slot.requests[i];
+            if (auto result = request.read_from_buffer(request.buffer(), data + offset, request.buffer_size()); result.is_error()) {
+                // Fail just this request, and let the others go again on their own.
+                Vector<NonnullLockRefPtr<AsyncBlockDeviceRequest>, max_requests_per_slot> requests;
+                release_slot(queue, slot_index, requests);
+                Vector<size_t, max_requests_per_slot> failed_requests;
+                failed_requests.unchecked_append(i);
+                {
+                    SpinlockLocker lock(queue.lock);
+                    for (size_t j = requests.size(); j > 0; --j) {
+                        if (j - 1 != i && queue.pending_requests.try_insert(0, requests[j - 1]).is_error())
+                            failed_requests.unchecked_append(j - 1);
+                    }
+                }
+                for (auto failed_request : failed_requests)
+                    requests[failed_request]->complete(failed_request == i ? AsyncDeviceRequest::MemoryFault : AsyncDeviceRequest::OutOfMemory);
+                submit_pending_requests(queue);
+                return;
+            }
+            offset += request.buffer_size();
+        }
+    }
+
+    auto* descriptor_area = queue.descriptor_region->vaddr().offset(slot_index * slot_descriptor_area_size).as_ptr();
+    auto descriptor_area_address = queue.descriptor_region->physical_page(0)->paddr().offset(slot_index * slot_descriptor_area_size);
+    auto& header = *reinterpret_cast<VirtIOBlockRequestHeader*>(descriptor_area + slot_header_offset);
+    header.type = type == AsyncBlockDeviceRequest::Read ? VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT;
+    header.reserved = 0;
+    header.sector = slot.first_block * (m_block_size / VIRTIO_BLK_SECTOR_SIZE);
+    descriptor_area[slot_status_offset] = 0xff;
+
+    // The device sees the data as one buffer per page, since the pages aren't physically contiguous.
+    size_t page_count = ceil_div(slot.byte_count, static_cast<size_t>(PAGE_SIZE));
+    size_t first_page = slot_index * queue.pages_per_slot;
+    auto data_buffer_type = type == AsyncBlockDeviceRequest::Read ? BufferType::DeviceWritable : BufferType::DeviceReadable;
+    auto page_length = [&](size_t page) { return min(PAGE_SIZE, slot.byte_count - page * PAGE_SIZE); };
+
+    dbgln_if(VIRTIO_DEBUG, "{}: Queue {} slot {}: {} requests, {} bytes at block {}", class_name(), queue.queue_index, slot_index, slot.requests.size(), slot.byte_count, slot.first_block);
+
+    auto& virtqueue = get_queue(queue.queue_index);
+    SpinlockLocker lock(virtqueue.lock());
+    QueueChain chain(virtqueue);
+    if (m_uses_indirect_descriptors) {
+        auto* table = reinterpret_cast<Queue::QueueDescriptor*>(descriptor_area);
+        size_t descriptor_count = page_count + 2;
+        auto set_descriptor = [&](size_t index, PhysicalAddress address, size_t length, BufferType buffer_type) {
+            table[index].address = address.get();
+            table[index].length = length;
+            table[index].flags = static_cast<u16>(buffer_type) | (index + 1 < descriptor_count ? VIRTQ_DESC_F_NEXT : 0);
+            table[index].next = index + 1 < descriptor_count ? index + 1 : 0;
+        };
+        set_descriptor(0, descriptor_area_address.offset(slot_header_offset), sizeof(VirtIOBlockRequestHeader), BufferType::DeviceReadable);
+        for (size_t page = 0; page < page_count; ++page)
+            set_descriptor(page + 1, queue.data_pages[first_page + page]->paddr(), page_length(page), data_buffer_type);
+        set_descriptor(page_count + 1, descriptor_area_address.offset(slot_status_offset), 1, BufferType::DeviceWritable);
+        VERIFY(chain.add_indirect_table_to_chain(descriptor_area_address, descriptor_count));
+    } else {
+        VERIFY(chain.add_buffer_to_chain(descriptor_area_address.offset(slot_header_offset), sizeof(VirtIOBlockRequestHeader), BufferType::DeviceReadable));
+        for (size_t page = 0; page < page_count; ++page)
+            VERIFY(chain.add_buffer_to_chain(queue.data_pages[first_page + page]->paddr(), page_length(page), data_buffer_type));
+        VERIFY(chain.add_buffer_to_chain(descriptor_area_address.offset(slot_status_offset), 1, BufferType::DeviceWritable));
+    }
+    full_memory_barrier();
+    supply_chain_and_notify(queue.queue_index, chain);
+}
+
+void VirtIOBlockController::handle_queue_update(u16 queue_index)
+{
+    // NOTE: Nothing can have completed before we've finished setting up all the request queues.
+    if (queue_index >= m_request_queues.size())
+        return;
+    auto& queue = *m_request_queues[queue_index];
+    auto& virtqueue = get_queue(queue_index);
+
+    Vector<u16, max_slots_per_queue> completed_slots;
+    {
+        SpinlockLocker lock(virtqueue.lock());
+        size_t used;
+        for (auto chain = virtqueue.pop_used_buffer_chain(used); !chain.is_empty(); chain = virtqueue.pop_used_buffer_chain(used)) {
+            // Both the indirect table and the header (for direct chains) live in the slot's descriptor area.
+            Optional<u16> slot_index;
+            chain.for_each([&](PhysicalAddress address, size_t) {
+                if (!slot_index.has_value())
+                    slot_index = (address.get() - queue.descriptor_region->physical_page(0)->paddr().get()) / slot_descriptor_area_size;
+            });
+            chain.release_buffer_slots_to_queue();
+            VERIFY(slot_index.has_value() && slot_index.value() < queue.slots.size());
+            completed_slots.append(slot_index.value());
+        }
+    }
+
+    for (auto slot_index : completed_slots) {
+        auto work_item_creation_result = g_io_work->try_queue([this, &queue, slot_index]() {
+            finish_slot(queue, slot_index);
+            // The completion freed up a slot, so requests that had to wait can go now.
+            submit_pending_requests(queue);
+        });
+        if (work_item_creation_result.is_error())
+            finish_slot(queue, slot_index, AsyncDeviceRequest::OutOfMemory);
+    }
+}
+
+void VirtIOBlockController::release_slot(RequestQueue& queue, u16 slot_index, Vector<NonnullLockRefPtr<AsyncBlockDeviceRequest>, max_requests_per_slot>& requests)
+{
+    SpinlockLocker lock(queue.lock);
+    auto& slot = queue.slots[slot_index];
+    requests = move(slot.requests);
+    slot.requests.clear();
+    slot.first_block = 0;
+    slot.byte_count = 0;
+    queue.free_slots.unchecked_append(slot_index);
+}
+
+void VirtIOBlockController::finish_slot(RequestQueue& queue, u16 slot_index, Optional<AsyncDeviceRequest::RequestResult> result_override)
+{
+    auto& slot = queue.slots[slot_index];
+    auto const* descriptor_area = queue.descriptor_region->vaddr().offset(slot_index * slot_descriptor_area_size).as_ptr();
+    u8 status = descriptor_area[slot_status_offset];
+
+    // NOTE: The slot stays taken while we copy the data out of its DMA buffer, so nobody can reuse it yet.
+    Vector<AsyncDeviceRequest::RequestResult, max_requests_per_slot> results;
+    auto const* data = slot_data(queue, slot_index);
+    size_t offset = 0;
+    for (auto& request : slot.requests) {
+        auto result = AsyncDeviceRequest::Success;
+        if (result_override.has_value()) {
+            result = result_override.value();
+        } else if (status != VIRTIO_BLK_S_OK) {
+            result = AsyncDeviceRequest::Failure;
+        } else if (request->request_type() == AsyncBlockDeviceRequest::Read) {
+            if (request->write_to_buffer(request->buffer(), data + offset, request->buffer_size()).is_error())
+                result = AsyncDeviceRequest::MemoryFault;
+        }
+        results.unchecked_append(result);
+        offset += request->buffer_size();
+    }
+    if (status != VIRTIO_BLK_S_OK)
+        dbgln("{}: Request for {} bytes at block {} failed with status {}", class_name(), slot.byte_count, slot.first_block, status);
+
+    Vector<NonnullLockRefPtr<AsyncBlockDeviceRequest>, max_requests_per_slot> requests;
+    release_slot(queue, slot_index, requests);
+    for (size_t i = 0; i < requests.size(); ++i)
+        requests[i]->complete(results[i]);
+}
+
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Badge.h>
+#include <AK/Vector.h>
+#include <Kernel/Bus/VirtIO/Device.h>
+#include <Kernel/Devices/BlockDevice.h>
+#include <Kernel/Devices/Storage/StorageController.h>
+#include <Kernel/Library/LockRefPtr.h>
+#include <Kernel/Locking/Spinlock.h>
+
+namespace Kernel {
+
+class VirtIOBlockDevice;
+class VirtIOBlockController final
+    : public StorageController
+    , public VirtIO::Device {
+public:
+    static bool probe(PCI::DeviceIdentifier const&);
+    static ErrorOr<NonnullRefPtr<VirtIOBlockController>> try_initialize(PCI::DeviceIdentifier const&);
+    virtual ~VirtIOBlockController() override = default;
+
+    // ^StorageController
+    virtual LockRefPtr<StorageDevice> device(u32 index) const override;
+    virtual size_t devices_count() const override { return m_device ? 1 : 0; }
+
+    // ^VirtIO::Device
+    virtual ErrorOr<void> initialize_virtio_resources() override;
+
+    void start_request(Badge<VirtIOBlockDevice>, AsyncBlockDeviceRequest&);
+
+protected:
+    // ^StorageController
+    virtual ErrorOr<void> reset() override { return ENOTIMPL; }
+    virtual ErrorOr<void> shutdown() override { return ENOTIMPL; }
+    virtual void complete_current_request(AsyncDeviceRequest::RequestResult) override { VERIFY_NOT_REACHED(); }
+
+private:
+    // Requests for adjacent blocks are merged into a single request to the device, as long as they fit into one slot.
+    static constexpr size_t max_pages_per_slot = 16;
+    static constexpr size_t max_requests_per_slot = 16;
+    static constexpr size_t max_slots_per_queue = 16;
+
+    // One device request in flight, made up of one or more merged block requests.
+    struct Slot {
+        Vector<NonnullLockRefPtr<AsyncBlockDeviceRequest>, max_requests_per_slot> requests;
+        u64 first_block { 0 };
+        size_t byte_count { 0 };
+    };
+
+    // Every processor submits to its own virtqueue, with its own set of slots and DMA buffers.
+    struct RequestQueue {
+        u16 queue_index { 0 };
+        size_t pages_per_slot { 0 };
+        NonnullOwnPtr<Memory::Region> descriptor_region;
+        NonnullOwnPtr<Memory::Region> data_region;
+        Vector<NonnullRefPtr<Memory::PhysicalPage>> data_pages;
+        Vector<Slot> slots;
+
+        Spinlock<LockRank::None> lock {};
+        Vector<u16> free_slots;
+        Vector<NonnullLockRefPtr<AsyncBlockDeviceRequest>> pending_requests;
+    };
+
+    VirtIOBlockController(NonnullOwnPtr<VirtIO::TransportEntity>, u32 hardware_relative_controller_id);
+
+    // ^VirtIO::Device
+    virtual StringView class_name() const override { return "VirtIOBlockController"sv; }
+    virtual ErrorOr<void> handle_device_config_change() override;
+    virtual void handle_queue_update(u16 queue_index) override;
+
+    ErrorOr<void> create_request_queue(u16 queue_index, size_t slot_count, size_t pages_per_slot);
+    bool try_merge_into_slot(RequestQueue&, Slot&, AsyncBlockDeviceRequest&) const;
+    void submit_slot(RequestQueue&, u16 slot_index);
+    void submit_pending_requests(RequestQueue&);
+    void finish_slot(RequestQueue&, u16 slot_index, Optional<AsyncDeviceRequest::RequestResult> result_override = {});
+    void release_slot(RequestQueue&, u16 slot_index, Vector<NonnullLockRefPtr<AsyncBlockDeviceRequest>, max_requests_per_slot>& requests);
+
+    u8* slot_data(RequestQueue& queue, u16 slot_index) const { return queue.data_region->vaddr().offset(slot_index * queue.pages_per_slot * PAGE_SIZE).as_ptr(); }
+
+    VirtIO::Configuration const* m_device_config { nullptr };
+    Vector<NonnullOwnPtr<RequestQueue>> m_request_queues;
+    LockRefPtr<VirtIOBlockDevice> m_device;
+    size_t m_block_size { 512 };
+    bool m_uses_indirect_descriptors { false };
+    bool m_is_read_only { false };
+};
+
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Devices/DeviceManagement.h>
+#include <Kernel/Devices/Storage/VirtIO/VirtIOBlockController.h>
+#include <Kernel/Devices/Storage/VirtIO/VirtIOBlockDevice.h>
+
+namespace Kernel {
+
+UNMAP_AFTER_INIT ErrorOr<NonnullLockRefPtr<VirtIOBlockDevice>> VirtIOBlockDevice::try_create(VirtIOBlockController& controller, size_t block_size, u64 block_count)
+{
+    return TRY(DeviceManagement::try_create_device<VirtIOBlockDevice>(StorageDevice::LUNAddress { controller.controller_id(), 0, 0 }, controller.hardware_relative_controller_id(), controller, block_size, block_count));
+}
+
+UNMAP_AFTER_INIT VirtIOBlockDevice::VirtIOBlockDevice(LUNAddress logical_unit_number_address, u32 hardware_relative_controller_id, VirtIOBlockController& controller, size_t block_size, u64 block_count)
+    : StorageDevice(logical_unit_number_address, hardware_relative_controller_id, block_size, block_count)
+    , m_controller(controller)
+{
+}
+
+void VirtIOBlockDevice::start_request(AsyncBlockDeviceRequest& request)
+{
+    m_controller.start_request({}, request);
+}
+
+}
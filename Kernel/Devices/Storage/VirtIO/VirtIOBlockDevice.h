@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/Devices/Storage/StorageDevice.h>
+#include <Kernel/Library/NonnullLockRefPtr.h>
+
+namespace Kernel {
+
+class VirtIOBlockController;
+class VirtIOBlockDevice final : public StorageDevice {
+    friend class DeviceManagement;
+
+public:
+    static ErrorOr<NonnullLockRefPtr<VirtIOBlockDevice>> try_create(VirtIOBlockController&, size_t block_size, u64 block_count);
+
+    virtual CommandSet command_set() const override { return CommandSet::VirtIO; }
+    virtual void start_request(AsyncBlockDeviceRequest&) override;
+    virtual bool can_process_requests_concurrently() const override { return true; }
+
+private:
+    VirtIOBlockDevice(LUNAddress, u32 hardware_relative_controller_id, VirtIOBlockController&, size_t block_size, u64 block_count);
+
+    // NOTE: Storage controllers are never destroyed, so we don't need to keep ours alive.
+    VirtIOBlockController& m_controller;
+};
+
+}
@@ -6,51 +6,128 @@
 
 #include <AK/IntrusiveList.h>
 #include <Kernel/Debug.h>
+#include <Kernel/Devices/BlockDevice.h>
 #include <Kernel/FileSystem/BlockBasedFileSystem.h>
+#include <Kernel/Memory/MemoryManager.h>
 #include <Kernel/Tasks/Process.h>
 
 namespace Kernel {
 
+class DiskCacheSegment;
+
 struct CacheEntry {
+    // The queues of the 2Q replacement policy (plus the free list) an entry can be on.
+    enum class Queue : u8 {
+        Free,
+        RecentlyUsed,
+        FrequentlyUsed,
+    };
+
     IntrusiveListNode<CacheEntry> list_node;
+    IntrusiveListNode<CacheEntry> dirty_list_node;
     BlockBasedFileSystem::BlockIndex block_index { 0 };
     u8* data { nullptr };
+    DiskCacheSegment* segment { nullptr };
+    Queue queue { Queue::Free };
     bool has_data { false };
 };
 
-class DiskCache {
+// The cache grows and shrinks in segments of a fixed number of entries, each backed
+// by its own pair of KBuffers, so that memory can be handed back under pressure.
+class DiskCacheSegment {
 public:
-    static constexpr size_t EntryCount = 10000;
-    explicit DiskCache(BlockBasedFileSystem& fs, NonnullOwnPtr<KBuffer> cached_block_data, NonnullOwnPtr<KBuffer> entries_buffer)
-        : m_fs(fs)
-        , m_cached_block_data(move(cached_block_data))
+    static constexpr size_t entry_count = 1024;
+
+    static ErrorOr<NonnullOwnPtr<DiskCacheSegment>> try_create(size_t block_size)
+    {
+        auto cached_block_data = TRY(KBuffer::try_create_with_size("BlockBasedFS: Cache blocks"sv, entry_count * block_size));
+        auto entries_data = TRY(KBuffer::try_create_with_size("BlockBasedFS: Cache entries"sv, entry_count * sizeof(CacheEntry)));
+        return adopt_nonnull_own_or_enomem(new (nothrow) DiskCacheSegment(block_size, move(cached_block_data), move(entries_data)));
+    }
+
+    ~DiskCacheSegment()
+    {
+        for (size_t i = 0; i < entry_count; ++i)
+            entries()[i].~CacheEntry();
+    }
+
+    CacheEntry* entries() { return (CacheEntry*)m_entries->data(); }
+
+    IntrusiveListNode<DiskCacheSegment> list_node;
+
+private:
+    DiskCacheSegment(size_t block_size, NonnullOwnPtr<KBuffer> cached_block_data, NonnullOwnPtr<KBuffer> entries_buffer)
+        : m_cached_block_data(move(cached_block_data))
         , m_entries(move(entries_buffer))
     {
-        for (size_t i = 0; i < EntryCount; ++i) {
-            entries()[i].data = m_cached_block_data->data() + i * m_fs->logical_block_size();
-            m_clean_list.append(entries()[i]);
+        for (size_t i = 0; i < entry_count; ++i) {
+            auto* entry = new (&entries()[i]) CacheEntry;
+            entry->data = m_cached_block_data->data() + i * block_size;
+            entry->segment = this;
         }
     }
 
-    ~DiskCache() = default;
+    NonnullOwnPtr<KBuffer> m_cached_block_data;
+    NonnullOwnPtr<KBuffer> m_entries;
+};
+
+// DiskCache implements the "2Q" replacement policy (Johnson & Shasha, 1994):
+// Blocks seen for the first time enter a FIFO of recently used blocks. Only blocks that
+// are requested again after having fallen out of that FIFO (which we remember in a queue
+// of "ghost" block indices) are promoted into an LRU list of frequently used blocks.
+// This keeps a single large sequential scan from flushing out the working set.
+class DiskCache {
+public:
+    // We never go below the 10000 entries the cache used to have before it could grow and shrink.
+    static constexpr size_t minimum_entry_count = 10000;
+    static constexpr size_t minimum_segment_count = ceil_div(minimum_entry_count, DiskCacheSegment::entry_count);
+
+    static ErrorOr<NonnullOwnPtr<DiskCache>> try_create(BlockBasedFileSystem& fs)
+    {
+        auto cache = TRY(adopt_nonnull_own_or_enomem(new (nothrow) DiskCache(fs)));
+        for (size_t i = 0; i < minimum_segment_count; ++i)
+            TRY(cache->try_grow());
+        return cache;
+    }
+
+    ~DiskCache()
+    {
+        // NOTE: Outstanding read-aheads write into buffers we own, so we have to let them finish first.
+        VERIFY(m_waited_for_read_aheads.is_empty());
+        while (auto* read_ahead = m_pending_read_aheads.take_first())
+            m_abandoned_read_aheads.append(*read_ahead);
+        while (auto* read_ahead = m_abandoned_read_aheads.take_first()) {
+            while (!read_ahead->request->is_completed())
+                (void)read_ahead->request->wait();
+            delete read_ahead;
+        }
+
+        // NOTE: The lists must be emptied before the segments holding their entries are destroyed.
+        m_dirty_list.clear();
+        m_free_list.clear();
+        m_recently_used_list.clear();
+        m_frequently_used_list.clear();
+        while (auto* segment = m_segments.take_first())
+            delete segment;
+    }
 
     bool is_dirty() const { return !m_dirty_list.is_empty(); }
-    bool entry_is_dirty(CacheEntry const& entry) const { return m_dirty_list.contains(entry); }
+    bool entry_is_dirty(CacheEntry const& entry) const { return entry.dirty_list_node.is_in_list(); }
 
     void mark_all_clean()
     {
-        while (auto* entry = m_dirty_list.first())
-            m_clean_list.prepend(*entry);
+        m_dirty_list.clear();
     }
 
     void mark_dirty(CacheEntry& entry)
     {
-        m_dirty_list.prepend(entry);
+        if (!entry_is_dirty(entry))
+            m_dirty_list.append(entry);
     }
 
     void mark_clean(CacheEntry& entry)
     {
-        m_clean_list.prepend(entry);
+        m_dirty_list.remove(entry);
     }
 
     CacheEntry* get(BlockBasedFileSystem::BlockIndex block_index) const
@@ -60,59 +137,475 @@ public:
             return nullptr;
         auto& entry = const_cast<CacheEntry&>(*it->value);
         VERIFY(entry.block_index == block_index);
-        if (!entry_is_dirty(entry) && (m_clean_list.first() != &entry)) {
-            // Cache hit! Promote the entry to the front of the list.
-            m_clean_list.prepend(entry);
+        if (entry.queue == CacheEntry::Queue::FrequentlyUsed && m_frequently_used_list.first() != &entry) {
+            // Cache hit! Promote the entry to the front of the LRU list.
+            m_frequently_used_list.prepend(entry);
         }
         return &entry;
     }
 
     ErrorOr<CacheEntry*> ensure(BlockBasedFileSystem::BlockIndex block_index) const
     {
-        if (auto* entry = get(block_index))
+        if (auto* entry = get(block_index)) {
+            ++m_statistics.hits;
             return entry;
+        }
+
+        ++m_statistics.misses;
+        return allocate_entry(block_index);
+    }
+
+    bool contains(BlockBasedFileSystem::BlockIndex block_index) const
+    {
+        return m_hash.contains(block_index);
+    }
 
-        if (m_clean_list.is_empty()) {
+    template<typename Callback>
+    void for_each_dirty_entry(Callback callback)
+    {
+        for (auto& entry : m_dirty_list)
+            callback(entry);
+    }
+
+    bool can_start_read_ahead() const { return m_pending_read_ahead_blocks * m_fs->logical_block_size() < maximum_pending_read_ahead_bytes; }
+
+    bool is_read_ahead_pending(BlockBasedFileSystem::BlockIndex block_index) const
+    {
+        if (find_pending_read_ahead(block_index))
+            return true;
+        for (auto& read_ahead : m_waited_for_read_aheads) {
+            if (read_ahead.contains(block_index))
+                return true;
+        }
+        return false;
+    }
+
+    ErrorOr<void> start_read_ahead(BlockDevice& device, BlockBasedFileSystem::BlockIndex first_block, size_t block_count)
+    {
+        auto buffer = TRY(ByteBuffer::create_uninitialized(block_count * m_fs->logical_block_size()));
+        auto read_ahead = TRY(adopt_nonnull_own_or_enomem(new (nothrow) PendingReadAhead(first_block, block_count, move(buffer))));
+        auto device_blocks_per_block = m_fs->logical_block_size() / device.block_size();
+        auto data_buffer = UserOrKernelBuffer::for_kernel_buffer(read_ahead->buffer.data());
+        read_ahead->request = TRY(device.try_make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Read,
+            first_block.value() * device_blocks_per_block, block_count * device_blocks_per_block, data_buffer, read_ahead->buffer.size()));
+        m_pending_read_aheads.append(*read_ahead.leak_ptr());
+        m_pending_read_ahead_blocks += block_count;
+        return {};
+    }
+
+    // Hands out the read-ahead covering the given block (if any), so that it can be waited for without holding
+    // the cache lock. It has to be given back to complete_read_ahead() once the wait is over.
+    AsyncBlockDeviceRequest* take_read_ahead(BlockBasedFileSystem::BlockIndex block_index)
+    {
+        auto* read_ahead = find_pending_read_ahead(block_index);
+        if (!read_ahead)
+            return nullptr;
+        m_pending_read_aheads.remove(*read_ahead);
+        m_pending_read_ahead_blocks -= read_ahead->block_count;
+        m_waited_for_read_aheads.append(*read_ahead);
+        return read_ahead->request.ptr();
+    }
+
+    // Moves all of the blocks a read-ahead handed out by take_read_ahead() read into the cache.
+    void complete_read_ahead(AsyncBlockDeviceRequest& request, AsyncDeviceRequest::RequestWaitResult const& result)
+    {
+        PendingReadAhead* read_ahead = nullptr;
+        for (auto& waited_for_read_ahead : m_waited_for_read_aheads) {
+            if (waited_for_read_ahead.request.ptr() == &request) {
+                read_ahead = &waited_for_read_ahead;
+                break;
+            }
+        }
+        VERIFY(read_ahead);
+        m_waited_for_read_aheads.remove(*read_ahead);
+
+        if (result.wait_result().was_interrupted()) {
+            // The device may still write into the buffer, so keep it alive until the request is done.
+            m_abandoned_read_aheads.append(*read_ahead);
+            return;
+        }
+
+        if (result.request_result() == AsyncDeviceRequest::Success && !read_ahead->is_abandoned)
+            install_read_ahead(*read_ahead);
+        delete read_ahead;
+    }
+
+    // Makes sure data from a read-ahead that was started before the given block was written never ends up in the cache.
+    void abandon_read_ahead(BlockBasedFileSystem::BlockIndex block_index)
+    {
+        // Whoever is waiting for these cleans up after them.
+        for (auto& read_ahead : m_waited_for_read_aheads) {
+            if (read_ahead.contains(block_index))
+                read_ahead.is_abandoned = true;
+        }
+
+        auto* read_ahead = find_pending_read_ahead(block_index);
+        if (!read_ahead)
+            return;
+        m_pending_read_aheads.remove(*read_ahead);
+        m_pending_read_ahead_blocks -= read_ahead->block_count;
+        m_abandoned_read_aheads.append(*read_ahead);
+    }
+
+    // Moves the blocks of every read-ahead that has finished into the cache, so that neither their buffers nor
+    // their share of the read-ahead budget stay tied up until someone happens to read one of their blocks.
+    void reap_completed_read_aheads()
+    {
+        for (auto it = m_pending_read_aheads.begin(); it != m_pending_read_aheads.end();) {
+            auto& read_ahead = *it;
+            ++it;
+            if (!read_ahead.request->is_completed())
+                continue;
+            m_pending_read_aheads.remove(read_ahead);
+            m_pending_read_ahead_blocks -= read_ahead.block_count;
+            // NOTE: This doesn't block, as the request has completed already.
+            if (read_ahead.request->wait().request_result() == AsyncDeviceRequest::Success)
+                install_read_ahead(read_ahead);
+            delete &read_ahead;
+        }
+        for (auto it = m_abandoned_read_aheads.begin(); it != m_abandoned_read_aheads.end();) {
+            auto& read_ahead = *it;
+            ++it;
+            if (read_ahead.request->is_completed()) {
+                m_abandoned_read_aheads.remove(read_ahead);
+                delete &read_ahead;
+            }
+        }
+    }
+
+    ErrorOr<CacheEntry*> allocate_entry(BlockBasedFileSystem::BlockIndex block_index) const
+    {
+        auto* new_entry = m_free_list.first();
+        if (!new_entry && should_grow() && !const_cast<DiskCache*>(this)->try_grow().is_error())
+            new_entry = m_free_list.first();
+        if (!new_entry)
+            new_entry = evict_one();
+
+        if (!new_entry) {
             // Not a single clean entry! Flush writes and try again.
             // NOTE: We want to make sure we only call FileBackedFileSystem flush here,
             //       not some FileBackedFileSystem subclass flush!
             m_fs->flush_writes_impl();
-            return ensure(block_index);
+            return allocate_entry(block_index);
         }
 
-        VERIFY(m_clean_list.last());
-        auto& new_entry = *m_clean_list.last();
-        m_clean_list.prepend(new_entry);
+        TRY(m_hash.try_set(block_index, new_entry));
 
-        m_hash.remove(new_entry.block_index);
-        TRY(m_hash.try_set(block_index, &new_entry));
+        new_entry->block_index = block_index;
+        new_entry->has_data = false;
 
-        new_entry.block_index = block_index;
-        new_entry.has_data = false;
+        if (forget_ghost(block_index)) {
+            ++m_statistics.ghost_hits;
+            move_to_queue(*new_entry, CacheEntry::Queue::FrequentlyUsed);
+        } else {
+            move_to_queue(*new_entry, CacheEntry::Queue::RecentlyUsed);
+        }
+        return new_entry;
+    }
 
-        return &new_entry;
+    // Gives back segments above the minimum size one at a time, until there is spare memory again.
+    // Returns the number of entries that were released.
+    size_t release_segments()
+    {
+        size_t released_entries = 0;
+        while (m_segment_count > minimum_segment_count) {
+            if (!release_last_segment())
+                break;
+            released_entries += DiskCacheSegment::entry_count;
+            if (MM.has_spare_memory_for_caches())
+                break;
+        }
+        m_statistics.capacity = capacity();
+        trim_ghosts();
+        return released_entries;
     }
 
-    CacheEntry const* entries() const { return (CacheEntry const*)m_entries->data(); }
-    CacheEntry* entries() { return (CacheEntry*)m_entries->data(); }
+    BlockBasedFileSystem::CacheStatistics const& statistics() const { return m_statistics; }
 
-    template<typename Callback>
-    void for_each_dirty_entry(Callback callback)
+private:
+    struct PendingReadAhead {
+        PendingReadAhead(BlockBasedFileSystem::BlockIndex first_block, size_t block_count, ByteBuffer buffer)
+            : first_block(first_block)
+            , block_count(block_count)
+            , buffer(move(buffer))
+        {
+        }
+
+        bool contains(BlockBasedFileSystem::BlockIndex block_index) const
+        {
+            return block_index >= first_block && block_index.value() < first_block.value() + block_count;
+        }
+
+        IntrusiveListNode<PendingReadAhead> list_node;
+        BlockBasedFileSystem::BlockIndex first_block;
+        size_t block_count { 0 };
+        ByteBuffer buffer;
+        // Set when one of the blocks was written while someone was waiting for the read-ahead.
+        bool is_abandoned { false };
+        LockRefPtr<AsyncBlockDeviceRequest> request;
+    };
+
+    // Enough for two of the largest read-ahead windows (see OpenFileDescription::update_read_ahead_state()).
+    static constexpr size_t maximum_pending_read_ahead_bytes = 1 * MiB;
+
+    void install_read_ahead(PendingReadAhead& read_ahead)
     {
-        for (auto& entry : m_dirty_list)
-            callback(entry);
+        for (size_t i = 0; i < read_ahead.block_count; ++i) {
+            BlockBasedFileSystem::BlockIndex block { read_ahead.first_block.value() + i };
+            if (contains(block))
+                continue;
+            auto entry_or_error = allocate_entry(block);
+            if (entry_or_error.is_error())
+                break;
+            auto* entry = entry_or_error.release_value();
+            memcpy(entry->data, read_ahead.buffer.data() + i * m_fs->logical_block_size(), m_fs->logical_block_size());
+            entry->has_data = true;
+            ++m_statistics.read_ahead_blocks;
+        }
+    }
+
+    PendingReadAhead* find_pending_read_ahead(BlockBasedFileSystem::BlockIndex block_index) const
+    {
+        for (auto& read_ahead : m_pending_read_aheads) {
+            if (read_ahead.contains(block_index))
+                return &read_ahead;
+        }
+        return nullptr;
+    }
+
+    explicit DiskCache(BlockBasedFileSystem& fs)
+        : m_fs(fs)
+    {
+        // Don't let the cache of a single filesystem grow beyond an eighth of physical memory.
+        auto physical_memory_size = MM.get_system_memory_info().physical_pages * PAGE_SIZE;
+        m_maximum_segment_count = max(minimum_segment_count, physical_memory_size / 8 / (DiskCacheSegment::entry_count * m_fs->logical_block_size()));
+        m_statistics.maximum_capacity = m_maximum_segment_count * DiskCacheSegment::entry_count;
+    }
+
+    size_t capacity() const { return m_segment_count * DiskCacheSegment::entry_count; }
+
+    // A quarter of the cache is reserved for blocks that have only been seen once,
+    // and we remember as many evicted blocks as fit into half of the cache.
+    size_t recently_used_target() const { return capacity() / 4; }
+    size_t ghost_capacity() const { return capacity() / 2; }
+
+    bool should_grow() const
+    {
+        if (m_segment_count >= m_maximum_segment_count)
+            return false;
+        return MM.has_spare_memory_for_caches();
+    }
+
+    ErrorOr<void> try_grow()
+    {
+        auto segment = TRY(DiskCacheSegment::try_create(m_fs->logical_block_size()));
+        for (size_t i = 0; i < DiskCacheSegment::entry_count; ++i)
+            m_free_list.append(segment->entries()[i]);
+        m_segments.append(*segment.leak_ptr());
+        ++m_segment_count;
+        m_statistics.capacity = capacity();
+        TRY(m_ghost_ring.try_resize(ghost_capacity()));
+        return {};
+    }
+
+    void move_to_queue(CacheEntry& entry, CacheEntry::Queue queue) const
+    {
+        remove_from_queue(entry);
+        entry.queue = queue;
+        switch (queue) {
+        case CacheEntry::Queue::Free:
+            m_free_list.append(entry);
+            break;
+        case CacheEntry::Queue::RecentlyUsed:
+            m_recently_used_list.prepend(entry);
+            ++m_recently_used_count;
+            break;
+        case CacheEntry::Queue::FrequentlyUsed:
+            m_frequently_used_list.prepend(entry);
+            ++m_frequently_used_count;
+            break;
+        }
+    }
+
+    void remove_from_queue(CacheEntry& entry) const
+    {
+        if (entry.queue == CacheEntry::Queue::RecentlyUsed)
+            --m_recently_used_count;
+        else if (entry.queue == CacheEntry::Queue::FrequentlyUsed)
+            --m_frequently_used_count;
+        entry.list_node.remove();
+        entry.queue = CacheEntry::Queue::Free;
+    }
+
+    static CacheEntry* find_clean_entry_from_back(IntrusiveList<&CacheEntry::list_node>& list)
+    {
+        for (auto it = list.rbegin(); it != list.rend(); ++it) {
+            if (!it->dirty_list_node.is_in_list())
+                return &*it;
+        }
+        return nullptr;
+    }
+
+    CacheEntry* evict_one() const
+    {
+        CacheEntry* victim = nullptr;
+        bool victim_was_recently_used = false;
+        if (m_recently_used_count > recently_used_target()) {
+            victim = find_clean_entry_from_back(m_recently_used_list);
+            victim_was_recently_used = victim != nullptr;
+        }
+        if (!victim)
+            victim = find_clean_entry_from_back(m_frequently_used_list);
+        if (!victim) {
+            victim = find_clean_entry_from_back(m_recently_used_list);
+            victim_was_recently_used = victim != nullptr;
+        }
+        if (!victim)
+            return nullptr;
+
+        ++m_statistics.evictions;
+        m_hash.remove(victim->block_index);
+        if (victim_was_recently_used)
+            remember_ghost(victim->block_index);
+        move_to_queue(*victim, CacheEntry::Queue::Free);
+        return victim;
+    }
+
+    void remember_ghost(BlockBasedFileSystem::BlockIndex block_index) const
+    {
+        if (m_ghost_ring.is_empty())
+            return;
+        auto slot = m_next_ghost_slot++ % m_ghost_ring.size();
+        auto previous = m_ghost_ring[slot];
+        if (auto it = m_ghosts.find(previous); it != m_ghosts.end() && it->value == slot)
+            m_ghosts.remove(it);
+        m_ghost_ring[slot] = block_index;
+        // NOTE: If we can't remember the block, we'll simply treat it as a new one should it come back.
+        (void)m_ghosts.try_set(block_index, slot);
+    }
+
+    bool forget_ghost(BlockBasedFileSystem::BlockIndex block_index) const
+    {
+        return m_ghosts.remove(block_index);
+    }
+
+    void trim_ghosts()
+    {
+        m_ghost_ring.shrink(ghost_capacity());
+        m_ghosts.remove_all_matching([&](auto&, auto slot) { return slot >= m_ghost_ring.size(); });
+        m_next_ghost_slot = 0;
+    }
+
+    ErrorOr<void> write_entry_to_disk(CacheEntry& entry)
+    {
+        auto base_offset = entry.block_index.value() * m_fs->logical_block_size();
+        auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
+        auto nwritten = TRY(m_fs->file_description().write(base_offset, entry_data_buffer, m_fs->logical_block_size()));
+        if (nwritten != m_fs->logical_block_size())
+            return EIO;
+        return {};
+    }
+
+    // Finds an entry outside of the given segment that a block can be moved into, evicting a clean block
+    // that has only been seen once if there's no free entry. Frequently used blocks are never displaced.
+    CacheEntry* find_relocation_target(DiskCacheSegment const& segment)
+    {
+        for (auto& entry : m_free_list) {
+            if (entry.segment != &segment)
+                return &entry;
+        }
+        for (auto it = m_recently_used_list.rbegin(); it != m_recently_used_list.rend(); ++it) {
+            if (it->segment == &segment || entry_is_dirty(*it))
+                continue;
+            auto& victim = *it;
+            ++m_statistics.evictions;
+            m_hash.remove(victim.block_index);
+            remember_ghost(victim.block_index);
+            move_to_queue(victim, CacheEntry::Queue::Free);
+            return &victim;
+        }
+        return nullptr;
+    }
+
+    // Empties the last segment and frees it. Frequently used and dirty blocks are moved into other segments
+    // where possible, at the expense of blocks that have only been seen once. Blocks that have to go are
+    // written out first if dirty, and if that fails, the segment is kept so that the data isn't lost.
+    bool release_last_segment()
+    {
+        auto* segment = m_segments.last();
+        VERIFY(segment);
+        auto const block_size = m_fs->logical_block_size();
+
+        for (size_t i = 0; i < DiskCacheSegment::entry_count; ++i) {
+            auto& entry = segment->entries()[i];
+            if (entry.queue == CacheEntry::Queue::Free)
+                continue;
+
+            bool is_dirty = entry_is_dirty(entry);
+            if (entry.queue == CacheEntry::Queue::FrequentlyUsed || is_dirty) {
+                if (auto* target = find_relocation_target(*segment)) {
+                    memcpy(target->data, entry.data, block_size);
+                    target->block_index = entry.block_index;
+                    target->has_data = entry.has_data;
+                    m_hash.find(entry.block_index)->value = target;
+                    move_to_queue(*target, entry.queue);
+                    if (is_dirty) {
+                        mark_clean(entry);
+                        mark_dirty(*target);
+                    }
+                    move_to_queue(entry, CacheEntry::Queue::Free);
+                    continue;
+                }
+            }
+
+            if (is_dirty) {
+                if (auto result = write_entry_to_disk(entry); result.is_error()) {
+                    dbgln("{}: Keeping cache segment, failed to write back block {}: {}", m_fs->class_name(), entry.block_index, result.error());
+                    return false;
+                }
+                mark_clean(entry);
+            }
+            m_hash.remove(entry.block_index);
+            if (entry.queue == CacheEntry::Queue::RecentlyUsed)
+                remember_ghost(entry.block_index);
+            move_to_queue(entry, CacheEntry::Queue::Free);
+        }
+
+        for (size_t i = 0; i < DiskCacheSegment::entry_count; ++i)
+            remove_from_queue(segment->entries()[i]);
+        m_segments.remove(*segment);
+        delete segment;
+        --m_segment_count;
+        return true;
     }
 
-private:
     mutable NonnullRefPtr<BlockBasedFileSystem> m_fs;
-    NonnullOwnPtr<KBuffer> m_cached_block_data;
 
-    // NOTE: m_entries must be declared before m_dirty_list and m_clean_list because their entries are allocated from it.
-    // We need to ensure that the destructors of m_dirty_list and m_clean_list are called before m_entries is destroyed.
-    NonnullOwnPtr<KBuffer> m_entries;
-    mutable IntrusiveList<&CacheEntry::list_node> m_dirty_list;
-    mutable IntrusiveList<&CacheEntry::list_node> m_clean_list;
+    // NOTE: m_segments must be declared before the entry lists because their entries are allocated from it.
+    // We need to ensure that the destructors of the entry lists are called before the segments are destroyed.
+    IntrusiveList<&DiskCacheSegment::list_node> m_segments;
+    size_t m_segment_count { 0 };
+    size_t m_maximum_segment_count { 0 };
+
+    mutable IntrusiveList<&CacheEntry::dirty_list_node> m_dirty_list;
+    mutable IntrusiveList<&CacheEntry::list_node> m_free_list;
+    mutable IntrusiveList<&CacheEntry::list_node> m_recently_used_list;
+    mutable IntrusiveList<&CacheEntry::list_node> m_frequently_used_list;
+    mutable size_t m_recently_used_count { 0 };
+    mutable size_t m_frequently_used_count { 0 };
     mutable HashMap<BlockBasedFileSystem::BlockIndex, CacheEntry*> m_hash;
+
+    mutable Vector<BlockBasedFileSystem::BlockIndex> m_ghost_ring;
+    mutable size_t m_next_ghost_slot { 0 };
+    mutable HashMap<BlockBasedFileSystem::BlockIndex, size_t> m_ghosts;
+
+    mutable IntrusiveList<&PendingReadAhead::list_node> m_pending_read_aheads;
+    IntrusiveList<&PendingReadAhead::list_node> m_abandoned_read_aheads;
+    // Read-aheads someone is waiting for without holding the cache lock.
+    IntrusiveList<&PendingReadAhead::list_node> m_waited_for_read_aheads;
+    size_t m_pending_read_ahead_blocks { 0 };
+
+    mutable BlockBasedFileSystem::CacheStatistics m_statistics;
 };
 
 BlockBasedFileSystem::BlockBasedFileSystem(OpenFileDescription& file_description)
@@ -136,9 +629,7 @@ ErrorOr<void> BlockBasedFileSystem::initialize_while_locked()
     VERIFY(m_lock.is_locked());
     VERIFY(!is_initialized_while_locked());
     VERIFY(logical_block_size() != 0);
-    auto cached_block_data = TRY(KBuffer::try_create_with_size("BlockBasedFS: Cache blocks"sv, DiskCache::EntryCount * logical_block_size()));
-    auto entries_data = TRY(KBuffer::try_create_with_size("BlockBasedFS: Cache entries"sv, DiskCache::EntryCount * sizeof(CacheEntry)));
-    auto disk_cache = TRY(adopt_nonnull_own_or_enomem(new (nothrow) DiskCache(*this, move(cached_block_data), move(entries_data))));
+    auto disk_cache = TRY(DiskCache::try_create(*this));
 
     m_cache.with_exclusive([&](auto& cache) {
         cache = move(disk_cache);
@@ -160,11 +651,16 @@ ErrorOr<void> BlockBasedFileSystem::write_block(BlockIndex index, UserOrKernelBu
     TRY(data.read(buffered_data.bytes()));
 
     return m_cache.with_exclusive([&](auto& cache) -> ErrorOr<void> {
+        cache->abandon_read_ahead(index);
+
         if (!allow_cache) {
             flush_specific_block_if_needed(index);
             u64 base_offset = index.value() * logical_block_size() + offset;
             auto nwritten = TRY(file_description().write(base_offset, data, count));
             VERIFY(nwritten == count);
+            // Don't leave a stale copy of the block behind for cached readers.
+            if (auto* entry = cache->get(index); entry && entry->has_data)
+                memcpy(entry->data + offset, buffered_data.data(), count);
             return {};
         }
 
@@ -233,8 +729,27 @@ ErrorOr<void> BlockBasedFileSystem::read_block(BlockIndex index, UserOrKernelBuf
     VERIFY(offset + count <= logical_block_size());
     dbgln_if(BBFS_DEBUG, "BlockBasedFileSystem::read_block {}", index);
 
+    // If the block is being read ahead, wait for that to finish. We don't need the cache for this, so we let go
+    // of it while the device does its thing.
+    auto* read_ahead_request = m_cache.with_exclusive([&](auto& cache) -> AsyncBlockDeviceRequest* {
+        return cache->contains(index) ? nullptr : cache->take_read_ahead(index);
+    });
+    if (read_ahead_request) {
+        auto result = read_ahead_request->wait();
+        m_cache.with_exclusive([&](auto& cache) {
+            cache->complete_read_ahead(*read_ahead_request, result);
+        });
+    }
+
     return m_cache.with_exclusive([&](auto& cache) -> ErrorOr<void> {
         if (!allow_cache) {
+            // Uncached readers keep the data elsewhere (e.g. in an inode's page cache), but there's no
+            // point in going to the device for a block we already have or have just read ahead.
+            if (auto* entry = cache->get(index); entry && entry->has_data) {
+                if (buffer)
+                    TRY(buffer->write(entry->data + offset, count));
+                return {};
+            }
             const_cast<BlockBasedFileSystem*>(this)->flush_specific_block_if_needed(index);
             u64 base_offset = index.value() * logical_block_size() + offset;
             auto nread = TRY(file_description().read(*buffer, base_offset, count));
@@ -272,6 +787,50 @@ ErrorOr<void> BlockBasedFileSystem::read_blocks(BlockIndex index, unsigned count
     return {};
 }
 
+size_t BlockBasedFileSystem::read_ahead_blocks(ReadonlySpan<BlockIndex> blocks) const
+{
+    // NOTE: Read-ahead talks to the device directly so the requests can be in flight
+    //       while we return to the reader. For anything else, just don't bother.
+    if (!file_description().file().is_block_device())
+        return 0;
+    auto& device = static_cast<BlockDevice&>(file_description().file());
+    if (logical_block_size() % device.block_size() != 0)
+        return 0;
+
+    // FIXME: The storage drivers only accept requests of up to PAGE_SIZE bytes for now.
+    size_t const maximum_blocks_per_request = max<size_t>(1, PAGE_SIZE / logical_block_size());
+
+    return m_cache.with_exclusive([&](auto& cache) -> size_t {
+        if (!cache)
+            return 0;
+        cache->reap_completed_read_aheads();
+
+        auto should_read = [&](BlockIndex index) {
+            return index.value() != 0 && !cache->contains(index) && !cache->is_read_ahead_pending(index);
+        };
+
+        size_t i = 0;
+        while (i < blocks.size()) {
+            if (!should_read(blocks[i])) {
+                ++i;
+                continue;
+            }
+            if (!cache->can_start_read_ahead())
+                break;
+            size_t run_length = 1;
+            while (i + run_length < blocks.size() && run_length < maximum_blocks_per_request
+                && blocks[i + run_length].value() == blocks[i].value() + run_length && should_read(blocks[i + run_length]))
+                ++run_length;
+            if (auto result = cache->start_read_ahead(device, blocks[i], run_length); result.is_error()) {
+                dbgln_if(BBFS_DEBUG, "{}: Failed to start read-ahead of {} blocks at {}: {}", class_name(), run_length, blocks[i], result.error());
+                break;
+            }
+            i += run_length;
+        }
+        return i;
+    });
+}
+
 void BlockBasedFileSystem::flush_specific_block_if_needed(BlockIndex index)
 {
     m_cache.with_exclusive([&](auto& cache) {
@@ -307,8 +866,33 @@ void BlockBasedFileSystem::flush_writes_impl()
 
 ErrorOr<void> BlockBasedFileSystem::flush_writes()
 {
+    // This runs periodically, so it's a good time to retire read-aheads that nobody came back for.
+    // NOTE: Not in flush_writes_impl(), as that may be called while installing read-ahead blocks.
+    m_cache.with_exclusive([&](auto& cache) {
+        if (cache)
+            cache->reap_completed_read_aheads();
+    });
     flush_writes_impl();
     return {};
 }
 
+void BlockBasedFileSystem::release_clean_cache_memory()
+{
+    m_cache.with_exclusive([&](auto& cache) {
+        if (!cache)
+            return;
+        if (auto released_entries = cache->release_segments())
+            dbgln_if(BBFS_DEBUG, "{}: Released {} cache entries due to memory pressure", class_name(), released_entries);
+    });
+}
+
+BlockBasedFileSystem::CacheStatistics BlockBasedFileSystem::cache_statistics() const
+{
+    return m_cache.with_shared([&](auto const& cache) -> CacheStatistics {
+        if (!cache)
+            return {};
+        return cache->statistics();
+    });
+}
+
 }
@@ -22,6 +22,23 @@ public:
     virtual ErrorOr<void> flush_writes() override;
     void flush_writes_impl();
 
+    virtual void release_clean_cache_memory() override;
+
+    struct CacheStatistics {
+        u64 hits { 0 };
+        u64 misses { 0 };
+        u64 evictions { 0 };
+        u64 ghost_hits { 0 };
+        u64 read_ahead_blocks { 0 };
+        size_t capacity { 0 };
+        size_t maximum_capacity { 0 };
+    };
+    CacheStatistics cache_statistics() const;
+
+    // Starts asynchronous reads of the given blocks into the cache, without waiting for them.
+    // Returns how many of the blocks (from the start) are now either cached or being read.
+    size_t read_ahead_blocks(ReadonlySpan<BlockIndex>) const;
+
 protected:
     explicit BlockBasedFileSystem(OpenFileDescription&);
 
@@ -44,6 +61,8 @@ protected:
     void remove_disk_cache_before_last_unmount();
 
 private:
+    virtual bool is_block_based() const override { return true; }
+
     void flush_specific_block_if_needed(BlockIndex index);
 
     mutable MutexProtected<OwnPtr<DiskCache>> m_cache;
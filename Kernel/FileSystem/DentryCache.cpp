@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Singleton.h>
+#include <AK/StringHash.h>
+#include <Kernel/FileSystem/DentryCache.h>
+#include <Kernel/FileSystem/FileSystem.h>
+#include <Kernel/FileSystem/Inode.h>
+
+namespace Kernel {
+
+static Singleton<DentryCache> s_the;
+
+DentryCache& DentryCache::the()
+{
+    return *s_the;
+}
+
+u32 DentryCache::hash_for(InodeIdentifier parent, StringView name)
+{
+    return pair_int_hash(Traits<InodeIdentifier>::hash(parent), string_hash(name.characters_without_null_termination(), name.length()));
+}
+
+ErrorOr<NonnullRefPtr<Inode>> DentryCache::lookup(Inode& parent, StringView name)
+{
+    if (!parent.fs().supports_dentry_cache())
+        return parent.lookup(name);
+
+    auto parent_id = parent.identifier();
+    auto hash = hash_for(parent_id, name);
+    auto& shard = shard_for(parent_id);
+
+    Optional<RefPtr<Inode>> cached_inode;
+    u64 generation = 0;
+    shard.with([&](auto& shard) {
+        generation = shard.generation;
+        auto it = shard.entries.find(hash, [&](Entry const* entry) {
+            return entry->parent == parent_id && entry->name->view() == name;
+        });
+        if (it == shard.entries.end())
+            return;
+        auto& entry = **it;
+        entry.list_node.remove();
+        shard.lru_list.append(entry);
+        cached_inode = entry.inode;
+    });
+
+    if (cached_inode.has_value()) {
+        if (!cached_inode.value())
+            return ENOENT;
+        return cached_inode.release_value().release_nonnull();
+    }
+
+    auto inode_or_error = parent.lookup(name);
+    if (!inode_or_error.is_error())
+        add(parent, name, hash, inode_or_error.value(), generation);
+    else if (inode_or_error.error().code() == ENOENT)
+        add(parent, name, hash, nullptr, generation);
+    return inode_or_error;
+}
+
+void DentryCache::add(Inode& parent, StringView name, u32 hash, RefPtr<Inode> inode, u64 generation)
+{
+    // NOTE: Failing to remember a lookup is no big deal, the next one will simply go to the file system again.
+    auto name_or_error = KString::try_create(name);
+    if (name_or_error.is_error())
+        return;
+    auto* new_entry = new (nothrow) Entry { parent.identifier(), name_or_error.release_value(), hash, move(inode), {} };
+    if (!new_entry)
+        return;
+
+    EntryList doomed;
+    shard_for(parent.identifier()).with([&](auto& shard) {
+        if (shard.generation != generation) {
+            doomed.append(*new_entry);
+            return;
+        }
+        if (shard.entries.find(new_entry) != shard.entries.end()) {
+            doomed.append(*new_entry);
+            return;
+        }
+        if (shard.entries.try_set(new_entry).is_error()) {
+            doomed.append(*new_entry);
+            return;
+        }
+        shard.lru_list.append(*new_entry);
+        parent.m_may_have_cached_dentries = true;
+
+        while (shard.entries.size() > max_entries_per_shard)
+            remove_locked(shard, *shard.lru_list.first(), doomed);
+    });
+    destroy_entries(doomed);
+}
+
+void DentryCache::remove_locked(Shard& shard, Entry& entry, EntryList& doomed)
+{
+    shard.entries.remove(&entry);
+    entry.list_node.remove();
+    doomed.append(entry);
+}
+
+void DentryCache::destroy_entries(EntryList& doomed)
+{
+    // NOTE: This must happen without holding any shard lock, since dropping the last reference to an inode
+    //       can take mutexes, and comes back to us to drop the entries of a directory.
+    while (auto* entry = doomed.take_first())
+        delete entry;
+}
+
+void DentryCache::invalidate(InodeIdentifier parent, StringView name)
+{
+    auto hash = hash_for(parent, name);
+    EntryList doomed;
+    shard_for(parent).with([&](auto& shard) {
+        ++shard.generation;
+        auto it = shard.entries.find(hash, [&](Entry const* entry) {
+            return entry->parent == parent && entry->name->view() == name;
+        });
+        if (it != shard.entries.end())
+            remove_locked(shard, **it, doomed);
+    });
+    destroy_entries(doomed);
+}
+
+void DentryCache::invalidate_directory(InodeIdentifier parent)
+{
+    EntryList doomed;
+    shard_for(parent).with([&](auto& shard) {
+        ++shard.generation;
+        for (auto it = shard.lru_list.begin(); it != shard.lru_list.end();) {
+            auto& entry = *it;
+            ++it;
+            if (entry.parent == parent)
+                remove_locked(shard, entry, doomed);
+        }
+    });
+    destroy_entries(doomed);
+}
+
+void DentryCache::invalidate_file_system(FileSystemID fsid)
+{
+    for (auto& shard : m_shards) {
+        EntryList doomed;
+        shard.with([&](auto& shard) {
+            ++shard.generation;
+            for (auto it = shard.lru_list.begin(); it != shard.lru_list.end();) {
+                auto& entry = *it;
+                ++it;
+                if (entry.parent.fsid() == fsid)
+                    remove_locked(shard, entry, doomed);
+            }
+        });
+        destroy_entries(doomed);
+    }
+}
+
+void DentryCache::clear()
+{
+    for (auto& shard : m_shards) {
+        EntryList doomed;
+        shard.with([&](auto& shard) {
+            ++shard.generation;
+            shard.entries.clear();
+            while (auto* entry = shard.lru_list.take_first())
+                doomed.append(*entry);
+        });
+        destroy_entries(doomed);
+    }
+}
+
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Array.h>
+#include <AK/Error.h>
+#include <AK/HashTable.h>
+#include <AK/IntrusiveList.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/RefPtr.h>
+#include <AK/StringView.h>
+#include <Kernel/FileSystem/InodeIdentifier.h>
+#include <Kernel/Forward.h>
+#include <Kernel/Library/KString.h>
+#include <Kernel/Locking/SpinlockProtected.h>
+
+namespace Kernel {
+
+// Remembers what names in directories resolved to, so that path resolution doesn't have to ask the
+// file system (and scan the directory) again for every component of every path it walks. Names that
+// didn't resolve are remembered as well, since looking for files that don't exist is common, e.g.
+// when searching $PATH or probing for optional configuration files.
+//
+// Only file systems that report every change to their directories through Inode::did_add_child() and
+// Inode::did_remove_child() can be cached, see FileSystem::supports_dentry_cache(). Mounts are applied
+// on top of what we return, so they never have to be reflected in here.
+class DentryCache {
+public:
+    static DentryCache& the();
+
+    // Looks up `name` in `parent`, going to the file system only if we don't know the answer yet.
+    ErrorOr<NonnullRefPtr<Inode>> lookup(Inode& parent, StringView name);
+
+    void invalidate(InodeIdentifier parent, StringView name);
+    void invalidate_directory(InodeIdentifier parent);
+    void invalidate_file_system(FileSystemID);
+    void clear();
+
+private:
+    struct Entry {
+        InodeIdentifier parent;
+        NonnullOwnPtr<KString> name;
+        u32 hash { 0 };
+        RefPtr<Inode> inode; // Null if the name doesn't exist.
+        IntrusiveListNode<Entry> list_node;
+    };
+
+    struct EntryTraits : public DefaultTraits<Entry*> {
+        static unsigned hash(Entry const* entry) { return entry->hash; }
+        static bool equals(Entry const* a, Entry const* b) { return a->parent == b->parent && a->name->view() == b->name->view(); }
+    };
+
+    using EntryList = IntrusiveList<&Entry::list_node>;
+
+    // Entries are sharded by their directory, so that lookups in unrelated directories don't contend
+    // on a single lock, and so that dropping all entries for a directory only has to look at one shard.
+    struct Shard {
+        HashTable<Entry*, EntryTraits> entries;
+        EntryList lru_list;
+        // Bumped on every invalidation, so that a lookup racing with a change doesn't cache a stale result.
+        u64 generation { 0 };
+    };
+
+    static constexpr size_t shard_count = 16;
+    static constexpr size_t max_entries_per_shard = 512;
+
+    static u32 hash_for(InodeIdentifier parent, StringView name);
+    SpinlockProtected<Shard, LockRank::None>& shard_for(InodeIdentifier parent) { return m_shards[pair_int_hash(parent.fsid().value(), parent.index().value()) % shard_count]; }
+
+    void add(Inode& parent, StringView name, u32 hash, RefPtr<Inode> inode, u64 generation);
+    static void remove_locked(Shard&, Entry&, EntryList& doomed);
+    static void destroy_entries(EntryList&);
+
+    Array<SpinlockProtected<Shard, LockRank::None>, shard_count> m_shards;
+};
+
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/FileSystem/EventPoll.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Library/KString.h>
+#include <Kernel/Tasks/Thread.h>
+
+namespace Kernel {
+
+ErrorOr<NonnullRefPtr<EventPollInterest>> EventPollInterest::try_create(EventPoll& event_poll, OpenFileDescription& description, int fd, u32 events, u64 data)
+{
+    return adopt_nonnull_ref_or_enomem(new (nothrow) EventPollInterest(event_poll, description, fd, events, data));
+}
+
+EventPollInterest::EventPollInterest(EventPoll& event_poll, OpenFileDescription& description, int fd, u32 events, u64 data)
+    : m_event_poll(event_poll)
+    , m_description(description)
+    , m_file(description.file())
+    , m_blocker_set(description.blocker_set())
+    , m_fd(fd)
+    , m_events(events)
+    , m_data(data)
+{
+}
+
+EventPollInterest::~EventPollInterest() = default;
+
+void EventPollInterest::notify_maybe_ready(Badge<FileBlockerSet>)
+{
+    m_event_poll.interest_maybe_ready({}, *this);
+}
+
+void EventPollInterest::description_will_be_destroyed(Badge<FileBlockerSet>)
+{
+    m_event_poll.forget_interest({}, *this);
+}
+
+ErrorOr<NonnullRefPtr<EventPoll>> EventPoll::try_create()
+{
+    return adopt_nonnull_ref_or_enomem(new (nothrow) EventPoll);
+}
+
+EventPoll::~EventPoll()
+{
+    HashMap<int, NonnullRefPtr<EventPollInterest>> interests;
+    {
+        SpinlockLocker lock(m_lock);
+        for (auto& it : m_interests)
+            it.value->m_registered = false;
+        m_ready_list.clear();
+        interests = move(m_interests);
+    }
+
+    // NOTE: This has to happen without holding our lock, as the blocker sets take their own lock
+    //       before calling into us.
+    for (auto& it : interests)
+        it.value->blocker_set().remove_event_poll_interest(*it.value);
+}
+
+bool EventPoll::can_read(OpenFileDescription const&, u64) const
+{
+    SpinlockLocker lock(m_lock);
+    return !m_ready_list.is_empty();
+}
+
+ErrorOr<NonnullOwnPtr<KString>> EventPoll::pseudo_path(OpenFileDescription const&) const
+{
+    SpinlockLocker lock(m_lock);
+    return KString::formatted("EventPoll:({})", m_interests.size());
+}
+
+ErrorOr<void> EventPoll::add_interest(OpenFileDescription& description, int fd, epoll_event const& event)
+{
+    // NOTE: Linux allows nesting epoll instances (with loop detection); we don't, which keeps
+    //       the lock ordering between blocker sets and event polls strictly one-way.
+    if (description.is_event_poll())
+        return EINVAL;
+
+    auto interest = TRY(EventPollInterest::try_create(*this, description, fd, event.events, event.data.u64));
+
+    // Link the interest into the watched file first, so that we can't miss a state change that
+    // happens between putting it onto the ready list and it being linked in.
+    interest->blocker_set().add_event_poll_interest(*interest);
+
+    RefPtr<EventPollInterest> replaced_interest;
+    auto result = [&]() -> ErrorOr<void> {
+        SpinlockLocker lock(m_lock);
+        if (auto it = m_interests.find(fd); it != m_interests.end()) {
+            if (&it->value->description() == &description)
+                return EEXIST;
+            // The fd was closed and then reused while the old description stayed alive somewhere
+            // else (e.g. in a child process), so its interest was never removed. Let the new
+            // description take over the slot.
+            replaced_interest = it->value;
+            forget_interest_locked(*replaced_interest);
+        }
+        TRY(m_interests.try_set(fd, interest));
+        interest->m_registered = true;
+        m_ready_list.append(*interest);
+        return {};
+    }();
+
+    if (replaced_interest)
+        replaced_interest->blocker_set().remove_event_poll_interest(*replaced_interest);
+
+    if (result.is_error()) {
+        interest->blocker_set().remove_event_poll_interest(*interest);
+        return result.release_error();
+    }
+
+    evaluate_block_conditions();
+    return {};
+}
+
+ErrorOr<void> EventPoll::modify_interest(OpenFileDescription& description, int fd, epoll_event const& event)
+{
+    {
+        SpinlockLocker lock(m_lock);
+        auto it = m_interests.find(fd);
+        if (it == m_interests.end() || &it->value->description() != &description)
+            return ENOENT;
+
+        auto& interest = *it->value;
+        interest.m_events = event.events;
+        interest.m_data = event.data.u64;
+        interest.m_disabled = false;
+        // Let the next wait find out whether the new set of events is ready.
+        if (!interest.m_ready_list_node.is_in_list())
+            m_ready_list.append(interest);
+    }
+
+    evaluate_block_conditions();
+    return {};
+}
+
+ErrorOr<void> EventPoll::remove_interest(OpenFileDescription& description, int fd)
+{
+    RefPtr<EventPollInterest> interest;
+    {
+        SpinlockLocker lock(m_lock);
+        auto it = m_interests.find(fd);
+        if (it == m_interests.end() || &it->value->description() != &description)
+            return ENOENT;
+        interest = it->value;
+        forget_interest_locked(*interest);
+    }
+
+    interest->blocker_set().remove_event_poll_interest(*interest);
+    return {};
+}
+
+u32 EventPoll::ready_events_locked(EventPollInterest const& interest) const
+{
+    VERIFY(m_lock.is_locked());
+    using BlockFlags = Thread::FileBlocker::BlockFlags;
+
+    // Like poll(), we always want to hear about errors and hang-ups.
+    BlockFlags block_flags = BlockFlags::WriteError | BlockFlags::WriteHangUp;
+    if (interest.m_events & EPOLLIN)
+        block_flags |= BlockFlags::Read;
+    if (interest.m_events & EPOLLOUT)
+        block_flags |= BlockFlags::Write;
+    if (interest.m_events & EPOLLPRI)
+        block_flags |= BlockFlags::ReadPriority;
+    if (interest.m_events & EPOLLWRBAND)
+        block_flags |= BlockFlags::WritePriority;
+    if (interest.m_events & EPOLLRDHUP)
+        block_flags |= BlockFlags::ReadHangUp;
+
+    auto unblocked_flags = interest.m_description.should_unblock(block_flags);
+
+    u32 ready_events = 0;
+    if (has_flag(unblocked_flags, BlockFlags::WriteHangUp))
+        ready_events |= EPOLLHUP;
+    if (has_flag(unblocked_flags, BlockFlags::WriteError))
+        ready_events |= EPOLLERR;
+    if (has_flag(unblocked_flags, BlockFlags::Read))
+        ready_events |= EPOLLIN;
+    if (has_flag(unblocked_flags, BlockFlags::ReadPriority))
+        ready_events |= EPOLLPRI;
+    if (!has_flag(unblocked_flags, BlockFlags::WriteHangUp) && has_flag(unblocked_flags, BlockFlags::Write))
+        ready_events |= EPOLLOUT;
+    if (has_flag(unblocked_flags, BlockFlags::WritePriority))
+        ready_events |= EPOLLWRBAND;
+    if (has_flag(unblocked_flags, BlockFlags::ReadHangUp))
+        ready_events |= EPOLLRDHUP;
+    return ready_events;
+}
+
+size_t EventPoll::collect_ready_events(Span<epoll_event> events)
+{
+    SpinlockLocker lock(m_lock);
+
+    EventPollInterest::ReadyList still_ready;
+    size_t count = 0;
+    while (count < events.size()) {
+        auto* interest = m_ready_list.take_first();
+        if (!interest)
+            break;
+
+        // Anything that turns out not to be ready is simply dropped from the list. Its file will
+        // put it back once its block conditions are evaluated again.
+        auto ready_events = ready_events_locked(*interest);
+        if (ready_events == 0)
+            continue;
+
+        auto& event = events[count++];
+        event.events = ready_events;
+        event.data.u64 = interest->m_data;
+
+        if (interest->m_events & EPOLLONESHOT)
+            interest->m_disabled = true;
+        else if (!(interest->m_events & EPOLLET))
+            still_ready.append(*interest);
+    }
+
+    while (auto* interest = still_ready.take_first())
+        m_ready_list.append(*interest);
+
+    return count;
+}
+
+void EventPoll::interest_maybe_ready(Badge<EventPollInterest>, EventPollInterest& interest)
+{
+    {
+        SpinlockLocker lock(m_lock);
+        if (!interest.m_registered || interest.m_disabled)
+            return;
+        // If it's already on the ready list, whoever is waiting on us has already been woken up.
+        if (interest.m_ready_list_node.is_in_list())
+            return;
+        m_ready_list.append(interest);
+    }
+
+    // NOTE: We are being called from the watched file's blocker set, so we can't be in an IRQ
+    //       handler, and don't need to go through the deferred path of evaluate_block_conditions().
+    blocker_set().unblock_all_blockers_whose_conditions_are_met();
+}
+
+void EventPoll::forget_interest(Badge<EventPollInterest>, EventPollInterest& interest)
+{
+    NonnullRefPtr protect = interest;
+    SpinlockLocker lock(m_lock);
+    if (interest.m_registered)
+        forget_interest_locked(interest);
+}
+
+void EventPoll::forget_interest_locked(EventPollInterest& interest)
+{
+    VERIFY(m_lock.is_locked());
+    VERIFY(interest.m_registered);
+    interest.m_registered = false;
+    if (interest.m_ready_list_node.is_in_list())
+        m_ready_list.remove(interest);
+    auto it = m_interests.find(interest.m_fd);
+    VERIFY(it != m_interests.end() && it->value.ptr() == &interest);
+    m_interests.remove(it);
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Badge.h>
+#include <AK/HashMap.h>
+#include <AK/Span.h>
+#include <Kernel/API/POSIX/sys/epoll.h>
+#include <Kernel/FileSystem/EventPollInterest.h>
+#include <Kernel/FileSystem/File.h>
+#include <Kernel/Forward.h>
+#include <Kernel/Locking/Spinlock.h>
+
+namespace Kernel {
+
+// An EventPoll is a persistent set of file descriptions that a process is interested in, along
+// with the subset of them that have (possibly) become ready since someone last looked.
+//
+// Unlike poll(), which has to rebuild its blockers from scratch on every call, interests stay
+// registered with the watched files, which push themselves onto the ready list whenever their
+// block conditions are evaluated. Waiting is therefore O(ready) instead of O(watched).
+class EventPoll final : public File {
+public:
+    static ErrorOr<NonnullRefPtr<EventPoll>> try_create();
+    virtual ~EventPoll() override;
+
+    // An EventPoll becomes readable when something is on its ready list, so it can itself be
+    // waited on with poll() or select().
+    virtual bool can_read(OpenFileDescription const&, u64) const override;
+    virtual ErrorOr<size_t> read(OpenFileDescription&, u64, UserOrKernelBuffer&, size_t) override { return EINVAL; }
+    virtual bool can_write(OpenFileDescription const&, u64) const override { return false; }
+    virtual ErrorOr<size_t> write(OpenFileDescription&, u64, UserOrKernelBuffer const&, size_t) override { return EINVAL; }
+
+    virtual ErrorOr<NonnullOwnPtr<KString>> pseudo_path(OpenFileDescription const&) const override;
+    virtual StringView class_name() const override { return "EventPoll"sv; }
+    virtual bool is_event_poll() const override { return true; }
+
+    ErrorOr<void> add_interest(OpenFileDescription&, int fd, epoll_event const&);
+    ErrorOr<void> modify_interest(OpenFileDescription&, int fd, epoll_event const&);
+    ErrorOr<void> remove_interest(OpenFileDescription&, int fd);
+
+    // Fills `events` with as many ready entries as possible, and returns how many were filled in.
+    // Level-triggered interests that are still ready are moved to the back of the ready list,
+    // so that a few busy descriptions can't starve the others.
+    size_t collect_ready_events(Span<epoll_event> events);
+
+    void interest_maybe_ready(Badge<EventPollInterest>, EventPollInterest&);
+    void forget_interest(Badge<EventPollInterest>, EventPollInterest&);
+
+private:
+    EventPoll() = default;
+
+    u32 ready_events_locked(EventPollInterest const&) const;
+    void forget_interest_locked(EventPollInterest&);
+
+    mutable Spinlock<LockRank::None> m_lock {};
+    HashMap<int, NonnullRefPtr<EventPollInterest>> m_interests;
+    EventPollInterest::ReadyList m_ready_list;
+};
+
+}
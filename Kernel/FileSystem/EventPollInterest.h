@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/AtomicRefCounted.h>
+#include <AK/Badge.h>
+#include <AK/Error.h>
+#include <AK/IntrusiveList.h>
+#include <AK/NonnullRefPtr.h>
+#include <AK/Types.h>
+#include <Kernel/Forward.h>
+
+namespace Kernel {
+
+class FileBlockerSet;
+
+// One entry in the interest set of an EventPoll.
+//
+// While an interest is registered, it is linked into the FileBlockerSet of the watched file, so
+// every time that file evaluates its block conditions the EventPoll gets to hear about it. This
+// is what makes waiting on an EventPoll independent of the number of watched descriptions.
+//
+// An interest does not keep the watched OpenFileDescription alive; instead, the description
+// removes all of its interests when it is destroyed. It does keep the File alive though, so that
+// the blocker set it's linked into can't disappear from underneath it.
+class EventPollInterest final : public AtomicRefCounted<EventPollInterest> {
+    AK_MAKE_NONCOPYABLE(EventPollInterest);
+    AK_MAKE_NONMOVABLE(EventPollInterest);
+
+public:
+    static ErrorOr<NonnullRefPtr<EventPollInterest>> try_create(EventPoll&, OpenFileDescription&, int fd, u32 events, u64 data);
+    ~EventPollInterest();
+
+    int fd() const { return m_fd; }
+    OpenFileDescription const& description() const { return m_description; }
+    FileBlockerSet& blocker_set() { return m_blocker_set; }
+
+    void notify_maybe_ready(Badge<FileBlockerSet>);
+    void description_will_be_destroyed(Badge<FileBlockerSet>);
+
+private:
+    friend class EventPoll;
+    friend class FileBlockerSet;
+
+    EventPollInterest(EventPoll&, OpenFileDescription&, int fd, u32 events, u64 data);
+
+    EventPoll& m_event_poll;
+    OpenFileDescription& m_description;
+    NonnullRefPtr<File> const m_file;
+    FileBlockerSet& m_blocker_set;
+    int const m_fd;
+
+    // These are protected by the EventPoll's lock.
+    u32 m_events { 0 };
+    u64 m_data { 0 };
+    bool m_registered { false };
+    bool m_disabled { false };
+    IntrusiveListNode<EventPollInterest> m_ready_list_node;
+
+    // This is protected by the FileBlockerSet's lock.
+    IntrusiveListNode<EventPollInterest> m_file_list_node;
+
+public:
+    using FileList = IntrusiveList<&EventPollInterest::m_file_list_node>;
+    using ReadyList = IntrusiveList<&EventPollInterest::m_ready_list_node>;
+};
+
+}
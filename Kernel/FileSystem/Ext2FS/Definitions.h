@@ -207,6 +207,41 @@ struct ext2_dx_countlimit {
     __u16 count;
 };
 
+/*
+ * Data structures used by the extents feature (ext4)
+ *
+ * The root of the tree lives in i_block, the rest of it in whole blocks.
+ * Each node starts with a header, followed by either extents (in leaves,
+ * eh_depth == 0) or index entries pointing at the next level down.
+ */
+#define EXT4_EXT_MAGIC 0xf30a
+#define EXT4_MAX_EXTENT_DEPTH 5
+
+/* Extents longer than this are uninitialized (allocated, but reading as zeroes). */
+#define EXT4_INIT_MAX_LEN (1u << 15)
+
+struct ext4_extent_header {
+    __u16 eh_magic;      /* probably will support different formats */
+    __u16 eh_entries;    /* number of valid entries */
+    __u16 eh_max;        /* capacity of store in entries */
+    __u16 eh_depth;      /* has tree real underlying blocks? */
+    __u32 eh_generation; /* generation of the tree */
+};
+
+struct ext4_extent {
+    __u32 ee_block;    /* first logical block extent covers */
+    __u16 ee_len;      /* number of blocks covered by extent */
+    __u16 ee_start_hi; /* high 16 bits of physical block */
+    __u32 ee_start_lo; /* low 32 bits of physical block */
+};
+
+struct ext4_extent_idx {
+    __u32 ei_block;   /* index covers logical blocks from 'block' */
+    __u32 ei_leaf_lo; /* pointer to the physical block of the next level */
+    __u16 ei_leaf_hi; /* high 16 bits of physical block */
+    __u16 ei_unused;
+};
+
 /*
  * Macro-instructions used to manage group descriptors
  */
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Array.h>
+#include <Kernel/FileSystem/Ext2FS/Definitions.h>
+#include <Kernel/FileSystem/Ext2FS/DirectoryIndex.h>
+
+namespace Kernel {
+
+// NOTE: These have to match what Linux (fs/ext4/hash.c) and e2fsprogs compute bit for bit,
+//       otherwise we wouldn't find names in directories they indexed, and vice versa.
+
+static constexpr u32 rotate_left(u32 value, unsigned shift)
+{
+    return (value << shift) | (value >> (32 - shift));
+}
+
+static void tea_transform(Array<u32, 4>& buffer, Array<u32, 8> const& in)
+{
+    constexpr u32 delta = 0x9E3779B9;
+    u32 sum = 0;
+    u32 b0 = buffer[0];
+    u32 b1 = buffer[1];
+    u32 a = in[0];
+    u32 b = in[1];
+    u32 c = in[2];
+    u32 d = in[3];
+
+    for (int n = 0; n < 16; ++n) {
+        sum += delta;
+        b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+        b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+    }
+
+    buffer[0] += b0;
+    buffer[1] += b1;
+}
+
+static void half_md4_transform(Array<u32, 4>& buffer, Array<u32, 8> const& in)
+{
+    auto f = [](u32 x, u32 y, u32 z) { return z ^ (x & (y ^ z)); };
+    auto g = [](u32 x, u32 y, u32 z) { return (x & y) + ((x ^ y) & z); };
+    auto h = [](u32 x, u32 y, u32 z) { return x ^ y ^ z; };
+
+    constexpr u32 k1 = 0;
+    constexpr u32 k2 = 013240474631;
+    constexpr u32 k3 = 015666365641;
+
+    u32 a = buffer[0];
+    u32 b = buffer[1];
+    u32 c = buffer[2];
+    u32 d = buffer[3];
+
+    auto round = [](auto function, u32& w, u32 x, u32 y, u32 z, u32 value, unsigned shift) {
+        w += function(x, y, z) + value;
+        w = rotate_left(w, shift);
+    };
+
+    // Round 1
+    round(f, a, b, c, d, in[0] + k1, 3);
+    round(f, d, a, b, c, in[1] + k1, 7);
+    round(f, c, d, a, b, in[2] + k1, 11);
+    round(f, b, c, d, a, in[3] + k1, 19);
+    round(f, a, b, c, d, in[4] + k1, 3);
+    round(f, d, a, b, c, in[5] + k1, 7);
+    round(f, c, d, a, b, in[6] + k1, 11);
+    round(f, b, c, d, a, in[7] + k1, 19);
+
+    // Round 2
+    round(g, a, b, c, d, in[1] + k2, 3);
+    round(g, d, a, b, c, in[3] + k2, 5);
+    round(g, c, d, a, b, in[5] + k2, 9);
+    round(g, b, c, d, a, in[7] + k2, 13);
+    round(g, a, b, c, d, in[0] + k2, 3);
+    round(g, d, a, b, c, in[2] + k2, 5);
+    round(g, c, d, a, b, in[4] + k2, 9);
+    round(g, b, c, d, a, in[6] + k2, 13);
+
+    // Round 3
+    round(h, a, b, c, d, in[3] + k3, 3);
+    round(h, d, a, b, c, in[7] + k3, 9);
+    round(h, c, d, a, b, in[2] + k3, 11);
+    round(h, b, c, d, a, in[6] + k3, 15);
+    round(h, a, b, c, d, in[1] + k3, 3);
+    round(h, d, a, b, c, in[5] + k3, 9);
+    round(h, c, d, a, b, in[0] + k3, 11);
+    round(h, b, c, d, a, in[4] + k3, 15);
+
+    buffer[0] += a;
+    buffer[1] += b;
+    buffer[2] += c;
+    buffer[3] += d;
+}
+
+// Whether names are hashed as signed or unsigned characters depends on the platform that created the
+// file system, which is why the signedness is recorded in the super block.
+static u32 character_value(char character, bool is_unsigned)
+{
+    if (is_unsigned)
+        return static_cast<u8>(character);
+    return static_cast<u32>(static_cast<i32>(static_cast<i8>(character)));
+}
+
+static u32 legacy_hash(StringView name, bool is_unsigned)
+{
+    u32 hash0 = 0x12a3fe2d;
+    u32 hash1 = 0x37abe8f9;
+    for (char character : name) {
+        u32 hash = hash1 + (hash0 ^ (character_value(character, is_unsigned) * 7152373));
+        if (hash & 0x80000000)
+            hash -= 0x7fffffff;
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
+
+static void string_to_hash_buffer(StringView name, Array<u32, 8>& buffer, size_t word_count, bool is_unsigned)
+{
+    u32 length = name.length();
+    u32 pad = length | (length << 8);
+    pad |= pad << 16;
+
+    u32 value = pad;
+    size_t bytes = min(name.length(), word_count * 4);
+    size_t out = 0;
+    int remaining_words = static_cast<int>(word_count);
+    for (size_t i = 0; i < bytes; ++i) {
+        value = character_value(name[i], is_unsigned) + (value << 8);
+        if ((i % 4) == 3) {
+            buffer[out++] = value;
+            value = pad;
+            --remaining_words;
+        }
+    }
+    if (--remaining_words >= 0)
+        buffer[out++] = value;
+    while (--remaining_words >= 0)
+        buffer[out++] = pad;
+}
+
+u32 ext2_directory_hash(StringView name, u8 hash_version, u32 const (&seed)[4])
+{
+    Array<u32, 4> buffer { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    if (seed[0] || seed[1] || seed[2] || seed[3]) {
+        for (size_t i = 0; i < 4; ++i)
+            buffer[i] = seed[i];
+    }
+
+    bool is_unsigned = hash_version >= EXT2_HASH_LEGACY_UNSIGNED;
+    u32 hash = 0;
+    Array<u32, 8> in {};
+
+    switch (hash_version) {
+    case EXT2_HASH_LEGACY:
+    case EXT2_HASH_LEGACY_UNSIGNED:
+        hash = legacy_hash(name, is_unsigned);
+        break;
+    case EXT2_HASH_HALF_MD4:
+    case EXT2_HASH_HALF_MD4_UNSIGNED: {
+        for (auto remaining = name; !remaining.is_empty(); remaining = remaining.substring_view(min<size_t>(remaining.length(), 32))) {
+            string_to_hash_buffer(remaining, in, 8, is_unsigned);
+            half_md4_transform(buffer, in);
+        }
+        hash = buffer[1];
+        break;
+    }
+    case EXT2_HASH_TEA:
+    case EXT2_HASH_TEA_UNSIGNED: {
+        for (auto remaining = name; !remaining.is_empty(); remaining = remaining.substring_view(min<size_t>(remaining.length(), 16))) {
+            string_to_hash_buffer(remaining, in, 4, is_unsigned);
+            tea_transform(buffer, in);
+        }
+        hash = buffer[0];
+        break;
+    }
+    default:
+        VERIFY_NOT_REACHED();
+    }
+
+    hash &= ~1u;
+    // The largest hash is reserved to mark the end of a directory for readdir() on Linux.
+    if (hash == (0x7fffffffu << 1))
+        hash = (0x7fffffffu - 1) << 1;
+    return hash;
+}
+
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/StringView.h>
+#include <AK/Types.h>
+
+namespace Kernel {
+
+// Layout of the HTree directory index ("dir_index"), as created by ext3/ext4 and mke2fs.
+//
+// Block 0 of an indexed directory holds the "." and ".." entries, where ".." spans the rest of the block
+// and hides the root of the index from anyone reading the directory linearly. Interior nodes of the tree
+// look like a single unused entry spanning their whole block. All other blocks are ordinary directory
+// blocks, each holding the names within a range of hashes.
+static constexpr size_t ext2_dx_root_info_offset = 24;
+static constexpr size_t ext2_dx_root_entries_offset = 32;
+static constexpr size_t ext2_dx_node_entries_offset = 8;
+
+// Without the "largedir" feature, the index is at most two levels deep (a root plus one level of nodes).
+static constexpr u8 ext2_dx_max_indirect_levels = 1;
+
+// Computes the hash that the index sorts names by. `hash_version` is one of the EXT2_HASH_* values, already
+// adjusted for the file system's signedness flag. The lowest bit of the result is always clear, since the
+// index uses it to mark a run of equal hashes that continues from the previous block.
+u32 ext2_directory_hash(StringView name, u8 hash_version, u32 const (&seed)[4]);
+
+}
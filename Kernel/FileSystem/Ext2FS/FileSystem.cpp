@@ -214,6 +214,13 @@ u8 Ext2FS::internal_file_type_to_directory_entry_type(DirectoryEntryView const&
     }
 }
 
+Ext2FS::FeaturesOptional Ext2FS::get_features_optional() const
+{
+    if (m_super_block.s_rev_level > 0)
+        return static_cast<Ext2FS::FeaturesOptional>(m_super_block.s_feature_compat);
+    return Ext2FS::FeaturesOptional::None;
+}
+
 Ext2FS::FeaturesReadOnly Ext2FS::get_features_readonly() const
 {
     if (m_super_block.s_rev_level > 0)
@@ -221,6 +228,13 @@ Ext2FS::FeaturesReadOnly Ext2FS::get_features_readonly() const
     return Ext2FS::FeaturesReadOnly::None;
 }
 
+Ext2FS::FeaturesIncompatible Ext2FS::get_features_incompatible() const
+{
+    if (m_super_block.s_rev_level > 0)
+        return static_cast<Ext2FS::FeaturesIncompatible>(m_super_block.s_feature_incompat);
+    return Ext2FS::FeaturesIncompatible::None;
+}
+
 u64 Ext2FS::inodes_per_block() const
 {
     return EXT2_INODES_PER_BLOCK(&super_block());
@@ -250,9 +264,9 @@ ErrorOr<void> Ext2FS::write_ext2_inode(InodeIndex inode, ext2_inode const& e2ino
     return write_block(block_index, buffer, inode_size(), offset);
 }
 
-auto Ext2FS::allocate_blocks(GroupIndex preferred_group_index, size_t count) -> ErrorOr<Vector<BlockIndex>>
+auto Ext2FS::allocate_blocks(GroupIndex preferred_group_index, size_t count, BlockIndex goal, size_t reserved_count) -> ErrorOr<Vector<BlockIndex>>
 {
-    dbgln_if(EXT2_DEBUG, "Ext2FS: allocate_blocks(preferred group: {}, count {})", preferred_group_index, count);
+    dbgln_if(EXT2_DEBUG, "Ext2FS: allocate_blocks(preferred group: {}, count {}, goal {})", preferred_group_index, count, goal);
     if (count == 0)
         return Vector<BlockIndex> {};
 
@@ -260,52 +274,114 @@ auto Ext2FS::allocate_blocks(GroupIndex preferred_group_index, size_t count) ->
     TRY(blocks.try_ensure_capacity(count));
 
     MutexLocker locker(m_lock);
-    auto group_index = preferred_group_index;
+    VERIFY(reserved_count <= count && reserved_count <= m_reserved_block_count);
+    // Blocks that are reserved for someone else's delayed allocation aren't up for grabs.
+    if (count - reserved_count > super_block().s_free_blocks_count - m_reserved_block_count)
+        return ENOSPC;
 
-    if (!group_descriptor(preferred_group_index).bg_free_blocks_count) {
-        group_index = 1;
-    }
+    size_t blocks_in_group = min(blocks_per_group(), super_block().s_blocks_count);
 
-    while (blocks.size() < count) {
-        bool found_a_group = false;
+    // If the goal is free, continue right there, so that the file stays contiguous on disk.
+    if (goal >= first_block_index() && goal < super_block().s_blocks_count) {
+        auto group_index = group_index_from_block_index(goal);
         if (group_descriptor(group_index).bg_free_blocks_count) {
-            found_a_group = true;
-        } else {
-            if (group_index == preferred_group_index)
-                group_index = 1;
-            for (; group_index <= m_block_group_count; group_index = GroupIndex { group_index.value() + 1 }) {
-                if (group_descriptor(group_index).bg_free_blocks_count) {
-                    found_a_group = true;
-                    break;
-                }
-            }
+            auto* cached_bitmap = TRY(get_bitmap_block(group_descriptor(group_index).bg_block_bitmap));
+            auto block_bitmap = cached_bitmap->bitmap(blocks_in_group);
+            size_t goal_index_in_group = goal.value() - first_block_of_group(group_index).value();
+            size_t run_start = goal_index_in_group;
+            auto run_length = block_bitmap.find_next_range_of_unset_bits(run_start, 1, count);
+            if (run_length.has_value() && run_start == goal_index_in_group)
+                TRY(allocate_block_run(group_index, run_start, run_length.value(), blocks));
         }
+    }
 
-        VERIFY(found_a_group);
-        auto const& bgd = group_descriptor(group_index);
-
-        auto* cached_bitmap = TRY(get_bitmap_block(bgd.bg_block_bitmap));
-
-        int blocks_in_group = min(blocks_per_group(), super_block().s_blocks_count);
-        auto block_bitmap = cached_bitmap->bitmap(blocks_in_group);
+    auto for_each_group = [&](auto callback) -> ErrorOr<void> {
+        GroupIndex group_index = preferred_group_index.value() ? preferred_group_index : GroupIndex { 1 };
+        for (size_t i = 0; i < m_block_group_count && blocks.size() < count; ++i) {
+            if (group_descriptor(group_index).bg_free_blocks_count)
+                TRY(callback(group_index));
+            group_index = group_index.value() == m_block_group_count ? 1 : group_index.value() + 1;
+        }
+        return {};
+    };
 
-        BlockIndex first_block_in_group = first_block_of_group(group_index);
-        size_t free_region_size = 0;
-        auto first_unset_bit_index = block_bitmap.find_longest_range_of_unset_bits(count - blocks.size(), free_region_size);
-        VERIFY(first_unset_bit_index.has_value());
-        dbgln_if(EXT2_DEBUG, "Ext2FS: allocating free region of size: {} [{}]", free_region_size, group_index);
-        for (size_t i = 0; i < free_region_size; ++i) {
-            BlockIndex block_index = (first_unset_bit_index.value() + i) + first_block_in_group.value();
-            TRY(set_block_allocation_state(block_index, true));
-            blocks.unchecked_append(block_index);
-            dbgln_if(EXT2_DEBUG, "  allocated > {}", block_index);
+    // Prefer a single run that holds everything that's left, rather than scattering the blocks over small gaps.
+    TRY(for_each_group([&](GroupIndex group_index) -> ErrorOr<void> {
+        size_t remaining_count = count - blocks.size();
+        if (group_descriptor(group_index).bg_free_blocks_count < remaining_count)
+            return {};
+        auto* cached_bitmap = TRY(get_bitmap_block(group_descriptor(group_index).bg_block_bitmap));
+        auto first_fit = cached_bitmap->bitmap(blocks_in_group).find_first_fit(remaining_count);
+        if (first_fit.has_value())
+            TRY(allocate_block_run(group_index, first_fit.value(), remaining_count, blocks));
+        return {};
+    }));
+
+    // Otherwise, take the longest runs we can find.
+    TRY(for_each_group([&](GroupIndex group_index) -> ErrorOr<void> {
+        auto* cached_bitmap = TRY(get_bitmap_block(group_descriptor(group_index).bg_block_bitmap));
+        while (blocks.size() < count && group_descriptor(group_index).bg_free_blocks_count) {
+            size_t run_length = 0;
+            auto run_start = cached_bitmap->bitmap(blocks_in_group).find_longest_range_of_unset_bits(count - blocks.size(), run_length);
+            if (!run_start.has_value())
+                break;
+            TRY(allocate_block_run(group_index, run_start.value(), run_length, blocks));
         }
+        return {};
+    }));
+
+    if (blocks.size() != count) {
+        dmesgln("Ext2FS: allocate_blocks: Free block counts are inconsistent with the block bitmaps");
+        for (auto block_index : blocks)
+            (void)set_block_allocation_state(block_index, false);
+        return EIO;
     }
 
-    VERIFY(blocks.size() == count);
+    m_reserved_block_count -= reserved_count;
     return blocks;
 }
 
+ErrorOr<void> Ext2FS::allocate_block_run(GroupIndex group_index, size_t first_index_in_group, size_t length, Vector<BlockIndex>& blocks)
+{
+    VERIFY(m_lock.is_exclusively_locked_by_current_thread());
+    auto& bgd = const_cast<ext2_group_desc&>(group_descriptor(group_index));
+    auto* cached_bitmap = TRY(get_bitmap_block(bgd.bg_block_bitmap));
+    auto block_bitmap = cached_bitmap->bitmap(blocks_per_group());
+    if (block_bitmap.count_in_range(first_index_in_group, length, true) != 0) {
+        dbgln("Ext2FS: Run of {} blocks at {} in group {} isn't free", length, first_index_in_group, group_index);
+        return EIO;
+    }
+    block_bitmap.set_range(first_index_in_group, length, true);
+    cached_bitmap->dirty = true;
+
+    m_super_block.s_free_blocks_count -= length;
+    bgd.bg_free_blocks_count -= length;
+    m_super_block_dirty = true;
+    m_block_group_descriptors_dirty = true;
+
+    BlockIndex first_block_in_run = first_block_of_group(group_index).value() + first_index_in_group;
+    dbgln_if(EXT2_DEBUG, "Ext2FS: Allocated {} blocks at {} [{}]", length, first_block_in_run, group_index);
+    for (size_t i = 0; i < length; ++i)
+        blocks.unchecked_append(first_block_in_run.value() + i);
+    return {};
+}
+
+ErrorOr<void> Ext2FS::reserve_blocks(size_t count)
+{
+    MutexLocker locker(m_lock);
+    if (count > super_block().s_free_blocks_count - m_reserved_block_count)
+        return ENOSPC;
+    m_reserved_block_count += count;
+    return {};
+}
+
+void Ext2FS::unreserve_blocks(size_t count)
+{
+    MutexLocker locker(m_lock);
+    VERIFY(count <= m_reserved_block_count);
+    m_reserved_block_count -= count;
+}
+
 ErrorOr<InodeIndex> Ext2FS::allocate_inode(GroupIndex preferred_group)
 {
     dbgln_if(EXT2_DEBUG, "Ext2FS: allocate_inode(preferred_group: {})", preferred_group);
@@ -529,6 +605,14 @@ ErrorOr<NonnullRefPtr<Inode>> Ext2FS::create_inode(Ext2FSInode& parent_inode, St
     else if (is_block_device(mode))
         e2inode.i_block[1] = dev;
 
+    // Like on Linux, new files and directories are mapped with extents whenever the file system supports them.
+    if (has_flag(get_features_incompatible(), FeaturesIncompatible::Extents) && (is_regular_file(mode) || is_directory(mode))) {
+        e2inode.i_flags |= EXT4_EXTENTS_FL;
+        auto& header = *reinterpret_cast<ext4_extent_header*>(e2inode.i_block);
+        header.eh_magic = EXT4_EXT_MAGIC;
+        header.eh_max = (sizeof(e2inode.i_block) - sizeof(ext4_extent_header)) / sizeof(ext4_extent);
+    }
+
     auto inode_id = TRY(allocate_inode());
 
     dbgln_if(EXT2_DEBUG, "Ext2FS: writing initial metadata for inode {}", inode_id.value());
@@ -556,7 +640,7 @@ unsigned Ext2FS::total_block_count() const
 unsigned Ext2FS::free_block_count() const
 {
     MutexLocker locker(m_lock);
-    return super_block().s_free_blocks_count;
+    return super_block().s_free_blocks_count - m_reserved_block_count;
 }
 
 unsigned Ext2FS::total_inode_count() const
@@ -22,6 +22,13 @@ class Ext2FS final : public BlockBasedFileSystem {
     friend class Ext2FSInode;
 
 public:
+    // s_feature_compat
+    enum class FeaturesOptional : u32 {
+        None = 0,
+        DirectoryIndex = EXT2_FEATURE_COMPAT_DIR_INDEX,
+    };
+    AK_ENUM_BITWISE_FRIEND_OPERATORS(FeaturesOptional);
+
     // s_feature_ro_compat
     enum class FeaturesReadOnly : u32 {
         None = 0,
@@ -30,6 +37,13 @@ public:
     };
     AK_ENUM_BITWISE_FRIEND_OPERATORS(FeaturesReadOnly);
 
+    // s_feature_incompat
+    enum class FeaturesIncompatible : u32 {
+        None = 0,
+        Extents = EXT3_FEATURE_INCOMPAT_EXTENTS,
+    };
+    AK_ENUM_BITWISE_FRIEND_OPERATORS(FeaturesIncompatible);
+
     static ErrorOr<NonnullRefPtr<FileSystem>> try_create(OpenFileDescription&, ReadonlyBytes);
 
     virtual ~Ext2FS() override;
@@ -40,10 +54,13 @@ public:
     virtual unsigned free_inode_count() const override;
 
     virtual bool supports_watchers() const override { return true; }
+    virtual bool supports_dentry_cache() const override { return true; }
 
     virtual u8 internal_file_type_to_directory_entry_type(DirectoryEntryView const& entry) const override;
 
+    FeaturesOptional get_features_optional() const;
     FeaturesReadOnly get_features_readonly() const;
+    FeaturesIncompatible get_features_incompatible() const;
 
     virtual StringView class_name() const override { return "Ext2FS"sv; }
     virtual Inode& root_inode() override;
@@ -82,7 +99,12 @@ private:
     BlockIndex first_block_index() const;
     BlockIndex first_block_of_block_group_descriptors() const;
     ErrorOr<InodeIndex> allocate_inode(GroupIndex preferred_group = 0);
-    ErrorOr<Vector<BlockIndex>> allocate_blocks(GroupIndex preferred_group_index, size_t count);
+    // Allocates `count` blocks in as few contiguous runs as possible, starting at `goal` if it's free.
+    // `reserved_count` of them were reserved for delayed allocation with reserve_blocks() before.
+    ErrorOr<Vector<BlockIndex>> allocate_blocks(GroupIndex preferred_group_index, size_t count, BlockIndex goal = 0, size_t reserved_count = 0);
+    ErrorOr<void> allocate_block_run(GroupIndex, size_t first_index_in_group, size_t length, Vector<BlockIndex>&);
+    ErrorOr<void> reserve_blocks(size_t count);
+    void unreserve_blocks(size_t count);
     GroupIndex group_index_from_inode(InodeIndex) const;
     GroupIndex group_index_from_block_index(BlockIndex) const;
     BlockIndex first_block_of_group(GroupIndex) const;
@@ -111,6 +133,9 @@ private:
 
     mutable HashMap<InodeIndex, RefPtr<Ext2FSInode>> m_inode_cache;
 
+    // Blocks that files have grown by, but that haven't been allocated yet (see Ext2FSInode::resize()).
+    u64 m_reserved_block_count { 0 };
+
     bool m_super_block_dirty { false };
     bool m_block_group_descriptors_dirty { false };
 
@@ -6,6 +6,7 @@
  */
 
 #include <AK/MemoryStream.h>
+#include <AK/QuickSort.h>
 #include <Kernel/API/POSIX/errno.h>
 #include <Kernel/Debug.h>
 #include <Kernel/FileSystem/Ext2FS/Inode.h>
@@ -16,6 +17,14 @@ namespace Kernel {
 
 static constexpr size_t max_inline_symlink_length = 60;
 
+// Stands in for the blocks in m_block_list that are reserved, but not allocated yet.
+static constexpr u64 delayed_allocation_marker = NumericLimits<u64>::max();
+
+static bool is_hole(BlockBasedFileSystem::BlockIndex block_index)
+{
+    return block_index.value() == 0 || block_index.value() == delayed_allocation_marker;
+}
+
 static u8 to_ext2_file_type(mode_t mode)
 {
     if (is_regular_file(mode))
@@ -199,11 +208,43 @@ ErrorOr<void> Ext2FSInode::shrink_triply_indirect_block(BlockBasedFileSystem::Bl
     return {};
 }
 
+ErrorOr<void> Ext2FSInode::rewrite_indirect_block_entries(BlockBasedFileSystem::BlockIndex block, unsigned depth, Span<BlockBasedFileSystem::BlockIndex> blocks_indices, size_t first_changed_entry)
+{
+    VERIFY(depth > 0);
+    if (depth == 1)
+        return write_indirect_block(block, blocks_indices);
+
+    auto const entries_per_block = EXT2_ADDR_PER_BLOCK(&fs().super_block());
+    size_t entries_per_child = entries_per_block;
+    for (unsigned i = 2; i < depth; ++i)
+        entries_per_child *= entries_per_block;
+
+    auto block_contents = TRY(ByteBuffer::create_uninitialized(fs().logical_block_size()));
+    auto* block_as_pointers = (unsigned*)block_contents.data();
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(block_contents.data());
+    TRY(fs().read_block(block, &buffer, fs().logical_block_size()));
+
+    // Only descend into the children that cover a changed entry.
+    for (size_t i = first_changed_entry / entries_per_child; i * entries_per_child < blocks_indices.size(); ++i) {
+        auto const offset_block = i * entries_per_child;
+        auto const first_changed_in_child = first_changed_entry > offset_block ? first_changed_entry - offset_block : 0;
+        TRY(rewrite_indirect_block_entries(block_as_pointers[i], depth - 1, blocks_indices.slice(offset_block, min(blocks_indices.size() - offset_block, entries_per_child)), first_changed_in_child));
+    }
+    return {};
+}
+
 ErrorOr<void> Ext2FSInode::flush_block_list()
 {
     MutexLocker locker(m_inode_lock);
 
+    if (uses_extents()) {
+        TRY(flush_extent_tree());
+        m_first_unflushed_block = NumericLimits<size_t>::max();
+        return {};
+    }
+
     if (m_block_list.is_empty()) {
+        m_first_unflushed_block = NumericLimits<size_t>::max();
         m_raw_inode.i_blocks = 0;
         memset(m_raw_inode.i_block, 0, sizeof(m_raw_inode.i_block));
         set_metadata_dirty(true);
@@ -216,24 +257,37 @@ ErrorOr<void> Ext2FSInode::flush_block_list()
     auto old_shape = fs().compute_block_list_shape(old_block_count);
     auto const new_shape = fs().compute_block_list_shape(m_block_list.size());
 
+    // Blocks that are only reserved for delayed allocation are holes as far as the disk is concerned.
+    Vector<Ext2FS::BlockIndex> block_list;
+    TRY(block_list.try_ensure_capacity(m_block_list.size()));
+    size_t data_block_count = 0;
+    for (auto block_index : m_block_list) {
+        if (is_hole(block_index)) {
+            block_list.unchecked_append(0);
+            continue;
+        }
+        block_list.unchecked_append(block_index);
+        ++data_block_count;
+    }
+
     Vector<Ext2FS::BlockIndex> new_meta_blocks;
     if (new_shape.meta_blocks > old_shape.meta_blocks) {
         new_meta_blocks = TRY(fs().allocate_blocks(fs().group_index_from_inode(index()), new_shape.meta_blocks - old_shape.meta_blocks));
     }
 
-    m_raw_inode.i_blocks = (m_block_list.size() + new_shape.meta_blocks) * (fs().logical_block_size() / 512);
+    m_raw_inode.i_blocks = (data_block_count + new_shape.meta_blocks) * (fs().logical_block_size() / 512);
     dbgln_if(EXT2_BLOCKLIST_DEBUG, "Ext2FSInode[{}]::flush_block_list(): Old shape=({};{};{};{}:{}), new shape=({};{};{};{}:{})", identifier(), old_shape.direct_blocks, old_shape.indirect_blocks, old_shape.doubly_indirect_blocks, old_shape.triply_indirect_blocks, old_shape.meta_blocks, new_shape.direct_blocks, new_shape.indirect_blocks, new_shape.doubly_indirect_blocks, new_shape.triply_indirect_blocks, new_shape.meta_blocks);
 
     unsigned output_block_index = 0;
-    unsigned remaining_blocks = m_block_list.size();
+    unsigned remaining_blocks = block_list.size();
 
     // Deal with direct blocks.
     bool inode_dirty = false;
     VERIFY(new_shape.direct_blocks <= EXT2_NDIR_BLOCKS);
     for (unsigned i = 0; i < new_shape.direct_blocks; ++i) {
-        if (BlockBasedFileSystem::BlockIndex(m_raw_inode.i_block[i]) != m_block_list[output_block_index])
+        if (BlockBasedFileSystem::BlockIndex(m_raw_inode.i_block[i]) != block_list[output_block_index])
             inode_dirty = true;
-        m_raw_inode.i_block[i] = m_block_list[output_block_index].value();
+        m_raw_inode.i_block[i] = block_list[output_block_index].value();
         ++output_block_index;
         --remaining_blocks;
     }
@@ -248,9 +302,9 @@ ErrorOr<void> Ext2FSInode::flush_block_list()
     }
     if (inode_dirty) {
         if constexpr (EXT2_DEBUG) {
-            dbgln("Ext2FSInode[{}]::flush_block_list(): Writing {} direct block(s) to i_block array of inode {}", identifier(), min((size_t)EXT2_NDIR_BLOCKS, m_block_list.size()), index());
-            for (size_t i = 0; i < min((size_t)EXT2_NDIR_BLOCKS, m_block_list.size()); ++i)
-                dbgln("   + {}", m_block_list[i]);
+            dbgln("Ext2FSInode[{}]::flush_block_list(): Writing {} direct block(s) to i_block array of inode {}", identifier(), min((size_t)EXT2_NDIR_BLOCKS, block_list.size()), index());
+            for (size_t i = 0; i < min((size_t)EXT2_NDIR_BLOCKS, block_list.size()); ++i)
+                dbgln("   + {}", block_list[i]);
         }
         set_metadata_dirty(true);
     }
@@ -267,7 +321,7 @@ ErrorOr<void> Ext2FSInode::flush_block_list()
                 old_shape.meta_blocks++;
             }
 
-            TRY(write_indirect_block(m_raw_inode.i_block[EXT2_IND_BLOCK], m_block_list.span().slice(output_block_index, new_shape.indirect_blocks)));
+            TRY(write_indirect_block(m_raw_inode.i_block[EXT2_IND_BLOCK], block_list.span().slice(output_block_index, new_shape.indirect_blocks)));
         } else if ((new_shape.indirect_blocks == 0) && (old_shape.indirect_blocks != 0)) {
             dbgln_if(EXT2_BLOCKLIST_DEBUG, "Ext2FSInode[{}]::flush_block_list(): Freeing indirect block: {}", identifier(), m_raw_inode.i_block[EXT2_IND_BLOCK]);
             TRY(fs().set_block_allocation_state(m_raw_inode.i_block[EXT2_IND_BLOCK], false));
@@ -289,7 +343,7 @@ ErrorOr<void> Ext2FSInode::flush_block_list()
                 set_metadata_dirty(true);
                 old_shape.meta_blocks++;
             }
-            TRY(grow_doubly_indirect_block(m_raw_inode.i_block[EXT2_DIND_BLOCK], old_shape.doubly_indirect_blocks, m_block_list.span().slice(output_block_index, new_shape.doubly_indirect_blocks), new_meta_blocks, old_shape.meta_blocks));
+            TRY(grow_doubly_indirect_block(m_raw_inode.i_block[EXT2_DIND_BLOCK], old_shape.doubly_indirect_blocks, block_list.span().slice(output_block_index, new_shape.doubly_indirect_blocks), new_meta_blocks, old_shape.meta_blocks));
         } else {
             TRY(shrink_doubly_indirect_block(m_raw_inode.i_block[EXT2_DIND_BLOCK], old_shape.doubly_indirect_blocks, new_shape.doubly_indirect_blocks, old_shape.meta_blocks));
             if (new_shape.doubly_indirect_blocks == 0)
@@ -310,7 +364,7 @@ ErrorOr<void> Ext2FSInode::flush_block_list()
                 set_metadata_dirty(true);
                 old_shape.meta_blocks++;
             }
-            TRY(grow_triply_indirect_block(m_raw_inode.i_block[EXT2_TIND_BLOCK], old_shape.triply_indirect_blocks, m_block_list.span().slice(output_block_index, new_shape.triply_indirect_blocks), new_meta_blocks, old_shape.meta_blocks));
+            TRY(grow_triply_indirect_block(m_raw_inode.i_block[EXT2_TIND_BLOCK], old_shape.triply_indirect_blocks, block_list.span().slice(output_block_index, new_shape.triply_indirect_blocks), new_meta_blocks, old_shape.meta_blocks));
         } else {
             TRY(shrink_triply_indirect_block(m_raw_inode.i_block[EXT2_TIND_BLOCK], old_shape.triply_indirect_blocks, new_shape.triply_indirect_blocks, old_shape.meta_blocks));
             if (new_shape.triply_indirect_blocks == 0)
@@ -321,6 +375,31 @@ ErrorOr<void> Ext2FSInode::flush_block_list()
     remaining_blocks -= new_shape.triply_indirect_blocks;
     output_block_index += new_shape.triply_indirect_blocks;
 
+    // Growing and shrinking above only write out the tail of each level, but allocate_missing_blocks()
+    // replaces reserved entries anywhere in the list without changing its shape.
+    if (m_first_unflushed_block < block_list.size()) {
+        struct IndirectLevel {
+            unsigned slot;
+            unsigned depth;
+            size_t length;
+        };
+        IndirectLevel const levels[] = {
+            { EXT2_IND_BLOCK, 1, new_shape.indirect_blocks },
+            { EXT2_DIND_BLOCK, 2, new_shape.doubly_indirect_blocks },
+            { EXT2_TIND_BLOCK, 3, new_shape.triply_indirect_blocks },
+        };
+        size_t level_start = new_shape.direct_blocks;
+        for (auto const& level : levels) {
+            if (level.length > 0 && m_first_unflushed_block < level_start + level.length) {
+                auto const first_changed_entry = m_first_unflushed_block > level_start ? m_first_unflushed_block - level_start : 0;
+                dbgln_if(EXT2_BLOCKLIST_DEBUG, "Ext2FSInode[{}]::flush_block_list(): Rewriting depth {} indirect block {} from entry {}", identifier(), level.depth, m_raw_inode.i_block[level.slot], first_changed_entry);
+                TRY(rewrite_indirect_block_entries(m_raw_inode.i_block[level.slot], level.depth, block_list.span().slice(level_start, level.length), first_changed_entry));
+            }
+            level_start += level.length;
+        }
+    }
+    m_first_unflushed_block = NumericLimits<size_t>::max();
+
     dbgln_if(EXT2_BLOCKLIST_DEBUG, "Ext2FSInode[{}]::flush_block_list(): New meta blocks count at {}, expecting {}", identifier(), old_shape.meta_blocks, new_shape.meta_blocks);
     VERIFY(new_meta_blocks.size() == 0);
     VERIFY(old_shape.meta_blocks == new_shape.meta_blocks);
@@ -331,6 +410,163 @@ ErrorOr<void> Ext2FSInode::flush_block_list()
     VERIFY_NOT_REACHED();
 }
 
+ErrorOr<void> Ext2FSInode::read_extent_tree_node(ReadonlyBytes node, Optional<u16> expected_depth, Vector<Ext2FS::BlockIndex>& block_list, Vector<Ext2FS::BlockIndex>* tree_blocks) const
+{
+    if (node.size() < sizeof(ext4_extent_header))
+        return EIO;
+    auto const& header = *reinterpret_cast<ext4_extent_header const*>(node.data());
+    if (header.eh_magic != EXT4_EXT_MAGIC || header.eh_entries > header.eh_max
+        || sizeof(ext4_extent_header) + header.eh_max * sizeof(ext4_extent) > node.size()
+        || header.eh_depth > EXT4_MAX_EXTENT_DEPTH || (expected_depth.has_value() && header.eh_depth != expected_depth.value())) {
+        dbgln("Ext2FSInode[{}]::read_extent_tree_node(): Invalid extent tree node (magic={:#04x}, entries={}, max={}, depth={})", identifier(), header.eh_magic, header.eh_entries, header.eh_max, header.eh_depth);
+        return EIO;
+    }
+
+    if (header.eh_depth == 0) {
+        auto const* extents = reinterpret_cast<ext4_extent const*>(node.offset(sizeof(ext4_extent_header)));
+        for (size_t i = 0; i < header.eh_entries; ++i) {
+            auto const& extent = extents[i];
+            // FIXME: Support uninitialized extents, which are allocated but read as zeroes.
+            if (extent.ee_len > EXT4_INIT_MAX_LEN) {
+                dbgln("Ext2FSInode[{}]::read_extent_tree_node(): Uninitialized extents are not supported", identifier());
+                return ENOTSUP;
+            }
+            u64 start = (static_cast<u64>(extent.ee_start_hi) << 32) | extent.ee_start_lo;
+            for (size_t j = 0; j < extent.ee_len && extent.ee_block + j < block_list.size(); ++j)
+                block_list[extent.ee_block + j] = start + j;
+        }
+        return {};
+    }
+
+    auto block_size = fs().logical_block_size();
+    auto block_buffer = TRY(ByteBuffer::create_uninitialized(block_size));
+    auto const* indices = reinterpret_cast<ext4_extent_idx const*>(node.offset(sizeof(ext4_extent_header)));
+    for (size_t i = 0; i < header.eh_entries; ++i) {
+        Ext2FS::BlockIndex leaf = (static_cast<u64>(indices[i].ei_leaf_hi) << 32) | indices[i].ei_leaf_lo;
+        if (tree_blocks)
+            TRY(tree_blocks->try_append(leaf));
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(block_buffer.data());
+        TRY(fs().read_block(leaf, &buffer, block_size));
+        TRY(read_extent_tree_node(block_buffer.bytes(), header.eh_depth - 1, block_list, tree_blocks));
+    }
+    return {};
+}
+
+ErrorOr<void> Ext2FSInode::flush_extent_tree()
+{
+    VERIFY(m_inode_lock.is_locked());
+
+    auto const block_size = fs().logical_block_size();
+    constexpr size_t root_capacity = (sizeof(m_raw_inode.i_block) - sizeof(ext4_extent_header)) / sizeof(ext4_extent);
+    size_t const node_capacity = (block_size - sizeof(ext4_extent_header)) / sizeof(ext4_extent);
+
+    // Describe the block list as runs of contiguous blocks. Holes (and blocks that are only reserved) are left out.
+    Vector<ext4_extent> extents;
+    size_t data_block_count = 0;
+    for (size_t i = 0; i < m_block_list.size(); ++i) {
+        auto block_index = m_block_list[i];
+        if (is_hole(block_index))
+            continue;
+        ++data_block_count;
+        if (!extents.is_empty()) {
+            auto& last = extents.last();
+            u64 last_start = (static_cast<u64>(last.ee_start_hi) << 32) | last.ee_start_lo;
+            if (last.ee_block + last.ee_len == i && last_start + last.ee_len == block_index.value() && last.ee_len < EXT4_INIT_MAX_LEN) {
+                ++last.ee_len;
+                continue;
+            }
+        }
+        ext4_extent extent {};
+        extent.ee_block = i;
+        extent.ee_len = 1;
+        extent.ee_start_hi = block_index.value() >> 32;
+        extent.ee_start_lo = block_index.value() & 0xffffffff;
+        TRY(extents.try_append(extent));
+    }
+
+    // Work out how many nodes each level of the tree needs, from the leaves up to (but not including) the root.
+    Vector<size_t, EXT4_MAX_EXTENT_DEPTH> level_node_counts;
+    for (size_t entries = extents.size(); entries > root_capacity; entries = level_node_counts.last()) {
+        if (level_node_counts.size() == EXT4_MAX_EXTENT_DEPTH)
+            return EFBIG;
+        level_node_counts.append(ceil_div(entries, node_capacity));
+    }
+    size_t tree_block_count = 0;
+    for (auto count : level_node_counts)
+        tree_block_count += count;
+
+    // Reuse the blocks of the current tree, and only allocate or free the difference.
+    Vector<Ext2FS::BlockIndex> tree_blocks;
+    {
+        Vector<Ext2FS::BlockIndex> no_blocks;
+        TRY(read_extent_tree_node({ m_raw_inode.i_block, sizeof(m_raw_inode.i_block) }, {}, no_blocks, &tree_blocks));
+    }
+    while (tree_blocks.size() > tree_block_count)
+        TRY(fs().set_block_allocation_state(tree_blocks.take_last(), false));
+    if (tree_blocks.size() < tree_block_count) {
+        Ext2FS::BlockIndex goal = 0;
+        if (!extents.is_empty())
+            goal = ((static_cast<u64>(extents.last().ee_start_hi) << 32) | extents.last().ee_start_lo) + extents.last().ee_len;
+        auto new_blocks = TRY(fs().allocate_blocks(fs().group_index_from_inode(index()), tree_block_count - tree_blocks.size(), goal));
+        TRY(tree_blocks.try_extend(move(new_blocks)));
+    }
+
+    // Write out the levels bottom-up, each one becoming the list of entries for the level above it.
+    auto block_buffer = TRY(ByteBuffer::create_zeroed(block_size));
+    Vector<ext4_extent_idx> indices;
+    size_t next_tree_block = 0;
+    u16 depth = 0;
+    for (auto node_count : level_node_counts) {
+        Vector<ext4_extent_idx> parent_indices;
+        TRY(parent_indices.try_ensure_capacity(node_count));
+        size_t entry_count = depth == 0 ? extents.size() : indices.size();
+        for (size_t node = 0; node < node_count; ++node) {
+            size_t first = node * node_capacity;
+            size_t count = min(node_capacity, entry_count - first);
+
+            block_buffer.zero_fill();
+            auto& header = *reinterpret_cast<ext4_extent_header*>(block_buffer.data());
+            header.eh_magic = EXT4_EXT_MAGIC;
+            header.eh_entries = count;
+            header.eh_max = node_capacity;
+            header.eh_depth = depth;
+            if (depth == 0)
+                memcpy(block_buffer.offset_pointer(sizeof(header)), &extents[first], count * sizeof(ext4_extent));
+            else
+                memcpy(block_buffer.offset_pointer(sizeof(header)), &indices[first], count * sizeof(ext4_extent_idx));
+
+            auto tree_block = tree_blocks[next_tree_block++];
+            auto buffer = UserOrKernelBuffer::for_kernel_buffer(block_buffer.data());
+            TRY(fs().write_block(tree_block, buffer, block_size));
+
+            ext4_extent_idx index_entry {};
+            index_entry.ei_block = depth == 0 ? extents[first].ee_block : indices[first].ei_block;
+            index_entry.ei_leaf_lo = tree_block.value() & 0xffffffff;
+            index_entry.ei_leaf_hi = tree_block.value() >> 32;
+            parent_indices.unchecked_append(index_entry);
+        }
+        indices = move(parent_indices);
+        ++depth;
+    }
+
+    memset(m_raw_inode.i_block, 0, sizeof(m_raw_inode.i_block));
+    auto& root_header = *reinterpret_cast<ext4_extent_header*>(m_raw_inode.i_block);
+    root_header.eh_magic = EXT4_EXT_MAGIC;
+    root_header.eh_max = root_capacity;
+    root_header.eh_depth = depth;
+    if (depth == 0) {
+        root_header.eh_entries = extents.size();
+        memcpy(&root_header + 1, extents.data(), extents.size() * sizeof(ext4_extent));
+    } else {
+        root_header.eh_entries = indices.size();
+        memcpy(&root_header + 1, indices.data(), indices.size() * sizeof(ext4_extent_idx));
+    }
+
+    m_raw_inode.i_blocks = (data_block_count + tree_block_count) * (block_size / 512);
+    set_metadata_dirty(true);
+    return {};
+}
+
 ErrorOr<Vector<Ext2FS::BlockIndex>> Ext2FSInode::compute_block_list() const
 {
     return compute_block_list_impl(false);
@@ -344,10 +580,8 @@ ErrorOr<Vector<Ext2FS::BlockIndex>> Ext2FSInode::compute_block_list_with_meta_bl
 ErrorOr<Vector<Ext2FS::BlockIndex>> Ext2FSInode::compute_block_list_impl(bool include_block_list_blocks) const
 {
     // FIXME: This is really awkwardly factored.. foo_impl_internal :|
-    auto block_list = TRY(compute_block_list_impl_internal(m_raw_inode, include_block_list_blocks));
-    while (!block_list.is_empty() && block_list.last() == 0)
-        block_list.take_last();
-    return block_list;
+    // NOTE: Holes (including those at the end of a sparse file) are kept as zeroes, so that the list covers the whole file.
+    return compute_block_list_impl_internal(m_raw_inode, include_block_list_blocks);
 }
 
 ErrorOr<Vector<Ext2FS::BlockIndex>> Ext2FSInode::compute_block_list_impl_internal(ext2_inode const& e2inode, bool include_block_list_blocks) const
@@ -366,6 +600,15 @@ ErrorOr<Vector<Ext2FS::BlockIndex>> Ext2FSInode::compute_block_list_impl_interna
 
     dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::block_list_for_inode(): i_size={}, i_blocks={}, block_count={}", identifier(), e2inode.i_size, e2inode.i_blocks, block_count);
 
+    if (e2inode.i_flags & EXT4_EXTENTS_FL) {
+        Vector<Ext2FS::BlockIndex> list;
+        TRY(list.try_resize(block_count));
+        Vector<Ext2FS::BlockIndex> tree_blocks;
+        TRY(read_extent_tree_node({ e2inode.i_block, sizeof(e2inode.i_block) }, {}, list, include_block_list_blocks ? &tree_blocks : nullptr));
+        TRY(list.try_extend(move(tree_blocks)));
+        return list;
+    }
+
     unsigned blocks_remaining = block_count;
 
     if (include_block_list_blocks) {
@@ -451,6 +694,8 @@ Ext2FSInode::Ext2FSInode(Ext2FS& fs, InodeIndex index)
 
 Ext2FSInode::~Ext2FSInode()
 {
+    if (m_delayed_block_count > 0)
+        fs().unreserve_blocks(m_delayed_block_count);
     if (m_raw_inode.i_links_count == 0) {
         // Alas, we have nowhere to propagate any errors that occur here.
         (void)fs().free_inode(*this);
@@ -524,6 +769,17 @@ ErrorOr<void> Ext2FSInode::compute_block_list_with_exclusive_locking()
 }
 
 ErrorOr<size_t> Ext2FSInode::read_bytes_locked(off_t offset, size_t count, UserOrKernelBuffer& buffer, OpenFileDescription* description) const
+{
+    return read_bytes_impl(offset, count, buffer, !description || !description->is_direct());
+}
+
+ErrorOr<size_t> Ext2FSInode::read_bytes_for_page_cache(off_t offset, size_t count, UserOrKernelBuffer& buffer) const
+{
+    // The page cache holds on to the data itself, so keeping another copy in the block cache is a waste.
+    return read_bytes_impl(offset, count, buffer, false);
+}
+
+ErrorOr<size_t> Ext2FSInode::read_bytes_impl(off_t offset, size_t count, UserOrKernelBuffer& buffer, bool allow_cache) const
 {
     VERIFY(m_inode_lock.is_locked());
     VERIFY(offset >= 0);
@@ -554,8 +810,6 @@ ErrorOr<size_t> Ext2FSInode::read_bytes_locked(off_t offset, size_t count, UserO
         return EIO;
     }
 
-    bool allow_cache = !description || !description->is_direct();
-
     int const block_size = fs().logical_block_size();
 
     BlockBasedFileSystem::BlockIndex first_block_logical_index = offset / block_size;
@@ -575,7 +829,7 @@ ErrorOr<size_t> Ext2FSInode::read_bytes_locked(off_t offset, size_t count, UserO
         size_t offset_into_block = (bi == first_block_logical_index) ? offset_into_first_block : 0;
         size_t num_bytes_to_copy = min((size_t)block_size - offset_into_block, (size_t)remaining_count);
         auto buffer_offset = buffer.offset(nread);
-        if (block_index.value() == 0) {
+        if (is_hole(block_index)) {
             // This is a hole, act as if it's filled with zeroes.
             TRY(buffer_offset.memset(0, num_bytes_to_copy));
         } else {
@@ -591,7 +845,43 @@ ErrorOr<size_t> Ext2FSInode::read_bytes_locked(off_t offset, size_t count, UserO
     return nread;
 }
 
-ErrorOr<void> Ext2FSInode::resize(u64 new_size)
+size_t Ext2FSInode::read_ahead(u64 offset, size_t length) const
+{
+    MutexLocker locker(m_inode_lock, Mutex::Mode::Shared);
+    if (!Kernel::is_regular_file(m_raw_inode.i_mode) || offset >= size())
+        return length;
+
+    if (const_cast<Ext2FSInode&>(*this).compute_block_list_with_exclusive_locking().is_error())
+        return 0;
+
+    auto block_size = fs().logical_block_size();
+    auto first_block_logical_index = offset / block_size;
+    auto end_block_logical_index = min(ceil_div(min(offset + length, size()), block_size), static_cast<u64>(m_block_list.size()));
+
+    Vector<BlockBasedFileSystem::BlockIndex, 32> blocks;
+    Vector<u64, 32> logical_indices;
+    for (auto bi = first_block_logical_index; bi < end_block_logical_index; ++bi) {
+        if (is_hole(m_block_list[bi]))
+            continue;
+        if (blocks.try_append(m_block_list[bi]).is_error() || logical_indices.try_append(bi).is_error()) {
+            end_block_logical_index = bi;
+            blocks.shrink(logical_indices.size());
+            break;
+        }
+    }
+
+    dbgln_if(EXT2_VERY_DEBUG, "Ext2FSInode[{}]::read_ahead(): Reading ahead {} blocks from logical block {}", identifier(), blocks.size(), first_block_logical_index);
+    auto handled_blocks = fs().read_ahead_blocks(blocks.span());
+
+    if (handled_blocks == blocks.size() && end_block_logical_index * block_size >= min(offset + length, size()))
+        return length;
+
+    // Holes in front of the first block that wasn't read ahead count as taken care of.
+    u64 handled_end = handled_blocks < blocks.size() ? logical_indices[handled_blocks] * block_size : end_block_logical_index * block_size;
+    return handled_end > offset ? static_cast<size_t>(handled_end - offset) : 0;
+}
+
+ErrorOr<void> Ext2FSInode::resize(u64 new_size, BlockAllocation allocation)
 {
     auto old_size = size();
     if (old_size == new_size)
@@ -609,18 +899,28 @@ ErrorOr<void> Ext2FSInode::resize(u64 new_size)
         dbgln("Ext2FSInode[{}]::resize(): Blocks needed after  (size is  {}): {}", identifier(), new_size, blocks_needed_after);
     }
 
-    if (blocks_needed_after > blocks_needed_before) {
-        auto additional_blocks_needed = blocks_needed_after - blocks_needed_before;
-        if (additional_blocks_needed > fs().super_block().s_free_blocks_count)
-            return ENOSPC;
-    }
-
     if (m_block_list.is_empty())
         m_block_list = TRY(compute_block_list());
 
     if (blocks_needed_after > blocks_needed_before) {
-        auto blocks = TRY(fs().allocate_blocks(fs().group_index_from_inode(index()), blocks_needed_after - blocks_needed_before));
-        TRY(m_block_list.try_extend(move(blocks)));
+        auto additional_blocks_needed = blocks_needed_after - blocks_needed_before;
+        if (allocation == BlockAllocation::Delayed) {
+            TRY(fs().reserve_blocks(additional_blocks_needed));
+            if (auto result = m_block_list.try_ensure_capacity(m_block_list.size() + additional_blocks_needed); result.is_error()) {
+                fs().unreserve_blocks(additional_blocks_needed);
+                return result.release_error();
+            }
+            for (size_t i = 0; i < additional_blocks_needed; ++i)
+                m_block_list.unchecked_append(delayed_allocation_marker);
+            m_delayed_block_count += additional_blocks_needed;
+        } else {
+            // Try to continue where the file currently ends, so that it stays contiguous.
+            Ext2FS::BlockIndex goal = 0;
+            if (!m_block_list.is_empty() && !is_hole(m_block_list.last()))
+                goal = m_block_list.last().value() + 1;
+            auto blocks = TRY(fs().allocate_blocks(fs().group_index_from_inode(index()), additional_blocks_needed, goal));
+            TRY(m_block_list.try_extend(move(blocks)));
+        }
     } else if (blocks_needed_after < blocks_needed_before) {
         if constexpr (EXT2_VERY_DEBUG) {
             dbgln("Ext2FSInode[{}]::resize(): Shrinking inode, old block list is {} entries:", identifier(), m_block_list.size());
@@ -630,7 +930,10 @@ ErrorOr<void> Ext2FSInode::resize(u64 new_size)
         }
         while (m_block_list.size() != blocks_needed_after) {
             auto block_index = m_block_list.take_last();
-            if (block_index.value()) {
+            if (block_index.value() == delayed_allocation_marker) {
+                fs().unreserve_blocks(1);
+                --m_delayed_block_count;
+            } else if (block_index.value()) {
                 if (auto result = fs().set_block_allocation_state(block_index, false); result.is_error()) {
                     dbgln("Ext2FSInode[{}]::resize(): Failed to free block {}: {}", identifier(), block_index, result.error());
                     return result;
@@ -649,12 +952,22 @@ ErrorOr<void> Ext2FSInode::resize(u64 new_size)
 
     if (new_size > old_size) {
         // If we're growing the inode, make sure we zero out all the new space.
+        // Holes (including blocks that are only reserved) already read as zeroes, so then only the rest
+        // of what used to be the last block needs clearing.
         // FIXME: There are definitely more efficient ways to achieve this.
-        auto bytes_to_clear = new_size - old_size;
+        auto clear_to = new_size;
+        if (allocation == BlockAllocation::Delayed) {
+            clear_to = min(new_size, blocks_needed_before * block_size);
+            if (blocks_needed_before > 0 && is_hole(m_block_list[blocks_needed_before - 1]))
+                clear_to = old_size;
+        }
+        auto bytes_to_clear = clear_to - old_size;
         auto clear_from = old_size;
-        u8 zero_buffer[PAGE_SIZE] {};
+        // NOTE: This is on the heap, as write_bytes_impl() needs a block's worth of zeroes of its own.
+        auto zero_buffer = TRY(ByteBuffer::create_zeroed(min(bytes_to_clear, static_cast<u64>(PAGE_SIZE))));
         while (bytes_to_clear) {
-            auto nwritten = TRY(write_bytes(clear_from, min(static_cast<u64>(sizeof(zero_buffer)), bytes_to_clear), UserOrKernelBuffer::for_kernel_buffer(zero_buffer), nullptr));
+            // NOTE: This goes around the page cache, which already has zeroes past the old end of the file.
+            auto nwritten = TRY(write_bytes_impl(clear_from, min(static_cast<u64>(zero_buffer.size()), bytes_to_clear), UserOrKernelBuffer::for_kernel_buffer(zero_buffer.data()), true));
             VERIFY(nwritten != 0);
             bytes_to_clear -= nwritten;
             clear_from += nwritten;
@@ -664,7 +977,63 @@ ErrorOr<void> Ext2FSInode::resize(u64 new_size)
     return {};
 }
 
+ErrorOr<void> Ext2FSInode::grow_with_delayed_allocation(u64 new_size)
+{
+    MutexLocker locker(m_inode_lock);
+    VERIFY(new_size > size());
+    return resize(new_size, BlockAllocation::Delayed);
+}
+
+ErrorOr<void> Ext2FSInode::allocate_missing_blocks(size_t first_block, size_t end_block)
+{
+    VERIFY(m_inode_lock.is_exclusively_locked_by_current_thread());
+    VERIFY(end_block <= m_block_list.size());
+
+    bool allocated_any_blocks = false;
+    for (size_t block = first_block; block < end_block;) {
+        if (!is_hole(m_block_list[block])) {
+            ++block;
+            continue;
+        }
+
+        size_t run_start = block;
+        size_t reserved_count = 0;
+        for (; block < end_block && is_hole(m_block_list[block]); ++block) {
+            if (m_block_list[block].value() == delayed_allocation_marker)
+                ++reserved_count;
+        }
+
+        // Try to continue right after the block in front of the run, so that the file stays contiguous.
+        Ext2FS::BlockIndex goal = 0;
+        if (run_start > 0 && !is_hole(m_block_list[run_start - 1]))
+            goal = m_block_list[run_start - 1].value() + 1;
+
+        auto blocks = TRY(fs().allocate_blocks(fs().group_index_from_inode(index()), block - run_start, goal, reserved_count));
+        m_delayed_block_count -= reserved_count;
+        for (size_t i = 0; i < blocks.size(); ++i)
+            m_block_list[run_start + i] = blocks[i];
+        m_first_unflushed_block = min(m_first_unflushed_block, run_start);
+        allocated_any_blocks = true;
+    }
+
+    if (allocated_any_blocks)
+        TRY(flush_block_list());
+    return {};
+}
+
 ErrorOr<size_t> Ext2FSInode::write_bytes_locked(off_t offset, size_t count, UserOrKernelBuffer const& data, OpenFileDescription* description)
+{
+    auto nwritten = TRY(write_bytes_impl(offset, count, data, !description || !description->is_direct()));
+    did_modify_contents();
+    return nwritten;
+}
+
+ErrorOr<size_t> Ext2FSInode::write_bytes_for_page_cache(off_t offset, size_t count, UserOrKernelBuffer const& data)
+{
+    return write_bytes_impl(offset, count, data, false);
+}
+
+ErrorOr<size_t> Ext2FSInode::write_bytes_impl(off_t offset, size_t count, UserOrKernelBuffer const& data, bool allow_cache)
 {
     VERIFY(m_inode_lock.is_locked());
     VERIFY(offset >= 0);
@@ -684,8 +1053,6 @@ ErrorOr<size_t> Ext2FSInode::write_bytes_locked(off_t offset, size_t count, User
         }
     }
 
-    bool allow_cache = !description || !description->is_direct();
-
     auto const block_size = fs().logical_block_size();
     auto new_size = max(static_cast<u64>(offset) + count, size());
 
@@ -699,6 +1066,32 @@ ErrorOr<size_t> Ext2FSInode::write_bytes_locked(off_t offset, size_t count, User
         return EIO;
     }
 
+    // Allocate whatever we're about to write into that's still a hole. If there are any, this is usually the page cache
+    // writing back a whole run of pages, so that the blocks can be allocated contiguously in one go.
+    {
+        u64 write_end = min(static_cast<u64>(offset) + count, new_size);
+        size_t first_block = offset / block_size;
+        size_t end_block = min(ceil_div(write_end, static_cast<u64>(block_size)), static_cast<u64>(m_block_list.size()));
+        bool first_block_is_partial = offset % block_size != 0 || write_end < (first_block + 1) * static_cast<u64>(block_size);
+        bool last_block_is_partial = write_end % block_size != 0;
+        bool first_block_was_hole = first_block < end_block && is_hole(m_block_list[first_block]);
+        bool last_block_was_hole = first_block < end_block && is_hole(m_block_list[end_block - 1]);
+
+        TRY(allocate_missing_blocks(first_block, end_block));
+
+        // A freshly allocated block may contain anything, so clear the parts of it that we aren't about to overwrite.
+        bool should_clear_first_block = first_block_was_hole && first_block_is_partial;
+        bool should_clear_last_block = last_block_was_hole && last_block_is_partial && end_block - 1 != first_block;
+        if (should_clear_first_block || should_clear_last_block) {
+            auto zero_buffer = TRY(ByteBuffer::create_zeroed(block_size));
+            auto zero_buffer_view = UserOrKernelBuffer::for_kernel_buffer(zero_buffer.data());
+            if (should_clear_first_block)
+                TRY(fs().write_block(m_block_list[first_block], zero_buffer_view, block_size, 0, allow_cache));
+            if (should_clear_last_block)
+                TRY(fs().write_block(m_block_list[end_block - 1], zero_buffer_view, block_size, 0, allow_cache));
+        }
+    }
+
     BlockBasedFileSystem::BlockIndex first_block_logical_index = offset / block_size;
     BlockBasedFileSystem::BlockIndex last_block_logical_index = (offset + count) / block_size;
     if (last_block_logical_index >= m_block_list.size())
@@ -723,8 +1116,6 @@ ErrorOr<size_t> Ext2FSInode::write_bytes_locked(off_t offset, size_t count, User
         nwritten += num_bytes_to_copy;
     }
 
-    did_modify_contents();
-
     dbgln_if(EXT2_VERY_DEBUG, "Ext2FSInode[{}]::write_bytes_locked(): After write, i_size={}, i_blocks={} ({} blocks in list)", identifier(), size(), m_raw_inode.i_blocks, m_block_list.size());
     return nwritten;
 }
@@ -813,12 +1204,547 @@ ErrorOr<void> Ext2FSInode::write_directory(Vector<Ext2FSDirectoryEntry>& entries
 
     auto buffer = UserOrKernelBuffer::for_kernel_buffer(directory_data.data());
     auto nwritten = TRY(write_bytes(0, serialized_bytes_count, buffer, nullptr));
+    // A linear rewrite doesn't keep any directory index around.
+    m_raw_inode.i_flags &= ~EXT2_INDEX_FL;
     set_metadata_dirty(true);
     if (nwritten != directory_data.size())
         return EIO;
     return {};
 }
 
+static ext2_dir_entry_2& directory_entry_at(Bytes block, size_t offset)
+{
+    return *reinterpret_cast<ext2_dir_entry_2*>(block.data() + offset);
+}
+
+static u16 index_limit(size_t block_size, size_t entries_offset)
+{
+    return (block_size - entries_offset) / sizeof(ext2_dx_entry);
+}
+
+// Makes sure that the entries of a directory block neatly cover it, so that we can walk them without further checks.
+static ErrorOr<void> validate_directory_block(ReadonlyBytes block)
+{
+    size_t offset = 0;
+    while (offset < block.size()) {
+        if (block.size() - offset < 8)
+            return EIO;
+        auto const& entry = *reinterpret_cast<ext2_dir_entry_2 const*>(block.data() + offset);
+        if (entry.rec_len < 8 || entry.rec_len % 4 != 0 || entry.rec_len > block.size() - offset)
+            return EIO;
+        if (entry.inode != 0 && EXT2_DIR_REC_LEN(entry.name_len) > entry.rec_len)
+            return EIO;
+        offset += entry.rec_len;
+    }
+    return {};
+}
+
+static Optional<size_t> find_entry_in_directory_block(Bytes block, StringView name)
+{
+    for (size_t offset = 0; offset < block.size(); offset += directory_entry_at(block, offset).rec_len) {
+        auto const& entry = directory_entry_at(block, offset);
+        if (entry.inode != 0 && StringView { entry.name, entry.name_len } == name)
+            return offset;
+    }
+    return {};
+}
+
+// Puts a new entry into the first gap that is large enough for it, if there is one.
+static bool try_insert_into_directory_block(Bytes block, StringView name, InodeIndex inode_index, u8 file_type)
+{
+    u16 needed_length = EXT2_DIR_REC_LEN(name.length());
+    for (size_t offset = 0; offset < block.size(); offset += directory_entry_at(block, offset).rec_len) {
+        auto& entry = directory_entry_at(block, offset);
+        u16 used_length = entry.inode != 0 ? EXT2_DIR_REC_LEN(entry.name_len) : 0;
+        if (entry.rec_len - used_length < needed_length)
+            continue;
+
+        size_t new_offset = offset + used_length;
+        u16 new_record_length = entry.rec_len - used_length;
+        if (used_length != 0)
+            entry.rec_len = used_length;
+
+        auto& new_entry = directory_entry_at(block, new_offset);
+        new_entry.inode = inode_index.value();
+        new_entry.rec_len = new_record_length;
+        new_entry.name_len = name.length();
+        new_entry.file_type = file_type;
+        memcpy(new_entry.name, name.characters_without_null_termination(), name.length());
+        return true;
+    }
+    return false;
+}
+
+static void remove_from_directory_block(Bytes block, size_t entry_offset)
+{
+    auto& entry = directory_entry_at(block, entry_offset);
+    // Merge the entry into the one before it, or mark it as unused if it's the first one in the block.
+    for (size_t offset = 0; offset < entry_offset; offset += directory_entry_at(block, offset).rec_len) {
+        auto& previous_entry = directory_entry_at(block, offset);
+        if (offset + previous_entry.rec_len == entry_offset) {
+            previous_entry.rec_len += entry.rec_len;
+            return;
+        }
+    }
+    entry.inode = 0;
+}
+
+bool Ext2FSInode::has_directory_index() const
+{
+    return is_directory()
+        && (m_raw_inode.i_flags & EXT2_INDEX_FL)
+        && has_flag(fs().get_features_optional(), Ext2FS::FeaturesOptional::DirectoryIndex);
+}
+
+u8 Ext2FSInode::effective_hash_version(u8 hash_version) const
+{
+    if (hash_version <= EXT2_HASH_TEA && (fs().super_block().s_flags & EXT2_FLAGS_UNSIGNED_HASH))
+        return hash_version + EXT2_HASH_LEGACY_UNSIGNED;
+    return hash_version;
+}
+
+ErrorOr<void> Ext2FSInode::read_directory_block(u32 block, Bytes buffer) const
+{
+    auto block_size = fs().logical_block_size();
+    VERIFY(buffer.size() == block_size);
+    if ((static_cast<u64>(block) + 1) * block_size > size())
+        return EIO;
+    auto user_buffer = UserOrKernelBuffer::for_kernel_buffer(buffer.data());
+    auto nread = TRY(read_bytes(static_cast<u64>(block) * block_size, block_size, user_buffer, nullptr));
+    if (nread != block_size)
+        return EIO;
+    return {};
+}
+
+ErrorOr<void> Ext2FSInode::write_directory_block(u32 block, ReadonlyBytes buffer)
+{
+    auto block_size = fs().logical_block_size();
+    VERIFY(buffer.size() == block_size);
+    auto user_buffer = UserOrKernelBuffer::for_kernel_buffer(const_cast<u8*>(buffer.data()));
+    auto nwritten = TRY(write_bytes(static_cast<u64>(block) * block_size, block_size, user_buffer, nullptr));
+    if (nwritten != block_size)
+        return EIO;
+    return {};
+}
+
+ErrorOr<u32> Ext2FSInode::append_directory_block()
+{
+    auto block_size = fs().logical_block_size();
+    auto block = size() / block_size;
+    if (block > NumericLimits<u32>::max())
+        return ENOSPC;
+    TRY(resize((block + 1) * block_size));
+    return static_cast<u32>(block);
+}
+
+ErrorOr<Ext2FSInode::DirectoryIndexPath> Ext2FSInode::probe_directory_index(StringView name) const
+{
+    auto block_size = fs().logical_block_size();
+
+    auto root_data = TRY(ByteBuffer::create_uninitialized(block_size));
+    TRY(read_directory_block(0, root_data.bytes()));
+    auto const& info = *reinterpret_cast<ext2_dx_root_info const*>(root_data.data() + ext2_dx_root_info_offset);
+    if (info.reserved_zero != 0 || info.info_length != 8)
+        return EIO;
+    if (info.hash_version > EXT2_HASH_TEA || info.indirect_levels > ext2_dx_max_indirect_levels || (info.unused_flags & EXT2_HASH_FLAG_INCOMPAT))
+        return ENOTSUP;
+
+    DirectoryIndexPath path;
+    path.hash_version = info.hash_version;
+    path.hash = ext2_directory_hash(name, effective_hash_version(info.hash_version), fs().super_block().s_hash_seed);
+    TRY(path.levels.try_append({ 0, move(root_data), ext2_dx_root_entries_offset, 0 }));
+
+    for (;;) {
+        auto& level = path.levels.last();
+        auto& countlimit = level.countlimit();
+        if (countlimit.count == 0 || countlimit.count > countlimit.limit || countlimit.limit > index_limit(block_size, level.entries_offset))
+            return EIO;
+
+        // Find the last entry whose hash isn't larger than ours.
+        auto* entries = level.entries();
+        size_t low = 1;
+        size_t high = countlimit.count;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (entries[middle].hash > path.hash)
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        level.position = low - 1;
+
+        if (path.levels.size() > info.indirect_levels)
+            break;
+
+        u32 child_block = entries[level.position].block;
+        auto child_data = TRY(ByteBuffer::create_uninitialized(block_size));
+        TRY(read_directory_block(child_block, child_data.bytes()));
+        TRY(path.levels.try_append({ child_block, move(child_data), ext2_dx_node_entries_offset, 0 }));
+    }
+
+    return path;
+}
+
+ErrorOr<bool> Ext2FSInode::advance_to_next_leaf(DirectoryIndexPath& path) const
+{
+    // Find the deepest level that has another entry after the one we went through.
+    size_t level_index = path.levels.size();
+    while (level_index > 0) {
+        auto& level = path.levels[level_index - 1];
+        if (level.position + 1 < level.countlimit().count)
+            break;
+        --level_index;
+    }
+    if (level_index == 0)
+        return false;
+
+    auto& level = path.levels[level_index - 1];
+    ++level.position;
+    // Names with the same hash only continue in the next block if it starts with that very hash.
+    if ((level.entries()[level.position].hash & ~1u) != path.hash)
+        return false;
+
+    for (; level_index < path.levels.size(); ++level_index) {
+        auto& parent = path.levels[level_index - 1];
+        auto& child = path.levels[level_index];
+        child.block = parent.entries()[parent.position].block;
+        TRY(read_directory_block(child.block, child.data.bytes()));
+        auto& countlimit = child.countlimit();
+        if (countlimit.count == 0 || countlimit.count > countlimit.limit)
+            return EIO;
+        child.position = 0;
+    }
+    return true;
+}
+
+ErrorOr<Ext2FSInode::DirectoryEntryLocation> Ext2FSInode::find_in_directory_index(StringView name) const
+{
+    auto block_size = fs().logical_block_size();
+    DirectoryEntryLocation location;
+    location.data = TRY(ByteBuffer::create_uninitialized(block_size));
+
+    // "." and ".." live in front of the index root, and aren't part of the index itself.
+    if (name == "."sv || name == ".."sv) {
+        TRY(read_directory_block(0, location.data.bytes()));
+        TRY(validate_directory_block(location.data.bytes()));
+        auto offset = find_entry_in_directory_block(location.data.bytes(), name);
+        if (!offset.has_value())
+            return ENOENT;
+        location.offset = offset.value();
+        return location;
+    }
+
+    auto path = TRY(probe_directory_index(name));
+    do {
+        auto& leaf_level = path.levels.last();
+        location.block = leaf_level.entries()[leaf_level.position].block;
+        TRY(read_directory_block(location.block, location.data.bytes()));
+        TRY(validate_directory_block(location.data.bytes()));
+        if (auto offset = find_entry_in_directory_block(location.data.bytes(), name); offset.has_value()) {
+            location.offset = offset.value();
+            return location;
+        }
+    } while (TRY(advance_to_next_leaf(path)));
+
+    return ENOENT;
+}
+
+ErrorOr<void> Ext2FSInode::make_room_in_directory_index(DirectoryIndexPath& path)
+{
+    auto block_size = fs().logical_block_size();
+    auto& last_level = path.levels.last();
+    if (last_level.countlimit().count < last_level.countlimit().limit)
+        return {};
+
+    if (path.levels.size() == 1) {
+        // The root is full, so move all of its entries into a new node below it, which adds a level to the tree.
+        auto& root = path.levels[0];
+        auto new_block = TRY(append_directory_block());
+        auto node_data = TRY(ByteBuffer::create_zeroed(block_size));
+        auto& fake_entry = directory_entry_at(node_data.bytes(), 0);
+        fake_entry.rec_len = block_size;
+
+        auto root_count = root.countlimit().count;
+        memcpy(node_data.data() + ext2_dx_node_entries_offset, root.entries(), root_count * sizeof(ext2_dx_entry));
+        DirectoryIndexLevel node { new_block, move(node_data), ext2_dx_node_entries_offset, root.position };
+        node.countlimit().limit = index_limit(block_size, ext2_dx_node_entries_offset);
+        node.countlimit().count = root_count;
+        TRY(write_directory_block(new_block, node.data.bytes()));
+
+        root.countlimit().count = 1;
+        root.entries()[0].block = new_block;
+        root.position = 0;
+        reinterpret_cast<ext2_dx_root_info*>(root.data.data() + ext2_dx_root_info_offset)->indirect_levels = 1;
+        TRY(write_directory_block(0, root.data.bytes()));
+
+        TRY(path.levels.try_append(move(node)));
+        return {};
+    }
+
+    // The node below the root is full. Split it in two, which needs room for one more entry in the root.
+    auto& root = path.levels[0];
+    auto& node = path.levels[1];
+    if (root.countlimit().count >= root.countlimit().limit) {
+        dbgln("Ext2FSInode[{}]::make_room_in_directory_index(): Directory index is full", identifier());
+        return ENOSPC;
+    }
+
+    auto new_block = TRY(append_directory_block());
+    auto new_node_data = TRY(ByteBuffer::create_zeroed(block_size));
+    auto& fake_entry = directory_entry_at(new_node_data.bytes(), 0);
+    fake_entry.rec_len = block_size;
+    DirectoryIndexLevel new_node { new_block, move(new_node_data), ext2_dx_node_entries_offset, 0 };
+
+    auto count = node.countlimit().count;
+    auto split = count / 2;
+    auto split_hash = node.entries()[split].hash;
+    memcpy(new_node.entries(), node.entries() + split, (count - split) * sizeof(ext2_dx_entry));
+    new_node.countlimit().limit = index_limit(block_size, ext2_dx_node_entries_offset);
+    new_node.countlimit().count = count - split;
+    node.countlimit().count = split;
+
+    auto* root_entries = root.entries();
+    auto root_count = root.countlimit().count;
+    memmove(root_entries + root.position + 2, root_entries + root.position + 1, (root_count - root.position - 1) * sizeof(ext2_dx_entry));
+    root_entries[root.position + 1] = { split_hash, new_block };
+    root.countlimit().count = root_count + 1;
+
+    TRY(write_directory_block(node.block, node.data.bytes()));
+    TRY(write_directory_block(new_node.block, new_node.data.bytes()));
+    TRY(write_directory_block(0, root.data.bytes()));
+
+    if (node.position >= split) {
+        new_node.position = node.position - split;
+        node = move(new_node);
+        ++root.position;
+    }
+    return {};
+}
+
+ErrorOr<void> Ext2FSInode::add_to_directory_index(StringView name, InodeIndex inode_index, u8 file_type)
+{
+    auto block_size = fs().logical_block_size();
+    auto path = TRY(probe_directory_index(name));
+
+    auto leaf_block = path.levels.last().entries()[path.levels.last().position].block;
+    auto leaf_data = TRY(ByteBuffer::create_uninitialized(block_size));
+    TRY(read_directory_block(leaf_block, leaf_data.bytes()));
+    TRY(validate_directory_block(leaf_data.bytes()));
+    if (try_insert_into_directory_block(leaf_data.bytes(), name, inode_index, file_type))
+        return write_directory_block(leaf_block, leaf_data.bytes());
+
+    // The leaf is full, so we have to split it, which needs room for one more entry in the index above it.
+    TRY(make_room_in_directory_index(path));
+    auto& level = path.levels.last();
+
+    struct LeafEntry {
+        u32 hash;
+        size_t offset;
+        u16 length;
+    };
+    Vector<LeafEntry> entries;
+    size_t total_length = 0;
+    for (size_t offset = 0; offset < block_size; offset += directory_entry_at(leaf_data.bytes(), offset).rec_len) {
+        auto const& entry = directory_entry_at(leaf_data.bytes(), offset);
+        if (entry.inode == 0)
+            continue;
+        auto hash = ext2_directory_hash({ entry.name, entry.name_len }, effective_hash_version(path.hash_version), fs().super_block().s_hash_seed);
+        u16 length = EXT2_DIR_REC_LEN(entry.name_len);
+        TRY(entries.try_append({ hash, offset, length }));
+        total_length += length;
+    }
+    if (entries.size() < 2)
+        return ENOSPC;
+    quick_sort(entries, [](auto const& a, auto const& b) { return a.hash < b.hash; });
+
+    // Move the upper half (by size) of the hashes into a new leaf.
+    size_t split = 0;
+    size_t lower_length = 0;
+    while (split < entries.size() - 1 && lower_length + entries[split].length <= total_length / 2)
+        lower_length += entries[split++].length;
+    if (split == 0)
+        split = 1;
+    u32 split_hash = entries[split].hash;
+    // If a run of equal hashes gets split up, the lookup for it has to continue into the new leaf.
+    bool continued = entries[split - 1].hash == split_hash;
+
+    auto lower_data = TRY(ByteBuffer::create_zeroed(block_size));
+    auto upper_data = TRY(ByteBuffer::create_zeroed(block_size));
+    auto pack_entries = [&](Bytes block, Span<LeafEntry const> entries_to_pack) {
+        size_t offset = 0;
+        for (size_t i = 0; i < entries_to_pack.size(); ++i) {
+            auto const& entry = entries_to_pack[i];
+            memcpy(block.data() + offset, leaf_data.data() + entry.offset, entry.length);
+            directory_entry_at(block, offset).rec_len = (i + 1 == entries_to_pack.size()) ? block_size - offset : entry.length;
+            offset += entry.length;
+        }
+    };
+    pack_entries(lower_data.bytes(), entries.span().trim(split));
+    pack_entries(upper_data.bytes(), entries.span().slice(split));
+
+    auto& target = path.hash >= split_hash ? upper_data : lower_data;
+    if (!try_insert_into_directory_block(target.bytes(), name, inode_index, file_type))
+        return ENOSPC;
+
+    auto new_leaf_block = TRY(append_directory_block());
+    auto* level_entries = level.entries();
+    auto count = level.countlimit().count;
+    memmove(level_entries + level.position + 2, level_entries + level.position + 1, (count - level.position - 1) * sizeof(ext2_dx_entry));
+    level_entries[level.position + 1] = { split_hash | (continued ? 1u : 0u), new_leaf_block };
+    level.countlimit().count = count + 1;
+
+    TRY(write_directory_block(leaf_block, lower_data.bytes()));
+    TRY(write_directory_block(new_leaf_block, upper_data.bytes()));
+    TRY(write_directory_block(level.block, level.data.bytes()));
+    return {};
+}
+
+ErrorOr<bool> Ext2FSInode::build_directory_index(Vector<Ext2FSDirectoryEntry>& entries)
+{
+    auto block_size = fs().logical_block_size();
+    auto root_limit = index_limit(block_size, ext2_dx_root_entries_offset);
+    auto node_limit = index_limit(block_size, ext2_dx_node_entries_offset);
+
+    u8 hash_version = fs().super_block().s_def_hash_version;
+    if (hash_version > EXT2_HASH_TEA)
+        hash_version = EXT2_HASH_HALF_MD4;
+
+    InodeIndex parent_index = 0;
+    struct HashedEntry {
+        u32 hash;
+        Ext2FSDirectoryEntry const* entry;
+    };
+    Vector<HashedEntry> hashed_entries;
+    for (auto const& entry : entries) {
+        if (entry.name->view() == "."sv)
+            continue;
+        if (entry.name->view() == ".."sv) {
+            parent_index = entry.inode_index;
+            continue;
+        }
+        auto hash = ext2_directory_hash(entry.name->view(), effective_hash_version(hash_version), fs().super_block().s_hash_seed);
+        TRY(hashed_entries.try_append({ hash, &entry }));
+    }
+    if (parent_index == 0)
+        return false;
+    quick_sort(hashed_entries, [](auto const& a, auto const& b) { return a.hash < b.hash; });
+
+    // Only fill the leaves (and nodes) up to three quarters, so that the next few insertions don't have to split them right away.
+    struct Leaf {
+        size_t first_entry;
+        size_t entry_count;
+    };
+    Vector<Leaf> leaves;
+    for (size_t i = 0; i < hashed_entries.size();) {
+        Leaf leaf { i, 0 };
+        size_t used_length = 0;
+        while (i < hashed_entries.size()) {
+            auto length = EXT2_DIR_REC_LEN(hashed_entries[i].entry->name->length());
+            if (leaf.entry_count > 0 && used_length + length > block_size * 3 / 4)
+                break;
+            used_length += length;
+            ++leaf.entry_count;
+            ++i;
+        }
+        TRY(leaves.try_append(leaf));
+    }
+    if (leaves.is_empty())
+        return false;
+
+    size_t node_fill = node_limit * 3 / 4;
+    size_t node_count = leaves.size() <= root_limit ? 0 : ceil_div(leaves.size(), node_fill);
+    if (node_count > root_limit)
+        return false;
+
+    size_t block_count = 1 + node_count + leaves.size();
+    auto directory_data = TRY(ByteBuffer::create_zeroed(block_count * block_size));
+    auto block_data = [&](size_t block) { return directory_data.bytes().slice(block * block_size, block_size); };
+    auto leaf_hash = [&](size_t leaf_index) -> u32 {
+        auto const& leaf = leaves[leaf_index];
+        u32 hash = hashed_entries[leaf.first_entry].hash;
+        bool continued = leaf.first_entry > 0 && hashed_entries[leaf.first_entry - 1].hash == hash;
+        return hash | (continued ? 1u : 0u);
+    };
+
+    // The leaves come after the root and the nodes.
+    size_t first_leaf_block = 1 + node_count;
+    for (size_t leaf_index = 0; leaf_index < leaves.size(); ++leaf_index) {
+        auto block = block_data(first_leaf_block + leaf_index);
+        auto const& leaf = leaves[leaf_index];
+        size_t offset = 0;
+        for (size_t i = 0; i < leaf.entry_count; ++i) {
+            auto const& entry = *hashed_entries[leaf.first_entry + i].entry;
+            auto& raw_entry = directory_entry_at(block, offset);
+            u16 length = EXT2_DIR_REC_LEN(entry.name->length());
+            raw_entry.inode = entry.inode_index.value();
+            raw_entry.rec_len = (i + 1 == leaf.entry_count) ? block_size - offset : length;
+            raw_entry.name_len = entry.name->length();
+            raw_entry.file_type = entry.file_type;
+            memcpy(raw_entry.name, entry.name->characters(), entry.name->length());
+            offset += length;
+        }
+    }
+
+    auto fill_index = [&](DirectoryIndexLevel& level, size_t limit, size_t first_child, size_t child_count, auto child_block, auto child_hash) {
+        level.countlimit().limit = limit;
+        level.countlimit().count = child_count;
+        auto* level_entries = level.entries();
+        for (size_t i = 0; i < child_count; ++i) {
+            if (i != 0)
+                level_entries[i].hash = child_hash(first_child + i);
+            level_entries[i].block = child_block(first_child + i);
+        }
+    };
+
+    DirectoryIndexLevel root { 0, {}, ext2_dx_root_entries_offset, 0 };
+    root.data = TRY(ByteBuffer::copy(block_data(0)));
+
+    auto& dot = directory_entry_at(root.data.bytes(), 0);
+    dot.inode = index().value();
+    dot.rec_len = 12;
+    dot.name_len = 1;
+    dot.file_type = EXT2_FT_DIR;
+    dot.name[0] = '.';
+    auto& dot_dot = directory_entry_at(root.data.bytes(), 12);
+    dot_dot.inode = parent_index.value();
+    dot_dot.rec_len = block_size - 12;
+    dot_dot.name_len = 2;
+    dot_dot.file_type = EXT2_FT_DIR;
+    dot_dot.name[0] = '.';
+    dot_dot.name[1] = '.';
+    auto& info = *reinterpret_cast<ext2_dx_root_info*>(root.data.data() + ext2_dx_root_info_offset);
+    info.hash_version = hash_version;
+    info.info_length = 8;
+    info.indirect_levels = node_count > 0 ? 1 : 0;
+
+    auto leaf_block = [&](size_t leaf_index) { return static_cast<u32>(first_leaf_block + leaf_index); };
+    if (node_count == 0) {
+        fill_index(root, root_limit, 0, leaves.size(), leaf_block, leaf_hash);
+    } else {
+        for (size_t node_index = 0; node_index < node_count; ++node_index) {
+            DirectoryIndexLevel node { static_cast<u32>(1 + node_index), TRY(ByteBuffer::copy(block_data(1 + node_index))), ext2_dx_node_entries_offset, 0 };
+            directory_entry_at(node.data.bytes(), 0).rec_len = block_size;
+            size_t first_leaf = node_index * node_fill;
+            fill_index(node, node_limit, first_leaf, min(node_fill, leaves.size() - first_leaf), leaf_block, leaf_hash);
+            block_data(1 + node_index).overwrite(0, node.data.data(), block_size);
+        }
+        auto node_block = [](size_t node_index) { return static_cast<u32>(1 + node_index); };
+        auto node_hash = [&](size_t node_index) { return leaf_hash(node_index * node_fill); };
+        fill_index(root, root_limit, 0, node_count, node_block, node_hash);
+    }
+    block_data(0).overwrite(0, root.data.data(), block_size);
+
+    TRY(resize(directory_data.size()));
+    auto buffer = UserOrKernelBuffer::for_kernel_buffer(directory_data.data());
+    auto nwritten = TRY(write_bytes(0, directory_data.size(), buffer, nullptr));
+    if (nwritten != directory_data.size())
+        return EIO;
+
+    m_raw_inode.i_flags |= EXT2_INDEX_FL;
+    set_metadata_dirty(true);
+    return true;
+}
+
 ErrorOr<NonnullRefPtr<Inode>> Ext2FSInode::create_child(StringView name, mode_t mode, dev_t dev, UserID uid, GroupID gid)
 {
     if (Kernel::is_directory(mode))
@@ -836,12 +1762,35 @@ ErrorOr<void> Ext2FSInode::add_child(Inode& child, StringView name, mode_t mode)
 
     dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::add_child(): Adding inode {} with name '{}' and mode {:o} to directory {}", identifier(), child.index(), name, mode, index());
 
+    if (has_directory_index()) {
+        auto existing_entry_or_error = find_in_directory_index(name);
+        if (!existing_entry_or_error.is_error())
+            return EEXIST;
+        if (existing_entry_or_error.error().code() != ENOENT && existing_entry_or_error.error().code() != ENOTSUP)
+            return existing_entry_or_error.release_error();
+
+        if (existing_entry_or_error.error().code() == ENOENT) {
+            TRY(child.increment_link_count());
+            auto result = add_to_directory_index(name, child.index(), to_ext2_file_type(mode));
+            if (!result.is_error()) {
+                did_add_child(child.identifier(), name);
+                return {};
+            }
+            MUST(child.decrement_link_count());
+            // NOTE: If the index is full (or one we can't extend), we fall back to rewriting the whole directory below.
+            if (result.error().code() != ENOSPC && result.error().code() != ENOTSUP)
+                return result.release_error();
+        }
+    }
+
     Vector<Ext2FSDirectoryEntry> entries;
+    size_t entries_length = 0;
     TRY(traverse_as_directory([&](auto& entry) -> ErrorOr<void> {
         if (name == entry.name)
             return EEXIST;
         auto entry_name = TRY(KString::try_create(entry.name));
         TRY(entries.try_append({ move(entry_name), entry.inode.index(), entry.file_type }));
+        entries_length += EXT2_DIR_REC_LEN(entry.name.length());
         return {};
     }));
 
@@ -849,12 +1798,19 @@ ErrorOr<void> Ext2FSInode::add_child(Inode& child, StringView name, mode_t mode)
 
     auto entry_name = TRY(KString::try_create(name));
     TRY(entries.try_empend(move(entry_name), child.index(), to_ext2_file_type(mode)));
+    entries_length += EXT2_DIR_REC_LEN(name.length());
 
-    TRY(write_directory(entries));
-    TRY(populate_lookup_cache());
+    // Once a directory no longer fits into a single block, index it so that lookups don't have to scan all of it.
+    bool should_index = entries_length > fs().logical_block_size() && has_flag(fs().get_features_optional(), Ext2FS::FeaturesOptional::DirectoryIndex);
+    if (should_index && TRY(build_directory_index(entries))) {
+        m_lookup_cache.clear();
+    } else {
+        TRY(write_directory(entries));
+        TRY(populate_lookup_cache());
 
-    auto cache_entry_name = TRY(KString::try_create(name));
-    TRY(m_lookup_cache.try_set(move(cache_entry_name), child.index()));
+        auto cache_entry_name = TRY(KString::try_create(name));
+        TRY(m_lookup_cache.try_set(move(cache_entry_name), child.index()));
+    }
     did_add_child(child.identifier(), name);
     return {};
 }
@@ -865,6 +1821,23 @@ ErrorOr<void> Ext2FSInode::remove_child(StringView name)
     dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::remove_child(): Removing '{}'", identifier(), name);
     VERIFY(is_directory());
 
+    if (has_directory_index() && name != "."sv && name != ".."sv) {
+        auto location_or_error = find_in_directory_index(name);
+        if (!location_or_error.is_error() || location_or_error.error().code() != ENOTSUP) {
+            auto location = TRY(move(location_or_error));
+            InodeIdentifier child_id { fsid(), directory_entry_at(location.data.bytes(), location.offset).inode };
+
+            remove_from_directory_block(location.data.bytes(), location.offset);
+            TRY(write_directory_block(location.block, location.data.bytes()));
+
+            auto child_inode = TRY(fs().get_inode(child_id));
+            TRY(child_inode->decrement_link_count());
+
+            did_remove_child(child_id, name);
+            return {};
+        }
+    }
+
     TRY(populate_lookup_cache());
 
     auto it = m_lookup_cache.find(name);
@@ -900,11 +1873,33 @@ ErrorOr<void> Ext2FSInode::replace_child(StringView name, Inode& child)
     dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]::replace_child(): Replacing '{}' with inode {}", identifier(), name, child.index());
     VERIFY(is_directory());
 
-    TRY(populate_lookup_cache());
-
     if (name.length() > EXT2_NAME_LEN)
         return ENAMETOOLONG;
 
+    if (has_directory_index()) {
+        auto location_or_error = find_in_directory_index(name);
+        if (!location_or_error.is_error() || location_or_error.error().code() != ENOTSUP) {
+            auto location = TRY(move(location_or_error));
+            auto& entry = directory_entry_at(location.data.bytes(), location.offset);
+            auto old_child = TRY(fs().get_inode({ fsid(), entry.inode }));
+
+            TRY(child.increment_link_count());
+            auto maybe_decrement_error = old_child->decrement_link_count();
+            if (maybe_decrement_error.is_error()) {
+                MUST(child.decrement_link_count());
+                return maybe_decrement_error;
+            }
+
+            // The entry keeps its name, so it stays exactly where it is in the index.
+            entry.inode = child.index().value();
+            entry.file_type = to_ext2_file_type(child.mode());
+            TRY(write_directory_block(location.block, location.data.bytes()));
+            return {};
+        }
+    }
+
+    TRY(populate_lookup_cache());
+
     Vector<Ext2FSDirectoryEntry> entries;
 
     Optional<InodeIndex> old_child_index;
@@ -977,13 +1972,27 @@ ErrorOr<NonnullRefPtr<Inode>> Ext2FSInode::lookup(StringView name)
     InodeIndex inode_index;
     {
         MutexLocker locker(m_inode_lock);
-        TRY(populate_lookup_cache());
-        auto it = m_lookup_cache.find(name);
-        if (it == m_lookup_cache.end()) {
-            dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]:lookup(): '{}' not found", identifier(), name);
-            return ENOENT;
+        auto found_in_index = false;
+        if (has_directory_index()) {
+            auto location_or_error = find_in_directory_index(name);
+            if (location_or_error.is_error() && location_or_error.error().code() != ENOTSUP)
+                return location_or_error.release_error();
+            if (!location_or_error.is_error()) {
+                auto& location = location_or_error.value();
+                inode_index = directory_entry_at(location.data.bytes(), location.offset).inode;
+                found_in_index = true;
+            }
+        }
+
+        if (!found_in_index) {
+            TRY(populate_lookup_cache());
+            auto it = m_lookup_cache.find(name);
+            if (it == m_lookup_cache.end()) {
+                dbgln_if(EXT2_DEBUG, "Ext2FSInode[{}]:lookup(): '{}' not found", identifier(), name);
+                return ENOENT;
+            }
+            inode_index = it->value;
         }
-        inode_index = it->value;
     }
 
     return fs().get_inode({ fsid(), inode_index });
@@ -1069,6 +2078,8 @@ ErrorOr<void> Ext2FSInode::truncate(u64 size)
     MutexLocker locker(m_inode_lock);
     if (static_cast<u64>(m_raw_inode.i_size) == size)
         return {};
+    if (size < this->size())
+        truncate_page_cache(size);
     TRY(resize(size));
     set_metadata_dirty(true);
     return {};
@@ -1081,7 +2092,7 @@ ErrorOr<int> Ext2FSInode::get_block_address(int index)
     if (m_block_list.is_empty())
         m_block_list = TRY(compute_block_list());
 
-    if (index < 0 || (size_t)index >= m_block_list.size())
+    if (index < 0 || (size_t)index >= m_block_list.size() || is_hole(m_block_list[index]))
         return 0;
 
     return m_block_list[index].value();
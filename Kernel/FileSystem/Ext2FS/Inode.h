@@ -6,9 +6,11 @@
 
 #pragma once
 
+#include <AK/ByteBuffer.h>
 #include <AK/HashMap.h>
 #include <Kernel/FileSystem/Ext2FS/Definitions.h>
 #include <Kernel/FileSystem/Ext2FS/DirectoryEntry.h>
+#include <Kernel/FileSystem/Ext2FS/DirectoryIndex.h>
 #include <Kernel/FileSystem/Ext2FS/FileSystem.h>
 #include <Kernel/FileSystem/Inode.h>
 #include <Kernel/UnixTypes.h>
@@ -28,6 +30,7 @@ public:
 private:
     // ^Inode
     virtual ErrorOr<size_t> read_bytes_locked(off_t, size_t, UserOrKernelBuffer& buffer, OpenFileDescription*) const override;
+    virtual size_t read_ahead(u64 offset, size_t length) const override;
     virtual InodeMetadata metadata() const override;
     virtual ErrorOr<void> traverse_as_directory(Function<ErrorOr<void>(FileSystem::DirectoryEntryView const&)>) const override;
     virtual ErrorOr<NonnullRefPtr<Inode>> lookup(StringView name) override;
@@ -44,17 +47,72 @@ private:
     virtual ErrorOr<void> chown(UserID, GroupID) override;
     virtual ErrorOr<void> truncate(u64) override;
     virtual ErrorOr<int> get_block_address(int) override;
+    virtual bool wants_page_cache() const override { return Kernel::is_regular_file(m_raw_inode.i_mode); }
+    virtual bool supports_delayed_allocation() const override { return Kernel::is_regular_file(m_raw_inode.i_mode); }
+    virtual ErrorOr<void> grow_with_delayed_allocation(u64) override;
+    virtual ErrorOr<size_t> read_bytes_for_page_cache(off_t, size_t, UserOrKernelBuffer& buffer) const override;
+    virtual ErrorOr<size_t> write_bytes_for_page_cache(off_t, size_t, UserOrKernelBuffer const& data) override;
+
+    ErrorOr<size_t> read_bytes_impl(off_t, size_t, UserOrKernelBuffer& buffer, bool allow_cache) const;
+    ErrorOr<size_t> write_bytes_impl(off_t, size_t, UserOrKernelBuffer const& data, bool allow_cache);
 
     ErrorOr<void> write_directory(Vector<Ext2FSDirectoryEntry>&);
     ErrorOr<void> populate_lookup_cache();
-    ErrorOr<void> resize(u64);
+
+    // The HTree directory index, see DirectoryIndex.h. Operations on it fail with ENOTSUP for indexes that we
+    // can't maintain, in which case the directory is handled (and eventually rewritten) as a linear one.
+    struct DirectoryIndexLevel {
+        u32 block { 0 };
+        ByteBuffer data;
+        size_t entries_offset { 0 };
+        size_t position { 0 };
+
+        // NOTE: The count and limit overlap the hash of the first entry, which is implied to be 0.
+        ext2_dx_countlimit& countlimit() { return *reinterpret_cast<ext2_dx_countlimit*>(data.data() + entries_offset); }
+        ext2_dx_entry* entries() { return reinterpret_cast<ext2_dx_entry*>(data.data() + entries_offset); }
+    };
+    struct DirectoryIndexPath {
+        Vector<DirectoryIndexLevel, ext2_dx_max_indirect_levels + 1> levels;
+        u8 hash_version { 0 };
+        u32 hash { 0 };
+    };
+    struct DirectoryEntryLocation {
+        u32 block { 0 };
+        ByteBuffer data;
+        size_t offset { 0 };
+    };
+
+    bool has_directory_index() const;
+    u8 effective_hash_version(u8) const;
+    ErrorOr<void> read_directory_block(u32 block, Bytes) const;
+    ErrorOr<void> write_directory_block(u32 block, ReadonlyBytes);
+    ErrorOr<u32> append_directory_block();
+    ErrorOr<DirectoryIndexPath> probe_directory_index(StringView name) const;
+    ErrorOr<bool> advance_to_next_leaf(DirectoryIndexPath&) const;
+    ErrorOr<DirectoryEntryLocation> find_in_directory_index(StringView name) const;
+    ErrorOr<void> add_to_directory_index(StringView name, InodeIndex, u8 file_type);
+    ErrorOr<void> make_room_in_directory_index(DirectoryIndexPath&);
+    ErrorOr<bool> build_directory_index(Vector<Ext2FSDirectoryEntry>&);
+
+    enum class BlockAllocation {
+        Immediate,
+        // Only reserve the blocks, and allocate them once data actually gets written to them.
+        Delayed,
+    };
+    ErrorOr<void> resize(u64, BlockAllocation = BlockAllocation::Immediate);
+    ErrorOr<void> allocate_missing_blocks(size_t first_block, size_t end_block);
     ErrorOr<void> write_indirect_block(BlockBasedFileSystem::BlockIndex, Span<BlockBasedFileSystem::BlockIndex>);
     ErrorOr<void> grow_doubly_indirect_block(BlockBasedFileSystem::BlockIndex, size_t, Span<BlockBasedFileSystem::BlockIndex>, Vector<BlockBasedFileSystem::BlockIndex>&, unsigned&);
     ErrorOr<void> shrink_doubly_indirect_block(BlockBasedFileSystem::BlockIndex, size_t, size_t, unsigned&);
     ErrorOr<void> grow_triply_indirect_block(BlockBasedFileSystem::BlockIndex, size_t, Span<BlockBasedFileSystem::BlockIndex>, Vector<BlockBasedFileSystem::BlockIndex>&, unsigned&);
     ErrorOr<void> shrink_triply_indirect_block(BlockBasedFileSystem::BlockIndex, size_t, size_t, unsigned&);
+    ErrorOr<void> rewrite_indirect_block_entries(BlockBasedFileSystem::BlockIndex, unsigned depth, Span<BlockBasedFileSystem::BlockIndex>, size_t first_changed_entry);
     ErrorOr<void> flush_block_list();
 
+    bool uses_extents() const { return m_raw_inode.i_flags & EXT4_EXTENTS_FL; }
+    ErrorOr<void> flush_extent_tree();
+    ErrorOr<void> read_extent_tree_node(ReadonlyBytes node, Optional<u16> expected_depth, Vector<BlockBasedFileSystem::BlockIndex>& block_list, Vector<BlockBasedFileSystem::BlockIndex>* tree_blocks) const;
+
     ErrorOr<void> compute_block_list_with_exclusive_locking();
     ErrorOr<Vector<BlockBasedFileSystem::BlockIndex>> compute_block_list() const;
     ErrorOr<Vector<BlockBasedFileSystem::BlockIndex>> compute_block_list_with_meta_blocks() const;
@@ -66,6 +124,10 @@ private:
     Ext2FSInode(Ext2FS&, InodeIndex);
 
     Vector<BlockBasedFileSystem::BlockIndex> m_block_list;
+    // Entries of m_block_list that are only reserved, see BlockAllocation::Delayed.
+    size_t m_delayed_block_count { 0 };
+    // Lowest entry of m_block_list that was changed in place since the last flush_block_list().
+    size_t m_first_unflushed_block { NumericLimits<size_t>::max() };
     HashMap<NonnullOwnPtr<KString>, InodeIndex> m_lookup_cache;
     ext2_inode m_raw_inode {};
 
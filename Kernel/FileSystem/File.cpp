@@ -12,6 +12,33 @@
 
 namespace Kernel {
 
+void FileBlockerSet::add_event_poll_interest(EventPollInterest& interest)
+{
+    SpinlockLocker lock(m_lock);
+    m_event_poll_interests.append(interest);
+}
+
+void FileBlockerSet::remove_event_poll_interest(EventPollInterest& interest)
+{
+    SpinlockLocker lock(m_lock);
+    // NOTE: The interest may already be gone if its description was destroyed in the meantime.
+    if (interest.m_file_list_node.is_in_list())
+        m_event_poll_interests.remove(interest);
+}
+
+void FileBlockerSet::remove_event_poll_interests_for(OpenFileDescription const& description)
+{
+    SpinlockLocker lock(m_lock);
+    for (auto it = m_event_poll_interests.begin(); it != m_event_poll_interests.end();) {
+        auto& interest = *it;
+        ++it;
+        if (&interest.description() != &description)
+            continue;
+        m_event_poll_interests.remove(interest);
+        interest.description_will_be_destroyed({});
+    }
+}
+
 File::File() = default;
 File::~File() = default;
 
@@ -10,6 +10,7 @@
 #include <AK/Error.h>
 #include <AK/StringView.h>
 #include <AK/Types.h>
+#include <Kernel/FileSystem/EventPollInterest.h>
 #include <Kernel/Forward.h>
 #include <Kernel/Library/LockWeakable.h>
 #include <Kernel/Library/NonnullLockRefPtr.h>
@@ -40,7 +41,18 @@ public:
             auto& blocker = static_cast<Thread::FileBlocker&>(b);
             return blocker.unblock_if_conditions_are_met(false, data);
         });
+        for (auto& interest : m_event_poll_interests)
+            interest.notify_maybe_ready({});
     }
+
+    // Event poll interests stay registered across many waits (unlike blockers, which only live
+    // for the duration of one), and get told about every state change of the file.
+    void add_event_poll_interest(EventPollInterest&);
+    void remove_event_poll_interest(EventPollInterest&);
+    void remove_event_poll_interests_for(OpenFileDescription const&);
+
+private:
+    EventPollInterest::FileList m_event_poll_interests;
 };
 
 // File is the base class for anything that can be referenced by a OpenFileDescription.
@@ -114,6 +126,8 @@ public:
     virtual bool is_character_device() const { return false; }
     virtual bool is_socket() const { return false; }
     virtual bool is_inode_watcher() const { return false; }
+    virtual bool is_event_poll() const { return false; }
+    virtual bool is_io_ring() const { return false; }
     virtual bool is_mount_file() const { return false; }
 
     virtual bool is_regular_file() const { return false; }
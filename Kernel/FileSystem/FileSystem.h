@@ -34,6 +34,10 @@ public:
     virtual Inode& root_inode() = 0;
     virtual bool supports_watchers() const { return false; }
 
+    // Lookups can only be cached if every change to a directory is reported through
+    // Inode::did_add_child() and Inode::did_remove_child(); see DentryCache.
+    virtual bool supports_dentry_cache() const { return false; }
+
     bool is_readonly() const { return m_readonly; }
 
     virtual unsigned total_block_count() const { return 0; }
@@ -53,10 +57,15 @@ public:
 
     virtual ErrorOr<void> flush_writes() { return {}; }
 
+    // Called when the system is low on memory; filesystems should hand back any memory
+    // used for caching that can be dropped without losing data.
+    virtual void release_clean_cache_memory() { }
+
     u64 logical_block_size() const { return m_logical_block_size; }
     size_t fragment_size() const { return m_fragment_size; }
 
     virtual bool is_file_backed() const { return false; }
+    virtual bool is_block_based() const { return false; }
 
     // Converts file types that are used internally by the filesystem to DT_* types
     virtual u8 internal_file_type_to_directory_entry_type(DirectoryEntryView const& entry) const { return entry.file_type; }
@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Atomic.h>
+#include <AK/IntegralMath.h>
+#include <Kernel/API/POSIX/sys/socket.h>
+#include <Kernel/FileSystem/IORing.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Library/KString.h>
+#include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Net/Socket.h>
+#include <Kernel/Tasks/Process.h>
+#include <Kernel/Time/TimeManagement.h>
+
+namespace Kernel {
+
+static_assert(sizeof(io_ring_header) <= PAGE_SIZE);
+
+using BlockFlags = Thread::FileBlocker::BlockFlags;
+
+ErrorOr<NonnullRefPtr<IORing>> IORing::try_create(Process& owner, u32 entries)
+{
+    if (entries == 0 || entries > IO_RING_MAX_ENTRIES)
+        return EINVAL;
+
+    // Like on Linux, there's room for twice as many completions as submissions, so that a full
+    // submission queue doesn't immediately get stuck on a full completion queue.
+    u32 sq_entries = 1u << AK::ceil_log2(entries);
+    u32 cq_entries = sq_entries * 2;
+    size_t sq_offset = PAGE_SIZE;
+    size_t cq_offset = sq_offset + align_up_to(sq_entries * sizeof(io_ring_submission), 64);
+    size_t total_size = TRY(Memory::page_round_up(cq_offset + cq_entries * sizeof(io_ring_completion)));
+
+    auto vmobject = TRY(Memory::AnonymousVMObject::try_create_with_size(total_size, AllocationStrategy::AllocateNow));
+    auto region = TRY(MM.allocate_kernel_region_with_vmobject(*vmobject, total_size, "IORing"sv, Memory::Region::Access::ReadWrite));
+
+    return adopt_nonnull_ref_or_enomem(new (nothrow) IORing(owner.pid(), move(vmobject), move(region), sq_entries, cq_entries));
+}
+
+IORing::IORing(ProcessID owner, NonnullLockRefPtr<Memory::AnonymousVMObject> vmobject, NonnullOwnPtr<Memory::Region> region, u32 sq_entries, u32 cq_entries)
+    : m_owner(owner)
+    , m_vmobject(move(vmobject))
+    , m_region(move(region))
+    , m_sq_entries(sq_entries)
+    , m_cq_entries(cq_entries)
+{
+}
+
+IORing::~IORing() = default;
+
+io_ring_params IORing::params() const
+{
+    io_ring_params params {};
+    params.sq_entries = m_sq_entries;
+    params.cq_entries = m_cq_entries;
+    params.ring_size = m_region->size();
+    params.sq_offset = PAGE_SIZE;
+    params.cq_offset = PAGE_SIZE + align_up_to(m_sq_entries * sizeof(io_ring_submission), 64);
+    return params;
+}
+
+io_ring_header& IORing::header() const
+{
+    return *reinterpret_cast<io_ring_header*>(m_region->vaddr().as_ptr());
+}
+
+io_ring_submission const& IORing::submission_at(u32 index) const
+{
+    auto* submissions = reinterpret_cast<io_ring_submission const*>(m_region->vaddr().offset(params().sq_offset).as_ptr());
+    return submissions[index & (m_sq_entries - 1)];
+}
+
+io_ring_completion& IORing::completion_at(u32 index) const
+{
+    auto* completions = reinterpret_cast<io_ring_completion*>(m_region->vaddr().offset(params().cq_offset).as_ptr());
+    return completions[index & (m_cq_entries - 1)];
+}
+
+u32 IORing::available_completions() const
+{
+    MutexLocker locker(m_lock);
+    u32 cq_head = AK::atomic_load(&header().cq_head, AK::MemoryOrder::memory_order_acquire);
+    return min(m_cq_tail - cq_head, m_cq_entries);
+}
+
+u32 IORing::free_completion_slots_locked() const
+{
+    VERIFY(m_lock.is_locked());
+    u32 cq_head = AK::atomic_load(&header().cq_head, AK::MemoryOrder::memory_order_acquire);
+    u32 unconsumed = m_cq_tail - cq_head;
+    // A `cq_head` from the future is treated like a full queue, so we don't post anything else
+    // until userspace gets its act together.
+    if (unconsumed > m_cq_entries)
+        return 0;
+    // Parked operations have their completion slot reserved.
+    u32 reserved = unconsumed + m_parked_operations.size();
+    return reserved >= m_cq_entries ? 0 : m_cq_entries - reserved;
+}
+
+void IORing::post_completion_locked(u64 user_data, ErrorOr<FlatPtr> const& result)
+{
+    VERIFY(m_lock.is_locked());
+    u32 cq_head = AK::atomic_load(&header().cq_head, AK::MemoryOrder::memory_order_acquire);
+    if (m_cq_tail - cq_head >= m_cq_entries) {
+        AK::atomic_fetch_add(&header().cq_overflow, 1u, AK::MemoryOrder::memory_order_relaxed);
+        return;
+    }
+
+    auto& completion = completion_at(m_cq_tail);
+    completion.user_data = user_data;
+    completion.result = result.is_error() ? -static_cast<i64>(result.error().code()) : static_cast<i64>(result.value());
+    ++m_cq_tail;
+    AK::atomic_store(&header().cq_tail, m_cq_tail, AK::MemoryOrder::memory_order_release);
+}
+
+ErrorOr<size_t> IORing::submit(Process& process, u32 count)
+{
+    MutexLocker locker(m_lock);
+
+    u32 sq_tail = AK::atomic_load(&header().sq_tail, AK::MemoryOrder::memory_order_acquire);
+    if (sq_tail - m_sq_head > m_sq_entries)
+        return EINVAL;
+    count = min(count, sq_tail - m_sq_head);
+
+    size_t submitted = 0;
+    while (submitted < count && free_completion_slots_locked() > 0) {
+        // NOTE: Userspace can keep changing the entry while we look at it, so work on a copy.
+        io_ring_submission submission;
+        memcpy(&submission, &submission_at(m_sq_head), sizeof(submission));
+        ++m_sq_head;
+        ++submitted;
+
+        auto operation_or_error = prepare(process, submission);
+        if (operation_or_error.is_error()) {
+            post_completion_locked(submission.user_data, operation_or_error.release_error());
+            continue;
+        }
+
+        auto operation = operation_or_error.release_value();
+        auto result = try_perform(process, operation);
+        if (result.is_error() && result.error().code() == EAGAIN) {
+            if (auto append_result = m_parked_operations.try_append(move(operation)); append_result.is_error())
+                post_completion_locked(submission.user_data, append_result.release_error());
+            continue;
+        }
+        post_completion_locked(submission.user_data, result);
+    }
+    AK::atomic_store(&header().sq_head, m_sq_head, AK::MemoryOrder::memory_order_release);
+
+    // Like Linux, we only complain about a full completion queue if we couldn't make any progress.
+    if (submitted == 0 && count > 0)
+        return EBUSY;
+    return submitted;
+}
+
+void IORing::complete_ready_operations(Process& process)
+{
+    MutexLocker locker(m_lock);
+    for (size_t i = 0; i < m_parked_operations.size();) {
+        auto& operation = m_parked_operations[i];
+        auto result = try_perform(process, operation);
+        if (result.is_error() && result.error().code() == EAGAIN) {
+            ++i;
+            continue;
+        }
+        auto user_data = operation.submission.user_data;
+        // Remove the operation first, so its reserved completion slot becomes available.
+        m_parked_operations.remove(i);
+        post_completion_locked(user_data, result);
+    }
+}
+
+bool IORing::prepare_wait(Thread::SelectBlocker::FDVector& fds, Optional<Duration>& earliest_deadline) const
+{
+    MutexLocker locker(m_lock);
+    for (auto& operation : m_parked_operations) {
+        if (operation.deadline.has_value()) {
+            if (!earliest_deadline.has_value() || operation.deadline.value() < earliest_deadline.value())
+                earliest_deadline = operation.deadline;
+            continue;
+        }
+
+        // Like poll(), we always want to hear about errors and hang-ups, which let the operation
+        // fail or finish early.
+        BlockFlags block_flags = BlockFlags::WriteError | BlockFlags::WriteHangUp;
+        switch (operation.submission.opcode) {
+        case IO_RING_OP_READ:
+        case IO_RING_OP_RECV:
+            block_flags |= BlockFlags::Read;
+            break;
+        case IO_RING_OP_WRITE:
+        case IO_RING_OP_SEND:
+            block_flags |= BlockFlags::Write;
+            break;
+        case IO_RING_OP_ACCEPT:
+            block_flags |= BlockFlags::Accept;
+            break;
+        default:
+            VERIFY_NOT_REACHED();
+        }
+        if (fds.try_append({ operation.description, block_flags }).is_error())
+            break;
+    }
+    return !m_parked_operations.is_empty();
+}
+
+ErrorOr<IORing::ParkedOperation> IORing::prepare(Process& process, io_ring_submission const& submission)
+{
+    if (submission.flags != 0)
+        return EINVAL;
+
+    ParkedOperation operation { submission, nullptr, {} };
+    switch (submission.opcode) {
+    case IO_RING_OP_NOP:
+        return operation;
+    case IO_RING_OP_TIMEOUT: {
+        auto timeout = TRY(copy_time_from_user(Userspace<timespec const*>(static_cast<FlatPtr>(submission.address))));
+        operation.deadline = TimeManagement::the().current_time(CLOCK_MONOTONIC_COARSE) + timeout;
+        return operation;
+    }
+    case IO_RING_OP_READ:
+    case IO_RING_OP_WRITE:
+    case IO_RING_OP_RECV:
+    case IO_RING_OP_SEND:
+    case IO_RING_OP_ACCEPT:
+    case IO_RING_OP_FSYNC:
+        break;
+    default:
+        return EINVAL;
+    }
+
+    operation.description = TRY(process.open_file_description(submission.fd));
+    auto& description = *operation.description;
+
+    switch (submission.opcode) {
+    case IO_RING_OP_READ:
+        if (!description.is_readable())
+            return EBADF;
+        if (description.is_directory())
+            return EISDIR;
+        break;
+    case IO_RING_OP_WRITE:
+        if (!description.is_writable())
+            return EBADF;
+        break;
+    case IO_RING_OP_RECV:
+    case IO_RING_OP_SEND:
+        if (!description.is_socket())
+            return ENOTSOCK;
+        break;
+    case IO_RING_OP_ACCEPT:
+        TRY(process.require_promise(Pledge::accept));
+        if (!description.is_socket())
+            return ENOTSOCK;
+        if ((submission.op_flags & (SOCK_NONBLOCK | SOCK_CLOEXEC)) != submission.op_flags)
+            return EINVAL;
+        break;
+    }
+
+    if ((submission.opcode == IO_RING_OP_READ || submission.opcode == IO_RING_OP_WRITE)
+        && submission.offset != IO_RING_CURRENT_POSITION) {
+        if (!description.file().is_seekable())
+            return EINVAL;
+        if (submission.offset > static_cast<u64>(NumericLimits<off_t>::max()))
+            return EINVAL;
+    }
+    if (submission.length > NumericLimits<ssize_t>::max())
+        return EINVAL;
+
+    return operation;
+}
+
+ErrorOr<FlatPtr> IORing::try_perform(Process& process, ParkedOperation& operation)
+{
+    auto const& submission = operation.submission;
+
+    if (operation.deadline.has_value()) {
+        if (TimeManagement::the().current_time(CLOCK_MONOTONIC_COARSE) < operation.deadline.value())
+            return EAGAIN;
+        return ETIMEDOUT;
+    }
+    if (submission.opcode == IO_RING_OP_NOP)
+        return 0;
+
+    auto& description = *operation.description;
+    auto buffer_address = static_cast<FlatPtr>(submission.address);
+
+    switch (submission.opcode) {
+    case IO_RING_OP_READ: {
+        if (submission.length == 0)
+            return 0;
+        if (!description.can_read())
+            return EAGAIN;
+        auto buffer = TRY(UserOrKernelBuffer::for_user_buffer(reinterpret_cast<u8*>(buffer_address), submission.length));
+        if (submission.offset == IO_RING_CURRENT_POSITION)
+            return TRY(description.read(buffer, submission.length));
+        return TRY(description.read(buffer, submission.offset, submission.length));
+    }
+    case IO_RING_OP_WRITE: {
+        if (submission.length == 0)
+            return 0;
+        if (!description.can_write())
+            return EAGAIN;
+        auto buffer = TRY(UserOrKernelBuffer::for_user_buffer(reinterpret_cast<u8*>(buffer_address), submission.length));
+        if (description.should_append() && description.file().is_seekable())
+            TRY(description.seek(0, SEEK_END));
+        if (submission.offset == IO_RING_CURRENT_POSITION)
+            return TRY(description.write(buffer, submission.length));
+        return TRY(description.write(submission.offset, buffer, submission.length));
+    }
+    case IO_RING_OP_RECV: {
+        auto& socket = *description.socket();
+        if (socket.is_shut_down_for_reading())
+            return 0;
+        auto buffer = TRY(UserOrKernelBuffer::for_user_buffer(reinterpret_cast<u8*>(buffer_address), submission.length));
+        UnixDateTime timestamp {};
+        return TRY(socket.recvfrom(description, buffer, submission.length, submission.op_flags | MSG_DONTWAIT, {}, {}, timestamp, false));
+    }
+    case IO_RING_OP_SEND: {
+        auto& socket = *description.socket();
+        if (socket.is_shut_down_for_writing())
+            return EPIPE;
+        if (!description.can_write())
+            return EAGAIN;
+        auto buffer = TRY(UserOrKernelBuffer::for_user_buffer(reinterpret_cast<u8*>(buffer_address), submission.length));
+        auto nsent = TRY(socket.sendto(description, buffer, submission.length, submission.op_flags | MSG_DONTWAIT, {}, 0));
+        if (nsent == 0 && submission.length > 0)
+            return EAGAIN;
+        return nsent;
+    }
+    case IO_RING_OP_ACCEPT:
+        return try_accept(process, description, submission.op_flags);
+    case IO_RING_OP_FSYNC:
+        TRY(description.sync());
+        return 0;
+    default:
+        VERIFY_NOT_REACHED();
+    }
+}
+
+ErrorOr<FlatPtr> IORing::try_accept(Process& process, OpenFileDescription& accepting_socket_description, u32 flags)
+{
+    auto& socket = *accepting_socket_description.socket();
+    if (!socket.can_accept())
+        return EAGAIN;
+
+    auto fd_allocation = TRY(process.fds().with_exclusive([](auto& fds) { return fds.allocate(); }));
+    auto accepted_socket = socket.accept();
+    if (!accepted_socket)
+        return EAGAIN;
+
+    auto accepted_socket_description = TRY(OpenFileDescription::try_create(*accepted_socket));
+    accepted_socket_description->set_readable(true);
+    accepted_socket_description->set_writable(true);
+    if (flags & SOCK_NONBLOCK)
+        accepted_socket_description->set_blocking(false);
+    int fd_flags = 0;
+    if (flags & SOCK_CLOEXEC)
+        fd_flags |= FD_CLOEXEC;
+
+    process.fds().with_exclusive([&](auto& fds) {
+        fds[fd_allocation.fd].set(move(accepted_socket_description), fd_flags);
+    });
+
+    // NOTE: Moving this state to Completed is what causes connect() to unblock on the client side.
+    accepted_socket->set_setup_state(Socket::SetupState::Completed);
+    return fd_allocation.fd;
+}
+
+ErrorOr<NonnullLockRefPtr<Memory::VMObject>> IORing::vmobject_for_mmap(Process& process, Memory::VirtualRange const&, u64&, bool shared)
+{
+    // The queues are only useful if both sides see each other's writes. Also, the operations in
+    // them point into the owner's address space, so nobody else gets to look at them.
+    if (!shared)
+        return EINVAL;
+    if (process.pid() != m_owner)
+        return EACCES;
+    return m_vmobject;
+}
+
+ErrorOr<NonnullOwnPtr<KString>> IORing::pseudo_path(OpenFileDescription const&) const
+{
+    return KString::formatted("IORing:({} entries)", m_sq_entries);
+}
+
+}
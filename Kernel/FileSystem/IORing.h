@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Optional.h>
+#include <AK/Time.h>
+#include <AK/Vector.h>
+#include <Kernel/API/POSIX/sys/io_ring.h>
+#include <Kernel/FileSystem/File.h>
+#include <Kernel/Locking/Mutex.h>
+#include <Kernel/Memory/AnonymousVMObject.h>
+#include <Kernel/Memory/Region.h>
+#include <Kernel/Tasks/Thread.h>
+
+namespace Kernel {
+
+// The kernel side of an io_ring_setup(2) file descriptor: a submission queue and a completion
+// queue, living in a VMObject that is mapped both into the kernel and (via mmap) into the
+// process that created the ring.
+//
+// There are no kernel threads working on the queues in the background. All operations are
+// performed by whichever thread of the owning process calls io_ring_enter(2), which first
+// tries each new submission right away. Operations that can't make progress without blocking
+// are parked, and retried whenever their file becomes ready while someone waits on the ring.
+class IORing final : public File {
+public:
+    static ErrorOr<NonnullRefPtr<IORing>> try_create(Process& owner, u32 entries);
+    virtual ~IORing() override;
+
+    io_ring_params params() const;
+    ProcessID owner() const { return m_owner; }
+
+    // Consumes up to `count` submissions, and returns how many were consumed. Submissions are
+    // only consumed while there's guaranteed room for their completion.
+    ErrorOr<size_t> submit(Process&, u32 count);
+
+    // Retries all parked operations, and posts completions for the ones that are done.
+    void complete_ready_operations(Process&);
+
+    // The number of completions that userspace hasn't consumed yet.
+    u32 available_completions() const;
+
+    // Fills in what a thread waiting for parked operations has to block on. Returns false if
+    // nothing is parked, in which case there's nothing worth waiting for.
+    bool prepare_wait(Thread::SelectBlocker::FDVector&, Optional<Duration>& earliest_deadline) const;
+
+    virtual ErrorOr<NonnullLockRefPtr<Memory::VMObject>> vmobject_for_mmap(Process&, Memory::VirtualRange const&, u64& offset, bool shared) override;
+    virtual bool is_io_ring() const override { return true; }
+
+private:
+    struct ParkedOperation {
+        io_ring_submission submission;
+        RefPtr<OpenFileDescription> description;
+        Optional<Duration> deadline;
+    };
+
+    IORing(ProcessID owner, NonnullLockRefPtr<Memory::AnonymousVMObject>, NonnullOwnPtr<Memory::Region>, u32 sq_entries, u32 cq_entries);
+
+    virtual StringView class_name() const override { return "IORing"sv; }
+    virtual ErrorOr<NonnullOwnPtr<KString>> pseudo_path(OpenFileDescription const&) const override;
+    virtual bool can_read(OpenFileDescription const&, u64) const override { return false; }
+    virtual bool can_write(OpenFileDescription const&, u64) const override { return false; }
+    virtual ErrorOr<size_t> read(OpenFileDescription&, u64, UserOrKernelBuffer&, size_t) override { return ENOTSUP; }
+    virtual ErrorOr<size_t> write(OpenFileDescription&, u64, UserOrKernelBuffer const&, size_t) override { return ENOTSUP; }
+
+    io_ring_header& header() const;
+    io_ring_submission const& submission_at(u32 index) const;
+    io_ring_completion& completion_at(u32 index) const;
+
+    ErrorOr<ParkedOperation> prepare(Process&, io_ring_submission const&);
+    // Returns EAGAIN if the operation would have to block.
+    ErrorOr<FlatPtr> try_perform(Process&, ParkedOperation&);
+    static ErrorOr<FlatPtr> try_accept(Process&, OpenFileDescription&, u32 flags);
+
+    u32 free_completion_slots_locked() const;
+    void post_completion_locked(u64 user_data, ErrorOr<FlatPtr> const& result);
+
+    ProcessID const m_owner;
+    NonnullLockRefPtr<Memory::AnonymousVMObject> m_vmobject;
+    NonnullOwnPtr<Memory::Region> m_region;
+    u32 const m_sq_entries { 0 };
+    u32 const m_cq_entries { 0 };
+
+    // NOTE: The counters in the shared header can be scribbled over by userspace at any time, so
+    //       these are the only ones we trust for the queue positions that we own.
+    u32 m_sq_head { 0 };
+    u32 m_cq_tail { 0 };
+
+    mutable Mutex m_lock { "IORing"sv };
+    Vector<ParkedOperation> m_parked_operations;
+};
+
+}
@@ -6,15 +6,20 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/ByteBuffer.h>
+#include <AK/QuickSort.h>
 #include <AK/Singleton.h>
 #include <AK/StringView.h>
 #include <Kernel/API/InodeWatcherEvent.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DentryCache.h>
 #include <Kernel/FileSystem/Inode.h>
 #include <Kernel/FileSystem/InodeWatcher.h>
 #include <Kernel/FileSystem/OpenFileDescription.h>
 #include <Kernel/FileSystem/VirtualFileSystem.h>
+#include <Kernel/Interrupts/InterruptDisabler.h>
 #include <Kernel/Library/KBufferBuilder.h>
+#include <Kernel/Memory/MemoryManager.h>
 #include <Kernel/Memory/SharedInodeVMObject.h>
 #include <Kernel/Net/LocalSocket.h>
 #include <Kernel/Tasks/Process.h>
@@ -33,18 +38,29 @@ void Inode::sync_all()
     Vector<NonnullRefPtr<Inode>, 32> inodes;
     Inode::all_instances().with([&](auto& all_inodes) {
         for (auto& inode : all_inodes) {
-            if (inode.is_metadata_dirty())
+            if (inode.is_metadata_dirty() || inode.m_dirty_cached_page_count.load(AK::MemoryOrder::memory_order_relaxed) > 0)
                 inodes.append(inode);
         }
     });
 
     for (auto& inode : inodes) {
-        (void)inode->flush_metadata();
+        MutexLocker locker(inode->m_inode_lock);
+        if (inode->m_dirty_cached_page_count.load(AK::MemoryOrder::memory_order_relaxed) > 0) {
+            MutexLocker page_cache_locker(inode->m_page_cache_lock);
+            (void)inode->write_back_dirty_cached_pages_locked(0, NumericLimits<u64>::max());
+        }
+        if (inode->is_metadata_dirty())
+            (void)inode->flush_metadata();
     }
 }
 
 void Inode::sync()
 {
+    {
+        MutexLocker locker(m_inode_lock);
+        MutexLocker page_cache_locker(m_page_cache_lock);
+        (void)write_back_dirty_cached_pages_locked(0, NumericLimits<u64>::max());
+    }
     (void)flush_metadata();
     auto result = fs().flush_writes();
     if (result.is_error()) {
@@ -83,7 +99,17 @@ Inode::~Inode()
 
 void Inode::will_be_destroyed()
 {
+    if (m_may_have_cached_dentries)
+        DentryCache::the().invalidate_directory(identifier());
+
     MutexLocker locker(m_inode_lock);
+    {
+        MutexLocker page_cache_locker(m_page_cache_lock);
+        // There's no point in writing back the contents of a file that is about to be deleted.
+        if (m_dirty_cached_page_count.load(AK::MemoryOrder::memory_order_relaxed) > 0 && metadata().link_count > 0)
+            (void)write_back_dirty_cached_pages_locked(0, NumericLimits<u64>::max());
+        m_cached_pages.clear();
+    }
     if (m_metadata_dirty)
         (void)flush_metadata();
 }
@@ -92,15 +118,301 @@ ErrorOr<size_t> Inode::write_bytes(off_t offset, size_t length, UserOrKernelBuff
 {
     MutexLocker locker(m_inode_lock);
     TRY(prepare_to_write_data());
+    if (wants_page_cache())
+        return write_bytes_through_page_cache(offset, length, target_buffer, open_description);
     return write_bytes_locked(offset, length, target_buffer, open_description);
 }
 
 ErrorOr<size_t> Inode::read_bytes(off_t offset, size_t length, UserOrKernelBuffer& buffer, OpenFileDescription* open_description) const
 {
     MutexLocker locker(m_inode_lock, Mutex::Mode::Shared);
+    if (wants_page_cache())
+        return read_bytes_through_page_cache(offset, length, buffer, open_description);
     return read_bytes_locked(offset, length, buffer, open_description);
 }
 
+ErrorOr<size_t> Inode::read_bytes_for_page_cache(off_t offset, size_t length, UserOrKernelBuffer& buffer) const
+{
+    return read_bytes_locked(offset, length, buffer, nullptr);
+}
+
+ErrorOr<size_t> Inode::write_bytes_for_page_cache(off_t offset, size_t length, UserOrKernelBuffer const& data)
+{
+    return write_bytes_locked(offset, length, data, nullptr);
+}
+
+Memory::PhysicalPage* Inode::cached_page(u64 page_index) const
+{
+    VERIFY(m_page_cache_lock.is_locked());
+    auto it = m_cached_pages.find(page_index);
+    if (it == m_cached_pages.end())
+        return nullptr;
+    return it->value.page.ptr();
+}
+
+ErrorOr<Memory::PhysicalPage*> Inode::ensure_cached_page(u64 page_index, bool read_contents) const
+{
+    VERIFY(m_inode_lock.is_locked());
+    VERIFY(m_page_cache_lock.is_locked());
+
+    if (auto* page = cached_page(page_index))
+        return page;
+
+    u64 page_start = page_index * PAGE_SIZE;
+    auto file_size = size();
+    if (page_start >= file_size)
+        return nullptr;
+
+    // Everything past the end of the file has to read as zeroes, both for shared mappings of the
+    // last page and for when the file grows later on.
+    auto page = TRY(MM.allocate_physical_page(read_contents ? Memory::MemoryManager::ShouldZeroFill::No : Memory::MemoryManager::ShouldZeroFill::Yes));
+    if (read_contents) {
+        // NOTE: This is on the heap rather than the stack, as our callers may well have page-sized buffers of their own.
+        auto page_buffer = TRY(ByteBuffer::create_uninitialized(PAGE_SIZE));
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer.data());
+        auto nread = TRY(read_bytes_for_page_cache(page_start, min(static_cast<u64>(PAGE_SIZE), file_size - page_start), buffer));
+        page_buffer.bytes().slice(nread).fill(0);
+        MM.copy_into_physical_page(*page, 0, page_buffer.bytes());
+    }
+
+    TRY(m_cached_pages.try_set(page_index, CachedPage { page, false }));
+    return page.ptr();
+}
+
+void Inode::mark_cached_page_dirty(CachedPage& cached_page)
+{
+    if (cached_page.dirty)
+        return;
+    cached_page.dirty = true;
+    m_dirty_cached_page_count.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+}
+
+ErrorOr<size_t> Inode::read_bytes_through_page_cache(off_t offset, size_t length, UserOrKernelBuffer& buffer, OpenFileDescription* description) const
+{
+    VERIFY(m_inode_lock.is_locked());
+    VERIFY(offset >= 0);
+
+    auto file_size = size();
+    if (static_cast<u64>(offset) >= file_size)
+        return 0;
+    length = min(static_cast<u64>(length), file_size - offset);
+
+    // Direct reads and reads under memory pressure still use whatever is cached (it may well be newer
+    // than what's on disk), but they don't make the cache grow.
+    bool populate_cache = !(description && description->is_direct()) && !MM.has_memory_pressure();
+
+    MutexLocker page_cache_locker(m_page_cache_lock);
+
+    // NOTE: Writing to the buffer may fault, which we can't do while a page is quickmapped, so we copy through this.
+    auto bounce_buffer = TRY(ByteBuffer::create_uninitialized(min(length, PAGE_SIZE)));
+
+    size_t nread = 0;
+    while (nread < length) {
+        u64 position = offset + nread;
+        u64 page_index = position / PAGE_SIZE;
+        size_t offset_in_page = position % PAGE_SIZE;
+        size_t chunk_length = min(PAGE_SIZE - offset_in_page, length - nread);
+        auto buffer_at_chunk = buffer.offset(nread);
+
+        auto* page = populate_cache ? TRY(ensure_cached_page(page_index)) : cached_page(page_index);
+        if (!page) {
+            auto chunk_nread = TRY(read_bytes_for_page_cache(position, chunk_length, buffer_at_chunk));
+            if (chunk_nread == 0)
+                break;
+            nread += chunk_nread;
+            continue;
+        }
+
+        auto chunk = bounce_buffer.bytes().trim(chunk_length);
+        MM.copy_from_physical_page(*page, offset_in_page, chunk);
+        TRY(buffer_at_chunk.write(chunk.data(), chunk.size()));
+        nread += chunk_length;
+    }
+
+    return nread;
+}
+
+ErrorOr<size_t> Inode::write_bytes_through_page_cache(off_t offset, size_t length, UserOrKernelBuffer const& data, OpenFileDescription* description)
+{
+    VERIFY(m_inode_lock.is_exclusively_locked_by_current_thread());
+    VERIFY(offset >= 0);
+
+    if (length == 0)
+        return 0;
+
+    u64 end = offset + length;
+    u64 first_page_index = offset / PAGE_SIZE;
+    u64 end_page_index = ceil_div(end, static_cast<u64>(PAGE_SIZE));
+
+    // Writes that grow the file have to go through the file system to allocate blocks anyway (unless it can
+    // put that off until write-back), and direct writes (or writes under memory pressure) shouldn't make the
+    // cache grow. Afterwards, we bring the cached pages in the written range up to date with what the file
+    // system now has, leaving anything that was dirty outside the range alone.
+    bool bypass_cache = (description && description->is_direct()) || MM.has_memory_pressure();
+    if (end > size() && !bypass_cache && supports_delayed_allocation())
+        TRY(grow_with_delayed_allocation(end));
+    if (end > size() || bypass_cache) {
+        auto nwritten = TRY(write_bytes_locked(offset, length, data, description));
+
+        MutexLocker page_cache_locker(m_page_cache_lock);
+        ByteBuffer chunk_buffer;
+        for (u64 page_index = first_page_index; page_index < end_page_index; ++page_index) {
+            auto* page = cached_page(page_index);
+            if (!page)
+                continue;
+            u64 page_start = page_index * PAGE_SIZE;
+            u64 chunk_start = max(page_start, static_cast<u64>(offset));
+            u64 chunk_end = min(page_start + PAGE_SIZE, static_cast<u64>(offset) + nwritten);
+            if (chunk_start >= chunk_end)
+                continue;
+            if (chunk_buffer.is_empty())
+                chunk_buffer = TRY(ByteBuffer::create_uninitialized(PAGE_SIZE));
+            auto buffer = UserOrKernelBuffer::for_kernel_buffer(chunk_buffer.data());
+            auto nread = TRY(read_bytes_for_page_cache(chunk_start, chunk_end - chunk_start, buffer));
+            MM.copy_into_physical_page(*page, chunk_start - page_start, chunk_buffer.bytes().trim(nread));
+        }
+        return nwritten;
+    }
+
+    MutexLocker page_cache_locker(m_page_cache_lock);
+
+    // NOTE: Reading the data may fault, which we can't do while a page is quickmapped, so we copy through this.
+    auto bounce_buffer = TRY(ByteBuffer::create_uninitialized(min(length, PAGE_SIZE)));
+
+    auto file_size = size();
+    size_t nwritten = 0;
+    while (nwritten < length) {
+        u64 position = offset + nwritten;
+        u64 page_index = position / PAGE_SIZE;
+        u64 page_start = page_index * PAGE_SIZE;
+        size_t offset_in_page = position % PAGE_SIZE;
+        size_t chunk_length = min(PAGE_SIZE - offset_in_page, length - nwritten);
+
+        // There's no need to read in a page that we're about to overwrite completely.
+        bool overwrites_page = offset_in_page == 0 && chunk_length >= min(static_cast<u64>(PAGE_SIZE), file_size - page_start);
+        auto* page = TRY(ensure_cached_page(page_index, !overwrites_page));
+        VERIFY(page);
+
+        auto chunk = bounce_buffer.bytes().trim(chunk_length);
+        TRY(data.offset(nwritten).read(chunk.data(), chunk.size()));
+        MM.copy_into_physical_page(*page, offset_in_page, chunk);
+        mark_cached_page_dirty(m_cached_pages.find(page_index)->value);
+        nwritten += chunk_length;
+    }
+
+    did_modify_contents();
+    return nwritten;
+}
+
+ErrorOr<void> Inode::write_back_dirty_cached_pages_locked(u64 first_page_index, u64 end_page_index)
+{
+    VERIFY(m_inode_lock.is_exclusively_locked_by_current_thread());
+    VERIFY(m_page_cache_lock.is_locked());
+
+    if (m_dirty_cached_page_count.load(AK::MemoryOrder::memory_order_relaxed) == 0)
+        return {};
+
+    Vector<u64> page_indices;
+    for (auto& it : m_cached_pages) {
+        if (it.value.dirty && it.key >= first_page_index && it.key < end_page_index)
+            TRY(page_indices.try_append(it.key));
+    }
+    // Write back in file order, so the file system sees nice sequential writes.
+    quick_sort(page_indices);
+
+    // Runs of consecutive pages are written with a single call, so that the file system can allocate
+    // blocks for them in one go if it delayed doing so.
+    static constexpr size_t max_pages_per_write = 16;
+    auto run_buffer = TRY(ByteBuffer::create_uninitialized(max_pages_per_write * PAGE_SIZE));
+
+    auto file_size = size();
+    for (size_t i = 0; i < page_indices.size();) {
+        size_t run_length = 1;
+        while (run_length < max_pages_per_write && i + run_length < page_indices.size() && page_indices[i + run_length] == page_indices[i] + run_length)
+            ++run_length;
+
+        u64 run_start = page_indices[i] * PAGE_SIZE;
+        if (run_start < file_size) {
+            for (size_t j = 0; j < run_length; ++j) {
+                InterruptDisabler disabler;
+                MM.copy_physical_page(*m_cached_pages.find(page_indices[i + j])->value.page, run_buffer.offset_pointer(j * PAGE_SIZE));
+            }
+            TRY(write_bytes_for_page_cache(run_start, min(static_cast<u64>(run_length * PAGE_SIZE), file_size - run_start), UserOrKernelBuffer::for_kernel_buffer(run_buffer.data())));
+        }
+        for (size_t j = 0; j < run_length; ++j) {
+            m_cached_pages.find(page_indices[i + j])->value.dirty = false;
+            m_dirty_cached_page_count.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+        }
+        i += run_length;
+    }
+    return {};
+}
+
+ErrorOr<RefPtr<Memory::PhysicalPage>> Inode::cached_page_for_mapping(u64 page_index)
+{
+    MutexLocker locker(m_inode_lock, Mutex::Mode::Shared);
+    MutexLocker page_cache_locker(m_page_cache_lock);
+    return TRY(ensure_cached_page(page_index));
+}
+
+ErrorOr<void> Inode::sync_cached_pages(u64 first_page_index, u64 page_count)
+{
+    MutexLocker locker(m_inode_lock);
+    MutexLocker page_cache_locker(m_page_cache_lock);
+
+    // We don't know which pages were written to through a shared mapping, so assume all of them were.
+    u64 end_page_index = first_page_index + page_count;
+    for (auto& it : m_cached_pages) {
+        if (it.key >= first_page_index && it.key < end_page_index)
+            mark_cached_page_dirty(it.value);
+    }
+    return write_back_dirty_cached_pages_locked(first_page_index, end_page_index);
+}
+
+void Inode::truncate_page_cache(u64 new_size)
+{
+    VERIFY(m_inode_lock.is_exclusively_locked_by_current_thread());
+    MutexLocker page_cache_locker(m_page_cache_lock);
+
+    u64 end_page_index = ceil_div(new_size, static_cast<u64>(PAGE_SIZE));
+    m_cached_pages.remove_all_matching([&](u64 page_index, CachedPage const& cached_page) {
+        if (page_index < end_page_index)
+            return false;
+        if (cached_page.dirty)
+            m_dirty_cached_page_count.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+        return true;
+    });
+
+    // What's left of the last page past the new end of the file has to read as zeroes again.
+    if (size_t offset_in_page = new_size % PAGE_SIZE; offset_in_page != 0) {
+        if (auto* page = cached_page(new_size / PAGE_SIZE))
+            MM.zero_physical_page_range(*page, offset_in_page, PAGE_SIZE - offset_in_page);
+    }
+}
+
+void Inode::release_clean_cached_pages()
+{
+    MutexLocker page_cache_locker(m_page_cache_lock);
+    // Pages that are still mapped somewhere have to stay, so that the mappings keep seeing the same data as read().
+    m_cached_pages.remove_all_matching([](u64, CachedPage const& cached_page) {
+        return !cached_page.dirty && cached_page.page->ref_count() == 1;
+    });
+}
+
+void Inode::release_all_clean_cached_pages()
+{
+    Vector<NonnullRefPtr<Inode>, 32> inodes;
+    Inode::all_instances().with([&](auto& all_inodes) {
+        for (auto& inode : all_inodes) {
+            if (inode.wants_page_cache())
+                inodes.append(inode);
+        }
+    });
+
+    for (auto& inode : inodes)
+        inode->release_clean_cached_pages();
+}
+
 ErrorOr<size_t> Inode::read_until_filled_or_end(off_t offset, size_t length, UserOrKernelBuffer buffer, OpenFileDescription* open_description) const
 {
     auto remaining_length = length;
@@ -214,6 +526,9 @@ void Inode::set_metadata_dirty(bool metadata_dirty)
 
 void Inode::did_add_child(InodeIdentifier, StringView name)
 {
+    if (fs().supports_dentry_cache())
+        DentryCache::the().invalidate(identifier(), name);
+
     m_watchers.for_each([&](auto& watcher) {
         watcher->notify_inode_event({}, identifier(), InodeWatcherEvent::Type::ChildCreated, name);
     });
@@ -221,6 +536,9 @@ void Inode::did_add_child(InodeIdentifier, StringView name)
 
 void Inode::did_remove_child(InodeIdentifier, StringView name)
 {
+    if (fs().supports_dentry_cache())
+        DentryCache::the().invalidate(identifier(), name);
+
     if (name == "." || name == "..") {
         // These are just aliases and are not interesting to userspace.
         return;
@@ -8,7 +8,9 @@
 #pragma once
 
 #include <AK/Error.h>
+#include <AK/Atomic.h>
 #include <AK/Function.h>
+#include <AK/HashMap.h>
 #include <AK/HashTable.h>
 #include <AK/IntrusiveList.h>
 #include <Kernel/FileSystem/FIFO.h>
@@ -19,6 +21,7 @@
 #include <Kernel/Library/ListedRefCounted.h>
 #include <Kernel/Library/LockWeakPtr.h>
 #include <Kernel/Locking/Mutex.h>
+#include <Kernel/Memory/PhysicalPage.h>
 #include <Kernel/Memory/SharedInodeVMObject.h>
 
 namespace Kernel {
@@ -33,6 +36,7 @@ class Inode : public ListedRefCounted<Inode, LockType::Spinlock>
     friend class VirtualFileSystem;
     friend class FileSystem;
     friend class InodeFile;
+    friend class DentryCache;
 
 public:
     virtual ~Inode();
@@ -60,6 +64,8 @@ public:
     virtual ErrorOr<void> attach(OpenFileDescription&) { return {}; }
     virtual void detach(OpenFileDescription&) { }
     virtual void did_seek(OpenFileDescription&, off_t) { }
+    // Starts reading the given range in the background. Returns how much of it (from the start) is taken care of.
+    virtual size_t read_ahead(u64, size_t length) const { return length; }
     virtual ErrorOr<void> traverse_as_directory(Function<ErrorOr<void>(FileSystem::DirectoryEntryView const&)>) const = 0;
     virtual ErrorOr<NonnullRefPtr<Inode>> lookup(StringView name) = 0;
     virtual ErrorOr<NonnullRefPtr<Inode>> create_child(StringView name, mode_t, dev_t, UserID, GroupID) = 0;
@@ -96,6 +102,21 @@ public:
     static void sync_all();
     void sync();
 
+    // Regular files of file systems that opt in keep their contents in a per-inode page cache,
+    // which serves read() and write() and provides the pages of shared mappings of the file.
+    virtual bool wants_page_cache() const { return false; }
+
+    // File systems that can put off allocating blocks until dirty cached pages get written back let writes
+    // that grow a file go into the page cache as well. Growing the file then only has to reserve the space.
+    virtual bool supports_delayed_allocation() const { return false; }
+    virtual ErrorOr<void> grow_with_delayed_allocation(u64) { VERIFY_NOT_REACHED(); }
+
+    // Returns the cached page for a shared mapping or sendfile(), or nullptr if it's past the end of the file.
+    ErrorOr<RefPtr<Memory::PhysicalPage>> cached_page_for_mapping(u64 page_index);
+    // Writes back the given range of cached pages, including changes made through shared mappings.
+    ErrorOr<void> sync_cached_pages(u64 first_page_index, u64 page_count);
+    static void release_all_clean_cached_pages();
+
     bool has_watchers() const;
 
     ErrorOr<void> register_watcher(Badge<InodeWatcher>, InodeWatcher&);
@@ -124,9 +145,30 @@ protected:
     virtual ErrorOr<size_t> write_bytes_locked(off_t, size_t, UserOrKernelBuffer const& data, OpenFileDescription*) = 0;
     virtual ErrorOr<size_t> read_bytes_locked(off_t, size_t, UserOrKernelBuffer& buffer, OpenFileDescription*) const = 0;
 
+    // Used to fill and write back the page cache. These must bypass any caching of the file system
+    // itself, and writing back must not count as a modification of the file.
+    virtual ErrorOr<size_t> read_bytes_for_page_cache(off_t, size_t, UserOrKernelBuffer& buffer) const;
+    virtual ErrorOr<size_t> write_bytes_for_page_cache(off_t, size_t, UserOrKernelBuffer const& data);
+
+    // Must be called (with m_inode_lock held) before the file system shrinks the file.
+    void truncate_page_cache(u64 new_size);
+
 private:
     ErrorOr<bool> try_apply_flock(Process const&, OpenFileDescription const&, flock const&);
 
+    struct CachedPage {
+        NonnullRefPtr<Memory::PhysicalPage> page;
+        bool dirty { false };
+    };
+
+    ErrorOr<size_t> read_bytes_through_page_cache(off_t, size_t, UserOrKernelBuffer& buffer, OpenFileDescription*) const;
+    ErrorOr<size_t> write_bytes_through_page_cache(off_t, size_t, UserOrKernelBuffer const& data, OpenFileDescription*);
+    Memory::PhysicalPage* cached_page(u64 page_index) const;
+    ErrorOr<Memory::PhysicalPage*> ensure_cached_page(u64 page_index, bool read_contents = true) const;
+    void mark_cached_page_dirty(CachedPage&);
+    ErrorOr<void> write_back_dirty_cached_pages_locked(u64 first_page_index, u64 end_page_index);
+    void release_clean_cached_pages();
+
     FileSystem& m_file_system;
     InodeIndex m_index { 0 };
     LockWeakPtr<Memory::SharedInodeVMObject> m_shared_vmobject;
@@ -136,6 +178,14 @@ private:
     RefPtr<FIFO> m_fifo;
     IntrusiveListNode<Inode> m_inode_list_node;
 
+    // NOTE: Always taken after m_inode_lock.
+    mutable Mutex m_page_cache_lock { "InodePageCache"sv };
+    mutable HashMap<u64, CachedPage> m_cached_pages;
+    Atomic<size_t> m_dirty_cached_page_count { 0 };
+
+    // Set once the DentryCache remembers a lookup in this directory.
+    Atomic<bool> m_may_have_cached_dentries { false };
+
     struct Flock {
         off_t start;
         off_t len;
@@ -33,6 +33,10 @@ ErrorOr<size_t> InodeFile::read(OpenFileDescription& description, u64 offset, Us
     if (nread > 0) {
         Thread::current()->did_file_read(nread);
         evaluate_block_conditions();
+        if (auto read_ahead = description.update_read_ahead_state(offset, nread); read_ahead.length > 0) {
+            auto submitted = m_inode->read_ahead(read_ahead.offset, read_ahead.length);
+            description.did_read_ahead(read_ahead.offset + submitted);
+        }
     }
     return nread;
 }
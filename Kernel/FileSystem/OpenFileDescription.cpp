@@ -11,7 +11,9 @@
 #include <Kernel/Devices/TTY/MasterPTY.h>
 #include <Kernel/Devices/TTY/TTY.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/EventPoll.h>
 #include <Kernel/FileSystem/FIFO.h>
+#include <Kernel/FileSystem/IORing.h>
 #include <Kernel/FileSystem/InodeFile.h>
 #include <Kernel/FileSystem/InodeWatcher.h>
 #include <Kernel/FileSystem/MountFile.h>
@@ -53,6 +55,7 @@ OpenFileDescription::OpenFileDescription(File& file)
 
 OpenFileDescription::~OpenFileDescription()
 {
+    blocker_set().remove_event_poll_interests_for(*this);
     m_file->detach(*this);
     // FIXME: Should this error path be observed somehow?
     (void)m_file->close();
@@ -314,6 +317,37 @@ InodeWatcher* OpenFileDescription::inode_watcher()
     return static_cast<InodeWatcher*>(m_file.ptr());
 }
 
+bool OpenFileDescription::is_event_poll() const
+{
+    return m_file->is_event_poll();
+}
+
+EventPoll const* OpenFileDescription::event_poll() const
+{
+    if (!is_event_poll())
+        return nullptr;
+    return static_cast<EventPoll const*>(m_file.ptr());
+}
+
+EventPoll* OpenFileDescription::event_poll()
+{
+    if (!is_event_poll())
+        return nullptr;
+    return static_cast<EventPoll*>(m_file.ptr());
+}
+
+bool OpenFileDescription::is_io_ring() const
+{
+    return m_file->is_io_ring();
+}
+
+IORing* OpenFileDescription::io_ring()
+{
+    if (!is_io_ring())
+        return nullptr;
+    return static_cast<IORing*>(m_file.ptr());
+}
+
 bool OpenFileDescription::is_mount_file() const
 {
     return m_file->is_mount_file();
@@ -499,6 +533,41 @@ bool OpenFileDescription::is_direct() const
     return m_state.with([](auto& state) { return state.direct; });
 }
 
+OpenFileDescription::ReadAheadRange OpenFileDescription::update_read_ahead_state(u64 offset, size_t count)
+{
+    static constexpr size_t initial_read_ahead_window = 32 * KiB;
+    static constexpr size_t maximum_read_ahead_window = 512 * KiB;
+
+    return m_state.with([&](auto& state) -> ReadAheadRange {
+        auto end_offset = offset + count;
+        if (state.direct || offset != state.next_sequential_offset) {
+            state.next_sequential_offset = end_offset;
+            state.read_ahead_end = 0;
+            state.read_ahead_window = 0;
+            return {};
+        }
+
+        // Sustained sequential reading doubles the window every time.
+        state.next_sequential_offset = end_offset;
+        state.read_ahead_window = state.read_ahead_window ? min(state.read_ahead_window * 2, maximum_read_ahead_window) : initial_read_ahead_window;
+
+        auto window_end = end_offset + state.read_ahead_window;
+        auto start = max(end_offset, state.read_ahead_end);
+        // Don't dribble out tiny requests; wait until the reader has used up half of what we read ahead last time.
+        if (start >= window_end || start - end_offset > state.read_ahead_window / 2)
+            return {};
+
+        return { start, static_cast<size_t>(window_end - start) };
+    });
+}
+
+void OpenFileDescription::did_read_ahead(u64 end_offset)
+{
+    m_state.with([&](auto& state) {
+        state.read_ahead_end = max(state.read_ahead_end, end_offset);
+    });
+}
+
 bool OpenFileDescription::is_directory() const
 {
     return m_state.with([](auto& state) { return state.is_directory; });
@@ -63,6 +63,16 @@ public:
 
     bool is_direct() const;
 
+    struct ReadAheadRange {
+        u64 offset { 0 };
+        size_t length { 0 };
+    };
+    // Tracks sequential reads through this description and returns the range (if any)
+    // that should be read ahead after a read of `count` bytes at `offset`.
+    ReadAheadRange update_read_ahead_state(u64 offset, size_t count);
+    // Records how far reading ahead actually got, which may be short of what update_read_ahead_state() asked for.
+    void did_read_ahead(u64 end_offset);
+
     bool is_directory() const;
 
     File& file() { return *m_file; }
@@ -80,6 +90,13 @@ public:
     InodeWatcher const* inode_watcher() const;
     InodeWatcher* inode_watcher();
 
+    bool is_event_poll() const;
+    EventPoll const* event_poll() const;
+    EventPoll* event_poll();
+
+    bool is_io_ring() const;
+    IORing* io_ring();
+
     bool is_mount_file() const;
     MountFile const* mount_file() const;
     MountFile* mount_file();
@@ -149,6 +166,9 @@ private:
         OwnPtr<OpenFileDescriptionData> data;
         RefPtr<Custody> custody;
         off_t current_offset { 0 };
+        u64 next_sequential_offset { 0 };
+        u64 read_ahead_end { 0 };
+        size_t read_ahead_window { 0 };
         u32 file_flags { 0 };
         bool readable : 1 { false };
         bool writable : 1 { false };
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Atomic.h>
+#include <Kernel/Arch/Processor.h>
+#include <Kernel/FileSystem/PerformanceEventStream.h>
+#include <Kernel/Interrupts/InterruptDisabler.h>
+#include <Kernel/Library/KString.h>
+#include <Kernel/Memory/MemoryManager.h>
+
+namespace Kernel {
+
+// Enough for a few seconds' worth of samples with deep stacks on a busy CPU, so that a consumer
+// that wakes up every few milliseconds has plenty of slack.
+static constexpr size_t ring_data_size = 1 * MiB;
+static constexpr size_t max_name_length = 256;
+
+static_assert(is_power_of_two(ring_data_size));
+static_assert(sizeof(PerformanceEventStreamHeader) <= PAGE_SIZE);
+static_assert(sizeof(PerformanceEventRingHeader) <= PAGE_SIZE);
+static_assert(sizeof(FlatPtr) == sizeof(u64));
+
+ErrorOr<NonnullRefPtr<PerformanceEventStream>> PerformanceEventStream::try_create(bool show_kernel_addresses)
+{
+    u32 cpu_count = Processor::count();
+    size_t ring_stride = PAGE_SIZE + ring_data_size;
+    size_t total_size = PAGE_SIZE + cpu_count * ring_stride;
+
+    // The rings are written to from interrupt handlers, so they all have to be backed by physical
+    // memory right away.
+    auto vmobject = TRY(Memory::AnonymousVMObject::try_create_with_size(total_size, AllocationStrategy::AllocateNow));
+    auto region = TRY(MM.allocate_kernel_region_with_vmobject(*vmobject, total_size, "Performance event stream"sv, Memory::Region::Access::ReadWrite));
+
+    auto& header = *reinterpret_cast<PerformanceEventStreamHeader*>(region->vaddr().as_ptr());
+    header.magic = performance_event_stream_magic;
+    header.version = performance_event_stream_version;
+    header.cpu_count = cpu_count;
+    header.total_size = total_size;
+    header.first_ring_offset = PAGE_SIZE;
+    header.ring_stride = ring_stride;
+    header.data_offset = PAGE_SIZE;
+    header.data_size = ring_data_size;
+
+    return adopt_nonnull_ref_or_enomem(new (nothrow) PerformanceEventStream(move(vmobject), move(region), cpu_count, show_kernel_addresses));
+}
+
+PerformanceEventStream::PerformanceEventStream(NonnullLockRefPtr<Memory::AnonymousVMObject> vmobject, NonnullOwnPtr<Memory::Region> region, u32 cpu_count, bool show_kernel_addresses)
+    : m_vmobject(move(vmobject))
+    , m_region(move(region))
+    , m_cpu_count(cpu_count)
+    , m_show_kernel_addresses(show_kernel_addresses)
+{
+}
+
+PerformanceEventStream::~PerformanceEventStream() = default;
+
+// NOTE: The stream header is mapped writable into userspace as well, so we never look at the
+//       layout it describes, and recompute everything from our own constants instead.
+PerformanceEventRingHeader& PerformanceEventStream::ring_header(u32 cpu) const
+{
+    VERIFY(cpu < m_cpu_count);
+    return *reinterpret_cast<PerformanceEventRingHeader*>(m_region->vaddr().offset(PAGE_SIZE + cpu * (PAGE_SIZE + ring_data_size)).as_ptr());
+}
+
+u8* PerformanceEventStream::ring_data(u32 cpu) const
+{
+    return reinterpret_cast<u8*>(&ring_header(cpu)) + PAGE_SIZE;
+}
+
+ErrorOr<void> PerformanceEventStream::append(PerformanceEventRecord record, ReadonlySpan<FlatPtr> stack, StringView name)
+{
+    size_t name_length = min(name.length(), max_name_length);
+    size_t record_size = align_up_to(sizeof(record) + stack.size() * sizeof(FlatPtr) + name_length, 8);
+    record.size = record_size;
+    record.stack_size = stack.size();
+    record.name_length = name_length;
+
+    // With interrupts disabled, nothing else can append to this CPU's ring until we're done.
+    InterruptDisabler disabler;
+    auto cpu = Processor::current_id();
+    auto& ring = ring_header(cpu);
+    auto* data = ring_data(cpu);
+
+    // NOTE: The ring header is shared with userspace, so neither of these can be trusted to make
+    //       sense. All we make sure of is that we never write outside of the ring.
+    u64 head = AK::atomic_load(&ring.head, AK::MemoryOrder::memory_order_relaxed);
+    u64 tail = AK::atomic_load(&ring.tail, AK::MemoryOrder::memory_order_acquire);
+
+    size_t offset = head & (ring_data_size - 1);
+    size_t space_until_end = ring_data_size - offset;
+    size_t needed = record_size;
+    if (space_until_end < record_size)
+        needed += space_until_end;
+
+    u64 used = head - tail;
+    if (used > ring_data_size || ring_data_size - used < needed) {
+        AK::atomic_fetch_add(&ring.dropped_events, static_cast<u64>(1), AK::MemoryOrder::memory_order_relaxed);
+        return ENOBUFS;
+    }
+
+    if (space_until_end < record_size) {
+        // Fill the rest of the ring with padding, so records never wrap around. As records are
+        // 8-byte aligned, there is always room for at least the size and type of the padding.
+        PerformanceEventRecord padding {};
+        padding.size = space_until_end;
+        padding.type = 0;
+        memcpy(data + offset, &padding, min(sizeof(padding), space_until_end));
+        head += space_until_end;
+        offset = 0;
+    }
+
+    memcpy(data + offset, &record, sizeof(record));
+    memcpy(data + offset + sizeof(record), stack.data(), stack.size() * sizeof(FlatPtr));
+    memcpy(data + offset + sizeof(record) + stack.size() * sizeof(FlatPtr), name.characters_without_null_termination(), name_length);
+
+    AK::atomic_store(&ring.head, head + record_size, AK::MemoryOrder::memory_order_release);
+    return {};
+}
+
+u64 PerformanceEventStream::dropped_events() const
+{
+    u64 dropped_events = 0;
+    for (u32 cpu = 0; cpu < m_cpu_count; ++cpu)
+        dropped_events += AK::atomic_load(&ring_header(cpu).dropped_events, AK::MemoryOrder::memory_order_relaxed);
+    return dropped_events;
+}
+
+ErrorOr<NonnullLockRefPtr<Memory::VMObject>> PerformanceEventStream::vmobject_for_mmap(Process&, Memory::VirtualRange const&, u64&, bool shared)
+{
+    // A private mapping would never see anything the kernel appends after the first write.
+    if (!shared)
+        return EINVAL;
+    return m_vmobject;
+}
+
+ErrorOr<NonnullOwnPtr<KString>> PerformanceEventStream::pseudo_path(OpenFileDescription const&) const
+{
+    return KString::formatted("PerformanceEventStream:({} CPUs)", m_cpu_count);
+}
+
+}
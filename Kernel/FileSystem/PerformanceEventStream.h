@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Span.h>
+#include <Kernel/API/PerformanceEventStream.h>
+#include <Kernel/FileSystem/File.h>
+#include <Kernel/Memory/AnonymousVMObject.h>
+#include <Kernel/Memory/Region.h>
+
+namespace Kernel {
+
+// The kernel side of a profiling_stream(2) file descriptor: one ring buffer per CPU, living in
+// a VMObject that is mapped both into the kernel and (via mmap) into the consuming process.
+//
+// Events are appended to the ring of the CPU they happen on, with interrupts disabled, so
+// every ring has exactly one producer and appending never has to take a lock. When the
+// consumer falls behind, new events are dropped and counted instead of overwriting old ones.
+class PerformanceEventStream final : public File {
+public:
+    static ErrorOr<NonnullRefPtr<PerformanceEventStream>> try_create(bool show_kernel_addresses);
+    virtual ~PerformanceEventStream() override;
+
+    ErrorOr<void> append(PerformanceEventRecord record, ReadonlySpan<FlatPtr> stack, StringView name);
+
+    u64 dropped_events() const;
+
+    // Whether the consumer is allowed to see kernel addresses and kernel heap events. This is
+    // decided once, when the stream is created, based on the credentials of its creator.
+    bool show_kernel_addresses() const { return m_show_kernel_addresses; }
+
+    virtual ErrorOr<NonnullLockRefPtr<Memory::VMObject>> vmobject_for_mmap(Process&, Memory::VirtualRange const&, u64& offset, bool shared) override;
+
+private:
+    PerformanceEventStream(NonnullLockRefPtr<Memory::AnonymousVMObject>, NonnullOwnPtr<Memory::Region>, u32 cpu_count, bool show_kernel_addresses);
+
+    virtual StringView class_name() const override { return "PerformanceEventStream"sv; }
+    virtual ErrorOr<NonnullOwnPtr<KString>> pseudo_path(OpenFileDescription const&) const override;
+    virtual bool can_read(OpenFileDescription const&, u64) const override { return false; }
+    virtual bool can_write(OpenFileDescription const&, u64) const override { return false; }
+    virtual ErrorOr<size_t> read(OpenFileDescription&, u64, UserOrKernelBuffer&, size_t) override { return ENOTSUP; }
+    virtual ErrorOr<size_t> write(OpenFileDescription&, u64, UserOrKernelBuffer const&, size_t) override { return ENOTSUP; }
+
+    PerformanceEventRingHeader& ring_header(u32 cpu) const;
+    u8* ring_data(u32 cpu) const;
+
+    NonnullLockRefPtr<Memory::AnonymousVMObject> m_vmobject;
+    NonnullOwnPtr<Memory::Region> m_region;
+    u32 const m_cpu_count { 0 };
+    bool const m_show_kernel_addresses { false };
+};
+
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/Configuration/LoopbackLossRate.h>
+#include <Kernel/Net/LoopbackAdapter.h>
+#include <Kernel/Net/NetworkingManagement.h>
+#include <Kernel/Sections.h>
+
+namespace Kernel {
+
+UNMAP_AFTER_INIT SysFSLoopbackLossRate::SysFSLoopbackLossRate(SysFSDirectory const& parent_directory)
+    : SysFSSystemUnsignedIntegerVariable(parent_directory)
+{
+}
+
+UNMAP_AFTER_INIT NonnullRefPtr<SysFSLoopbackLossRate> SysFSLoopbackLossRate::must_create(SysFSDirectory const& parent_directory)
+{
+    return adopt_ref_if_nonnull(new (nothrow) SysFSLoopbackLossRate(parent_directory)).release_nonnull();
+}
+
+u32 SysFSLoopbackLossRate::value() const
+{
+    return static_cast<LoopbackAdapter&>(*NetworkingManagement::the().loopback_adapter()).loss_per_mille();
+}
+
+void SysFSLoopbackLossRate::set_value(u32 new_value)
+{
+    static_cast<LoopbackAdapter&>(*NetworkingManagement::the().loopback_adapter()).set_loss_per_mille(new_value);
+}
+
+}
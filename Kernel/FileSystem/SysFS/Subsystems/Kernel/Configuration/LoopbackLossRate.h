@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/RefPtr.h>
+#include <AK/Types.h>
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/Configuration/UnsignedIntegerVariable.h>
+
+namespace Kernel {
+
+class SysFSLoopbackLossRate final : public SysFSSystemUnsignedIntegerVariable {
+public:
+    virtual StringView name() const override { return "loopback_loss_per_mille"sv; }
+    static NonnullRefPtr<SysFSLoopbackLossRate> must_create(SysFSDirectory const&);
+
+private:
+    virtual u32 value() const override;
+    virtual void set_value(u32 new_value) override;
+    virtual u32 maximum_value() const override { return 1000; }
+
+    explicit SysFSLoopbackLossRate(SysFSDirectory const&);
+};
+
+}
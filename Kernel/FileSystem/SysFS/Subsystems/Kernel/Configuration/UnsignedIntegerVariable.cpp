@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/FileSystem/SysFS/Subsystems/Kernel/Configuration/UnsignedIntegerVariable.h>
+#include <Kernel/Sections.h>
+#include <Kernel/Tasks/Process.h>
+
+namespace Kernel {
+
+ErrorOr<void> SysFSSystemUnsignedIntegerVariable::try_generate(KBufferBuilder& builder)
+{
+    return builder.appendff("{}\n", value());
+}
+
+ErrorOr<size_t> SysFSSystemUnsignedIntegerVariable::write_bytes(off_t, size_t count, UserOrKernelBuffer const& buffer, OpenFileDescription*)
+{
+    MutexLocker locker(m_refresh_lock);
+    // Enough for any u32 and a trailing newline.
+    char value_buffer[12] {};
+    if (count == 0 || count > sizeof(value_buffer))
+        return Error::from_errno(EINVAL);
+    TRY(buffer.read(value_buffer, count));
+
+    // NOTE: If we are in a jail, don't let the current process to change the variable.
+    if (Process::current().is_currently_in_jail())
+        return Error::from_errno(EPERM);
+
+    auto new_value = StringView { value_buffer, count }.trim("\n"sv).to_uint<u32>();
+    if (!new_value.has_value() || new_value.value() > maximum_value())
+        return Error::from_errno(EINVAL);
+    set_value(new_value.value());
+    return count;
+}
+
+ErrorOr<void> SysFSSystemUnsignedIntegerVariable::truncate(u64 size)
+{
+    if (size != 0)
+        return EPERM;
+    return {};
+}
+
+}
@@ -5,6 +5,7 @@
  */
 
 #include <AK/JsonObjectSerializer.h>
+#include <Kernel/FileSystem/BlockBasedFileSystem.h>
 #include <Kernel/FileSystem/FileBackedFileSystem.h>
 #include <Kernel/FileSystem/SysFS/Subsystems/Kernel/DiskUsage.h>
 #include <Kernel/FileSystem/VirtualFileSystem.h>
@@ -46,6 +47,19 @@ ErrorOr<void> SysFSDiskUsage::try_generate(KBufferBuilder& builder)
             TRY(fs_object.add("source"sv, "none"));
         }
 
+        if (fs.is_block_based()) {
+            auto statistics = static_cast<BlockBasedFileSystem const&>(fs).cache_statistics();
+            auto cache_object = TRY(fs_object.add_object("block_cache"sv));
+            TRY(cache_object.add("hits"sv, statistics.hits));
+            TRY(cache_object.add("misses"sv, statistics.misses));
+            TRY(cache_object.add("evictions"sv, statistics.evictions));
+            TRY(cache_object.add("ghost_hits"sv, statistics.ghost_hits));
+            TRY(cache_object.add("read_ahead_blocks"sv, statistics.read_ahead_blocks));
+            TRY(cache_object.add("capacity"sv, statistics.capacity));
+            TRY(cache_object.add("maximum_capacity"sv, statistics.maximum_capacity));
+            TRY(cache_object.finish());
+        }
+
         TRY(fs_object.finish());
         return {};
     }));
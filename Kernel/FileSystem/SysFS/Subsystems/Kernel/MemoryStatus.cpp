@@ -37,6 +37,16 @@ ErrorOr<void> SysFSMemoryStatus::try_generate(KBufferBuilder& builder)
     TRY(json.add("physical_uncommitted"sv, system_memory.physical_pages_uncommitted));
     TRY(json.add("kmalloc_call_count"sv, stats.kmalloc_call_count));
     TRY(json.add("kfree_call_count"sv, stats.kfree_call_count));
+    auto slabheaps = TRY(json.add_array("kmalloc_slabheaps"sv));
+    for (auto const& slabheap_stats : stats.slabheaps) {
+        auto obj = TRY(slabheaps.add_object());
+        TRY(obj.add("slab_size"sv, slabheap_stats.slab_size));
+        TRY(obj.add("magazine_hits"sv, slabheap_stats.magazine_hits));
+        TRY(obj.add("magazine_misses"sv, slabheap_stats.magazine_misses));
+        TRY(obj.add("depot_magazines"sv, slabheap_stats.depot_magazine_count));
+        TRY(obj.finish());
+    }
+    TRY(slabheaps.finish());
     TRY(json.finish());
     return {};
 }
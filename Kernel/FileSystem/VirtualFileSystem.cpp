@@ -15,6 +15,7 @@
 #include <Kernel/Devices/BlockDevice.h>
 #include <Kernel/Devices/DeviceManagement.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DentryCache.h>
 #include <Kernel/FileSystem/FileBackedFileSystem.h>
 #include <Kernel/FileSystem/FileSystem.h>
 #include <Kernel/FileSystem/OpenFileDescription.h>
@@ -267,6 +268,21 @@ void VirtualFileSystem::sync_filesystems()
     }
 }
 
+void VirtualFileSystem::release_filesystem_cache_memory()
+{
+    DentryCache::the().clear();
+    Inode::release_all_clean_cached_pages();
+
+    Vector<NonnullRefPtr<FileSystem>, 32> file_systems;
+    m_file_systems_list.with([&](auto const& list) {
+        for (auto& fs : list)
+            file_systems.append(fs);
+    });
+
+    for (auto& fs : file_systems)
+        fs->release_clean_cache_memory();
+}
+
 void VirtualFileSystem::lock_all_filesystems()
 {
     Vector<NonnullRefPtr<FileSystem>, 32> file_systems;
@@ -288,6 +304,9 @@ ErrorOr<void> VirtualFileSystem::unmount(Custody& mountpoint_custody)
 
 ErrorOr<void> VirtualFileSystem::unmount(Inode& guest_inode, StringView custody_path)
 {
+    // The cached lookups hold on to inodes, which would make the file system look busy.
+    DentryCache::the().invalidate_file_system(guest_inode.fsid());
+
     return m_file_backed_file_systems_list.with_exclusive([&](auto& file_backed_fs_list) -> ErrorOr<void> {
         TRY(m_mounts.with([&](auto& mounts) -> ErrorOr<void> {
             for (auto& mount : mounts) {
@@ -1212,7 +1231,7 @@ ErrorOr<NonnullRefPtr<Custody>> VirtualFileSystem::resolve_path_without_veil(Cre
         }
 
         // Okay, let's look up this part.
-        auto child_or_error = parent.inode().lookup(part);
+        auto child_or_error = DentryCache::the().lookup(parent.inode(), part);
         if (child_or_error.is_error()) {
             if (out_parent) {
                 // ENOENT with a non-null parent custody signals to caller that
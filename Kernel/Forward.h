@@ -21,8 +21,11 @@ class Custody;
 class Device;
 class DiskCache;
 class DoubleBuffer;
+class EventPoll;
+class EventPollInterest;
 class File;
 class FATInode;
+class IORing;
 class OpenFileDescription;
 class DisplayConnector;
 class FileSystem;
@@ -40,6 +43,7 @@ class Mutex;
 class MasterPTY;
 class Mount;
 class PerformanceEventBuffer;
+class PerformanceEventStream;
 class ProcFS;
 class ProcFSInode;
 class Process;
@@ -5,11 +5,13 @@
  */
 
 #include <AK/Assertions.h>
+#include <AK/Atomic.h>
 #include <AK/Types.h>
 #include <Kernel/Arch/PageDirectory.h>
 #include <Kernel/Debug.h>
 #include <Kernel/Heap/Heap.h>
 #include <Kernel/Heap/kmalloc.h>
+#include <Kernel/Interrupts/InterruptDisabler.h>
 #include <Kernel/KSyms.h>
 #include <Kernel/Library/Panic.h>
 #include <Kernel/Library/StdLib.h>
@@ -113,6 +115,48 @@ private:
     [[gnu::aligned(16)]] u8 m_data[];
 };
 
+// A magazine is a small stack of free slabs of a single slabheap size class.
+// Every processor keeps a loaded and a previous magazine per slabheap, so that
+// most kmalloc/kfree pairs can be served without taking the global kmalloc lock.
+// Whenever both of them are exhausted, the processor exchanges a magazine with
+// the slabheap's depot, which is what rebalances free slabs between processors.
+struct KmallocMagazine {
+    static constexpr size_t capacity = 28;
+
+    bool is_empty() const { return count == 0; }
+    bool is_full() const { return count == capacity; }
+
+    void push(void* slab)
+    {
+        VERIFY(!is_full());
+        slabs[count++] = slab;
+    }
+
+    void* pop()
+    {
+        VERIFY(!is_empty());
+        return slabs[--count];
+    }
+
+    IntrusiveListNode<KmallocMagazine> list_node;
+    using List = IntrusiveList<&KmallocMagazine::list_node>;
+
+    size_t count { 0 };
+    void* slabs[capacity];
+};
+
+struct KmallocProcessorSlabheapCache {
+    KmallocMagazine* loaded { nullptr };
+    KmallocMagazine* previous { nullptr };
+    size_t hits { 0 };
+    size_t misses { 0 };
+};
+
+static KmallocMagazine* allocate_magazine();
+static void deallocate_magazine(KmallocMagazine*);
+static void request_processor_cache_flush();
+static size_t processor_cached_bytes(size_t slabheap_index);
+
 class KmallocSlabheap {
 public:
     KmallocSlabheap(size_t slab_size)
@@ -124,39 +168,105 @@ public:
 
     void* allocate(CallerWillInitializeMemory caller_will_initialize_memory)
     {
-        if (m_usable_blocks.is_empty()) {
-            // FIXME: This allocation wastes `block_size` bytes due to the implementation of kmalloc_aligned().
-            //        Handle this with a custom VM+page allocator instead of using kmalloc_aligned().
-            auto* slot = kmalloc_aligned(KmallocSlabBlock::block_size, KmallocSlabBlock::block_size);
-            if (!slot) {
-                dbgln_if(KMALLOC_DEBUG, "OOM while growing slabheap ({})", m_slab_size);
-                return nullptr;
+        auto* ptr = allocate_slab();
+        if (ptr && caller_will_initialize_memory == CallerWillInitializeMemory::No) {
+            memset(ptr, KMALLOC_SCRUB_BYTE, m_slab_size);
+        }
+        return ptr;
+    }
+
+    void deallocate(void* ptr)
+    {
+        memset(ptr, KFREE_SCRUB_BYTE, m_slab_size);
+        deallocate_slab(ptr);
+    }
+
+    // Called with the kmalloc lock held once both of a processor's magazines are empty.
+    void* allocate_with_magazine_exchange(KmallocProcessorSlabheapCache& cache, CallerWillInitializeMemory caller_will_initialize_memory)
+    {
+        ++cache.misses;
+
+        if (!m_full_magazines.is_empty()) {
+            if (cache.loaded) {
+                VERIFY(cache.loaded->is_empty());
+                return_empty_magazine(*cache.loaded);
             }
-            auto* block = new (slot) KmallocSlabBlock(m_slab_size);
-            m_usable_blocks.append(*block);
+            cache.loaded = m_full_magazines.take_first();
+            --m_full_magazine_count;
+        } else {
+            // The depot has nothing to offer, so fill our own magazine straight from the slab blocks.
+            // We only fill it halfway, to leave room for the frees that usually follow.
+            if (!cache.loaded)
+                cache.loaded = take_empty_magazine();
+            if (!cache.loaded)
+                return allocate(caller_will_initialize_memory);
+            while (cache.loaded->count < KmallocMagazine::capacity / 2) {
+                auto* slab = allocate_slab();
+                if (!slab)
+                    break;
+                cache.loaded->push(slab);
+            }
+            if (cache.loaded->is_empty())
+                return nullptr;
         }
-        auto* block = m_usable_blocks.first();
-        auto* ptr = block->allocate();
-        if (block->is_full())
-            m_full_blocks.append(*block);
 
-        if (caller_will_initialize_memory == CallerWillInitializeMemory::No) {
+        auto* ptr = cache.loaded->pop();
+        if (caller_will_initialize_memory == CallerWillInitializeMemory::No)
             memset(ptr, KMALLOC_SCRUB_BYTE, m_slab_size);
-        }
         return ptr;
     }
 
-    void deallocate(void* ptr)
+    // Called with the kmalloc lock held once both of a processor's magazines are full.
+    void deallocate_with_magazine_exchange(KmallocProcessorSlabheapCache& cache, void* ptr)
     {
+        ++cache.misses;
         memset(ptr, KFREE_SCRUB_BYTE, m_slab_size);
 
-        auto* block = (KmallocSlabBlock*)((FlatPtr)ptr & KmallocSlabBlock::block_mask);
-        bool block_was_full = block->is_full();
-        block->deallocate(ptr);
-        if (block_was_full)
-            m_usable_blocks.append(*block);
+        if (cache.loaded) {
+            VERIFY(cache.loaded->is_full());
+            m_full_magazines.append(*exchange(cache.loaded, nullptr));
+            ++m_full_magazine_count;
+            trim_depot();
+        }
+
+        cache.loaded = take_empty_magazine();
+        if (!cache.loaded) {
+            deallocate_slab(ptr);
+            return;
+        }
+        cache.loaded->push(ptr);
+    }
+
+    // Returns every slab held by the depot to its slab block, so that fully unused blocks can be purged.
+    void flush_depot()
+    {
+        while (!m_full_magazines.is_empty()) {
+            auto* magazine = m_full_magazines.take_first();
+            --m_full_magazine_count;
+            drain_magazine(*magazine);
+            deallocate_magazine(magazine);
+        }
+        while (!m_empty_magazines.is_empty()) {
+            deallocate_magazine(m_empty_magazines.take_first());
+            --m_empty_magazine_count;
+        }
     }
 
+    // Called with the kmalloc lock held by the processor owning the cache, when it isn't using the cache further up the stack.
+    void flush_processor_cache(KmallocProcessorSlabheapCache& cache)
+    {
+        auto flush = [&](KmallocMagazine* magazine) {
+            if (!magazine)
+                return;
+            drain_magazine(*magazine);
+            return_empty_magazine(*magazine);
+        };
+        flush(exchange(cache.loaded, nullptr));
+        flush(exchange(cache.previous, nullptr));
+    }
+
+    size_t depot_magazine_count() const { return m_full_magazine_count; }
+
     size_t allocated_bytes() const
     {
         size_t total = m_full_blocks.size_slow() * KmallocSlabBlock::block_size;
@@ -173,6 +283,14 @@ public:
         return total;
     }
 
+    size_t depot_cached_bytes() const
+    {
+        size_t total = 0;
+        for (auto const& magazine : m_full_magazines)
+            total += magazine.count * m_slab_size;
+        return total;
+    }
+
     bool try_purge()
     {
         bool did_purge = false;
@@ -199,10 +317,85 @@ public:
     }
 
 private:
+    // Upper bounds for the number of magazines kept in the depot, so that free slabs
+    // don't pile up there after a burst of frees.
+    static constexpr size_t max_full_magazines_in_depot = 16;
+    static constexpr size_t max_empty_magazines_in_depot = 16;
+
+    void* allocate_slab()
+    {
+        if (m_usable_blocks.is_empty()) {
+            // FIXME: This allocation wastes `block_size` bytes due to the implementation of kmalloc_aligned().
+            //        Handle this with a custom VM+page allocator instead of using kmalloc_aligned().
+            auto* slot = kmalloc_aligned(KmallocSlabBlock::block_size, KmallocSlabBlock::block_size);
+            if (!slot) {
+                dbgln_if(KMALLOC_DEBUG, "OOM while growing slabheap ({})", m_slab_size);
+                return nullptr;
+            }
+            auto* block = new (slot) KmallocSlabBlock(m_slab_size);
+            m_usable_blocks.append(*block);
+        }
+        auto* block = m_usable_blocks.first();
+        auto* ptr = block->allocate();
+        if (block->is_full())
+            m_full_blocks.append(*block);
+        return ptr;
+    }
+
+    void deallocate_slab(void* ptr)
+    {
+        auto* block = (KmallocSlabBlock*)((FlatPtr)ptr & KmallocSlabBlock::block_mask);
+        bool block_was_full = block->is_full();
+        block->deallocate(ptr);
+        if (block_was_full)
+            m_usable_blocks.append(*block);
+    }
+
+    void drain_magazine(KmallocMagazine& magazine)
+    {
+        while (!magazine.is_empty())
+            deallocate_slab(magazine.pop());
+    }
+
+    KmallocMagazine* take_empty_magazine()
+    {
+        if (!m_empty_magazines.is_empty()) {
+            --m_empty_magazine_count;
+            return m_empty_magazines.take_first();
+        }
+        return allocate_magazine();
+    }
+
+    void return_empty_magazine(KmallocMagazine& magazine)
+    {
+        VERIFY(magazine.is_empty());
+        if (m_empty_magazine_count >= max_empty_magazines_in_depot) {
+            deallocate_magazine(&magazine);
+            return;
+        }
+        m_empty_magazines.append(magazine);
+        ++m_empty_magazine_count;
+    }
+
+    void trim_depot()
+    {
+        while (m_full_magazine_count > max_full_magazines_in_depot) {
+            auto* magazine = m_full_magazines.take_first();
+            --m_full_magazine_count;
+            drain_magazine(*magazine);
+            return_empty_magazine(*magazine);
+        }
+    }
+
     size_t m_slab_size { 0 };
 
     KmallocSlabBlock::List m_usable_blocks;
     KmallocSlabBlock::List m_full_blocks;
+
+    KmallocMagazine::List m_full_magazines;
+    KmallocMagazine::List m_empty_magazines;
+    size_t m_full_magazine_count { 0 };
+    size_t m_empty_magazine_count { 0 };
 };
 
 struct KmallocGlobalData {
@@ -240,6 +433,10 @@ struct KmallocGlobalData {
             // FIXME: We should propagate a freed pointer, to find the specific subheap it belonged to
             //        This would save us iterating over them in the next step and remove a recursion
             bool did_purge = false;
+            // The processors give back what their own magazines hold the next time they enter kmalloc.
+            request_processor_cache_flush();
+            for (auto& slabheap : slabheaps)
+                slabheap.flush_depot();
             for (auto& slabheap : slabheaps) {
                 if (slabheap.try_purge()) {
                     dbgln_if(KMALLOC_DEBUG, "Kmalloc purged block(s) from slabheap of size {} to avoid expansion", slabheap.slab_size());
@@ -284,8 +481,10 @@ struct KmallocGlobalData {
         size_t total = 0;
         for (auto const& subheap : subheaps)
             total += subheap.allocator.allocated_bytes();
-        for (auto const& slabheap : slabheaps)
-            total += slabheap.allocated_bytes();
+        for (size_t i = 0; i < KMALLOC_SLABHEAP_COUNT; ++i) {
+            auto cached_bytes = slabheaps[i].depot_cached_bytes() + processor_cached_bytes(i);
+            total += slabheaps[i].allocated_bytes() - min(cached_bytes, slabheaps[i].allocated_bytes());
+        }
         return total;
     }
 
@@ -294,8 +493,8 @@ struct KmallocGlobalData {
         size_t total = 0;
         for (auto const& subheap : subheaps)
             total += subheap.allocator.free_bytes();
-        for (auto const& slabheap : slabheaps)
-            total += slabheap.free_bytes();
+        for (size_t i = 0; i < KMALLOC_SLABHEAP_COUNT; ++i)
+            total += slabheaps[i].free_bytes() + slabheaps[i].depot_cached_bytes() + processor_cached_bytes(i);
         return total;
     }
 
@@ -394,7 +593,7 @@ struct KmallocGlobalData {
 
     KmallocSubheap::List subheaps;
 
-    KmallocSlabheap slabheaps[6] = { 16, 32, 64, 128, 256, 512 };
+    KmallocSlabheap slabheaps[KMALLOC_SLABHEAP_COUNT] = { 16, 32, 64, 128, 256, 512 };
 
     bool expansion_in_progress { false };
 };
@@ -402,11 +601,133 @@ struct KmallocGlobalData {
 READONLY_AFTER_INIT static KmallocGlobalData* g_kmalloc_global;
 alignas(KmallocGlobalData) static u8 g_kmalloc_global_heap[sizeof(KmallocGlobalData)];
 
-static size_t g_kmalloc_call_count;
-static size_t g_kfree_call_count;
-static size_t g_nested_kfree_calls;
+struct KmallocProcessorData {
+    KmallocProcessorSlabheapCache slabheap_caches[KMALLOC_SLABHEAP_COUNT];
+    size_t kmalloc_call_count { 0 };
+    size_t kfree_call_count { 0 };
+    size_t nested_kfree_calls { 0 };
+    Atomic<bool> cache_flush_requested { false };
+};
+
+// NOTE: Each entry is only ever touched by its own processor with interrupts disabled,
+//       except for statistics and the cached byte counts, which are read racily, and the flush request flag.
+static KmallocProcessorData g_kmalloc_processor_data[MAX_CPU_COUNT];
+
+static void request_processor_cache_flush()
+{
+    for (auto& processor_data : g_kmalloc_processor_data)
+        processor_data.cache_flush_requested.store(true, AK::MemoryOrder::memory_order_relaxed);
+}
+
+// NOTE: This is called with the kmalloc lock held, which keeps the magazines from being freed under us.
+//       Their counts may be slightly off while their processors are using them.
+static size_t processor_cached_bytes(size_t slabheap_index)
+{
+    size_t count = 0;
+    for (auto const& processor_data : g_kmalloc_processor_data) {
+        auto const& cache = processor_data.slabheap_caches[slabheap_index];
+        if (auto* magazine = cache.loaded)
+            count += magazine->count;
+        if (auto* magazine = cache.previous)
+            count += magazine->count;
+    }
+    return count * g_kmalloc_global->slabheaps[slabheap_index].slab_size();
+}
+
+static void flush_processor_caches_if_requested(KmallocProcessorData& processor_data)
+{
+    if (!processor_data.cache_flush_requested.load(AK::MemoryOrder::memory_order_relaxed))
+        return;
+    // If we already hold the lock, we got here from within kmalloc, which may be in the middle of using our magazines.
+    if (s_lock.is_locked_by_current_processor())
+        return;
+
+    SpinlockLocker lock(s_lock);
+    processor_data.cache_flush_requested.store(false, AK::MemoryOrder::memory_order_relaxed);
+    for (size_t i = 0; i < KMALLOC_SLABHEAP_COUNT; ++i)
+        g_kmalloc_global->slabheaps[i].flush_processor_cache(processor_data.slabheap_caches[i]);
+}
+
 bool g_dump_kmalloc_stacks;
 
+static KmallocMagazine* allocate_magazine()
+{
+    static_assert(sizeof(KmallocMagazine) <= 256);
+    auto* slot = g_kmalloc_global->allocate(sizeof(KmallocMagazine), alignof(KmallocMagazine), CallerWillInitializeMemory::Yes);
+    if (!slot)
+        return nullptr;
+    return new (slot) KmallocMagazine;
+}
+
+static void deallocate_magazine(KmallocMagazine* magazine)
+{
+    VERIFY(magazine->is_empty());
+    magazine->~KmallocMagazine();
+    g_kmalloc_global->deallocate(magazine, sizeof(KmallocMagazine));
+}
+
+static Optional<size_t> slabheap_index_for(size_t size, size_t alignment)
+{
+    // NOTE: There's no need to take the kmalloc lock, as the kmalloc slab-heaps (and their sizes) are constant
+    for (size_t i = 0; i < KMALLOC_SLABHEAP_COUNT; ++i) {
+        auto slab_size = g_kmalloc_global->slabheaps[i].slab_size();
+        if (size <= slab_size && alignment <= slab_size)
+            return i;
+    }
+    return {};
+}
+
+static void* allocate_from_magazines(size_t slabheap_index, KmallocProcessorData& processor_data, CallerWillInitializeMemory caller_will_initialize_memory)
+{
+    auto& cache = processor_data.slabheap_caches[slabheap_index];
+    auto& slabheap = g_kmalloc_global->slabheaps[slabheap_index];
+
+    if (cache.previous && (!cache.loaded || cache.loaded->is_empty()) && !cache.previous->is_empty())
+        swap(cache.loaded, cache.previous);
+
+    if (cache.loaded && !cache.loaded->is_empty()) {
+        ++cache.hits;
+        auto* ptr = cache.loaded->pop();
+        if (caller_will_initialize_memory == CallerWillInitializeMemory::No)
+            memset(ptr, KMALLOC_SCRUB_BYTE, slabheap.slab_size());
+        return ptr;
+    }
+
+    SpinlockLocker lock(s_lock);
+    VERIFY(!g_kmalloc_global->expansion_in_progress);
+
+    // Keep the empty magazine around as our previous one before asking the depot for a full one.
+    if (!cache.previous)
+        cache.previous = exchange(cache.loaded, nullptr);
+    return slabheap.allocate_with_magazine_exchange(cache, caller_will_initialize_memory);
+}
+
+static void deallocate_into_magazines(size_t slabheap_index, KmallocProcessorData& processor_data, void* ptr)
+{
+    auto& cache = processor_data.slabheap_caches[slabheap_index];
+    auto& slabheap = g_kmalloc_global->slabheaps[slabheap_index];
+
+    VERIFY(g_kmalloc_global->is_valid_kmalloc_address(VirtualAddress { ptr }));
+
+    if (cache.previous && (!cache.loaded || cache.loaded->is_full()) && !cache.previous->is_full())
+        swap(cache.loaded, cache.previous);
+
+    if (cache.loaded && !cache.loaded->is_full()) {
+        ++cache.hits;
+        memset(ptr, KFREE_SCRUB_BYTE, slabheap.slab_size());
+        cache.loaded->push(ptr);
+        return;
+    }
+
+    SpinlockLocker lock(s_lock);
+    VERIFY(!g_kmalloc_global->expansion_in_progress);
+
+    // Keep the full magazine around as our previous one before giving anything to the depot.
+    if (!cache.previous)
+        cache.previous = exchange(cache.loaded, nullptr);
+    slabheap.deallocate_with_magazine_exchange(cache, ptr);
+}
+
 void kmalloc_enable_expand()
 {
     g_kmalloc_global->enable_expansion();
@@ -431,15 +752,25 @@ static void* kmalloc_impl(size_t size, size_t alignment, CallerWillInitializeMem
     // Alignment must be a power of two.
     VERIFY(is_power_of_two(alignment));
 
-    SpinlockLocker lock(s_lock);
-    ++g_kmalloc_call_count;
+    // NOTE: Disabling interrupts keeps us on this processor and protects its magazines from IRQ handlers.
+    InterruptDisabler disabler;
+    auto& processor_data = g_kmalloc_processor_data[Processor::current_id()];
+    ++processor_data.kmalloc_call_count;
+    flush_processor_caches_if_requested(processor_data);
 
     if (g_dump_kmalloc_stacks && Kernel::g_kernel_symbols_available) {
+        SpinlockLocker lock(s_lock);
         dbgln("kmalloc({})", size);
         Kernel::dump_backtrace();
     }
 
-    void* ptr = g_kmalloc_global->allocate(size, alignment, caller_will_initialize_memory);
+    void* ptr = nullptr;
+    if (auto slabheap_index = slabheap_index_for(size, alignment); slabheap_index.has_value()) {
+        ptr = allocate_from_magazines(slabheap_index.value(), processor_data, caller_will_initialize_memory);
+    } else {
+        SpinlockLocker lock(s_lock);
+        ptr = g_kmalloc_global->allocate(size, alignment, caller_will_initialize_memory);
+    }
 
     Thread* current_thread = Thread::current();
     if (!current_thread)
@@ -482,11 +813,13 @@ void kfree_sized(void* ptr, size_t size)
         Processor::verify_no_spinlocks_held();
     }
 
-    SpinlockLocker lock(s_lock);
-    ++g_kfree_call_count;
-    ++g_nested_kfree_calls;
+    InterruptDisabler disabler;
+    auto& processor_data = g_kmalloc_processor_data[Processor::current_id()];
+    ++processor_data.kfree_call_count;
+    ++processor_data.nested_kfree_calls;
+    flush_processor_caches_if_requested(processor_data);
 
-    if (g_nested_kfree_calls == 1) {
+    if (processor_data.nested_kfree_calls == 1) {
         Thread* current_thread = Thread::current();
         if (!current_thread)
             current_thread = Processor::idle_thread();
@@ -496,8 +829,13 @@ void kfree_sized(void* ptr, size_t size)
         }
     }
 
-    g_kmalloc_global->deallocate(ptr, size);
-    --g_nested_kfree_calls;
+    if (auto slabheap_index = slabheap_index_for(size, 0); slabheap_index.has_value()) {
+        deallocate_into_magazines(slabheap_index.value(), processor_data, ptr);
+    } else {
+        SpinlockLocker lock(s_lock);
+        g_kmalloc_global->deallocate(ptr, size);
+    }
+    --processor_data.nested_kfree_calls;
 }
 
 size_t kmalloc_good_size(size_t size)
@@ -584,6 +922,22 @@ void get_kmalloc_stats(kmalloc_stats& stats)
     SpinlockLocker lock(s_lock);
     stats.bytes_allocated = g_kmalloc_global->allocated_bytes();
     stats.bytes_free = g_kmalloc_global->free_bytes();
-    stats.kmalloc_call_count = g_kmalloc_call_count;
-    stats.kfree_call_count = g_kfree_call_count;
+    stats.kmalloc_call_count = 0;
+    stats.kfree_call_count = 0;
+    for (size_t i = 0; i < KMALLOC_SLABHEAP_COUNT; ++i) {
+        auto& slabheap_stats = stats.slabheaps[i];
+        slabheap_stats.slab_size = g_kmalloc_global->slabheaps[i].slab_size();
+        slabheap_stats.magazine_hits = 0;
+        slabheap_stats.magazine_misses = 0;
+        slabheap_stats.depot_magazine_count = g_kmalloc_global->slabheaps[i].depot_magazine_count();
+    }
+
+    for (auto const& processor_data : g_kmalloc_processor_data) {
+        stats.kmalloc_call_count += processor_data.kmalloc_call_count;
+        stats.kfree_call_count += processor_data.kfree_call_count;
+        for (size_t i = 0; i < KMALLOC_SLABHEAP_COUNT; ++i) {
+            stats.slabheaps[i].magazine_hits += processor_data.slabheap_caches[i].hits;
+            stats.slabheaps[i].magazine_misses += processor_data.slabheap_caches[i].misses;
+        }
+    }
 }
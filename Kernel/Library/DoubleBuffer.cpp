@@ -19,19 +19,27 @@ inline void DoubleBuffer::compute_lockfree_metadata()
 
 ErrorOr<NonnullOwnPtr<DoubleBuffer>> DoubleBuffer::try_create(StringView name, size_t capacity)
 {
-    auto storage = TRY(KBuffer::try_create_with_size(name, capacity * 2, Memory::Region::Access::ReadWrite));
-    return adopt_nonnull_own_or_enomem(new (nothrow) DoubleBuffer(capacity, move(storage)));
+    return try_create_growable(name, capacity, capacity);
 }
 
-DoubleBuffer::DoubleBuffer(size_t capacity, NonnullOwnPtr<KBuffer> storage)
+ErrorOr<NonnullOwnPtr<DoubleBuffer>> DoubleBuffer::try_create_growable(StringView name, size_t initial_capacity, size_t capacity)
+{
+    VERIFY(initial_capacity > 0 && initial_capacity <= capacity);
+    auto storage = TRY(KBuffer::try_create_with_size(name, initial_capacity * 2, Memory::Region::Access::ReadWrite));
+    return adopt_nonnull_own_or_enomem(new (nothrow) DoubleBuffer(name, capacity, initial_capacity, move(storage)));
+}
+
+DoubleBuffer::DoubleBuffer(StringView name, size_t capacity, size_t allocated_capacity, NonnullOwnPtr<KBuffer> storage)
     : m_write_buffer(&m_buffer1)
     , m_read_buffer(&m_buffer2)
     , m_storage(move(storage))
+    , m_name(name)
     , m_capacity(capacity)
+    , m_allocated_capacity(allocated_capacity)
 {
     m_buffer1.data = m_storage->data();
     m_buffer1.size = 0;
-    m_buffer2.data = m_storage->data() + capacity;
+    m_buffer2.data = m_storage->data() + allocated_capacity;
     m_buffer2.size = 0;
     m_space_for_writing = capacity;
 }
@@ -45,12 +53,37 @@ void DoubleBuffer::flip()
     compute_lockfree_metadata();
 }
 
+ErrorOr<void> DoubleBuffer::try_grow(size_t minimum_capacity)
+{
+    VERIFY(m_lock.is_locked());
+    size_t new_capacity = m_allocated_capacity;
+    while (new_capacity < minimum_capacity)
+        new_capacity *= 2;
+    new_capacity = min(new_capacity, m_capacity);
+    auto storage = TRY(KBuffer::try_create_with_size(m_name, new_capacity * 2, Memory::Region::Access::ReadWrite));
+
+    // Only what hasn't been read yet has to move over.
+    size_t unread_size = m_read_buffer->size - m_read_buffer_index;
+    memcpy(storage->data(), m_read_buffer->data + m_read_buffer_index, unread_size);
+    memcpy(storage->data() + new_capacity, m_write_buffer->data, m_write_buffer->size);
+    m_read_buffer->data = storage->data();
+    m_read_buffer->size = unread_size;
+    m_read_buffer_index = 0;
+    m_write_buffer->data = storage->data() + new_capacity;
+
+    m_storage = move(storage);
+    m_allocated_capacity = new_capacity;
+    return {};
+}
+
 ErrorOr<size_t> DoubleBuffer::write(UserOrKernelBuffer const& data, size_t size)
 {
     if (!size)
         return 0;
     MutexLocker locker(m_lock);
     size_t bytes_to_write = min(size, m_space_for_writing);
+    if (m_write_buffer->size + bytes_to_write > m_allocated_capacity)
+        TRY(try_grow(m_write_buffer->size + bytes_to_write));
     u8* write_ptr = m_write_buffer->data + m_write_buffer->size;
     TRY(data.read(write_ptr, bytes_to_write));
     m_write_buffer->size += bytes_to_write;
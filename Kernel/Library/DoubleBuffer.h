@@ -17,6 +17,8 @@ namespace Kernel {
 class DoubleBuffer {
 public:
     static ErrorOr<NonnullOwnPtr<DoubleBuffer>> try_create(StringView name, size_t capacity = 65536);
+    // Only allocates room for initial_capacity bytes up front, and grows as needed once more is written.
+    static ErrorOr<NonnullOwnPtr<DoubleBuffer>> try_create_growable(StringView name, size_t initial_capacity, size_t capacity);
     ErrorOr<size_t> write(UserOrKernelBuffer const&, size_t);
     ErrorOr<size_t> write(u8 const* data, size_t size)
     {
@@ -50,8 +52,9 @@ public:
     }
 
 private:
-    explicit DoubleBuffer(size_t capacity, NonnullOwnPtr<KBuffer> storage);
+    explicit DoubleBuffer(StringView name, size_t capacity, size_t allocated_capacity, NonnullOwnPtr<KBuffer> storage);
     void flip();
+    ErrorOr<void> try_grow(size_t minimum_capacity);
     void compute_lockfree_metadata();
 
     ErrorOr<size_t> read_impl(UserOrKernelBuffer&, size_t, MutexLocker&, bool advance_buffer_index);
@@ -68,7 +71,10 @@ private:
 
     NonnullOwnPtr<KBuffer> m_storage;
     Function<void()> m_unblock_callback;
+    StringView m_name;
     size_t m_capacity { 0 };
+    // How much each of the two buffers can hold without growing the storage.
+    size_t m_allocated_capacity { 0 };
     size_t m_read_buffer_index { 0 };
     size_t m_space_for_writing { 0 };
     bool m_empty { true };
@@ -275,6 +275,48 @@ NonnullRefPtr<PhysicalPage> AnonymousVMObject::allocate_committed_page(Badge<Reg
     return m_unused_committed_pages->take_one();
 }
 
+bool AnonymousVMObject::try_allocate_committed_huge_page(Badge<Region>, size_t first_page_index)
+{
+    auto new_pages_or_error = FixedArray<RefPtr<PhysicalPage>>::create(pages_per_huge_page);
+    if (new_pages_or_error.is_error())
+        return false;
+    auto new_pages = new_pages_or_error.release_value();
+
+    {
+        SpinlockLocker locker(m_lock);
+
+        if (first_page_index + pages_per_huge_page > page_count())
+            return false;
+        // Once we've been cloned, pages have to be copied one by one anyway.
+        if (!m_cow_map.is_null())
+            return false;
+        if (!m_unused_committed_pages.has_value() || m_unused_committed_pages->page_count() < pages_per_huge_page)
+            return false;
+
+        for (auto& page : physical_pages().slice(first_page_index, pages_per_huge_page)) {
+            if (!page || !page->is_lazy_committed_page())
+                return false;
+        }
+
+        // NOTE: If there's no free 2 MiB block left, the caller falls back to faulting in a single page.
+        if (!m_unused_committed_pages->try_take_huge_page(new_pages.span()))
+            return false;
+    }
+
+    // NOTE: Zeroing 2 MiB takes a while, so we don't do it with our lock held (and interrupts disabled).
+    for (auto& page : new_pages)
+        MM.zero_physical_page_range(*page, 0, PAGE_SIZE);
+
+    SpinlockLocker locker(m_lock);
+    auto pages = physical_pages().slice(first_page_index, pages_per_huge_page);
+    for (size_t i = 0; i < pages_per_huge_page; ++i) {
+        // Another thread may have faulted in a page of this chunk in the meantime. That's fine, we'll just keep theirs.
+        if (pages[i] && pages[i]->is_lazy_committed_page())
+            pages[i] = move(new_pages[i]);
+    }
+    return true;
+}
+
 ErrorOr<void> AnonymousVMObject::ensure_cow_map()
 {
     if (m_cow_map.is_null())
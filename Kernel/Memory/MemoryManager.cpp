@@ -604,6 +604,10 @@ PageTableEntry* MemoryManager::pte(PageDirectory& page_directory, VirtualAddress
     PageDirectoryEntry const& pde = pd[page_directory_index];
     if (!pde.is_present())
         return nullptr;
+#if ARCH(X86_64)
+    // Huge pages are only used for user memory, which never gets here.
+    VERIFY(!pde.is_huge());
+#endif
 
     return &quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()))[page_table_index];
 }
@@ -618,6 +622,16 @@ PageTableEntry* MemoryManager::ensure_pte(PageDirectory& page_directory, Virtual
 
     auto* pd = quickmap_pd(page_directory, page_directory_table_index);
     auto& pde = pd[page_directory_index];
+#if ARCH(X86_64)
+    if (pde.is_present() && pde.is_huge()) {
+        // Someone wants to change a single page within a huge page, so it has to become a
+        // regular page table first.
+        if (!split_huge_pde(page_directory, vaddr))
+            return nullptr;
+        pd = quickmap_pd(page_directory, page_directory_table_index);
+        return &quickmap_pt(PhysicalAddress(pd[page_directory_index].page_table_base()))[page_table_index];
+    }
+#endif
     if (pde.is_present())
         return &quickmap_pt(PhysicalAddress(pde.page_table_base()))[page_table_index];
 
@@ -658,6 +672,20 @@ void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress va
     u32 page_table_index = (vaddr.get() >> 12) & 0x1ff;
 
     auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+#if ARCH(X86_64)
+    if (pd[page_directory_index].is_present() && pd[page_directory_index].is_huge()) {
+        // NOTE: Regions release their huge pages as a whole, so we only get here if only a part
+        //       of one is going away. If we can't split it up, there's nothing left to do but to
+        //       throw away all of it.
+        if (!split_huge_pde(page_directory, vaddr)) {
+            dbgln("MM: Unable to split huge page at {}, releasing all of it", vaddr);
+            pd = quickmap_pd(page_directory, page_directory_table_index);
+            pd[page_directory_index].clear();
+            return;
+        }
+        pd = quickmap_pd(page_directory, page_directory_table_index);
+    }
+#endif
     PageDirectoryEntry& pde = pd[page_directory_index];
     if (pde.is_present()) {
         auto* page_table = quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()));
@@ -682,6 +710,125 @@ void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress va
     }
 }
 
+#if ARCH(X86_64)
+PageDirectoryEntry* MemoryManager::ensure_huge_pde(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(page_directory.get_lock().is_locked_by_current_processor());
+    VERIFY(vaddr.get() % huge_page_size == 0);
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x1ff;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    auto& pde = pd[page_directory_index];
+    if (pde.is_present() && !pde.is_huge()) {
+        // The caller is taking over the whole range covered by this page table, so whatever
+        // was mapped through it is going away anyway.
+        get_physical_page_entry(PhysicalAddress { pde.page_table_base() }).allocated.physical_page.unref();
+    }
+    pde.clear();
+    return &pde;
+}
+
+bool MemoryManager::release_huge_pde(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(page_directory.get_lock().is_locked_by_current_processor());
+    VERIFY(vaddr.get() % huge_page_size == 0);
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x1ff;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    auto& pde = pd[page_directory_index];
+    if (!pde.is_present() || !pde.is_huge())
+        return false;
+    pde.clear();
+    return true;
+}
+
+void MemoryManager::release_page_table(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(page_directory.get_lock().is_locked_by_current_processor());
+    VERIFY(vaddr.get() % huge_page_size == 0);
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x1ff;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    auto& pde = pd[page_directory_index];
+    if (pde.is_present() && !pde.is_huge())
+        get_physical_page_entry(PhysicalAddress { pde.page_table_base() }).allocated.physical_page.unref();
+    pde.clear();
+}
+
+bool MemoryManager::is_mapped_by_huge_pde(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(page_directory.get_lock().is_locked_by_current_processor());
+    VERIFY(vaddr.get() % huge_page_size == 0);
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x1ff;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    auto const& pde = pd[page_directory_index];
+    return pde.is_present() && pde.is_huge();
+}
+
+bool MemoryManager::split_huge_pde(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    VERIFY_INTERRUPTS_DISABLED();
+    VERIFY(page_directory.get_lock().is_locked_by_current_processor());
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x1ff;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto page_table_or_error = allocate_physical_page(ShouldZeroFill::No);
+    if (page_table_or_error.is_error()) {
+        dbgln("MM: Unable to allocate page table to split huge page at {}", vaddr);
+        return false;
+    }
+    auto page_table = page_table_or_error.release_value();
+
+    // NOTE: Allocating may have purged memory, which could have used the quickmap slots, so we
+    //       only look at the page directory once we have our page table.
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    auto& pde = pd[page_directory_index];
+    VERIFY(pde.is_present() && pde.is_huge());
+    auto huge_pde = pde;
+    // NOTE: page_table_base() doesn't know about the NX bit or the PAT bit of huge pages.
+    PhysicalPtr huge_page_base = huge_pde.page_table_base() & 0x000f'ffff'ffe0'0000ull;
+
+    auto* ptes = quickmap_pt(page_table->paddr());
+    for (size_t i = 0; i < pages_per_huge_page; ++i) {
+        auto& pte = ptes[i];
+        pte.clear();
+        pte.set_physical_page_base(huge_page_base + i * PAGE_SIZE);
+        pte.set_present(true);
+        pte.set_writable(huge_pde.is_writable());
+        pte.set_user_allowed(huge_pde.is_user_allowed());
+        pte.set_cache_disabled(huge_pde.is_cache_disabled());
+        pte.set_execute_disabled(huge_pde.is_execute_disabled());
+        pte.set_global(huge_pde.is_global());
+    }
+
+    pd = quickmap_pd(page_directory, page_directory_table_index);
+    auto& new_pde = pd[page_directory_index];
+    new_pde.clear();
+    new_pde.set_page_table_base(page_table->paddr().get());
+    new_pde.set_user_allowed(true);
+    new_pde.set_present(true);
+    new_pde.set_writable(true);
+    new_pde.set_global(&page_directory == m_kernel_page_directory.ptr());
+
+    // NOTE: This leaked ref is matched by the unref in MemoryManager::release_pte()
+    (void)page_table.leak_ref();
+
+    // The translations didn't change, but the processor must not keep using the huge page
+    // alongside the new page table.
+    flush_tlb(&page_directory, VirtualAddress { vaddr.get() & ~(huge_page_size - 1) }, pages_per_huge_page);
+    return true;
+}
+#endif
+
 UNMAP_AFTER_INIT void MemoryManager::initialize(u32 cpu)
 {
     dmesgln("Initialize MMU");
@@ -991,6 +1138,32 @@ RefPtr<PhysicalPage> MemoryManager::find_free_physical_page(bool committed)
     return page;
 }
 
+bool MemoryManager::try_allocate_committed_huge_page(Badge<CommittedPhysicalPageSet>, Span<RefPtr<PhysicalPage>> pages)
+{
+    VERIFY(pages.size() == pages_per_huge_page);
+
+    auto base = m_global_data.with([&](auto& global_data) -> Optional<PhysicalAddress> {
+        VERIFY(global_data.system_memory_info.physical_pages_committed >= pages_per_huge_page);
+        for (auto& region : global_data.physical_regions) {
+            auto base = region->take_huge_page();
+            if (!base.has_value())
+                continue;
+            global_data.system_memory_info.physical_pages_committed -= pages_per_huge_page;
+            global_data.system_memory_info.physical_pages_used += pages_per_huge_page;
+            return base;
+        }
+        return {};
+    });
+    if (!base.has_value())
+        return false;
+
+    // NOTE: Each page is freed on its own again once it's no longer used, and the buddy allocator
+    //       takes care of merging them back together.
+    for (size_t i = 0; i < pages_per_huge_page; ++i)
+        pages[i] = PhysicalPage::create(base->offset(i * PAGE_SIZE));
+    return true;
+}
+
 NonnullRefPtr<PhysicalPage> MemoryManager::allocate_committed_physical_page(Badge<CommittedPhysicalPageSet>, ShouldZeroFill should_zero_fill)
 {
     auto page = find_free_physical_page(true);
@@ -1253,6 +1426,16 @@ void CommittedPhysicalPageSet::uncommit_one()
     MM.uncommit_physical_pages({}, 1);
 }
 
+bool CommittedPhysicalPageSet::try_take_huge_page(Span<RefPtr<PhysicalPage>> pages)
+{
+    if (m_page_count < pages_per_huge_page)
+        return false;
+    if (!MM.try_allocate_committed_huge_page({}, pages))
+        return false;
+    m_page_count -= pages_per_huge_page;
+    return true;
+}
+
 void MemoryManager::copy_physical_page(PhysicalPage& physical_page, u8 page_buffer[PAGE_SIZE])
 {
     auto* quickmapped_page = quickmap_page(physical_page);
@@ -1260,6 +1443,33 @@ void MemoryManager::copy_physical_page(PhysicalPage& physical_page, u8 page_buff
     unquickmap_page();
 }
 
+void MemoryManager::copy_into_physical_page(PhysicalPage& physical_page, size_t offset_in_page, ReadonlyBytes data)
+{
+    VERIFY(offset_in_page + data.size() <= PAGE_SIZE);
+    InterruptDisabler disabler;
+    auto* quickmapped_page = quickmap_page(physical_page);
+    memcpy(quickmapped_page + offset_in_page, data.data(), data.size());
+    unquickmap_page();
+}
+
+void MemoryManager::copy_from_physical_page(PhysicalPage& physical_page, size_t offset_in_page, Bytes buffer)
+{
+    VERIFY(offset_in_page + buffer.size() <= PAGE_SIZE);
+    InterruptDisabler disabler;
+    auto* quickmapped_page = quickmap_page(physical_page);
+    memcpy(buffer.data(), quickmapped_page + offset_in_page, buffer.size());
+    unquickmap_page();
+}
+
+void MemoryManager::zero_physical_page_range(PhysicalPage& physical_page, size_t offset_in_page, size_t length)
+{
+    VERIFY(offset_in_page + length <= PAGE_SIZE);
+    InterruptDisabler disabler;
+    auto* quickmapped_page = quickmap_page(physical_page);
+    memset(quickmapped_page + offset_in_page, 0, length);
+    unquickmap_page();
+}
+
 ErrorOr<NonnullOwnPtr<Memory::Region>> MemoryManager::create_identity_mapped_region(PhysicalAddress address, size_t size)
 {
     auto vmobject = TRY(Memory::AnonymousVMObject::try_create_for_physical_range(address, size));
@@ -1285,4 +1495,16 @@ MemoryManager::SystemMemoryInfo MemoryManager::get_system_memory_info()
         return global_data.system_memory_info;
     });
 }
+
+bool MemoryManager::has_memory_pressure()
+{
+    auto info = get_system_memory_info();
+    return info.physical_pages_uncommitted < info.physical_pages / 16;
+}
+
+bool MemoryManager::has_spare_memory_for_caches()
+{
+    auto info = get_system_memory_info();
+    return info.physical_pages_uncommitted > info.physical_pages / 4;
+}
 }
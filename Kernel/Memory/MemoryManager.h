@@ -34,6 +34,12 @@ constexpr FlatPtr page_round_down(FlatPtr x)
     return ((FlatPtr)(x)) & ~(PAGE_SIZE - 1);
 }
 
+// The amount of memory mapped by a single page directory entry. Regions that ask for huge pages
+// get physically contiguous blocks of this size where possible, which are mapped without a page
+// table on architectures that support it.
+static constexpr size_t huge_page_size = 2 * MiB;
+static constexpr size_t pages_per_huge_page = huge_page_size / PAGE_SIZE;
+
 inline FlatPtr virtual_to_low_physical(FlatPtr virtual_)
 {
     return virtual_ - physical_to_virtual_offset;
@@ -116,6 +122,13 @@ public:
     [[nodiscard]] NonnullRefPtr<PhysicalPage> take_one();
     void uncommit_one();
 
+    // Fills `pages` (which has to hold exactly `pages_per_huge_page` entries) with one physically
+    // contiguous, huge page aligned block of committed pages. This fails if there are not enough
+    // pages left in this set, or if physical memory is too fragmented to find such a block.
+    // The pages are not zeroed, as doing that for 2 MiB at once is best left to callers that
+    // aren't holding any spinlocks.
+    [[nodiscard]] bool try_take_huge_page(Span<RefPtr<PhysicalPage>> pages);
+
     void operator=(CommittedPhysicalPageSet&&) = delete;
 
 private:
@@ -164,6 +177,7 @@ public:
     void uncommit_physical_pages(Badge<CommittedPhysicalPageSet>, size_t page_count);
 
     NonnullRefPtr<PhysicalPage> allocate_committed_physical_page(Badge<CommittedPhysicalPageSet>, ShouldZeroFill = ShouldZeroFill::Yes);
+    bool try_allocate_committed_huge_page(Badge<CommittedPhysicalPageSet>, Span<RefPtr<PhysicalPage>>);
     ErrorOr<NonnullRefPtr<PhysicalPage>> allocate_physical_page(ShouldZeroFill = ShouldZeroFill::Yes, bool* did_purge = nullptr);
     ErrorOr<Vector<NonnullRefPtr<PhysicalPage>>> allocate_contiguous_physical_pages(size_t size);
     void deallocate_physical_page(PhysicalAddress);
@@ -188,6 +202,10 @@ public:
 
     SystemMemoryInfo get_system_memory_info();
 
+    // Used by caches to decide whether they may grow, or should give memory back.
+    bool has_memory_pressure();
+    bool has_spare_memory_for_caches();
+
     template<IteratorFunction<VMObject&> Callback>
     static void for_each_vmobject(Callback callback)
     {
@@ -233,6 +251,9 @@ public:
     PhysicalAddress get_physical_address(PhysicalPage const&);
 
     void copy_physical_page(PhysicalPage&, u8 page_buffer[PAGE_SIZE]);
+    void copy_into_physical_page(PhysicalPage&, size_t offset_in_page, ReadonlyBytes);
+    void copy_from_physical_page(PhysicalPage&, size_t offset_in_page, Bytes);
+    void zero_physical_page_range(PhysicalPage&, size_t offset_in_page, size_t length);
 
     IterationDecision for_each_physical_memory_range(Function<IterationDecision(PhysicalMemoryRange const&)>);
 
@@ -270,6 +291,22 @@ private:
     };
     void release_pte(PageDirectory&, VirtualAddress, IsLastPTERelease);
 
+#if ARCH(X86_64)
+    // Returns the (cleared) page directory entry for the huge page at `vaddr`, ready to be filled
+    // in by the caller. Any page table that was there before is released.
+    PageDirectoryEntry* ensure_huge_pde(PageDirectory&, VirtualAddress);
+    // Clears the page directory entry for the huge page at `vaddr`, if there is one.
+    bool release_huge_pde(PageDirectory&, VirtualAddress);
+    // Replaces a huge page directory entry with a page table mapping the same memory, so that
+    // the pages within can be remapped individually.
+    bool split_huge_pde(PageDirectory&, VirtualAddress);
+    // Clears the page directory entry covering `vaddr`, releasing the page table it points to (if any)
+    // without looking at its entries.
+    void release_page_table(PageDirectory&, VirtualAddress);
+    // Returns whether the huge page at `vaddr` is currently mapped with a single page directory entry.
+    bool is_mapped_by_huge_pde(PageDirectory&, VirtualAddress);
+#endif
+
     // NOTE: These are outside of GlobalData as they are only assigned on startup,
     //       and then never change. Atomic ref-counting covers that case without
     //       the need for additional synchronization.
@@ -102,6 +102,26 @@ Vector<NonnullRefPtr<PhysicalPage>> PhysicalRegion::take_contiguous_free_pages(s
     return physical_pages;
 }
 
+Optional<PhysicalAddress> PhysicalRegion::take_huge_page()
+{
+    auto order = count_trailing_zeroes(pages_per_huge_page);
+    for (auto& zone : m_usable_zones) {
+        // Buddy blocks are only aligned relative to the start of their zone, so we can only
+        // use zones that start on a huge page boundary themselves.
+        if (zone.base().get() % huge_page_size != 0)
+            continue;
+        auto block = zone.allocate_block(order);
+        if (!block.has_value())
+            continue;
+        if (zone.is_empty()) {
+            // We've exhausted this zone, move it to the full zones list.
+            m_full_zones.append(zone);
+        }
+        return block;
+    }
+    return {};
+}
+
 RefPtr<PhysicalPage> PhysicalRegion::take_free_page()
 {
     if (m_usable_zones.is_empty())
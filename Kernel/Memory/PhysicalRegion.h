@@ -36,6 +36,7 @@ public:
 
     RefPtr<PhysicalPage> take_free_page();
     Vector<NonnullRefPtr<PhysicalPage>> take_contiguous_free_pages(size_t count);
+    Optional<PhysicalAddress> take_huge_page();
     void return_page(PhysicalAddress);
 
 private:
@@ -117,6 +117,7 @@ ErrorOr<NonnullOwnPtr<Region>> Region::try_clone()
         region->set_mmap(m_mmap, m_mmapped_from_readable, m_mmapped_from_writable);
         region->set_shared(m_shared);
         region->set_syscall_region(is_syscall_region());
+        region->set_wants_huge_pages(m_wants_huge_pages);
         return region;
     }
 
@@ -125,9 +126,10 @@ ErrorOr<NonnullOwnPtr<Region>> Region::try_clone()
 
     auto vmobject_clone = TRY(vmobject().try_clone());
 
-    // Set up a COW region. The parent (this) region becomes COW as well!
+    // Set up a COW region. The parent (this) region becomes COW as well! Rather than write-protecting
+    // each of our pages right away, we drop our mappings, and let faults set up the COW mappings.
     if (is_writable())
-        remap();
+        unmap_lazily();
 
     OwnPtr<KString> clone_region_name;
     if (m_name)
@@ -142,6 +144,7 @@ ErrorOr<NonnullOwnPtr<Region>> Region::try_clone()
     }
     clone_region->set_syscall_region(is_syscall_region());
     clone_region->set_mmap(m_mmap, m_mmapped_from_readable, m_mmapped_from_writable);
+    clone_region->set_wants_huge_pages(m_wants_huge_pages);
     return clone_region;
 }
 
@@ -161,6 +164,26 @@ size_t Region::cow_pages() const
     return static_cast<AnonymousVMObject const&>(vmobject()).cow_pages();
 }
 
+size_t Region::huge_page_count() const
+{
+#if ARCH(X86_64)
+    if (!m_page_directory)
+        return 0;
+    // NOTE: Looking at the page directory doesn't change it, we just need to hold its lock while doing so.
+    auto& page_directory = const_cast<PageDirectory&>(*m_page_directory);
+    SpinlockLocker page_lock(page_directory.get_lock());
+    size_t count = 0;
+    auto first_chunk_index = (align_up_to(vaddr().get(), huge_page_size) - vaddr().get()) / PAGE_SIZE;
+    for (size_t page_index = first_chunk_index; page_index + pages_per_huge_page <= page_count(); page_index += pages_per_huge_page) {
+        if (MM.is_mapped_by_huge_pde(page_directory, vaddr_from_page_index(page_index)))
+            ++count;
+    }
+    return count;
+#else
+    return 0;
+#endif
+}
+
 size_t Region::amount_dirty() const
 {
     if (!vmobject().is_inode())
@@ -246,6 +269,62 @@ bool Region::map_individual_page_impl(size_t page_index, RefPtr<PhysicalPage> pa
     return true;
 }
 
+#if ARCH(X86_64)
+bool Region::is_huge_page_chunk(size_t page_index) const
+{
+    auto page_vaddr = vaddr_from_page_index(page_index);
+    return page_vaddr.get() % huge_page_size == 0 && page_index + pages_per_huge_page <= page_count();
+}
+
+// Maps the 2 MiB chunk starting at `page_index` with a single page directory entry, if the
+// physical pages backing it allow for that. Returns false if the caller has to map it page by page.
+bool Region::try_map_huge_page_impl(size_t page_index)
+{
+    VERIFY(m_page_directory->get_lock().is_locked_by_current_processor());
+    VERIFY(is_huge_page_chunk(page_index));
+
+    if (!vmobject().is_anonymous() || !m_cacheable || is_write_combine() || !is_readable())
+        return false;
+
+    auto page_vaddr = vaddr_from_page_index(page_index);
+    if (page_vaddr.get() < USER_RANGE_BASE || !is_user_address(page_vaddr))
+        return false;
+
+    PhysicalAddress base;
+    bool is_cow = false;
+    {
+        SpinlockLocker vmobject_locker(vmobject().m_lock);
+        auto const& pages = vmobject().physical_pages();
+        auto first_page_index_in_vmobject = first_page_index() + page_index;
+        auto const& first_page = pages[first_page_index_in_vmobject];
+        if (!first_page || first_page->is_shared_zero_page() || first_page->is_lazy_committed_page())
+            return false;
+        base = first_page->paddr();
+        if (base.get() % huge_page_size != 0)
+            return false;
+        // After a fork, the whole chunk is COW and can be mapped read-only. The first write to it then splits it up.
+        is_cow = should_cow(page_index);
+        for (size_t i = 0; i < pages_per_huge_page; ++i) {
+            auto const& page = pages[first_page_index_in_vmobject + i];
+            if (!page || page->paddr() != base.offset(i * PAGE_SIZE))
+                return false;
+            if (should_cow(page_index + i) != is_cow)
+                return false;
+        }
+    }
+
+    auto* pde = MM.ensure_huge_pde(*m_page_directory, page_vaddr);
+    pde->set_page_table_base(base.get());
+    pde->set_huge(true);
+    pde->set_present(true);
+    pde->set_writable(is_writable() && !is_cow);
+    pde->set_user_allowed(true);
+    if (Processor::current().has_nx())
+        pde->set_execute_disabled(!is_executable());
+    return true;
+}
+#endif
+
 bool Region::map_individual_page_impl(size_t page_index)
 {
     RefPtr<PhysicalPage> page;
@@ -285,6 +364,12 @@ void Region::unmap_with_locks_held(ShouldFlushTLB should_flush_tlb, SpinlockLock
     size_t count = page_count();
     for (size_t i = 0; i < count; ++i) {
         auto vaddr = vaddr_from_page_index(i);
+#if ARCH(X86_64)
+        if (is_huge_page_chunk(i) && MM.release_huge_pde(*m_page_directory, vaddr)) {
+            i += pages_per_huge_page - 1;
+            continue;
+        }
+#endif
         MM.release_pte(*m_page_directory, vaddr, i == count - 1 ? MemoryManager::IsLastPTERelease::Yes : MemoryManager::IsLastPTERelease::No);
     }
     if (should_flush_tlb == ShouldFlushTLB::Yes)
@@ -310,6 +395,12 @@ ErrorOr<void> Region::map(PageDirectory& page_directory, ShouldFlushTLB should_f
     set_page_directory(page_directory);
     size_t page_index = 0;
     while (page_index < page_count()) {
+#if ARCH(X86_64)
+        if (is_huge_page_chunk(page_index) && try_map_huge_page_impl(page_index)) {
+            page_index += pages_per_huge_page;
+            continue;
+        }
+#endif
         if (!map_individual_page_impl(page_index))
             break;
         ++page_index;
@@ -323,6 +414,35 @@ ErrorOr<void> Region::map(PageDirectory& page_directory, ShouldFlushTLB should_f
     return ENOMEM;
 }
 
+void Region::map_lazily(PageDirectory& page_directory)
+{
+    SpinlockLocker page_lock(page_directory.get_lock());
+    if (is_user() && !is_shared()) {
+        VERIFY(!vmobject().is_shared_inode());
+    }
+    set_page_directory(page_directory);
+}
+
+void Region::unmap_lazily()
+{
+    VERIFY(m_page_directory);
+    SpinlockLocker pd_locker(m_page_directory->get_lock());
+    size_t count = page_count();
+    for (size_t i = 0; i < count; ++i) {
+        auto vaddr = vaddr_from_page_index(i);
+#if ARCH(X86_64)
+        // Page tables (or huge pages) that only cover this region can go away as a whole.
+        if (is_huge_page_chunk(i)) {
+            MM.release_page_table(*m_page_directory, vaddr);
+            i += pages_per_huge_page - 1;
+            continue;
+        }
+#endif
+        MM.release_pte(*m_page_directory, vaddr, i == count - 1 ? MemoryManager::IsLastPTERelease::Yes : MemoryManager::IsLastPTERelease::No);
+    }
+    MemoryManager::flush_tlb(m_page_directory, vaddr(), page_count());
+}
+
 void Region::remap()
 {
     VERIFY(m_page_directory);
@@ -368,6 +488,28 @@ PageFaultResponse Region::handle_fault(PageFault const& fault)
             dbgln("NP(non-writable) write fault in Region({})[{}] at {}", this, page_index_in_region, fault.vaddr());
             return PageFaultResponse::ShouldCrash;
         }
+
+        // The page may just not have been mapped yet (see map_lazily()).
+        RefPtr<PhysicalPage> page;
+        {
+            SpinlockLocker vmobject_locker(vmobject().m_lock);
+            page = physical_page_slot(page_index_in_region);
+        }
+        if (page && !page->is_lazy_committed_page()) {
+            dbgln_if(PAGE_FAULT_DEBUG, "NP(lazy) fault in Region({})[{}] at {}", this, page_index_in_region, fault.vaddr());
+            if (fault.is_write() && should_cow(page_index_in_region)) {
+                if (page->is_shared_zero_page())
+                    return handle_zero_fault(page_index_in_region, *page);
+                return handle_cow_fault(page_index_in_region);
+            }
+#if ARCH(X86_64)
+            if (try_map_huge_page_lazily(page_index_in_region))
+                return PageFaultResponse::Continue;
+#endif
+            if (!remap_vmobject_page(translate_to_vmobject_page(page_index_in_region), *page))
+                return PageFaultResponse::OutOfMemory;
+            return PageFaultResponse::Continue;
+        }
         if (vmobject().is_inode()) {
             dbgln_if(PAGE_FAULT_DEBUG, "NP(inode) fault in Region({})[{}]", this, page_index_in_region);
             return handle_inode_fault(page_index_in_region);
@@ -416,6 +558,13 @@ PageFaultResponse Region::handle_zero_fault(size_t page_index_in_region, Physica
     if (current_thread != nullptr)
         current_thread->did_zero_fault();
 
+#if ARCH(X86_64)
+    if (m_wants_huge_pages && page_in_slot_at_time_of_fault.is_lazy_committed_page()) {
+        if (auto response = try_handle_zero_fault_with_huge_page(page_index_in_region); response.has_value())
+            return response.release_value();
+    }
+#endif
+
     RefPtr<PhysicalPage> new_physical_page;
 
     if (page_in_slot_at_time_of_fault.is_lazy_committed_page()) {
@@ -454,6 +603,56 @@ PageFaultResponse Region::handle_zero_fault(size_t page_index_in_region, Physica
     return PageFaultResponse::Continue;
 }
 
+#if ARCH(X86_64)
+// Returns an empty Optional if the fault has to be handled one page at a time.
+Optional<PageFaultResponse> Region::try_handle_zero_fault_with_huge_page(size_t page_index_in_region)
+{
+    // Sharing huge pages between several regions would need all of them to be remapped, so we
+    // only ever do this for private memory.
+    if (m_shared)
+        return {};
+
+    size_t first_page_index = page_index_in_region - (vaddr_from_page_index(page_index_in_region).get() % huge_page_size) / PAGE_SIZE;
+    if (first_page_index > page_index_in_region || !is_huge_page_chunk(first_page_index))
+        return {};
+
+    auto& anonymous_vmobject = static_cast<AnonymousVMObject&>(vmobject());
+    if (!anonymous_vmobject.try_allocate_committed_huge_page({}, translate_to_vmobject_page(first_page_index)))
+        return {};
+
+    dbgln_if(PAGE_FAULT_DEBUG, "      >> ALLOCATED HUGE PAGE for {}", vaddr_from_page_index(first_page_index));
+
+    SpinlockLocker page_lock(m_page_directory->get_lock());
+    if (!try_map_huge_page_impl(first_page_index)) {
+        // The whole chunk has been faulted in regardless, so all of it has to be remapped.
+        for (size_t i = 0; i < pages_per_huge_page; ++i) {
+            if (!map_individual_page_impl(first_page_index + i)) {
+                dmesgln("MM: handle_zero_fault was unable to allocate a page table to map {}", vaddr_from_page_index(first_page_index + i));
+                return PageFaultResponse::OutOfMemory;
+            }
+        }
+    }
+    MemoryManager::flush_tlb(m_page_directory, vaddr_from_page_index(first_page_index), pages_per_huge_page);
+    return PageFaultResponse::Continue;
+}
+#endif
+
+#if ARCH(X86_64)
+// Maps the whole 2 MiB chunk around a lazily mapped page at once, if it's still backed by a huge page.
+bool Region::try_map_huge_page_lazily(size_t page_index_in_region)
+{
+    size_t first_page_index = page_index_in_region - (vaddr_from_page_index(page_index_in_region).get() % huge_page_size) / PAGE_SIZE;
+    if (first_page_index > page_index_in_region || !is_huge_page_chunk(first_page_index))
+        return false;
+
+    SpinlockLocker page_lock(m_page_directory->get_lock());
+    if (!try_map_huge_page_impl(first_page_index))
+        return false;
+    MemoryManager::flush_tlb(m_page_directory, vaddr_from_page_index(first_page_index), pages_per_huge_page);
+    return true;
+}
+#endif
+
 PageFaultResponse Region::handle_cow_fault(size_t page_index_in_region)
 {
     auto current_thread = Thread::current();
@@ -497,9 +696,29 @@ PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
     if (current_thread)
         current_thread->did_inode_fault();
 
-    u8 page_buffer[PAGE_SIZE];
     auto& inode = inode_vmobject.inode();
 
+    // Shared mappings use the pages of the inode's page cache directly, so that they and read()/write()
+    // always see the same data. Private mappings get their own copy below, as they may not write into it.
+    if (inode_vmobject.is_shared_inode() && inode.wants_page_cache()) {
+        auto cached_page_or_error = inode.cached_page_for_mapping(page_index_in_vmobject);
+        if (cached_page_or_error.is_error()) {
+            dmesgln("handle_inode_fault: Error ({}) while getting cached page from inode", cached_page_or_error.error());
+            return PageFaultResponse::OutOfMemory;
+        }
+        if (auto cached_page = cached_page_or_error.release_value()) {
+            // NOTE: The VMObject lock is required when manipulating the VMObject's physical page slot.
+            SpinlockLocker locker(inode_vmobject.m_lock);
+            if (vmobject_physical_page_slot.is_null())
+                vmobject_physical_page_slot = move(cached_page);
+            if (!remap_vmobject_page(page_index_in_vmobject, *vmobject_physical_page_slot))
+                return PageFaultResponse::OutOfMemory;
+            return PageFaultResponse::Continue;
+        }
+    }
+
+    u8 page_buffer[PAGE_SIZE];
+
     auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer);
     auto result = inode.read_bytes(page_index_in_vmobject * PAGE_SIZE, PAGE_SIZE, buffer, nullptr);
 
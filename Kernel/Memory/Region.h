@@ -89,6 +89,11 @@ public:
     [[nodiscard]] bool is_stack() const { return m_stack; }
     void set_stack(bool stack) { m_stack = stack; }
 
+    // Anonymous regions that want huge pages get them on the first write fault in each suitably
+    // aligned 2 MiB chunk, as long as there's enough contiguous physical memory left.
+    [[nodiscard]] bool wants_huge_pages() const { return m_wants_huge_pages; }
+    void set_wants_huge_pages(bool wants_huge_pages) { m_wants_huge_pages = wants_huge_pages; }
+
     [[nodiscard]] bool is_immutable() const { return m_immutable; }
     void set_immutable() { m_immutable = true; }
 
@@ -184,6 +189,9 @@ public:
 
     [[nodiscard]] size_t cow_pages() const;
 
+    // The number of 2 MiB chunks of this region that are currently mapped with a single page directory entry.
+    [[nodiscard]] size_t huge_page_count() const;
+
     void set_readable(bool b) { set_access_bit(Access::Read, b); }
     void set_writable(bool b) { set_access_bit(Access::Write, b); }
     void set_executable(bool b) { set_access_bit(Access::Execute, b); }
@@ -192,6 +200,11 @@ public:
 
     void set_page_directory(PageDirectory&);
     ErrorOr<void> map(PageDirectory&, ShouldFlushTLB = ShouldFlushTLB::Yes);
+    // Like map(), but leaves all pages unmapped until they are faulted in.
+    void map_lazily(PageDirectory&);
+    // Throws away all of the mappings without detaching from the page directory, so that pages are
+    // mapped again as they are faulted in, just like after map_lazily().
+    void unmap_lazily();
     void unmap(ShouldFlushTLB = ShouldFlushTLB::Yes);
     void unmap_with_locks_held(ShouldFlushTLB, SpinlockLocker<RecursiveSpinlock<LockRank::None>>& pd_locker);
 
@@ -231,6 +244,12 @@ private:
 
     [[nodiscard]] bool map_individual_page_impl(size_t page_index);
     [[nodiscard]] bool map_individual_page_impl(size_t page_index, RefPtr<PhysicalPage>);
+#if ARCH(X86_64)
+    [[nodiscard]] bool is_huge_page_chunk(size_t page_index) const;
+    [[nodiscard]] bool try_map_huge_page_impl(size_t page_index);
+    [[nodiscard]] Optional<PageFaultResponse> try_handle_zero_fault_with_huge_page(size_t page_index);
+    [[nodiscard]] bool try_map_huge_page_lazily(size_t page_index);
+#endif
 
     LockRefPtr<PageDirectory> m_page_directory;
     VirtualRange m_range;
@@ -248,6 +267,7 @@ private:
     bool m_write_combine : 1 { false };
     bool m_mmapped_from_readable : 1 { false };
     bool m_mmapped_from_writable : 1 { false };
+    bool m_wants_huge_pages : 1 { false };
 
     IntrusiveRedBlackTreeNode<FlatPtr, Region, RawPtr<Region>> m_tree_node;
     IntrusiveListNode<Region> m_vmobject_list_node;
@@ -51,6 +51,10 @@ SharedInodeVMObject::SharedInodeVMObject(SharedInodeVMObject const& other, Fixed
 
 ErrorOr<void> SharedInodeVMObject::sync(off_t offset_in_pages, size_t pages)
 {
+    // Our pages are the ones in the inode's page cache, so it can write them back by itself.
+    if (m_inode->wants_page_cache())
+        return m_inode->sync_cached_pages(offset_in_pages, pages);
+
     SpinlockLocker locker(m_lock);
 
     size_t highest_page_to_flush = min(page_count(), offset_in_pages + pages);
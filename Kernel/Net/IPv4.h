@@ -121,4 +121,34 @@ inline NetworkOrdered<u16> internet_checksum(void const* ptr, size_t count)
     return ~checksum & 0xffff;
 }
 
+// Adds the given bytes to a one's complement sum, as used by the internet checksum. An odd byte
+// at the end is padded with zero. The result still needs to go through fold_internet_checksum().
+inline u32 add_to_internet_checksum(u32 checksum, void const* ptr, size_t count)
+{
+    u64 sum = checksum;
+    auto const* w = (u16 const*)ptr;
+    for (; count > 1; count -= 2)
+        sum += AK::convert_between_host_and_network_endian(*w++);
+    if (count)
+        sum += static_cast<u16>(*(u8 const*)w << 8);
+    while (sum >> 32)
+        sum = (sum & 0xffffffff) + (sum >> 32);
+    return static_cast<u32>(sum);
+}
+
+inline u16 fold_internet_checksum(u32 checksum)
+{
+    while (checksum >> 16)
+        checksum = (checksum & 0xffff) + (checksum >> 16);
+    return static_cast<u16>(checksum);
+}
+
+// The part of the TCP and UDP checksums that covers the pseudo-header (RFC 9293, 3.1).
+inline u32 ipv4_pseudo_header_checksum(IPv4Address const& source, IPv4Address const& destination, IPv4Protocol protocol, u16 length)
+{
+    u32 checksum = add_to_internet_checksum(0, &source, sizeof(source));
+    checksum = add_to_internet_checksum(checksum, &destination, sizeof(destination));
+    return checksum + static_cast<u16>(protocol) + length;
+}
+
 }
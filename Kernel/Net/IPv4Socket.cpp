@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/Atomic.h>
 #include <AK/Singleton.h>
 #include <AK/StringBuilder.h>
 #include <AK/StringView.h>
@@ -28,6 +29,7 @@
 namespace Kernel {
 
 static Singleton<MutexProtected<IPv4Socket::List>> s_all_sockets;
+static Atomic<size_t> s_raw_tcp_socket_count;
 
 using BlockFlags = Thread::OpenFileDescriptionBlocker::BlockFlags;
 
@@ -36,9 +38,21 @@ MutexProtected<IPv4Socket::List>& IPv4Socket::all_sockets()
     return *s_all_sockets;
 }
 
+bool IPv4Socket::has_raw_tcp_sockets()
+{
+    return s_raw_tcp_socket_count.load(AK::MemoryOrder::memory_order_relaxed) != 0;
+}
+
+bool IPv4Socket::is_raw_tcp_socket() const
+{
+    return type() == SOCK_RAW && protocol() == IPPROTO_TCP;
+}
+
 ErrorOr<NonnullOwnPtr<DoubleBuffer>> IPv4Socket::try_create_receive_buffer()
 {
-    return DoubleBuffer::try_create("IPv4Socket: Receive buffer"sv, 256 * KiB);
+    // NOTE: Most sockets never see more than a few packets' worth of data waiting to be read at once,
+    //       so they only get a full-sized receive buffer once they need one.
+    return DoubleBuffer::try_create_growable("IPv4Socket: Receive buffer"sv, 2 * KiB, 256 * KiB);
 }
 
 ErrorOr<NonnullRefPtr<Socket>> IPv4Socket::create(int type, int protocol)
@@ -50,7 +64,7 @@ ErrorOr<NonnullRefPtr<Socket>> IPv4Socket::create(int type, int protocol)
     if (type == SOCK_DGRAM)
         return TRY(UDPSocket::try_create(protocol, move(receive_buffer)));
     if (type == SOCK_RAW) {
-        auto raw_socket = adopt_ref_if_nonnull(new (nothrow) IPv4Socket(type, protocol, move(receive_buffer), {}));
+        auto raw_socket = adopt_ref_if_nonnull(new (nothrow) IPv4Socket(type, protocol, move(receive_buffer)));
         if (raw_socket)
             return raw_socket.release_nonnull();
         return ENOMEM;
@@ -58,24 +72,24 @@ ErrorOr<NonnullRefPtr<Socket>> IPv4Socket::create(int type, int protocol)
     return EINVAL;
 }
 
-IPv4Socket::IPv4Socket(int type, int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, OwnPtr<KBuffer> optional_scratch_buffer)
+IPv4Socket::IPv4Socket(int type, int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer)
     : Socket(AF_INET, type, protocol)
     , m_receive_buffer(move(receive_buffer))
-    , m_scratch_buffer(move(optional_scratch_buffer))
 {
     dbgln_if(IPV4_SOCKET_DEBUG, "IPv4Socket({}) created with type={}, protocol={}", this, type, protocol);
     m_buffer_mode = type == SOCK_STREAM ? BufferMode::Bytes : BufferMode::Packets;
-    if (m_buffer_mode == BufferMode::Bytes) {
-        VERIFY(m_scratch_buffer);
-    }
 
     all_sockets().with_exclusive([&](auto& table) {
         table.append(*this);
     });
+    if (is_raw_tcp_socket())
+        s_raw_tcp_socket_count.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
 }
 
 IPv4Socket::~IPv4Socket()
 {
+    if (is_raw_tcp_socket())
+        s_raw_tcp_socket_count.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
     all_sockets().with_exclusive([&](auto& table) {
         table.remove(*this);
     });
@@ -283,6 +297,8 @@ ErrorOr<size_t> IPv4Socket::receive_byte_buffered(OpenFileDescription& descripti
         Thread::current()->did_ipv4_socket_read(nreceived_or_error.value());
 
     set_can_read(!m_receive_buffer->is_empty());
+    if (!nreceived_or_error.is_error() && nreceived_or_error.value() > 0 && !(flags & MSG_PEEK))
+        protocol_did_consume_receive_buffer();
     return nreceived_or_error;
 }
 
@@ -432,11 +448,12 @@ bool IPv4Socket::did_receive(IPv4Address const& source_address, u16 source_port,
             VERIFY(m_can_read);
             return false;
         }
-        auto scratch_buffer = UserOrKernelBuffer::for_kernel_buffer(m_scratch_buffer->data());
-        auto nreceived_or_error = protocol_receive(packet, scratch_buffer, m_scratch_buffer->size(), 0);
-        if (nreceived_or_error.is_error())
+        // NOTE: The payload always comes last in the packet, so it can go into the receive buffer as-is.
+        auto payload_size_or_error = protocol_size(packet);
+        if (payload_size_or_error.is_error())
             return false;
-        auto nwritten_or_error = m_receive_buffer->write(scratch_buffer, nreceived_or_error.value());
+        auto payload = packet.slice(packet_size - payload_size_or_error.value());
+        auto nwritten_or_error = m_receive_buffer->write(payload.data(), payload.size());
         if (nwritten_or_error.is_error())
             return false;
         set_can_read(!m_receive_buffer->is_empty());
@@ -898,4 +915,17 @@ void IPv4Socket::drop_receive_buffer()
     m_receive_buffer = nullptr;
 }
 
+ErrorOr<void> IPv4Socket::append_to_receive_buffer(ReadonlyBytes data)
+{
+    VERIFY(buffer_mode() == BufferMode::Bytes);
+    if (!m_receive_buffer || data.size() > m_receive_buffer->space_for_writing())
+        return ENOBUFS;
+    auto nwritten = TRY(m_receive_buffer->write(data.data(), data.size()));
+    set_can_read(!m_receive_buffer->is_empty());
+    m_bytes_received += nwritten;
+    if (nwritten != data.size())
+        return ENOBUFS;
+    return {};
+}
+
 }
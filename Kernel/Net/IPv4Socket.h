@@ -68,7 +68,7 @@ public:
     BufferMode buffer_mode() const { return m_buffer_mode; }
 
 protected:
-    IPv4Socket(int type, int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, OwnPtr<KBuffer> optional_scratch_buffer);
+    IPv4Socket(int type, int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer);
     virtual StringView class_name() const override { return "IPv4Socket"sv; }
 
     void set_bound(bool bound) { m_bound = bound; }
@@ -81,6 +81,8 @@ protected:
     virtual ErrorOr<void> protocol_connect(OpenFileDescription&) { return {}; }
     virtual ErrorOr<size_t> protocol_size(ReadonlyBytes /* raw_ipv4_packet */) { return ENOTIMPL; }
     virtual bool protocol_is_disconnected() const { return false; }
+    // Called after data was read out of the receive buffer (in BufferMode::Bytes).
+    virtual void protocol_did_consume_receive_buffer() { }
 
     virtual void shut_down_for_reading() override;
 
@@ -89,6 +91,9 @@ protected:
 
     static ErrorOr<NonnullOwnPtr<DoubleBuffer>> try_create_receive_buffer();
     void drop_receive_buffer();
+    size_t receive_buffer_space() const { return m_receive_buffer ? m_receive_buffer->space_for_writing() : 0; }
+    // Appends protocol payload that needs no further processing to the receive buffer (in BufferMode::Bytes).
+    ErrorOr<void> append_to_receive_buffer(ReadonlyBytes);
 
 private:
     virtual bool is_ipv4() const override { return true; }
@@ -128,14 +133,16 @@ private:
 
     BufferMode m_buffer_mode { BufferMode::Packets };
 
-    OwnPtr<KBuffer> m_scratch_buffer;
-
     IntrusiveListNode<IPv4Socket> m_list_node;
 
 public:
     using List = IntrusiveList<&IPv4Socket::m_list_node>;
 
     static MutexProtected<IPv4Socket::List>& all_sockets();
+
+    // Raw TCP sockets get a copy of every incoming TCP packet, so this tells whether anyone is listening for them.
+    static bool has_raw_tcp_sockets();
+    bool is_raw_tcp_socket() const;
 };
 
 }
@@ -224,6 +224,9 @@ UNMAP_AFTER_INIT ErrorOr<void> E1000ENetworkAdapter::initialize(Badge<Networking
     initialize_rx_descriptors();
     initialize_tx_descriptors();
 
+    // The 82574 understands the same context descriptors as the older models.
+    set_offload_features(OffloadFeatures::TCPChecksum | OffloadFeatures::UDPChecksum | OffloadFeatures::TCPSegmentation);
+
     setup_link();
     setup_interrupts();
     return {};
@@ -81,6 +81,19 @@ namespace Kernel {
 #define CMD_VLE (1 << 6)  // VLAN Packet Enable
 #define CMD_IDE (1 << 7)  // Interrupt Delay Enable
 
+// Extended Transmit Descriptors (used for checksum and segmentation offload)
+
+#define DTYP_CONTEXT (0 << 4) // TCP/IP Context Descriptor
+#define DTYP_DATA (1 << 4)    // TCP/IP Data Descriptor
+#define DCMD_TSE (1 << 2)     // TCP Segmentation Enable
+#define DCMD_DEXT (1 << 5)    // Extended Descriptor
+#define TUCMD_TCP (1 << 0)    // Packet Type is TCP
+#define TUCMD_IP (1 << 1)     // Packet Type is IPv4
+#define TUCMD_TSE (1 << 2)    // TCP Segmentation Enable
+#define TUCMD_DEXT (1 << 5)   // Extended Descriptor
+#define POPTS_IXSM (1 << 0)   // Insert IP Checksum
+#define POPTS_TXSM (1 << 1)   // Insert TCP/UDP Checksum
+
 // TCTL Register
 
 #define TCTL_EN (1 << 1)      // Transmit Enable
@@ -203,6 +216,8 @@ UNMAP_AFTER_INIT ErrorOr<void> E1000NetworkAdapter::initialize(Badge<NetworkingM
     initialize_rx_descriptors();
     initialize_tx_descriptors();
 
+    set_offload_features(OffloadFeatures::TCPChecksum | OffloadFeatures::UDPChecksum | OffloadFeatures::TCPSegmentation);
+
     setup_link();
     setup_interrupts();
 
@@ -351,7 +366,8 @@ UNMAP_AFTER_INIT void E1000NetworkAdapter::initialize_tx_descriptors()
     for (size_t i = 0; i < number_of_tx_descriptors; ++i) {
         auto& descriptor = tx_descriptors[i];
         m_tx_buffers[i] = m_tx_buffer_region->vaddr().as_ptr() + tx_buffer_size * i;
-        descriptor.addr = m_tx_buffer_region->physical_page(tx_buffer_page_count * i)->paddr().get();
+        m_tx_buffer_addresses[i] = m_tx_buffer_region->physical_page(tx_buffer_page_count * i)->paddr().get();
+        descriptor.addr = m_tx_buffer_addresses[i];
         descriptor.cmd = 0;
     }
 
@@ -408,17 +424,96 @@ void E1000NetworkAdapter::send_raw(ReadonlyBytes payload)
     dbgln_if(E1000_DEBUG, "E1000: Sending packet ({} bytes)", payload.size());
     auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
     auto& descriptor = tx_descriptors[tx_current];
-    VERIFY(payload.size() <= 8192);
+    VERIFY(payload.size() <= tx_buffer_size);
     auto* vptr = (void*)m_tx_buffers[tx_current];
     memcpy(vptr, payload.data(), payload.size());
+    // NOTE: This may have been used as a context descriptor before.
+    descriptor.addr = m_tx_buffer_addresses[tx_current];
     descriptor.length = payload.size();
+    descriptor.cso = 0;
+    descriptor.css = 0;
     descriptor.status = 0;
     descriptor.cmd = CMD_EOP | CMD_IFCS | CMD_RS;
     dbgln_if(E1000_DEBUG, "E1000: Using tx descriptor {} (head is at {})", tx_current, in32(REG_TXDESCHEAD));
     tx_current = (tx_current + 1) % number_of_tx_descriptors;
+    wait_for_transmission(descriptor, tx_current);
+}
+
+void E1000NetworkAdapter::send_raw_with_offload(ReadonlyBytes payload, TransmitOffload const& offload)
+{
+    VERIFY(offload.needs_checksum());
+    // A super-segment is spread over as many transmit buffers as it needs.
+    VERIFY(payload.size() <= tx_buffer_size * 16);
+
+    disable_irq();
+    size_t tx_current = in32(REG_TXDESCTAIL) % number_of_tx_descriptors;
+    dbgln_if(E1000_DEBUG, "E1000: Sending packet with offload ({} bytes, segment size {})", payload.size(), offload.segment_size);
+    auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
+
+    auto const& ipv4_packet = *reinterpret_cast<IPv4Packet const*>(payload.offset_pointer(layer3_payload_offset()));
+    bool is_tcp = ipv4_packet.protocol() == to_underlying(IPv4Protocol::TCP);
+
+    // The context descriptor tells the hardware where the headers are. It applies to all the data
+    // descriptors that follow it.
+    auto& context = *(e1000_tx_context_desc*)&tx_descriptors[tx_current];
+    u8 tucmd = TUCMD_DEXT | TUCMD_IP | (is_tcp ? TUCMD_TCP : 0);
+    u32 payload_length = 0;
+    context.ipcss = layer3_payload_offset();
+    context.ipcso = layer3_payload_offset() + 10;
+    context.ipcse = offload.checksum_start - 1;
+    context.tucss = offload.checksum_start;
+    context.tucso = offload.checksum_start + offload.checksum_offset;
+    context.tucse = 0; // Up to the end of the packet.
+    context.hdrlen = 0;
+    context.mss = 0;
+    if (offload.needs_segmentation()) {
+        VERIFY(is_tcp);
+        tucmd |= TUCMD_TSE;
+        payload_length = payload.size() - offload.header_size;
+        context.hdrlen = offload.header_size;
+        context.mss = offload.segment_size;
+    }
+    context.payload_length_and_command = payload_length | DTYP_CONTEXT << 16 | tucmd << 24;
+    context.status = 0;
+    tx_current = (tx_current + 1) % number_of_tx_descriptors;
+
+    u8 dcmd = DCMD_DEXT | CMD_IFCS | (offload.needs_segmentation() ? DCMD_TSE : 0);
+    u8 popts = POPTS_TXSM | (offload.needs_segmentation() ? POPTS_IXSM : 0);
+    e1000_tx_desc* last_descriptor = nullptr;
+    for (size_t offset = 0; offset < payload.size(); offset += tx_buffer_size) {
+        auto chunk = payload.slice(offset, min(tx_buffer_size, payload.size() - offset));
+        memcpy(m_tx_buffers[tx_current], chunk.data(), chunk.size());
+        if (offset == 0 && offload.needs_segmentation()) {
+            // The hardware fills in the lengths and checksums of every segment, and expects the
+            // checksum of a pseudo-header without the length to start from.
+            auto* headers = static_cast<u8*>(m_tx_buffers[tx_current]);
+            auto& ipv4_header = *reinterpret_cast<IPv4Packet*>(headers + layer3_payload_offset());
+            ipv4_header.set_length(0);
+            ipv4_header.set_checksum(0);
+            auto& checksum = *reinterpret_cast<NetworkOrdered<u16>*>(headers + offload.checksum_start + offload.checksum_offset);
+            checksum = fold_internet_checksum(ipv4_pseudo_header_checksum(ipv4_packet.source(), ipv4_packet.destination(), IPv4Protocol::TCP, 0));
+        }
+
+        auto& descriptor = tx_descriptors[tx_current];
+        descriptor.addr = m_tx_buffer_addresses[tx_current];
+        descriptor.length = chunk.size();
+        descriptor.cso = DTYP_DATA;
+        descriptor.css = popts;
+        descriptor.status = 0;
+        bool is_last_chunk = offset + chunk.size() == payload.size();
+        descriptor.cmd = dcmd | (is_last_chunk ? CMD_EOP | CMD_RS : 0);
+        last_descriptor = &descriptor;
+        tx_current = (tx_current + 1) % number_of_tx_descriptors;
+    }
+
+    wait_for_transmission(*last_descriptor, tx_current);
+}
+
+void E1000NetworkAdapter::wait_for_transmission(e1000_tx_desc& descriptor, size_t new_tail)
+{
     Processor::disable_interrupts();
     enable_irq();
-    out32(REG_TXDESCTAIL, tx_current);
+    out32(REG_TXDESCTAIL, new_tail);
     for (;;) {
         if (descriptor.status) {
             Processor::enable_interrupts();
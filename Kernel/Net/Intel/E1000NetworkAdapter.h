@@ -27,6 +27,7 @@ public:
     virtual ~E1000NetworkAdapter() override;
 
     virtual void send_raw(ReadonlyBytes) override;
+    virtual void send_raw_with_offload(ReadonlyBytes, TransmitOffload const&) override;
     virtual bool link_up() override { return m_link_up; }
     virtual i32 link_speed() override;
     virtual bool link_full_duplex() override;
@@ -69,6 +70,21 @@ protected:
         volatile uint16_t special { 0 };
     };
 
+    // Shares the transmit descriptor ring with the data descriptors.
+    struct [[gnu::packed]] e1000_tx_context_desc {
+        volatile uint8_t ipcss { 0 };
+        volatile uint8_t ipcso { 0 };
+        volatile uint16_t ipcse { 0 };
+        volatile uint8_t tucss { 0 };
+        volatile uint8_t tucso { 0 };
+        volatile uint16_t tucse { 0 };
+        volatile uint32_t payload_length_and_command { 0 };
+        volatile uint8_t status { 0 };
+        volatile uint8_t hdrlen { 0 };
+        volatile uint16_t mss { 0 };
+    };
+    static_assert(sizeof(e1000_tx_context_desc) == sizeof(e1000_tx_desc));
+
     virtual void detect_eeprom();
     virtual u32 read_eeprom(u8 address);
     void read_mac_address();
@@ -84,6 +100,7 @@ protected:
     u32 in32(u16 address);
 
     void receive();
+    void wait_for_transmission(e1000_tx_desc& last_descriptor, size_t new_tail);
 
     static constexpr size_t number_of_rx_descriptors = 256;
     static constexpr size_t number_of_tx_descriptors = 256;
@@ -96,6 +113,7 @@ protected:
     NonnullOwnPtr<Memory::Region> m_tx_buffer_region;
     Array<void*, number_of_rx_descriptors> m_rx_buffers;
     Array<void*, number_of_tx_descriptors> m_tx_buffers;
+    Array<u64, number_of_tx_descriptors> m_tx_buffer_addresses;
     bool m_has_eeprom { false };
     bool m_link_up { false };
     EntropySource m_entropy_source;
@@ -6,6 +6,7 @@
 
 #include <AK/Singleton.h>
 #include <Kernel/Net/LoopbackAdapter.h>
+#include <Kernel/Security/Random.h>
 
 namespace Kernel {
 
@@ -13,11 +14,13 @@ static bool s_loopback_initialized = false;
 
 ErrorOr<NonnullRefPtr<LoopbackAdapter>> LoopbackAdapter::try_create()
 {
-    return TRY(adopt_nonnull_ref_or_enomem(new (nothrow) LoopbackAdapter("loop"sv)));
+    auto delivery_timer = TRY(adopt_nonnull_ref_or_enomem(new (nothrow) Timer));
+    return TRY(adopt_nonnull_ref_or_enomem(new (nothrow) LoopbackAdapter("loop"sv, move(delivery_timer))));
 }
 
-LoopbackAdapter::LoopbackAdapter(StringView interface_name)
+LoopbackAdapter::LoopbackAdapter(StringView interface_name, NonnullRefPtr<Timer> delivery_timer)
     : NetworkAdapter(interface_name)
+    , m_delivery_timer(move(delivery_timer))
 {
     VERIFY(!s_loopback_initialized);
     s_loopback_initialized = true;
@@ -26,6 +29,8 @@ LoopbackAdapter::LoopbackAdapter(StringView interface_name)
     // by the data-link (Ethernet in this case) or physical layers, we need to subtract it from the MTU.
     set_mtu(65536 - sizeof(EthernetFrameHeader));
     set_mac_address({ 19, 85, 2, 9, 0x55, 0xaa });
+    // Nothing we send here ever leaves the machine, and we don't verify checksums on the way in.
+    set_offload_features(OffloadFeatures::TCPChecksum | OffloadFeatures::UDPChecksum);
 }
 
 LoopbackAdapter::~LoopbackAdapter() = default;
@@ -33,7 +38,83 @@ LoopbackAdapter::~LoopbackAdapter() = default;
 void LoopbackAdapter::send_raw(ReadonlyBytes payload)
 {
     dbgln_if(LOOPBACK_DEBUG, "LoopbackAdapter: Sending {} byte(s) to myself.", payload.size());
-    did_receive(payload);
+
+    auto loss = loss_per_mille();
+    if (loss > 0 && get_fast_random<u32>() % 1000 < loss) {
+        dbgln_if(LOOPBACK_DEBUG, "LoopbackAdapter: Losing {} byte(s) on purpose.", payload.size());
+        return;
+    }
+
+    auto delay = delay_in_milliseconds();
+    bool has_delayed_packets = m_delay_queue.with([](auto& queue) { return !queue.packets.is_empty(); });
+    // Packets must never overtake the ones that are still being delayed.
+    if (delay == 0 && !has_delayed_packets) {
+        did_receive(payload);
+        return;
+    }
+    delay_packet(payload, delay);
+}
+
+void LoopbackAdapter::send_raw_with_offload(ReadonlyBytes payload, TransmitOffload const&)
+{
+    send_raw(payload);
+}
+
+void LoopbackAdapter::delay_packet(ReadonlyBytes payload, u32 delay_in_milliseconds)
+{
+    auto packet = acquire_packet_buffer(payload.size());
+    if (!packet) {
+        dbgln("LoopbackAdapter: Discarding delayed packet because we're out of memory");
+        return;
+    }
+    memcpy(packet->buffer->data(), payload.data(), payload.size());
+
+    auto deadline = TimeManagement::the().current_time(CLOCK_MONOTONIC) + Duration::from_milliseconds(delay_in_milliseconds);
+    auto should_arm_timer = m_delay_queue.with([&](auto& queue) -> ErrorOr<bool> {
+        TRY(queue.packets.try_append({ *packet, deadline }));
+        if (queue.is_timer_armed)
+            return false;
+        queue.is_timer_armed = true;
+        return true;
+    });
+    if (should_arm_timer.is_error()) {
+        dbgln("LoopbackAdapter: Discarding delayed packet because we're out of memory");
+        release_packet_buffer(*packet);
+        return;
+    }
+
+    if (should_arm_timer.value() && !TimerQueue::the().add_timer_without_id(m_delivery_timer, CLOCK_MONOTONIC, deadline, [this] { deliver_delayed_packets(); }))
+        deliver_delayed_packets();
+}
+
+void LoopbackAdapter::deliver_delayed_packets()
+{
+    for (;;) {
+        auto now = TimeManagement::the().current_time(CLOCK_MONOTONIC);
+        Optional<Duration> next_deadline;
+        auto packet = m_delay_queue.with([&](auto& queue) -> RefPtr<PacketWithTimestamp> {
+            if (queue.packets.is_empty()) {
+                queue.is_timer_armed = false;
+                return nullptr;
+            }
+            if (queue.packets.first().deadline > now) {
+                next_deadline = queue.packets.first().deadline;
+                return nullptr;
+            }
+            return queue.packets.take_first().packet;
+        });
+
+        if (packet) {
+            did_receive(packet->bytes());
+            release_packet_buffer(*packet);
+            continue;
+        }
+
+        // The timer stays armed until the queue is empty, so that nobody else can add it to the
+        // timer queue while we're still using it.
+        if (!next_deadline.has_value() || TimerQueue::the().add_timer_without_id(m_delivery_timer, CLOCK_MONOTONIC, next_deadline.value(), [this] { deliver_delayed_packets(); }))
+            return;
+    }
 }
 
 }
@@ -6,13 +6,16 @@
 
 #pragma once
 
+#include <AK/Atomic.h>
+#include <AK/SinglyLinkedList.h>
 #include <Kernel/Net/NetworkAdapter.h>
+#include <Kernel/Time/TimerQueue.h>
 
 namespace Kernel {
 
 class LoopbackAdapter final : public NetworkAdapter {
 private:
-    LoopbackAdapter(StringView);
+    LoopbackAdapter(StringView, NonnullRefPtr<Timer> delivery_timer);
 
 public:
     static ErrorOr<NonnullRefPtr<LoopbackAdapter>> try_create();
@@ -21,11 +24,38 @@ public:
     virtual ErrorOr<void> initialize(Badge<NetworkingManagement>) override { VERIFY_NOT_REACHED(); }
 
     virtual void send_raw(ReadonlyBytes) override;
+    virtual void send_raw_with_offload(ReadonlyBytes, TransmitOffload const&) override;
     virtual StringView class_name() const override { return "LoopbackAdapter"sv; }
     virtual Type adapter_type() const override { return Type::Loopback; }
     virtual bool link_up() override { return true; }
     virtual bool link_full_duplex() override { return true; }
     virtual int link_speed() override { return 1000; }
+
+    // Impairments for testing how the network stack copes with real networks, configured
+    // through /sys/kernel/conf/loopback_{delay_ms,loss_per_mille}.
+    u32 delay_in_milliseconds() const { return m_delay_in_milliseconds.load(AK::MemoryOrder::memory_order_relaxed); }
+    void set_delay_in_milliseconds(u32 delay) { m_delay_in_milliseconds.store(delay, AK::MemoryOrder::memory_order_relaxed); }
+    u32 loss_per_mille() const { return m_loss_per_mille.load(AK::MemoryOrder::memory_order_relaxed); }
+    void set_loss_per_mille(u32 loss) { m_loss_per_mille.store(loss, AK::MemoryOrder::memory_order_relaxed); }
+
+private:
+    struct DelayedPacket {
+        NonnullRefPtr<PacketWithTimestamp> packet;
+        Duration deadline;
+    };
+
+    void delay_packet(ReadonlyBytes, u32 delay_in_milliseconds);
+    void deliver_delayed_packets();
+
+    Atomic<u32> m_delay_in_milliseconds { 0 };
+    Atomic<u32> m_loss_per_mille { 0 };
+
+    struct DelayQueue {
+        SinglyLinkedList<DelayedPacket> packets;
+        bool is_timer_armed { false };
+    };
+    SpinlockProtected<DelayQueue, LockRank::None> m_delay_queue {};
+    NonnullRefPtr<Timer> m_delivery_timer;
 };
 
 }
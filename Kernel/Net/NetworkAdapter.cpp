@@ -5,11 +5,12 @@
  */
 
 #include <Kernel/Heap/kmalloc.h>
-#include <Kernel/Interrupts/InterruptDisabler.h>
 #include <Kernel/Library/StdLib.h>
 #include <Kernel/Net/EtherType.h>
+#include <Kernel/Net/IPv4SocketTuple.h>
 #include <Kernel/Net/NetworkAdapter.h>
 #include <Kernel/Net/NetworkingManagement.h>
+#include <Kernel/Net/TCP.h>
 #include <Kernel/Tasks/Process.h>
 
 namespace Kernel {
@@ -23,11 +24,127 @@ NetworkAdapter::~NetworkAdapter() = default;
 
 void NetworkAdapter::send_packet(ReadonlyBytes packet)
 {
+    VERIFY(packet.size() <= layer3_payload_offset() + mtu());
     m_packets_out++;
     m_bytes_out += packet.size();
     send_raw(packet);
 }
 
+// Fills in the TCP or UDP checksum of an IPv4 packet. Adapters that offload the checksum expect
+// to find the checksum of the pseudo-header in there instead.
+static void fill_in_transport_checksum(Bytes frame, TransmitOffload const& offload, bool pseudo_header_only)
+{
+    auto& ipv4 = *reinterpret_cast<IPv4Packet const*>(frame.offset_pointer(sizeof(EthernetFrameHeader)));
+    auto protocol = static_cast<IPv4Protocol>(ipv4.protocol());
+    auto transport = frame.slice(offload.checksum_start, ipv4.payload_size());
+    auto& checksum_field = *reinterpret_cast<NetworkOrdered<u16>*>(transport.offset_pointer(offload.checksum_offset));
+
+    // NOTE: Whatever is in there right now may have been left behind by an earlier attempt to
+    //       send this packet, so we always start from scratch.
+    checksum_field = 0;
+    u32 checksum = ipv4_pseudo_header_checksum(ipv4.source(), ipv4.destination(), protocol, transport.size());
+    if (pseudo_header_only) {
+        checksum_field = fold_internet_checksum(checksum);
+        return;
+    }
+
+    u16 result = ~fold_internet_checksum(add_to_internet_checksum(checksum, transport.data(), transport.size()));
+    // RFC 768: A computed UDP checksum of zero is sent as all ones, as zero means "no checksum".
+    if (protocol == IPv4Protocol::UDP && result == 0)
+        result = 0xffff;
+    checksum_field = result;
+}
+
+void NetworkAdapter::send_packet(Bytes packet, TransmitOffload const& offload)
+{
+    if (offload.needs_segmentation() && !has_offload(OffloadFeatures::TCPSegmentation)) {
+        send_segmented_in_software(packet, offload);
+        return;
+    }
+    if (!offload.needs_checksum()) {
+        send_packet(ReadonlyBytes { packet });
+        return;
+    }
+
+    VERIFY(offload.needs_segmentation() || packet.size() <= layer3_payload_offset() + mtu());
+    auto& ipv4 = *reinterpret_cast<IPv4Packet const*>(packet.offset_pointer(layer3_payload_offset()));
+    bool offload_checksum = can_offload_checksum(static_cast<IPv4Protocol>(ipv4.protocol()));
+    fill_in_transport_checksum(packet, offload, offload_checksum);
+
+    m_packets_out++;
+    m_bytes_out += packet.size();
+    if (offload_checksum)
+        send_raw_with_offload(packet, offload);
+    else
+        send_raw(packet);
+}
+
+bool NetworkAdapter::can_offload_checksum(IPv4Protocol protocol) const
+{
+    switch (protocol) {
+    case IPv4Protocol::TCP:
+        return has_offload(OffloadFeatures::TCPChecksum);
+    case IPv4Protocol::UDP:
+        return has_offload(OffloadFeatures::UDPChecksum);
+    default:
+        return false;
+    }
+}
+
+// Software GSO: Cuts a TCP super-segment into segments that fit the MTU, each one with a copy of
+// the headers that has the sequence number, lengths and checksums adjusted.
+void NetworkAdapter::send_segmented_in_software(ReadonlyBytes super_segment, TransmitOffload const& offload)
+{
+    VERIFY(offload.needs_checksum() && offload.header_size < super_segment.size());
+    auto headers = super_segment.trim(offload.header_size);
+    auto payload = super_segment.slice(offload.header_size);
+
+    auto scratch = acquire_packet_buffer(offload.header_size + offload.segment_size);
+    if (!scratch) {
+        // TCP will send it again later.
+        dbgln("NetworkAdapter: Dropping TCP super-segment because we're out of memory");
+        return;
+    }
+
+    auto& original_tcp_packet = *reinterpret_cast<TCPPacket const*>(headers.offset_pointer(offload.checksum_start));
+    u32 sequence_number = original_tcp_packet.sequence_number();
+    u16 flags = original_tcp_packet.flags();
+
+    TransmitOffload segment_offload {};
+    segment_offload.checksum_start = offload.checksum_start;
+    segment_offload.checksum_offset = offload.checksum_offset;
+
+    for (size_t offset = 0; offset < payload.size(); offset += offload.segment_size) {
+        size_t segment_payload_size = min(static_cast<size_t>(offload.segment_size), payload.size() - offset);
+        bool is_last_segment = offset + segment_payload_size == payload.size();
+
+        auto segment = scratch->buffer->bytes().trim(offload.header_size + segment_payload_size);
+        memcpy(segment.data(), headers.data(), headers.size());
+        memcpy(segment.offset_pointer(offload.header_size), payload.offset_pointer(offset), segment_payload_size);
+
+        auto& ipv4 = *reinterpret_cast<IPv4Packet*>(segment.offset_pointer(layer3_payload_offset()));
+        ipv4.set_length(segment.size() - layer3_payload_offset());
+        ipv4.set_checksum(0);
+        ipv4.set_checksum(ipv4.compute_checksum());
+
+        auto& tcp_packet = *reinterpret_cast<TCPPacket*>(segment.offset_pointer(offload.checksum_start));
+        tcp_packet.set_sequence_number(sequence_number + offset);
+        // Only the last segment gets to push the data, or to close the connection.
+        if (!is_last_segment)
+            tcp_packet.set_flags(flags & ~(TCPFlags::PSH | TCPFlags::FIN));
+
+        send_packet(segment, segment_offload);
+    }
+
+    release_packet_buffer(*scratch);
+}
+
+void NetworkAdapter::set_offload_features(OffloadFeatures features)
+{
+    VERIFY(!has_flag(features, OffloadFeatures::TCPSegmentation) || has_flag(features, OffloadFeatures::TCPChecksum));
+    m_offload_features = features;
+}
+
 void NetworkAdapter::send(MACAddress const& destination, ARPPacket const& packet)
 {
     size_t size_in_bytes = sizeof(EthernetFrameHeader) + sizeof(ARPPacket);
@@ -47,7 +164,8 @@ void NetworkAdapter::send(MACAddress const& destination, ARPPacket const& packet
 void NetworkAdapter::fill_in_ipv4_header(PacketWithTimestamp& packet, IPv4Address const& source_ipv4, MACAddress const& destination_mac, IPv4Address const& destination_ipv4, IPv4Protocol protocol, size_t payload_size, u8 type_of_service, u8 ttl)
 {
     size_t ipv4_packet_size = sizeof(IPv4Packet) + payload_size;
-    VERIFY(ipv4_packet_size <= mtu());
+    // NOTE: send_packet() makes sure that anything larger than the MTU gets segmented.
+    VERIFY(ipv4_packet_size <= max_super_segment_size);
 
     size_t ethernet_frame_size = ipv4_payload_offset() + payload_size;
     VERIFY(packet.buffer->size() == ethernet_frame_size);
@@ -71,7 +189,7 @@ void NetworkAdapter::fill_in_ipv4_header(PacketWithTimestamp& packet, IPv4Addres
 
 void NetworkAdapter::did_receive(ReadonlyBytes payload)
 {
-    InterruptDisabler disabler;
+    SpinlockLocker locker(m_receive_queue_lock);
     m_packets_in++;
     m_bytes_in += payload.size();
 
@@ -88,19 +206,60 @@ void NetworkAdapter::did_receive(ReadonlyBytes payload)
 
     memcpy(packet->buffer->data(), payload.data(), payload.size());
 
-    m_packet_queue.append(*packet);
+    auto receive_queue = receive_queue_for_frame(payload);
+    m_receive_queues[receive_queue].append(*packet);
     m_packet_queue_size++;
 
     if (on_receive)
-        on_receive();
+        on_receive(receive_queue);
+}
+
+void NetworkAdapter::set_receive_queue_count(size_t count)
+{
+    SpinlockLocker locker(m_receive_queue_lock);
+    VERIFY(count > 0 && count <= max_receive_queues);
+    // Packets that are already queued stay where they are, which is fine as long as nothing
+    // processes them in parallel yet.
+    m_receive_queue_count = count;
+}
+
+// Software receive steering: None of our drivers can tell us which hardware queue (and thus
+// flow) a packet belongs to, so we hash the IPv4 tuple ourselves. Everything that isn't TCP or
+// UDP, as well as fragments that don't carry the ports, goes by the addresses alone.
+size_t NetworkAdapter::receive_queue_for_frame(ReadonlyBytes frame) const
+{
+    if (m_receive_queue_count == 1)
+        return 0;
+    if (frame.size() < sizeof(EthernetFrameHeader) + sizeof(IPv4Packet))
+        return 0;
+    auto& eth = *reinterpret_cast<EthernetFrameHeader const*>(frame.data());
+    if (eth.ether_type() != EtherType::IPv4)
+        return 0;
+
+    auto& ipv4_packet = *static_cast<IPv4Packet const*>(eth.payload());
+    u16 source_port = 0;
+    u16 destination_port = 0;
+    auto protocol = static_cast<IPv4Protocol>(ipv4_packet.protocol());
+    bool has_ports = protocol == IPv4Protocol::TCP || protocol == IPv4Protocol::UDP;
+    if (has_ports && !ipv4_packet.is_a_fragment() && frame.size() >= sizeof(EthernetFrameHeader) + sizeof(IPv4Packet) + 2 * sizeof(u16)) {
+        // Both TCP and UDP start with the source and destination port.
+        auto const* ports = static_cast<u8 const*>(ipv4_packet.payload());
+        source_port = (ports[0] << 8) | ports[1];
+        destination_port = (ports[2] << 8) | ports[3];
+    }
+
+    // This is the tuple of the socket that will end up handling the packet.
+    IPv4SocketTuple tuple(ipv4_packet.destination(), destination_port, ipv4_packet.source(), source_port);
+    return Traits<IPv4SocketTuple>::hash(tuple) % m_receive_queue_count;
 }
 
-size_t NetworkAdapter::dequeue_packet(u8* buffer, size_t buffer_size, UnixDateTime& packet_timestamp)
+size_t NetworkAdapter::dequeue_packet(size_t receive_queue, u8* buffer, size_t buffer_size, UnixDateTime& packet_timestamp)
 {
-    InterruptDisabler disabler;
-    if (m_packet_queue.is_empty())
+    SpinlockLocker locker(m_receive_queue_lock);
+    auto& queue = m_receive_queues[receive_queue];
+    if (queue.is_empty())
         return 0;
-    auto packet_with_timestamp = m_packet_queue.take_first();
+    auto packet_with_timestamp = queue.take_first();
     m_packet_queue_size--;
     packet_timestamp = packet_with_timestamp->timestamp;
     auto& packet_buffer = packet_with_timestamp->buffer;
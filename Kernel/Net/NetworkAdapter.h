@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <AK/Array.h>
 #include <AK/AtomicRefCounted.h>
 #include <AK/ByteBuffer.h>
+#include <AK/EnumBits.h>
 #include <AK/Function.h>
 #include <AK/IntrusiveList.h>
 #include <AK/MACAddress.h>
@@ -42,6 +44,35 @@ struct PacketWithTimestamp final : public AtomicRefCounted<PacketWithTimestamp>
     IntrusiveListNode<PacketWithTimestamp, RefPtr<PacketWithTimestamp>> packet_node;
 };
 
+// Work on outgoing packets that an adapter can take over from the network stack.
+enum class OffloadFeatures : u8 {
+    None = 0,
+    TCPChecksum = 1 << 0,
+    UDPChecksum = 1 << 1,
+    // Implies TCPChecksum, as every segment needs its own checksum.
+    TCPSegmentation = 1 << 2,
+};
+
+AK_ENUM_BITWISE_OPERATORS(OffloadFeatures);
+
+// What is left to do for an outgoing IPv4 packet. This mirrors the virtio-net header, which
+// describes the same thing for the same reasons.
+struct TransmitOffload {
+    // If checksum_offset is non-zero, the TCP or UDP checksum is missing. It covers everything
+    // from checksum_start to the end of the packet (and the pseudo-header), and is stored
+    // checksum_offset bytes after checksum_start.
+    u16 checksum_start { 0 };
+    u16 checksum_offset { 0 };
+    // If segment_size is non-zero, the packet is a TCP super-segment that is larger than the
+    // MTU. It has to be cut into segments carrying this many bytes of payload each, all with a
+    // copy of the first header_size bytes in front of them.
+    u16 header_size { 0 };
+    u16 segment_size { 0 };
+
+    bool needs_checksum() const { return checksum_offset != 0; }
+    bool needs_segmentation() const { return segment_size != 0; }
+};
+
 class NetworkingManagement;
 class NetworkAdapter
     : public AtomicRefCounted<NetworkAdapter>
@@ -79,13 +110,27 @@ public:
     void send(MACAddress const&, ARPPacket const&);
     void fill_in_ipv4_header(PacketWithTimestamp&, IPv4Address const&, MACAddress const&, IPv4Address const&, IPv4Protocol, size_t, u8 type_of_service, u8 ttl);
 
-    size_t dequeue_packet(u8* buffer, size_t buffer_size, UnixDateTime& packet_timestamp);
+    // Received packets are spread over this many queues by flow, so that each queue can be
+    // processed by a different thread while the packets of any one flow stay in order.
+    static constexpr size_t max_receive_queues = 8;
+    size_t receive_queue_count() const { return m_receive_queue_count; }
+    void set_receive_queue_count(size_t);
+
+    size_t dequeue_packet(size_t receive_queue, u8* buffer, size_t buffer_size, UnixDateTime& packet_timestamp);
 
-    bool has_queued_packets() const { return !m_packet_queue.is_empty(); }
+    bool has_queued_packets(size_t receive_queue) const { return !m_receive_queues[receive_queue].is_empty(); }
 
     u32 mtu() const { return m_mtu; }
     void set_mtu(u32 mtu) { m_mtu = mtu; }
 
+    OffloadFeatures offload_features() const { return m_offload_features; }
+    bool has_offload(OffloadFeatures features) const { return has_flag(m_offload_features, features); }
+
+    // The largest IPv4 packet that may be handed to send_packet() as a TCP super-segment. Adapters
+    // that can't segment by themselves get them split in software, which still saves us from
+    // going through the TCP and IPv4 layers for every single segment.
+    static constexpr size_t max_super_segment_size = NumericLimits<u16>::max();
+
     u32 packets_in() const { return m_packets_in; }
     u32 bytes_in() const { return m_bytes_in; }
     u32 packets_out() const { return m_packets_out; }
@@ -97,15 +142,22 @@ public:
     constexpr size_t layer3_payload_offset() const { return sizeof(EthernetFrameHeader); }
     constexpr size_t ipv4_payload_offset() const { return layer3_payload_offset() + sizeof(IPv4Packet); }
 
-    Function<void()> on_receive;
+    Function<void(size_t receive_queue)> on_receive;
 
     void send_packet(ReadonlyBytes);
+    // NOTE: This may modify the checksum field of the packet, but leaves it in a state that
+    //       allows sending the same packet again, even through a different adapter.
+    void send_packet(Bytes, TransmitOffload const&);
 
 protected:
     NetworkAdapter(StringView);
     void set_mac_address(MACAddress const& mac_address) { m_mac_address = mac_address; }
+    void set_offload_features(OffloadFeatures);
     void did_receive(ReadonlyBytes);
     virtual void send_raw(ReadonlyBytes) = 0;
+    // Only called for the work that the adapter claims to be able to do in offload_features().
+    // The checksum field of the packet holds the checksum of the pseudo-header.
+    virtual void send_raw_with_offload(ReadonlyBytes, TransmitOffload const&) { VERIFY_NOT_REACHED(); }
 
 private:
     MACAddress m_mac_address;
@@ -117,7 +169,15 @@ private:
 
     using PacketList = IntrusiveList<&PacketWithTimestamp::packet_node>;
 
-    PacketList m_packet_queue;
+    size_t receive_queue_for_frame(ReadonlyBytes) const;
+
+    bool can_offload_checksum(IPv4Protocol) const;
+    void send_segmented_in_software(ReadonlyBytes, TransmitOffload const&);
+
+    // Packets are queued from interrupt handlers and dequeued by several threads at once.
+    Spinlock<LockRank::None> m_receive_queue_lock {};
+    Array<PacketList, max_receive_queues> m_receive_queues;
+    size_t m_receive_queue_count { 1 };
     size_t m_packet_queue_size { 0 };
     SpinlockProtected<PacketList, LockRank::None> m_unused_packets {};
     FixedStringBuffer<IFNAMSIZ> m_name;
@@ -126,6 +186,7 @@ private:
     u32 m_packets_out { 0 };
     u32 m_bytes_out { 0 };
     u32 m_mtu { 1500 };
+    OffloadFeatures m_offload_features { OffloadFeatures::None };
 };
 
 }
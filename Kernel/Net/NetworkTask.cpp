@@ -32,31 +32,60 @@ static void handle_udp(IPv4Packet const&, UnixDateTime const& packet_timestamp);
 static void handle_tcp(IPv4Packet const&, UnixDateTime const& packet_timestamp);
 static void send_delayed_tcp_ack(TCPSocket& socket);
 static void send_tcp_rst(IPv4Packet const& ipv4_packet, TCPPacket const& tcp_packet, RefPtr<NetworkAdapter> adapter);
-static void flush_delayed_tcp_acks();
 static void retransmit_tcp_packets();
 
-static Thread* network_task = nullptr;
-static HashTable<NonnullRefPtr<TCPSocket>>* delayed_ack_sockets;
+// Inbound packets are spread over several receive workers by flow (see
+// NetworkAdapter::receive_queue_for_frame()), so that different connections can be processed on
+// different CPUs. All packets of a flow go to the same worker, which keeps them in order.
+struct ReceiveWorker {
+    size_t index { 0 };
+    Atomic<Thread*> thread { nullptr };
+    WaitQueue packet_wait_queue;
+    Atomic<u32> pending_packets { 0 };
+    // Only ever accessed by the worker itself, as it handles every packet of these sockets.
+    HashTable<NonnullRefPtr<TCPSocket>> delayed_ack_sockets;
+};
+
+static ReceiveWorker* s_receive_workers = nullptr;
+static size_t s_receive_worker_count = 0;
+
+static void flush_delayed_tcp_acks(ReceiveWorker&);
 
 [[noreturn]] static void NetworkTask_main(void*);
+[[noreturn]] static void receive_worker_main(void*);
 
 void NetworkTask::spawn()
 {
-    auto [_, first_thread] = MUST(Process::create_kernel_process("Network Task"sv, NetworkTask_main, nullptr));
-    network_task = first_thread;
+    s_receive_worker_count = clamp(static_cast<size_t>(Processor::count()), 1, NetworkAdapter::max_receive_queues);
+    s_receive_workers = new ReceiveWorker[s_receive_worker_count];
+    for (size_t i = 0; i < s_receive_worker_count; ++i)
+        s_receive_workers[i].index = i;
+
+    (void)MUST(Process::create_kernel_process("Network Task"sv, NetworkTask_main, &s_receive_workers[0]));
 }
 
 bool NetworkTask::is_current()
 {
-    return Thread::current() == network_task;
+    auto* current_thread = Thread::current();
+    for (size_t i = 0; i < s_receive_worker_count; ++i) {
+        if (s_receive_workers[i].thread.load(AK::MemoryOrder::memory_order_relaxed) == current_thread)
+            return true;
+    }
+    return false;
 }
 
-void NetworkTask_main(void*)
+static ReceiveWorker& current_receive_worker()
 {
-    delayed_ack_sockets = new HashTable<NonnullRefPtr<TCPSocket>>;
+    auto* current_thread = Thread::current();
+    for (size_t i = 0; i < s_receive_worker_count; ++i) {
+        if (s_receive_workers[i].thread.load(AK::MemoryOrder::memory_order_relaxed) == current_thread)
+            return s_receive_workers[i];
+    }
+    VERIFY_NOT_REACHED();
+}
 
-    WaitQueue packet_wait_queue;
-    int pending_packets = 0;
+void NetworkTask_main(void* argument)
+{
     NetworkingManagement::the().for_each([&](auto& adapter) {
         dmesgln("NetworkTask: {} network adapter found: hw={}", adapter.class_name(), adapter.mac_address().to_string());
 
@@ -65,22 +94,37 @@ void NetworkTask_main(void*)
             adapter.set_ipv4_netmask({ 255, 0, 0, 0 });
         }
 
-        adapter.on_receive = [&]() {
-            pending_packets++;
-            packet_wait_queue.wake_all();
+        adapter.set_receive_queue_count(s_receive_worker_count);
+        adapter.on_receive = [](size_t receive_queue) {
+            auto& worker = s_receive_workers[receive_queue];
+            worker.pending_packets.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+            worker.packet_wait_queue.wake_all();
         };
     });
 
-    auto dequeue_packet = [&pending_packets](u8* buffer, size_t buffer_size, UnixDateTime& packet_timestamp) -> size_t {
-        if (pending_packets == 0)
+    for (size_t i = 1; i < s_receive_worker_count; ++i) {
+        auto name = MUST(KString::formatted("Network Task #{}", i));
+        (void)MUST(Process::current().create_kernel_thread(receive_worker_main, &s_receive_workers[i], THREAD_PRIORITY_NORMAL, name->view(), THREAD_AFFINITY_DEFAULT, false));
+    }
+
+    receive_worker_main(argument);
+}
+
+void receive_worker_main(void* argument)
+{
+    auto& worker = *static_cast<ReceiveWorker*>(argument);
+    worker.thread = Thread::current();
+
+    auto dequeue_packet = [&worker](u8* buffer, size_t buffer_size, UnixDateTime& packet_timestamp) -> size_t {
+        if (worker.pending_packets.load(AK::MemoryOrder::memory_order_relaxed) == 0)
             return 0;
         size_t packet_size = 0;
         NetworkingManagement::the().for_each([&](auto& adapter) {
-            if (packet_size || !adapter.has_queued_packets())
+            if (packet_size || !adapter.has_queued_packets(worker.index))
                 return;
-            packet_size = adapter.dequeue_packet(buffer, buffer_size, packet_timestamp);
-            pending_packets--;
-            dbgln_if(NETWORK_TASK_DEBUG, "NetworkTask: Dequeued packet from {} ({} bytes)", adapter.name(), packet_size);
+            packet_size = adapter.dequeue_packet(worker.index, buffer, buffer_size, packet_timestamp);
+            worker.pending_packets.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+            dbgln_if(NETWORK_TASK_DEBUG, "NetworkTask: Worker {} dequeued packet from {} ({} bytes)", worker.index, adapter.name(), packet_size);
         });
         return packet_size;
     };
@@ -94,13 +138,15 @@ void NetworkTask_main(void*)
     UnixDateTime packet_timestamp;
 
     while (!Process::current().is_dying()) {
-        flush_delayed_tcp_acks();
-        retransmit_tcp_packets();
+        flush_delayed_tcp_acks(worker);
+        // The retransmission timers are shared by all connections, so only one worker looks after them.
+        if (worker.index == 0)
+            retransmit_tcp_packets();
         size_t packet_size = dequeue_packet(buffer, buffer_size, packet_timestamp);
         if (!packet_size) {
             auto timeout_time = Duration::from_milliseconds(500);
             auto timeout = Thread::BlockTimeout { false, &timeout_time };
-            [[maybe_unused]] auto result = packet_wait_queue.wait_on(timeout, "NetworkTask"sv);
+            [[maybe_unused]] auto result = worker.packet_wait_queue.wait_on(timeout, "NetworkTask"sv);
             continue;
         }
         if (packet_size < sizeof(EthernetFrameHeader)) {
@@ -124,7 +170,10 @@ void NetworkTask_main(void*)
             dbgln_if(ETHERNET_DEBUG, "NetworkTask: Unknown ethernet type {:#04x}", eth.ether_type());
         }
     }
-    Process::current().sys$exit(0);
+
+    if (worker.index == 0)
+        Process::current().sys$exit(0);
+    Thread::current()->exit();
     VERIFY_NOT_REACHED();
 }
 
@@ -308,13 +357,14 @@ void send_delayed_tcp_ack(TCPSocket& socket)
         return;
     }
 
-    delayed_ack_sockets->set(move(socket));
+    current_receive_worker().delayed_ack_sockets.set(move(socket));
 }
 
-void flush_delayed_tcp_acks()
+void flush_delayed_tcp_acks(ReceiveWorker& worker)
 {
+    auto& delayed_ack_sockets = worker.delayed_ack_sockets;
     Vector<NonnullRefPtr<TCPSocket>, 32> remaining_sockets;
-    for (auto& socket : *delayed_ack_sockets) {
+    for (auto& socket : delayed_ack_sockets) {
         MutexLocker locker(socket->mutex());
         if (socket->should_delay_next_ack()) {
             MUST(remaining_sockets.try_append(*socket));
@@ -323,12 +373,12 @@ void flush_delayed_tcp_acks()
         [[maybe_unused]] auto result = socket->send_ack();
     }
 
-    if (remaining_sockets.size() != delayed_ack_sockets->size()) {
-        delayed_ack_sockets->clear();
+    if (remaining_sockets.size() != delayed_ack_sockets.size()) {
+        delayed_ack_sockets.clear();
         if (remaining_sockets.size() > 0)
             dbgln("flush_delayed_tcp_acks: {} sockets remaining", remaining_sockets.size());
         for (auto&& socket : remaining_sockets)
-            delayed_ack_sockets->set(move(socket));
+            delayed_ack_sockets.set(move(socket));
     }
 }
 
@@ -388,6 +438,18 @@ void handle_tcp(IPv4Packet const& ipv4_packet, UnixDateTime const& packet_timest
 
     size_t payload_size = ipv4_packet.payload_size() - tcp_packet.header_size();
 
+    if (IPv4Socket::has_raw_tcp_sockets()) {
+        Vector<NonnullRefPtr<IPv4Socket>> raw_tcp_sockets;
+        IPv4Socket::all_sockets().with_exclusive([&](auto& sockets) {
+            for (auto& socket : sockets) {
+                if (socket.is_raw_tcp_socket())
+                    raw_tcp_sockets.append(socket);
+            }
+        });
+        for (auto& socket : raw_tcp_sockets)
+            socket->did_receive(ipv4_packet.source(), 0, { &ipv4_packet, sizeof(IPv4Packet) + ipv4_packet.payload_size() }, packet_timestamp);
+    }
+
     dbgln_if(TCP_DEBUG, "handle_tcp: source={}:{}, destination={}:{}, seq_no={}, ack_no={}, flags={:#04x} ({}{}{}{}), window_size={}, payload_size={}",
         ipv4_packet.source().to_string(),
         tcp_packet.source_port(),
@@ -457,6 +519,7 @@ void handle_tcp(IPv4Packet const& ipv4_packet, UnixDateTime const& packet_timest
             dbgln_if(TCP_DEBUG, "handle_tcp: created new client socket with tuple {}", client->tuple().to_string());
             client->set_sequence_number(1000);
             client->set_ack_number(tcp_packet.sequence_number() + payload_size + 1);
+            client->process_syn_options(tcp_packet);
             [[maybe_unused]] auto rc2 = client->send_tcp_packet(TCPFlags::SYN | TCPFlags::ACK);
             client->set_state(TCPSocket::State::SynReceived);
             return;
@@ -470,11 +533,13 @@ void handle_tcp(IPv4Packet const& ipv4_packet, UnixDateTime const& packet_timest
         switch (tcp_packet.flags()) {
         case TCPFlags::SYN:
             socket->set_ack_number(tcp_packet.sequence_number() + payload_size + 1);
+            socket->process_syn_options(tcp_packet);
             (void)socket->send_tcp_packet(TCPFlags::SYN | TCPFlags::ACK);
             socket->set_state(TCPSocket::State::SynReceived);
             return;
         case TCPFlags::ACK | TCPFlags::SYN:
             socket->set_ack_number(tcp_packet.sequence_number() + payload_size + 1);
+            socket->process_syn_options(tcp_packet);
             (void)socket->send_ack(true);
             socket->set_state(TCPSocket::State::Established);
             socket->set_setup_state(Socket::SetupState::Completed);
@@ -618,6 +683,15 @@ void handle_tcp(IPv4Packet const& ipv4_packet, UnixDateTime const& packet_timest
         }
 
         if (tcp_packet.sequence_number() != socket->ack_number()) {
+            // With SACK, the peer can make use of everything we hold on to, and learns about it
+            // from every duplicate ACK we send.
+            if (socket->is_sack_enabled()) {
+                if (socket->queue_out_of_order_segment(tcp_packet, payload_size))
+                    dbgln_if(TCP_DEBUG, "Queued out of order packet: seq {} vs. ack {}", tcp_packet.sequence_number(), socket->ack_number());
+                [[maybe_unused]] auto result = socket->send_ack(true);
+                return;
+            }
+
             dbgln_if(TCP_DEBUG, "Discarding out of order packet: seq {} vs. ack {}", tcp_packet.sequence_number(), socket->ack_number());
             if (socket->duplicate_acks() < TCPSocket::maximum_duplicate_acks) {
                 dbgln_if(TCP_DEBUG, "Sending ACK with same ack number to trigger fast retransmission");
@@ -645,6 +719,11 @@ void handle_tcp(IPv4Packet const& ipv4_packet, UnixDateTime const& packet_timest
                 socket->set_ack_number(tcp_packet.sequence_number() + payload_size);
                 dbgln_if(TCP_DEBUG, "Got packet with ack_no={}, seq_no={}, payload_size={}, acking it with new ack_no={}, seq_no={}",
                     tcp_packet.ack_number(), tcp_packet.sequence_number(), payload_size, socket->ack_number(), socket->sequence_number());
+                // RFC 5681, 4.2: Filling a hole has to be acknowledged immediately.
+                if (socket->has_out_of_order_segments() && socket->deliver_out_of_order_segments()) {
+                    [[maybe_unused]] auto result = socket->send_ack(true);
+                    return;
+                }
                 send_delayed_tcp_ack(*socket);
             }
         }
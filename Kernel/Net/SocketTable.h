@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Array.h>
+#include <AK/HashMap.h>
+#include <Kernel/Locking/MutexProtected.h>
+
+namespace Kernel {
+
+// A table for looking up sockets, split into shards with a lock of their own. Finding the socket
+// for an incoming packet only contends with whatever happens to sockets in the same shard, so
+// connections that are handled by different receive workers (or that are being set up or torn
+// down at the same time) rarely get in each other's way.
+template<typename Key, typename Value>
+class SocketTable {
+    AK_MAKE_NONCOPYABLE(SocketTable);
+    AK_MAKE_NONMOVABLE(SocketTable);
+
+public:
+    using Shard = MutexProtected<HashMap<Key, Value>>;
+
+    SocketTable() = default;
+
+    Shard& shard_for(Key const& key) { return m_shards[shard_index(key)]; }
+    Shard const& shard_for(Key const& key) const { return m_shards[shard_index(key)]; }
+
+    template<typename Callback>
+    void for_each_shared(Callback callback) const
+    {
+        for (auto& shard : m_shards)
+            shard.for_each_shared(callback);
+    }
+
+    template<typename Callback>
+    ErrorOr<void> try_for_each_shared(Callback callback) const
+    {
+        for (auto& shard : m_shards) {
+            TRY(shard.with_shared([&](auto const& table) -> ErrorOr<void> {
+                for (auto& it : table)
+                    TRY(callback(it));
+                return {};
+            }));
+        }
+        return {};
+    }
+
+private:
+    static constexpr size_t shard_count_bits = 6;
+    static constexpr size_t shard_count = 1 << shard_count_bits;
+
+    static size_t shard_index(Key const& key)
+    {
+        // NOTE: The hash maps pick their buckets based on the low bits of the same hash, so we go
+        //       by the high bits of a scrambled version of it. Otherwise, every shard would only
+        //       ever use a fraction of its buckets.
+        u32 hash = Traits<Key>::hash(key) * 0x9e3779b1u;
+        return hash >> (32 - shard_count_bits);
+    }
+
+    Array<Shard, shard_count> m_shards;
+};
+
+}
@@ -38,6 +38,88 @@ private:
 
 static_assert(AssertSize<TCPOptionMSS, 4>());
 
+enum class TCPOptionKind : u8 {
+    End = 0,
+    NoOperation = 1,
+    MSS = 2,
+    WindowScale = 3,
+    SACKPermitted = 4,
+    SACK = 5,
+    Timestamp = 8,
+};
+
+// RFC 7323, 2.2. Window Scale Option
+class [[gnu::packed]] TCPOptionWindowScale {
+public:
+    TCPOptionWindowScale(u8 shift_count)
+        : m_shift_count(shift_count)
+    {
+    }
+
+    u8 shift_count() const { return m_shift_count; }
+
+private:
+    u8 m_option_kind { to_underlying(TCPOptionKind::WindowScale) };
+    u8 m_option_length { sizeof(TCPOptionWindowScale) };
+    u8 m_shift_count { 0 };
+};
+
+static_assert(AssertSize<TCPOptionWindowScale, 3>());
+
+// RFC 2018, 2. Sack-Permitted Option
+class [[gnu::packed]] TCPOptionSACKPermitted {
+private:
+    u8 m_option_kind { to_underlying(TCPOptionKind::SACKPermitted) };
+    u8 m_option_length { sizeof(TCPOptionSACKPermitted) };
+};
+
+static_assert(AssertSize<TCPOptionSACKPermitted, 2>());
+
+// RFC 7323, 3.2. Timestamps Option
+class [[gnu::packed]] TCPOptionTimestamp {
+public:
+    TCPOptionTimestamp(u32 value, u32 echo_reply)
+        : m_value(value)
+        , m_echo_reply(echo_reply)
+    {
+    }
+
+    u32 value() const { return m_value; }
+    u32 echo_reply() const { return m_echo_reply; }
+
+private:
+    u8 m_option_kind { to_underlying(TCPOptionKind::Timestamp) };
+    u8 m_option_length { sizeof(TCPOptionTimestamp) };
+    NetworkOrdered<u32> m_value;
+    NetworkOrdered<u32> m_echo_reply;
+};
+
+static_assert(AssertSize<TCPOptionTimestamp, 10>());
+
+// RFC 2018, 3. Sack Option Format
+// The option itself is a kind and a length byte, followed by up to four of these.
+class [[gnu::packed]] TCPSACKBlock {
+public:
+    TCPSACKBlock(u32 left_edge, u32 right_edge)
+        : m_left_edge(left_edge)
+        , m_right_edge(right_edge)
+    {
+    }
+
+    u32 left_edge() const { return m_left_edge; }
+    u32 right_edge() const { return m_right_edge; }
+
+private:
+    NetworkOrdered<u32> m_left_edge;
+    NetworkOrdered<u32> m_right_edge;
+};
+
+static_assert(AssertSize<TCPSACKBlock, 8>());
+
+// Sequence numbers wrap around, so they can only be compared relative to each other.
+inline bool tcp_sequence_less_than(u32 a, u32 b) { return static_cast<i32>(a - b) < 0; }
+inline bool tcp_sequence_less_than_or_equal(u32 a, u32 b) { return static_cast<i32>(a - b) <= 0; }
+
 class [[gnu::packed]] TCPPacket {
 public:
     TCPPacket() = default;
@@ -73,6 +155,8 @@ public:
 
     u16 checksum() const { return m_checksum; }
     void set_checksum(u16 checksum) { m_checksum = checksum; }
+    // Where the checksum is, for adapters that fill it in for us.
+    static constexpr u16 checksum_offset = 16;
 
     u16 urgent() const { return m_urgent; }
     void set_urgent(u16 urgent) { m_urgent = urgent; }
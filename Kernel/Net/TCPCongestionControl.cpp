@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Net/TCPCongestionControl.h>
+
+namespace Kernel {
+
+ErrorOr<NonnullOwnPtr<TCPCongestionControl>> TCPCongestionControl::try_create(Algorithm algorithm)
+{
+    switch (algorithm) {
+    case Algorithm::NewReno:
+        return adopt_nonnull_own_or_enomem<TCPCongestionControl>(new (nothrow) TCPNewRenoCongestionControl);
+    case Algorithm::Cubic:
+        return adopt_nonnull_own_or_enomem<TCPCongestionControl>(new (nothrow) TCPCubicCongestionControl);
+    }
+    VERIFY_NOT_REACHED();
+}
+
+Optional<TCPCongestionControl::Algorithm> TCPCongestionControl::algorithm_from_name(StringView name)
+{
+    if (name == "newreno"sv || name == "reno"sv)
+        return Algorithm::NewReno;
+    if (name == "cubic"sv)
+        return Algorithm::Cubic;
+    return {};
+}
+
+void TCPCongestionControl::set_maximum_segment_size(u32 maximum_segment_size)
+{
+    m_maximum_segment_size = max(maximum_segment_size, 1u);
+    // RFC 6928, 2. TCP Modification
+    m_congestion_window = min(10 * m_maximum_segment_size, max(2 * m_maximum_segment_size, 14600u));
+}
+
+void TCPCongestionControl::on_recovery_complete()
+{
+    // RFC 6582, 3.2. Specification, step 3: "Set cwnd to either (1) min (ssthresh, max(FlightSize,
+    // SMSS) + SMSS) or (2) ssthresh". We don't inflate the window during recovery, so it's (2).
+    m_congestion_window = max(m_slow_start_threshold, m_maximum_segment_size);
+}
+
+void TCPCongestionControl::on_retransmit_timeout(u32 bytes_in_flight, MonotonicTime)
+{
+    // RFC 5681, 3.1. Slow Start and Congestion Avoidance, equation (4).
+    m_slow_start_threshold = max(bytes_in_flight / 2, 2 * m_maximum_segment_size);
+    m_congestion_window = m_maximum_segment_size;
+}
+
+void TCPCongestionControl::slow_start(u32 bytes_acked)
+{
+    // RFC 3465 (Appropriate Byte Counting) with L = 2 * SMSS, which keeps delayed ACKs from
+    // slowing down slow start.
+    Checked<u32> new_window = m_congestion_window;
+    new_window += min(bytes_acked, 2 * m_maximum_segment_size);
+    m_congestion_window = new_window.has_overflow() ? NumericLimits<u32>::max() : new_window.value();
+}
+
+void TCPNewRenoCongestionControl::on_ack(u32 bytes_acked, MonotonicTime, Duration)
+{
+    if (is_in_slow_start()) {
+        slow_start(bytes_acked);
+        return;
+    }
+
+    // RFC 3465, 2.1. Congestion Avoidance: Grow by one segment for every window's worth of data
+    // that was acknowledged.
+    m_bytes_acked_in_congestion_avoidance += bytes_acked;
+    if (m_bytes_acked_in_congestion_avoidance >= m_congestion_window) {
+        m_bytes_acked_in_congestion_avoidance -= m_congestion_window;
+        if (m_congestion_window <= NumericLimits<u32>::max() - m_maximum_segment_size)
+            m_congestion_window += m_maximum_segment_size;
+    }
+}
+
+void TCPNewRenoCongestionControl::on_congestion_event(u32 bytes_in_flight, MonotonicTime)
+{
+    m_slow_start_threshold = max(bytes_in_flight / 2, 2 * m_maximum_segment_size);
+    m_congestion_window = m_slow_start_threshold;
+    m_bytes_acked_in_congestion_avoidance = 0;
+}
+
+// RFC 8312, 4.1. Window Increase Function: C = 0.4 and beta_cubic = 0.7.
+static constexpr u64 cubic_c_numerator = 4;
+static constexpr u64 cubic_c_denominator = 10;
+static constexpr u64 cubic_beta_numerator = 7;
+static constexpr u64 cubic_beta_denominator = 10;
+
+// Beyond this distance from K, the cubic function is far outside of any sensible window size.
+static constexpr i64 maximum_cubic_time_offset_ms = 1'000'000;
+
+static u64 integer_cube_root(u64 value)
+{
+    // The cube of this is the largest one that fits into a u64.
+    u64 low = 0;
+    u64 high = 2642245;
+    while (low < high) {
+        u64 middle = (low + high + 1) / 2;
+        if (middle * middle * middle <= value)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    return low;
+}
+
+void TCPCubicCongestionControl::on_ack(u32 bytes_acked, MonotonicTime now, Duration smoothed_round_trip_time)
+{
+    if (is_in_slow_start()) {
+        slow_start(bytes_acked);
+        return;
+    }
+
+    u64 const mss = m_maximum_segment_size;
+    u64 const window = m_congestion_window;
+
+    if (!m_epoch_start.has_value()) {
+        m_epoch_start = now;
+        if (window < m_window_max) {
+            // K = cubic_root(W_max * (1 - beta_cubic) / C), in milliseconds. As we start out from
+            // the reduced window, (W_max - cwnd) is exactly W_max * (1 - beta_cubic).
+            u64 segments_to_recover_times_1e9 = (m_window_max - window) * 1'000'000'000ull / mss;
+            m_time_to_origin_point_ms = integer_cube_root(segments_to_recover_times_1e9 / cubic_c_numerator * cubic_c_denominator);
+            m_origin_point = m_window_max;
+        } else {
+            m_time_to_origin_point_ms = 0;
+            m_origin_point = window;
+        }
+        m_tcp_friendly_window = window;
+    }
+
+    // RFC 8312, 4.1: Aim for the window W_cubic(t + RTT) one round trip from now.
+    i64 t_ms = (now - m_epoch_start.value() + smoothed_round_trip_time).to_milliseconds();
+    i64 offset_ms = clamp(t_ms - static_cast<i64>(m_time_to_origin_point_ms), -maximum_cubic_time_offset_ms, maximum_cubic_time_offset_ms);
+    i64 offset_cubed = offset_ms * offset_ms * offset_ms;
+    // C * (t - K)^3 segments with t in seconds, in thousandths of a segment.
+    i64 delta_millisegments = offset_cubed * static_cast<i64>(cubic_c_numerator) / (static_cast<i64>(cubic_c_denominator) * 1'000'000);
+    i64 target = static_cast<i64>(m_origin_point) + delta_millisegments * static_cast<i64>(mss) / 1000;
+
+    // RFC 8312, 4.3 and 4.4: Never grow by more than half the window per round trip.
+    target = clamp(target, static_cast<i64>(window), static_cast<i64>(window + window / 2));
+
+    u64 increment;
+    if (static_cast<u64>(target) > window)
+        increment = (static_cast<u64>(target) - window) * bytes_acked / window;
+    else
+        increment = mss * bytes_acked / (100 * window);
+
+    // RFC 8312, 4.2. TCP-Friendly Region: W_est grows by 3 * (1 - beta) / (1 + beta) segments
+    // per round trip, which is 9/17 of a segment.
+    m_tcp_friendly_window += static_cast<u32>(min(mss * bytes_acked * 9 / (17 * window), static_cast<u64>(mss)));
+
+    u64 new_window = min(window + increment, static_cast<u64>(NumericLimits<u32>::max()));
+    m_congestion_window = static_cast<u32>(max(new_window, static_cast<u64>(m_tcp_friendly_window)));
+}
+
+void TCPCubicCongestionControl::reduce_window_for_loss()
+{
+    m_epoch_start.clear();
+
+    // RFC 8312, 4.6. Fast Convergence: If the window didn't get back to where it was when the
+    // last loss happened, another flow probably joined, so release some bandwidth for it.
+    u64 window = m_congestion_window;
+    if (window < m_last_window_max)
+        m_window_max = static_cast<u32>(window * (cubic_beta_denominator + cubic_beta_numerator) / (2 * cubic_beta_denominator));
+    else
+        m_window_max = static_cast<u32>(window);
+    m_last_window_max = static_cast<u32>(window);
+
+    m_slow_start_threshold = max(static_cast<u32>(window * cubic_beta_numerator / cubic_beta_denominator), 2 * m_maximum_segment_size);
+}
+
+void TCPCubicCongestionControl::on_congestion_event(u32, MonotonicTime)
+{
+    // RFC 8312, 4.5. Multiplicative Decrease
+    reduce_window_for_loss();
+    m_congestion_window = m_slow_start_threshold;
+}
+
+void TCPCubicCongestionControl::on_retransmit_timeout(u32, MonotonicTime)
+{
+    // RFC 8312, 4.7. Timeout
+    reduce_window_for_loss();
+    m_congestion_window = m_maximum_segment_size;
+}
+
+}
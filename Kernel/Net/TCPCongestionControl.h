@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/NumericLimits.h>
+#include <AK/Optional.h>
+#include <AK/StringView.h>
+#include <AK/Time.h>
+#include <AK/Types.h>
+
+namespace Kernel {
+
+// The congestion window limits how much unacknowledged data a TCPSocket may have in flight, on
+// top of the window advertised by the peer. The socket itself detects loss and decides what to
+// retransmit; a congestion controller only decides how the window reacts to acknowledgements and
+// loss, so that different algorithms can be plugged in per socket (see TCP_CONGESTION).
+class TCPCongestionControl {
+public:
+    enum class Algorithm {
+        NewReno,
+        Cubic,
+    };
+
+    static constexpr Algorithm default_algorithm = Algorithm::Cubic;
+
+    static ErrorOr<NonnullOwnPtr<TCPCongestionControl>> try_create(Algorithm);
+    static Optional<Algorithm> algorithm_from_name(StringView);
+
+    virtual ~TCPCongestionControl() = default;
+
+    virtual Algorithm algorithm() const = 0;
+    virtual StringView name() const = 0;
+
+    u32 maximum_segment_size() const { return m_maximum_segment_size; }
+    u32 congestion_window() const { return m_congestion_window; }
+    u32 slow_start_threshold() const { return m_slow_start_threshold; }
+    bool is_in_slow_start() const { return m_congestion_window < m_slow_start_threshold; }
+
+    // Called once the connection is established and the segment size is known. This also sets
+    // up the initial window (RFC 6928).
+    void set_maximum_segment_size(u32);
+
+    // New data was cumulatively acknowledged while not in loss recovery.
+    virtual void on_ack(u32 bytes_acked, MonotonicTime now, Duration smoothed_round_trip_time) = 0;
+    // Loss was detected through duplicate acknowledgements or SACK, and loss recovery begins.
+    virtual void on_congestion_event(u32 bytes_in_flight, MonotonicTime now) = 0;
+    // Everything that was outstanding when loss recovery began has been acknowledged.
+    virtual void on_recovery_complete();
+    // The retransmission timer expired, so the network has probably lost everything in flight.
+    virtual void on_retransmit_timeout(u32 bytes_in_flight, MonotonicTime now);
+
+protected:
+    TCPCongestionControl() = default;
+
+    void slow_start(u32 bytes_acked);
+
+    u32 m_maximum_segment_size { 536 };
+    u32 m_congestion_window { 4 * 536 };
+    u32 m_slow_start_threshold { NumericLimits<u32>::max() };
+};
+
+// RFC 5681 and RFC 6582: Halve the window on loss, then grow it by one segment per round trip.
+class TCPNewRenoCongestionControl final : public TCPCongestionControl {
+public:
+    virtual Algorithm algorithm() const override { return Algorithm::NewReno; }
+    virtual StringView name() const override { return "newreno"sv; }
+
+    virtual void on_ack(u32 bytes_acked, MonotonicTime now, Duration smoothed_round_trip_time) override;
+    virtual void on_congestion_event(u32 bytes_in_flight, MonotonicTime now) override;
+
+private:
+    u32 m_bytes_acked_in_congestion_avoidance { 0 };
+};
+
+// RFC 8312: Grow the window along a cubic function of the time since the last loss, which makes
+// it independent of the round trip time and lets it recover quickly on long, fat networks.
+class TCPCubicCongestionControl final : public TCPCongestionControl {
+public:
+    virtual Algorithm algorithm() const override { return Algorithm::Cubic; }
+    virtual StringView name() const override { return "cubic"sv; }
+
+    virtual void on_ack(u32 bytes_acked, MonotonicTime now, Duration smoothed_round_trip_time) override;
+    virtual void on_congestion_event(u32 bytes_in_flight, MonotonicTime now) override;
+    virtual void on_retransmit_timeout(u32 bytes_in_flight, MonotonicTime now) override;
+
+private:
+    void reduce_window_for_loss();
+
+    // The window size just before the last reduction, and the one before that.
+    u32 m_window_max { 0 };
+    u32 m_last_window_max { 0 };
+
+    // State of the current congestion avoidance epoch, which starts with the first ACK after a
+    // window reduction.
+    Optional<MonotonicTime> m_epoch_start;
+    u32 m_origin_point { 0 };
+    u64 m_time_to_origin_point_ms { 0 };
+    // The window standard TCP would have at this point, so that we never do worse than it.
+    u32 m_tcp_friendly_window { 0 };
+};
+
+}
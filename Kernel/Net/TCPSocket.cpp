@@ -32,16 +32,14 @@ void TCPSocket::for_each(Function<void(TCPSocket const&)> callback)
 
 ErrorOr<void> TCPSocket::try_for_each(Function<ErrorOr<void>(TCPSocket const&)> callback)
 {
-    return sockets_by_tuple().with_shared([&](auto const& sockets) -> ErrorOr<void> {
-        for (auto& it : sockets)
-            TRY(callback(*it.value));
-        return {};
+    return sockets_by_tuple().try_for_each_shared([&](auto const& it) -> ErrorOr<void> {
+        return callback(*it.value);
     });
 }
 
 bool TCPSocket::unref() const
 {
-    bool did_hit_zero = sockets_by_tuple().with_exclusive([&](auto& table) {
+    bool did_hit_zero = sockets_by_tuple().shard_for(tuple()).with_exclusive([&](auto& table) {
         if (deref_base())
             return false;
         table.remove(tuple());
@@ -64,6 +62,13 @@ void TCPSocket::set_state(State new_state)
 
     m_state = new_state;
 
+    if (new_state == State::Established) {
+        auto adapter = bound_interface().with([](auto& bound_device) -> RefPtr<NetworkAdapter> { return bound_device; });
+        auto routing_decision = route_to(peer_address(), local_address(), adapter);
+        if (!routing_decision.is_zero())
+            m_congestion_control->set_maximum_segment_size(maximum_segment_size(*routing_decision.adapter));
+    }
+
     if (new_state == State::Established && m_direction == Direction::Outgoing) {
         set_role(Role::Connected);
         clear_so_error();
@@ -74,10 +79,12 @@ void TCPSocket::set_state(State new_state)
         // are packets on the way which we wouldn't want a new socket to get hit
         // with, so there's no point in keeping the receive buffer around.
         drop_receive_buffer();
+        m_out_of_order_ranges.clear();
+        m_out_of_order_buffer = nullptr;
     }
 
     if (new_state == State::Closed) {
-        closing_sockets().with_exclusive([&](auto& table) {
+        closing_sockets().shard_for(tuple()).with_exclusive([&](auto& table) {
             table.remove(tuple());
         });
 
@@ -89,49 +96,51 @@ void TCPSocket::set_state(State new_state)
         evaluate_block_conditions();
 }
 
-static Singleton<MutexProtected<HashMap<IPv4SocketTuple, RefPtr<TCPSocket>>>> s_socket_closing;
+static Singleton<SocketTable<IPv4SocketTuple, RefPtr<TCPSocket>>> s_socket_closing;
 
-MutexProtected<HashMap<IPv4SocketTuple, RefPtr<TCPSocket>>>& TCPSocket::closing_sockets()
+SocketTable<IPv4SocketTuple, RefPtr<TCPSocket>>& TCPSocket::closing_sockets()
 {
     return *s_socket_closing;
 }
 
-static Singleton<MutexProtected<HashMap<IPv4SocketTuple, TCPSocket*>>> s_socket_tuples;
+static Singleton<SocketTable<IPv4SocketTuple, TCPSocket*>> s_socket_tuples;
 
-MutexProtected<HashMap<IPv4SocketTuple, TCPSocket*>>& TCPSocket::sockets_by_tuple()
+SocketTable<IPv4SocketTuple, TCPSocket*>& TCPSocket::sockets_by_tuple()
 {
     return *s_socket_tuples;
 }
 
 RefPtr<TCPSocket> TCPSocket::from_tuple(IPv4SocketTuple const& tuple)
 {
-    return sockets_by_tuple().with_shared([&](auto const& table) -> RefPtr<TCPSocket> {
-        auto exact_match = table.get(tuple);
-        if (exact_match.has_value())
-            return { *exact_match.value() };
+    // NOTE: The socket can't go away while we hold the lock of its shard, as unref() needs it to
+    //       remove the socket from the table.
+    auto find = [](IPv4SocketTuple const& tuple) -> RefPtr<TCPSocket> {
+        return sockets_by_tuple().shard_for(tuple).with_shared([&](auto const& table) -> RefPtr<TCPSocket> {
+            auto match = table.get(tuple);
+            if (match.has_value())
+                return { *match.value() };
+            return {};
+        });
+    };
 
-        auto address_tuple = IPv4SocketTuple(tuple.local_address(), tuple.local_port(), IPv4Address(), 0);
-        auto address_match = table.get(address_tuple);
-        if (address_match.has_value())
-            return { *address_match.value() };
+    if (auto exact_match = find(tuple))
+        return exact_match;
 
-        auto wildcard_tuple = IPv4SocketTuple(IPv4Address(), tuple.local_port(), IPv4Address(), 0);
-        auto wildcard_match = table.get(wildcard_tuple);
-        if (wildcard_match.has_value())
-            return { *wildcard_match.value() };
+    if (auto address_match = find(IPv4SocketTuple(tuple.local_address(), tuple.local_port(), IPv4Address(), 0)))
+        return address_match;
 
-        return {};
-    });
+    return find(IPv4SocketTuple(IPv4Address(), tuple.local_port(), IPv4Address(), 0));
 }
 ErrorOr<NonnullRefPtr<TCPSocket>> TCPSocket::try_create_client(IPv4Address const& new_local_address, u16 new_local_port, IPv4Address const& new_peer_address, u16 new_peer_port)
 {
     auto tuple = IPv4SocketTuple(new_local_address, new_local_port, new_peer_address, new_peer_port);
-    return sockets_by_tuple().with_exclusive([&](auto& table) -> ErrorOr<NonnullRefPtr<TCPSocket>> {
+    return sockets_by_tuple().shard_for(tuple).with_exclusive([&](auto& table) -> ErrorOr<NonnullRefPtr<TCPSocket>> {
         if (table.contains(tuple))
             return EEXIST;
 
         auto receive_buffer = TRY(try_create_receive_buffer());
         auto client = TRY(TCPSocket::try_create(protocol(), move(receive_buffer)));
+        client->m_congestion_control = TRY(TCPCongestionControl::try_create(m_congestion_control->algorithm()));
 
         client->set_setup_state(SetupState::InProgress);
         client->set_local_address(new_local_address);
@@ -158,16 +167,20 @@ void TCPSocket::release_to_originator()
 
 void TCPSocket::release_for_accept(NonnullRefPtr<TCPSocket> socket)
 {
+    // NOTE: The client is handled by whichever network receive worker its flow hashes to, which
+    //       may be busy with a new connection to us at the same time.
+    MutexLocker locker(mutex());
     VERIFY(m_pending_release_for_accept.contains(socket->tuple()));
     m_pending_release_for_accept.remove(socket->tuple());
     // FIXME: Should we observe this error somehow?
     [[maybe_unused]] auto rc = queue_connection_from(move(socket));
 }
 
-TCPSocket::TCPSocket(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, NonnullOwnPtr<KBuffer> scratch_buffer)
-    : IPv4Socket(SOCK_STREAM, protocol, move(receive_buffer), move(scratch_buffer))
+TCPSocket::TCPSocket(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, NonnullOwnPtr<TCPCongestionControl> congestion_control)
+    : IPv4Socket(SOCK_STREAM, protocol, move(receive_buffer))
     , m_last_ack_sent_time(TimeManagement::the().monotonic_time())
     , m_last_retransmit_time(TimeManagement::the().monotonic_time())
+    , m_congestion_control(move(congestion_control))
 {
 }
 
@@ -180,9 +193,8 @@ TCPSocket::~TCPSocket()
 
 ErrorOr<NonnullRefPtr<TCPSocket>> TCPSocket::try_create(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer)
 {
-    // Note: Scratch buffer is only used for SOCK_STREAM sockets.
-    auto scratch_buffer = TRY(KBuffer::try_create_with_size("TCPSocket: Scratch buffer"sv, 65536));
-    return adopt_nonnull_ref_or_enomem(new (nothrow) TCPSocket(protocol, move(receive_buffer), move(scratch_buffer)));
+    auto congestion_control = TRY(TCPCongestionControl::try_create(TCPCongestionControl::default_algorithm));
+    return adopt_nonnull_ref_or_enomem(new (nothrow) TCPSocket(protocol, move(receive_buffer), move(congestion_control)));
 }
 
 ErrorOr<size_t> TCPSocket::protocol_size(ReadonlyBytes raw_ipv4_packet)
@@ -192,24 +204,13 @@ ErrorOr<size_t> TCPSocket::protocol_size(ReadonlyBytes raw_ipv4_packet)
     return raw_ipv4_packet.size() - sizeof(IPv4Packet) - tcp_packet.header_size();
 }
 
-ErrorOr<size_t> TCPSocket::protocol_receive(ReadonlyBytes raw_ipv4_packet, UserOrKernelBuffer& buffer, size_t buffer_size, [[maybe_unused]] int flags)
-{
-    auto& ipv4_packet = *reinterpret_cast<IPv4Packet const*>(raw_ipv4_packet.data());
-    auto& tcp_packet = *static_cast<TCPPacket const*>(ipv4_packet.payload());
-    size_t payload_size = raw_ipv4_packet.size() - sizeof(IPv4Packet) - tcp_packet.header_size();
-    dbgln_if(TCP_SOCKET_DEBUG, "payload_size {}, will it fit in {}?", payload_size, buffer_size);
-    VERIFY(buffer_size >= payload_size);
-    SOCKET_TRY(buffer.write(tcp_packet.payload(), payload_size));
-    return payload_size;
-}
-
 ErrorOr<size_t> TCPSocket::protocol_send(UserOrKernelBuffer const& data, size_t data_length)
 {
     auto adapter = bound_interface().with([](auto& bound_device) -> RefPtr<NetworkAdapter> { return bound_device; });
     RoutingDecision routing_decision = route_to(peer_address(), local_address(), adapter);
     if (routing_decision.is_zero())
         return set_so_error(EHOSTUNREACH);
-    size_t mss = routing_decision.adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
+    size_t mss = maximum_segment_size(*routing_decision.adapter);
 
     if (!m_no_delay) {
         // RFC 896 (Nagle’s algorithm): https://www.ietf.org/rfc/rfc0896
@@ -223,7 +224,18 @@ ErrorOr<size_t> TCPSocket::protocol_send(UserOrKernelBuffer const& data, size_t
             return set_so_error(EAGAIN);
     }
 
-    data_length = min(data_length, mss);
+    // Only put as much data into flight as both the peer and the network can take.
+    size_t window_space = m_unacked_packets.with_shared([&](auto const& packets) -> size_t {
+        size_t send_window = m_send_window_size;
+        size_t congestion_window = m_congestion_control->congestion_window();
+        if (packets.size >= send_window || packets.bytes_in_flight >= congestion_window)
+            return 0;
+        return min(send_window - packets.size, congestion_window - packets.bytes_in_flight);
+    });
+    if (window_space == 0)
+        return set_so_error(EAGAIN);
+
+    data_length = min(data_length, min(maximum_send_size(mss), window_space));
     TRY(send_tcp_packet(TCPFlags::PSH | TCPFlags::ACK, &data, data_length, &routing_decision));
     return data_length;
 }
@@ -244,8 +256,8 @@ ErrorOr<void> TCPSocket::send_tcp_packet(u16 flags, UserOrKernelBuffer const* pa
 
     auto ipv4_payload_offset = routing_decision.adapter->ipv4_payload_offset();
 
-    bool const has_mss_option = flags == TCPFlags::SYN;
-    const size_t options_size = has_mss_option ? sizeof(TCPOptionMSS) : 0;
+    u8 options[maximum_options_size];
+    const size_t options_size = write_options(options, flags, payload_size, *routing_decision.adapter);
     const size_t tcp_header_size = sizeof(TCPPacket) + options_size;
     const size_t buffer_size = ipv4_payload_offset + tcp_header_size + payload_size;
     auto packet = routing_decision.adapter->acquire_packet_buffer(buffer_size);
@@ -259,10 +271,11 @@ ErrorOr<void> TCPSocket::send_tcp_packet(u16 flags, UserOrKernelBuffer const* pa
     VERIFY(local_port());
     tcp_packet.set_source_port(local_port());
     tcp_packet.set_destination_port(peer_port());
-    tcp_packet.set_window_size(NumericLimits<u16>::max());
+    tcp_packet.set_window_size(advertised_window(flags & TCPFlags::SYN));
     tcp_packet.set_sequence_number(m_sequence_number);
     tcp_packet.set_data_offset(tcp_header_size / sizeof(u32));
     tcp_packet.set_flags(flags);
+    memcpy(packet->buffer->data() + ipv4_payload_offset + sizeof(TCPPacket), options, options_size);
 
     if (payload) {
         if (auto result = payload->read(tcp_packet.payload(), payload_size); result.is_error()) {
@@ -277,32 +290,40 @@ ErrorOr<void> TCPSocket::send_tcp_packet(u16 flags, UserOrKernelBuffer const* pa
         tcp_packet.set_ack_number(m_ack_number);
     }
 
+    u32 first_sequence_number = m_sequence_number;
     if (flags & TCPFlags::SYN) {
+        m_send_unacknowledged = m_sequence_number;
         ++m_sequence_number;
     } else {
         m_sequence_number += payload_size;
     }
 
-    if (has_mss_option) {
-        u16 mss = routing_decision.adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
-        TCPOptionMSS mss_option { mss };
-        VERIFY(packet->buffer->size() >= ipv4_payload_offset + sizeof(TCPPacket) + sizeof(mss_option));
-        memcpy(packet->buffer->data() + ipv4_payload_offset + sizeof(TCPPacket), &mss_option, sizeof(mss_option));
+    // The adapter fills in the checksum (or has it filled in in software), and cuts anything larger
+    // than a segment into segments.
+    TransmitOffload offload {};
+    offload.checksum_start = ipv4_payload_offset;
+    offload.checksum_offset = TCPPacket::checksum_offset;
+    if (size_t mss = maximum_segment_size(*routing_decision.adapter); payload_size > mss) {
+        offload.header_size = ipv4_payload_offset + tcp_header_size;
+        offload.segment_size = mss;
     }
 
-    tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
-
     bool expect_ack { tcp_packet.has_syn() || payload_size > 0 };
     if (expect_ack) {
         bool append_failed { false };
         m_unacked_packets.with_exclusive([&](auto& unacked_packets) {
-            auto result = unacked_packets.packets.try_append({ m_sequence_number, packet, ipv4_payload_offset, *routing_decision.adapter });
+            auto now = TimeManagement::the().monotonic_time();
+            // RFC 6298, 5.1: Start the retransmission timer with the first packet that is outstanding.
+            if (unacked_packets.packets.is_empty())
+                m_last_retransmit_time = now;
+            auto result = unacked_packets.packets.try_append({ m_sequence_number, packet, ipv4_payload_offset, *routing_decision.adapter, 0, first_sequence_number, static_cast<u32>(payload_size), now, offload });
             if (result.is_error()) {
                 dbgln("TCPSocket: Dropped outbound packet because try_append() failed");
                 append_failed = true;
                 return;
             }
             unacked_packets.size += payload_size;
+            unacked_packets.bytes_in_flight += payload_size;
             enqueue_for_retransmit();
         });
         if (append_failed)
@@ -311,56 +332,531 @@ ErrorOr<void> TCPSocket::send_tcp_packet(u16 flags, UserOrKernelBuffer const* pa
 
     m_packets_out++;
     m_bytes_out += buffer_size;
-    routing_decision.adapter->send_packet(packet->bytes());
+    routing_decision.adapter->send_packet(packet->buffer->bytes(), offload);
     if (!expect_ack)
         routing_decision.adapter->release_packet_buffer(*packet);
 
     return {};
 }
 
+static u32 current_timestamp()
+{
+    // RFC 7323, 5.4: Any clock between 1 ms and 1 s per tick works; milliseconds give us
+    // precise round trip time samples.
+    return static_cast<u32>(TimeManagement::the().monotonic_time().milliseconds());
+}
+
+u32 TCPSocket::maximum_segment_size(NetworkAdapter const& adapter) const
+{
+    u32 maximum_segment_size = min(static_cast<u32>(adapter.mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket)), m_peer_maximum_segment_size);
+    // Every segment carries a timestamp option once they are enabled (see write_options()).
+    if (m_timestamps_enabled)
+        maximum_segment_size -= 2 + sizeof(TCPOptionTimestamp);
+    return maximum_segment_size;
+}
+
+// With segmentation offload (or its software fallback), we can hand the adapter more than one
+// segment's worth of data at once. Loss recovery only ever retransmits whole super-segments though,
+// so we keep them small compared to the congestion window.
+size_t TCPSocket::maximum_send_size(size_t maximum_segment_size) const
+{
+    constexpr size_t maximum_payload_size = NetworkAdapter::max_super_segment_size - sizeof(IPv4Packet) - sizeof(TCPPacket) - maximum_options_size;
+    size_t segments = m_congestion_control->congestion_window() / (4 * maximum_segment_size);
+    segments = max(static_cast<size_t>(1), min(segments, maximum_payload_size / maximum_segment_size));
+    return segments * maximum_segment_size;
+}
+
+u16 TCPSocket::advertised_window(bool is_syn)
+{
+    // NOTE: Segments we hold in the out-of-order queue are still within the window, as they
+    //       only take up space in the receive buffer once they are in order.
+    size_t space = receive_buffer_space();
+
+    // NOTE: We don't have a persist timer, so a zero window that the peer never hears the end of
+    //       would stall the connection forever. Instead, we always leave the peer room for a
+    //       segment, which we simply drop if it doesn't fit. Its retransmission then doubles as a
+    //       window probe.
+    space = max(space, static_cast<size_t>(m_receive_maximum_segment_size));
+
+    // RFC 7323, 2.2: The window in a SYN segment is never scaled.
+    u8 scale = (!is_syn && m_window_scaling_enabled) ? receive_window_scale : 0;
+    u32 window = min(space >> scale, static_cast<size_t>(NumericLimits<u16>::max()));
+    m_last_advertised_window = window << scale;
+    return window;
+}
+
+size_t TCPSocket::write_options(u8* options, u16 flags, size_t payload_size, NetworkAdapter const& adapter)
+{
+    size_t offset = 0;
+    auto append = [&](auto const& option) {
+        memcpy(options + offset, &option, sizeof(option));
+        offset += sizeof(option);
+    };
+    auto append_padding = [&](size_t count) {
+        for (size_t i = 0; i < count; ++i)
+            options[offset++] = to_underlying(TCPOptionKind::NoOperation);
+    };
+
+    if (flags & TCPFlags::SYN) {
+        // Laid out like everyone else does, so that no space is wasted on padding.
+        m_receive_maximum_segment_size = adapter.mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
+        append(TCPOptionMSS { static_cast<u16>(min(m_receive_maximum_segment_size, static_cast<u32>(NumericLimits<u16>::max()))) });
+        if (m_sack_enabled)
+            append(TCPOptionSACKPermitted {});
+        if (m_timestamps_enabled) {
+            if (!m_sack_enabled)
+                append_padding(2);
+            append(TCPOptionTimestamp { current_timestamp(), m_recent_timestamp });
+        } else if (m_sack_enabled) {
+            append_padding(2);
+        }
+        if (m_window_scaling_enabled) {
+            append_padding(1);
+            append(TCPOptionWindowScale { receive_window_scale });
+        }
+        VERIFY(offset % sizeof(u32) == 0);
+        return offset;
+    }
+
+    // RFC 7323, 3.2: Once negotiated, the timestamp option has to be sent in every segment.
+    if (m_timestamps_enabled) {
+        append_padding(2);
+        append(TCPOptionTimestamp { current_timestamp(), m_recent_timestamp });
+    }
+
+    // RFC 2018, 4: Tell the peer about the data we're holding beyond a hole. We only do this in
+    // pure ACKs, as that's when the peer needs to know.
+    if (m_sack_enabled && payload_size == 0 && !m_out_of_order_ranges.is_empty()) {
+        size_t most_recent_range = 0;
+        for (size_t i = 0; i < m_out_of_order_ranges.size(); ++i) {
+            auto& range = m_out_of_order_ranges[i];
+            if (tcp_sequence_less_than_or_equal(range.sequence_number, m_last_out_of_order_sequence_number)
+                && tcp_sequence_less_than(m_last_out_of_order_sequence_number, range.sequence_number + range.size))
+                most_recent_range = i;
+        }
+        auto append_block = [&](OutOfOrderRange const& range) {
+            append(TCPSACKBlock { range.sequence_number, range.sequence_number + range.size });
+        };
+
+        // RFC 2018, 4: The first block has to be the one containing the most recently received
+        // segment, the others may be whatever fits.
+        size_t block_count = min(m_out_of_order_ranges.size(), (maximum_options_size - offset - 4) / sizeof(TCPSACKBlock));
+
+        append_padding(2);
+        options[offset++] = to_underlying(TCPOptionKind::SACK);
+        options[offset++] = 2 + block_count * sizeof(TCPSACKBlock);
+        append_block(m_out_of_order_ranges[most_recent_range]);
+        for (size_t i = 0, appended = 1; i < m_out_of_order_ranges.size() && appended < block_count; ++i) {
+            if (i == most_recent_range)
+                continue;
+            append_block(m_out_of_order_ranges[i]);
+            ++appended;
+        }
+    }
+
+    VERIFY(offset % sizeof(u32) == 0);
+    return offset;
+}
+
+TCPSocket::ReceivedOptions TCPSocket::parse_options(TCPPacket const& packet)
+{
+    ReceivedOptions options;
+    if (packet.header_size() <= sizeof(TCPPacket))
+        return options;
+
+    auto const* data = reinterpret_cast<u8 const*>(&packet) + sizeof(TCPPacket);
+    size_t size = packet.header_size() - sizeof(TCPPacket);
+    auto read_u32 = [&](size_t offset) -> u32 {
+        return (data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+    };
+
+    for (size_t offset = 0; offset < size;) {
+        auto kind = static_cast<TCPOptionKind>(data[offset]);
+        if (kind == TCPOptionKind::End)
+            break;
+        if (kind == TCPOptionKind::NoOperation) {
+            ++offset;
+            continue;
+        }
+        if (offset + 1 >= size)
+            break;
+        u8 length = data[offset + 1];
+        if (length < 2 || offset + length > size)
+            break;
+
+        switch (kind) {
+        case TCPOptionKind::MSS:
+            if (length == sizeof(TCPOptionMSS))
+                options.maximum_segment_size = (data[offset + 2] << 8) | data[offset + 3];
+            break;
+        case TCPOptionKind::WindowScale:
+            if (length == sizeof(TCPOptionWindowScale))
+                options.window_scale = data[offset + 2];
+            break;
+        case TCPOptionKind::SACKPermitted:
+            if (length == sizeof(TCPOptionSACKPermitted))
+                options.sack_permitted = true;
+            break;
+        case TCPOptionKind::SACK:
+            if ((length - 2) % sizeof(TCPSACKBlock) != 0)
+                break;
+            for (size_t block_offset = offset + 2; block_offset < offset + length && options.sack_blocks.size() < 4; block_offset += sizeof(TCPSACKBlock))
+                options.sack_blocks.unchecked_append({ read_u32(block_offset), read_u32(block_offset + 4) });
+            break;
+        case TCPOptionKind::Timestamp:
+            if (length == sizeof(TCPOptionTimestamp)) {
+                options.timestamp_value = read_u32(offset + 2);
+                options.timestamp_echo_reply = read_u32(offset + 6);
+            }
+            break;
+        default:
+            break;
+        }
+        offset += length;
+    }
+    return options;
+}
+
+void TCPSocket::process_syn_options(TCPPacket const& packet)
+{
+    auto options = parse_options(packet);
+
+    m_peer_maximum_segment_size = options.maximum_segment_size.value_or(default_maximum_segment_size);
+
+    // Incoming connections use whatever the peer offers, outgoing ones only what both sides offered.
+    bool is_outgoing = m_direction == Direction::Outgoing;
+    m_window_scaling_enabled = options.window_scale.has_value() && (!is_outgoing || m_window_scaling_enabled);
+    m_sack_enabled = options.sack_permitted && (!is_outgoing || m_sack_enabled);
+    m_timestamps_enabled = options.timestamp_value.has_value() && (!is_outgoing || m_timestamps_enabled);
+
+    if (m_window_scaling_enabled) {
+        // RFC 7323, 2.3: Larger shift counts have to be treated as 14.
+        m_send_window_scale = min(options.window_scale.value(), static_cast<u8>(14));
+    } else {
+        m_send_window_scale = 0;
+    }
+
+    if (m_timestamps_enabled)
+        m_recent_timestamp = options.timestamp_value.value();
+}
+
 void TCPSocket::receive_tcp_packet(TCPPacket const& packet, u16 size)
 {
-    if (packet.has_ack()) {
-        u32 ack_number = packet.ack_number();
+    auto options = parse_options(packet);
+    size_t payload_size = size - packet.header_size();
+
+    // RFC 7323, 4.3: Only remember timestamps from segments that don't lie beyond what we've
+    // acknowledged, so that delayed ACKs don't make the peer's round trip time look longer.
+    if (m_timestamps_enabled && options.timestamp_value.has_value()
+        && tcp_sequence_less_than_or_equal(packet.sequence_number(), m_last_ack_number_sent)
+        && static_cast<i32>(options.timestamp_value.value() - m_recent_timestamp) >= 0)
+        m_recent_timestamp = options.timestamp_value.value();
+
+    if (packet.has_ack())
+        process_ack(packet, options, payload_size);
+
+    m_packets_in++;
+    m_bytes_in += packet.header_size() + size;
+}
+
+void TCPSocket::process_ack(TCPPacket const& packet, ReceivedOptions const& options, size_t payload_size)
+{
+    u32 ack_number = packet.ack_number();
+
+    dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: receive_tcp_packet: {}", ack_number);
 
-        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: receive_tcp_packet: {}", ack_number);
+    // RFC 7323, 2.3: The window in a SYN segment is never scaled.
+    u32 send_window_size = packet.has_syn() ? packet.window_size() : static_cast<u32>(packet.window_size()) << m_send_window_scale;
+    bool window_changed = send_window_size != m_send_window_size;
+    m_send_window_size = send_window_size;
 
+    auto now = TimeManagement::the().monotonic_time();
+    bool acknowledges_new_data = tcp_sequence_less_than(m_send_unacknowledged, ack_number) && tcp_sequence_less_than_or_equal(ack_number, m_sequence_number);
+    bool needs_retransmission = false;
+    bool must_send_one = false;
+    Optional<Duration> round_trip_time;
+
+    m_unacked_packets.with_exclusive([&](auto& unacked_packets) {
         int removed = 0;
-        m_unacked_packets.with_exclusive([&](auto& unacked_packets) {
-            while (!unacked_packets.packets.is_empty()) {
-                auto& packet = unacked_packets.packets.first();
-
-                dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: iterate: {}", packet.ack_number);
-
-                if (packet.ack_number <= ack_number) {
-                    auto old_adapter = packet.adapter.strong_ref();
-                    if (old_adapter)
-                        old_adapter->release_packet_buffer(*packet.buffer);
-                    TCPPacket& tcp_packet = *(TCPPacket*)(packet.buffer->buffer->data() + packet.ipv4_payload_offset);
-                    if (m_send_window_size != tcp_packet.window_size()) {
-                        m_send_window_size = tcp_packet.window_size();
-                    }
-                    auto payload_size = packet.buffer->buffer->data() + packet.buffer->buffer->size() - (u8*)tcp_packet.payload();
-                    unacked_packets.size -= payload_size;
-                    evaluate_block_conditions();
-                    unacked_packets.packets.take_first();
-                    removed++;
-                } else {
-                    break;
+        u32 bytes_acked = 0;
+        while (!unacked_packets.packets.is_empty()) {
+            auto& packet = unacked_packets.packets.first();
+
+            dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: iterate: {}", packet.ack_number);
+
+            if (!tcp_sequence_less_than_or_equal(packet.ack_number, ack_number))
+                break;
+
+            auto old_adapter = packet.adapter.strong_ref();
+            if (old_adapter)
+                old_adapter->release_packet_buffer(*packet.buffer);
+            // RFC 6298, 3: Karn's algorithm; a retransmitted packet doesn't tell us which copy got acknowledged.
+            if (packet.tx_counter == 0)
+                round_trip_time = now - packet.sent_time;
+            unacked_packets.size -= packet.payload_size;
+            bytes_acked += packet.payload_size;
+            unacked_packets.packets.take_first();
+            removed++;
+        }
+
+        dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: receive_tcp_packet acknowledged {} packets", removed);
+
+        if (m_sack_enabled) {
+            for (auto& block : options.sack_blocks) {
+                for (auto& packet : unacked_packets.packets) {
+                    if (tcp_sequence_less_than_or_equal(block.left_edge(), packet.sequence_number) && tcp_sequence_less_than_or_equal(packet.ack_number, block.right_edge()))
+                        packet.sacked = true;
                 }
             }
+        }
 
-            if (unacked_packets.packets.is_empty()) {
-                m_retransmit_attempts = 0;
-                dequeue_for_retransmit();
+        // RFC 5681, 2: What counts as a duplicate acknowledgement.
+        bool is_duplicate = !acknowledges_new_data && ack_number == m_send_unacknowledged && payload_size == 0
+            && !packet.has_syn() && !packet.has_fin() && !window_changed && !unacked_packets.packets.is_empty();
+
+        if (acknowledges_new_data) {
+            m_send_unacknowledged = ack_number;
+            m_retransmit_attempts = 0;
+            m_last_retransmit_time = now;
+            if (m_in_loss_recovery) {
+                m_duplicate_acks_received = 0;
+                if (tcp_sequence_less_than_or_equal(m_recovery_point, ack_number)) {
+                    m_in_loss_recovery = false;
+                    m_congestion_control->on_recovery_complete();
+                } else if (!unacked_packets.packets.is_empty()) {
+                    // RFC 6582, 3.2: A partial acknowledgement means that the next hole is lost as well.
+                    auto& first_packet = unacked_packets.packets.first();
+                    if (!first_packet.sacked)
+                        first_packet.lost = true;
+                    must_send_one = true;
+                }
+            } else {
+                m_duplicate_acks_received = 0;
+                if (bytes_acked > 0)
+                    m_congestion_control->on_ack(bytes_acked, now, m_smoothed_round_trip_time.value_or(m_retransmit_timeout));
             }
+        } else if (is_duplicate) {
+            ++m_duplicate_acks_received;
+        }
 
-            dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket: receive_tcp_packet acknowledged {} packets", removed);
-        });
+        update_scoreboard(unacked_packets);
+
+        // RFC 6675, 5: Loss recovery starts after enough duplicate acknowledgements, or as soon as
+        // the SACK scoreboard tells us that the first outstanding packet is lost.
+        if (!m_in_loss_recovery && !unacked_packets.packets.is_empty()) {
+            auto& first_packet = unacked_packets.packets.first();
+            if (m_duplicate_acks_received >= duplicate_ack_threshold || first_packet.lost) {
+                dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket({}) entering loss recovery at {}", this, m_send_unacknowledged);
+                m_in_loss_recovery = true;
+                m_recovery_point = m_sequence_number;
+                first_packet.lost = true;
+                m_congestion_control->on_congestion_event(unacked_packets.size, now);
+                update_scoreboard(unacked_packets);
+                must_send_one = true;
+            }
+        }
+
+        needs_retransmission = m_in_loss_recovery && !unacked_packets.packets.is_empty();
+
+        if (unacked_packets.packets.is_empty()) {
+            m_retransmit_attempts = 0;
+            dequeue_for_retransmit();
+        }
+    });
+
+    if (acknowledges_new_data) {
+        if (m_timestamps_enabled && options.timestamp_echo_reply != 0)
+            round_trip_time = Duration::from_milliseconds(static_cast<i32>(current_timestamp() - options.timestamp_echo_reply));
+        if (round_trip_time.has_value() && !round_trip_time->is_negative())
+            update_round_trip_time(round_trip_time.value());
     }
 
-    m_packets_in++;
-    m_bytes_in += packet.header_size() + size;
+    if (needs_retransmission) {
+        auto adapter = bound_interface().with([](auto& bound_device) -> RefPtr<NetworkAdapter> { return bound_device; });
+        auto routing_decision = route_to(peer_address(), local_address(), adapter);
+        if (!routing_decision.is_zero()) {
+            m_unacked_packets.with_exclusive([&](auto& unacked_packets) {
+                send_pending_retransmissions(unacked_packets, routing_decision, must_send_one);
+            });
+        }
+    }
+
+    evaluate_block_conditions();
+}
+
+void TCPSocket::update_round_trip_time(Duration sample)
+{
+    // RFC 6298, 2: alpha = 1/8, beta = 1/4, K = 4, and a minimum timeout of one second.
+    constexpr i64 clock_granularity_us = 10'000;
+    i64 sample_us = sample.to_microseconds();
+    i64 smoothed_us;
+    i64 variance_us;
+    if (!m_smoothed_round_trip_time.has_value()) {
+        smoothed_us = sample_us;
+        variance_us = sample_us / 2;
+    } else {
+        smoothed_us = m_smoothed_round_trip_time->to_microseconds();
+        variance_us = m_round_trip_time_variance.to_microseconds();
+        i64 deviation_us = smoothed_us > sample_us ? smoothed_us - sample_us : sample_us - smoothed_us;
+        variance_us = (3 * variance_us + deviation_us) / 4;
+        smoothed_us = (7 * smoothed_us + sample_us) / 8;
+    }
+    m_smoothed_round_trip_time = Duration::from_microseconds(smoothed_us);
+    m_round_trip_time_variance = Duration::from_microseconds(variance_us);
+
+    i64 timeout_us = smoothed_us + max(clock_granularity_us, 4 * variance_us);
+    timeout_us = clamp(timeout_us, minimum_retransmit_timeout.to_microseconds(), maximum_retransmit_timeout.to_microseconds());
+    m_retransmit_timeout = Duration::from_microseconds(timeout_us);
+}
+
+void TCPSocket::update_scoreboard(UnackedPackets& unacked_packets)
+{
+    u32 maximum_segment_size = m_congestion_control->maximum_segment_size();
+
+    size_t sacked_bytes_above = 0;
+    for (auto& packet : unacked_packets.packets) {
+        if (packet.sacked)
+            sacked_bytes_above += packet.payload_size;
+    }
+
+    size_t bytes_in_flight = 0;
+    for (auto& packet : unacked_packets.packets) {
+        if (packet.sacked) {
+            sacked_bytes_above -= packet.payload_size;
+            continue;
+        }
+        // RFC 6675, 4: IsLost() holds once DupThresh segments worth of data above it were SACKed.
+        if (m_sack_enabled && sacked_bytes_above >= duplicate_ack_threshold * maximum_segment_size)
+            packet.lost = true;
+        // RFC 6675, 4: SetPipe()
+        if (!packet.lost || packet.retransmitted)
+            bytes_in_flight += packet.payload_size;
+    }
+
+    // Without SACK, each duplicate acknowledgement still means that a packet has left the network.
+    if (!m_sack_enabled && m_in_loss_recovery)
+        bytes_in_flight -= min(bytes_in_flight, static_cast<size_t>(m_duplicate_acks_received) * maximum_segment_size);
+
+    unacked_packets.bytes_in_flight = bytes_in_flight;
+}
+
+void TCPSocket::send_pending_retransmissions(UnackedPackets& unacked_packets, RoutingDecision const& routing_decision, bool must_send_one)
+{
+    size_t congestion_window = m_congestion_control->congestion_window();
+    for (auto& packet : unacked_packets.packets) {
+        if (packet.sacked || !packet.lost || packet.retransmitted)
+            continue;
+        if (!must_send_one && unacked_packets.bytes_in_flight + packet.payload_size > congestion_window)
+            break;
+        retransmit_packet(packet, routing_decision);
+        packet.retransmitted = true;
+        unacked_packets.bytes_in_flight += packet.payload_size;
+        must_send_one = false;
+    }
+}
+
+void TCPSocket::protocol_did_consume_receive_buffer()
+{
+    if (m_state != State::Established && m_state != State::FinWait1 && m_state != State::FinWait2)
+        return;
+
+    // RFC 9293, 3.8.6.2.2: Only announce a larger window once it has grown by a good amount, so
+    // that the peer doesn't end up sending lots of tiny segments.
+    size_t space = receive_buffer_space();
+    if (space < m_last_advertised_window + 2 * m_receive_maximum_segment_size)
+        return;
+
+    (void)send_ack(true);
+}
+
+bool TCPSocket::queue_out_of_order_segment(TCPPacket const& tcp_packet, size_t payload_size)
+{
+    if (payload_size == 0 || tcp_packet.has_syn() || tcp_packet.has_fin())
+        return false;
+
+    u32 sequence_number = tcp_packet.sequence_number();
+    if (!tcp_sequence_less_than(m_ack_number, sequence_number))
+        return false;
+
+    // Anything that wouldn't fit into the receive buffer once it's in order, or that would wrap
+    // around the ring onto data we're still holding, is dropped right away.
+    u32 end_sequence_number = sequence_number + payload_size;
+    if (end_sequence_number - m_ack_number > min(receive_buffer_space(), out_of_order_buffer_size))
+        return false;
+
+    size_t index = 0;
+    while (index < m_out_of_order_ranges.size() && tcp_sequence_less_than(m_out_of_order_ranges[index].sequence_number, sequence_number))
+        ++index;
+    auto* previous = index > 0 ? &m_out_of_order_ranges[index - 1] : nullptr;
+    auto* next = index < m_out_of_order_ranges.size() ? &m_out_of_order_ranges[index] : nullptr;
+
+    // We only keep segments that don't overlap with anything we already have, which takes care
+    // of duplicates as well. The peer will retransmit anything we've thrown away.
+    if (previous && tcp_sequence_less_than(sequence_number, previous->sequence_number + previous->size))
+        return false;
+    if (next && tcp_sequence_less_than(next->sequence_number, end_sequence_number))
+        return false;
+
+    bool extends_previous = previous && previous->sequence_number + previous->size == sequence_number;
+    bool extends_next = next && next->sequence_number == end_sequence_number;
+    if (!extends_previous && !extends_next && m_out_of_order_ranges.size() >= maximum_out_of_order_ranges)
+        return false;
+
+    if (!m_out_of_order_buffer) {
+        auto buffer = KBuffer::try_create_with_size("TCPSocket: Out of order buffer"sv, out_of_order_buffer_size);
+        if (buffer.is_error())
+            return false;
+        m_out_of_order_buffer = buffer.release_value();
+    }
+
+    auto ring = m_out_of_order_buffer->bytes();
+    size_t ring_offset = sequence_number & (out_of_order_buffer_size - 1);
+    size_t first_part = min(payload_size, out_of_order_buffer_size - ring_offset);
+    auto const* payload = static_cast<u8 const*>(tcp_packet.payload());
+    memcpy(ring.offset_pointer(ring_offset), payload, first_part);
+    memcpy(ring.data(), payload + first_part, payload_size - first_part);
+
+    if (extends_previous && extends_next) {
+        previous->size += payload_size + next->size;
+        m_out_of_order_ranges.remove(index);
+    } else if (extends_previous) {
+        previous->size += payload_size;
+    } else if (extends_next) {
+        next->sequence_number = sequence_number;
+        next->size += payload_size;
+    } else if (m_out_of_order_ranges.try_insert(index, OutOfOrderRange { sequence_number, static_cast<u32>(payload_size) }).is_error()) {
+        return false;
+    }
+
+    m_last_out_of_order_sequence_number = sequence_number;
+    return true;
+}
+
+bool TCPSocket::deliver_out_of_order_segments()
+{
+    bool did_deliver = false;
+    while (!m_out_of_order_ranges.is_empty()) {
+        auto& range = m_out_of_order_ranges.first();
+        if (tcp_sequence_less_than(m_ack_number, range.sequence_number))
+            break;
+
+        // Skip whatever arrived again in the meantime.
+        u32 end_sequence_number = range.sequence_number + range.size;
+        while (tcp_sequence_less_than(m_ack_number, end_sequence_number)) {
+            size_t ring_offset = m_ack_number & (out_of_order_buffer_size - 1);
+            size_t size = min(static_cast<size_t>(end_sequence_number - m_ack_number), out_of_order_buffer_size - ring_offset);
+            if (append_to_receive_buffer(m_out_of_order_buffer->bytes().slice(ring_offset, size)).is_error())
+                return did_deliver;
+            m_ack_number += size;
+            did_deliver = true;
+        }
+        m_out_of_order_ranges.take_first();
+    }
+
+    // Most connections never see a hole, so we don't keep the ring around once it's empty.
+    if (m_out_of_order_ranges.is_empty())
+        m_out_of_order_buffer = nullptr;
+    return did_deliver;
 }
 
 bool TCPSocket::should_delay_next_ack() const
@@ -445,6 +941,30 @@ ErrorOr<void> TCPSocket::setsockopt(int level, int option, Userspace<void const*
             return EINVAL;
         m_no_delay = value;
         return {};
+    case TCP_CONGESTION: {
+        // Like on Linux, this is the name of the algorithm, and doesn't have to be null-terminated.
+        char name_buffer[16] {};
+        if (user_value_size == 0 || user_value_size > sizeof(name_buffer))
+            return EINVAL;
+        TRY(copy_from_user(name_buffer, static_ptr_cast<char const*>(user_value), user_value_size));
+        StringView name { name_buffer, user_value_size };
+        if (auto null_terminator = name.find('\0'); null_terminator.has_value())
+            name = name.substring_view(0, null_terminator.value());
+
+        auto algorithm = TCPCongestionControl::algorithm_from_name(name);
+        if (!algorithm.has_value())
+            return ENOENT;
+        if (algorithm.value() == m_congestion_control->algorithm())
+            return {};
+        auto congestion_control = TRY(TCPCongestionControl::try_create(algorithm.value()));
+        congestion_control->set_maximum_segment_size(m_congestion_control->maximum_segment_size());
+        // NOTE: can_write() looks at the congestion window without holding the socket mutex, so we swap while
+        //       holding the unacked packets lock, like it does. The old instance is only destroyed after that.
+        m_unacked_packets.with_exclusive([&](auto&) {
+            swap(m_congestion_control, congestion_control);
+        });
+        return {};
+    }
     default:
         dbgln("setsockopt({}) at IPPROTO_TCP not implemented.", option);
         return ENOPROTOOPT;
@@ -470,6 +990,15 @@ ErrorOr<void> TCPSocket::getsockopt(OpenFileDescription& description, int level,
         size = sizeof(nodelay);
         return copy_to_user(value_size, &size);
     }
+    case TCP_CONGESTION: {
+        char name_buffer[16] {};
+        auto name = m_congestion_control->name();
+        VERIFY(name.length() < sizeof(name_buffer));
+        memcpy(name_buffer, name.characters_without_null_termination(), name.length());
+        size = min(size, static_cast<socklen_t>(sizeof(name_buffer)));
+        TRY(copy_to_user(static_ptr_cast<char*>(value), name_buffer, size));
+        return copy_to_user(value_size, &size);
+    }
     default:
         dbgln("getsockopt({}) at IPPROTO_TCP not implemented.", option);
         return ENOPROTOOPT;
@@ -496,29 +1025,33 @@ ErrorOr<void> TCPSocket::protocol_bind()
         constexpr u16 ephemeral_port_range_size = last_ephemeral_port - first_ephemeral_port;
         u16 first_scan_port = first_ephemeral_port + get_good_random<u16>() % ephemeral_port_range_size;
 
-        return sockets_by_tuple().with_exclusive([&](auto& table) -> ErrorOr<void> {
-            u16 port = first_scan_port;
-            while (true) {
-                IPv4SocketTuple proposed_tuple(local_address(), port, peer_address(), peer_port());
-
-                auto it = table.find(proposed_tuple);
-                if (it == table.end()) {
-                    set_local_port(port);
-                    table.set(proposed_tuple, this);
-                    dbgln_if(TCP_SOCKET_DEBUG, "...allocated port {}, tuple {}", port, proposed_tuple.to_string());
-                    return {};
-                }
-                ++port;
-                if (port > last_ephemeral_port)
-                    port = first_ephemeral_port;
-                if (port == first_scan_port)
-                    break;
+        u16 port = first_scan_port;
+        while (true) {
+            IPv4SocketTuple proposed_tuple(local_address(), port, peer_address(), peer_port());
+
+            // Every tuple lives in exactly one shard, so checking and claiming it under the lock
+            // of that shard is enough to make sure nobody else gets it.
+            bool claimed = sockets_by_tuple().shard_for(proposed_tuple).with_exclusive([&](auto& table) {
+                if (table.contains(proposed_tuple))
+                    return false;
+                set_local_port(port);
+                table.set(proposed_tuple, this);
+                return true;
+            });
+            if (claimed) {
+                dbgln_if(TCP_SOCKET_DEBUG, "...allocated port {}, tuple {}", port, proposed_tuple.to_string());
+                return {};
             }
-            return set_so_error(EADDRINUSE);
-        });
+            ++port;
+            if (port > last_ephemeral_port)
+                port = first_ephemeral_port;
+            if (port == first_scan_port)
+                break;
+        }
+        return set_so_error(EADDRINUSE);
     } else {
         // Verify that the user-supplied port is not already used by someone else.
-        bool ok = sockets_by_tuple().with_exclusive([&](auto& table) -> bool {
+        bool ok = sockets_by_tuple().shard_for(tuple()).with_exclusive([&](auto& table) -> bool {
             if (table.contains(tuple()))
                 return false;
             table.set(tuple(), this);
@@ -553,6 +1086,11 @@ ErrorOr<void> TCPSocket::protocol_connect(OpenFileDescription& description)
     m_sequence_number = get_good_random<u32>();
     m_ack_number = 0;
 
+    // Offer everything we support; process_syn_options() will turn off what the peer doesn't.
+    m_window_scaling_enabled = true;
+    m_timestamps_enabled = true;
+    m_sack_enabled = true;
+
     set_setup_state(SetupState::InProgress);
     TRY(send_tcp_packet(TCPFlags::SYN));
     m_state = State::SynSent;
@@ -619,7 +1157,7 @@ ErrorOr<void> TCPSocket::close()
     }
 
     if (state() != State::Closed && state() != State::Listen)
-        closing_sockets().with_exclusive([&](auto& table) {
+        closing_sockets().shard_for(tuple()).with_exclusive([&](auto& table) {
             table.set(tuple(), *this);
         });
     return result;
@@ -650,13 +1188,14 @@ void TCPSocket::retransmit_packets()
 {
     auto now = TimeManagement::the().monotonic_time();
 
-    // RFC6298 says we should have at least one second between retransmits. According to
-    // RFC1122 we must do exponential backoff - even for SYN packets.
-    i64 retransmit_interval = 1;
-    for (decltype(m_retransmit_attempts) i = 0; i < m_retransmit_attempts; i++)
-        retransmit_interval *= 2;
+    // RFC 6298, 5.5: Back off the timer for every retransmission. According to RFC 1122 we must
+    // do exponential backoff - even for SYN packets.
+    auto retransmit_timeout = m_retransmit_timeout;
+    for (decltype(m_retransmit_attempts) i = 0; i < m_retransmit_attempts && retransmit_timeout < maximum_retransmit_timeout; i++)
+        retransmit_timeout = retransmit_timeout + retransmit_timeout;
+    retransmit_timeout = min(retransmit_timeout, maximum_retransmit_timeout);
 
-    if (m_last_retransmit_time > now - Duration::from_seconds(retransmit_interval))
+    if (m_last_retransmit_time > now - retransmit_timeout)
         return;
 
     dbgln_if(TCP_SOCKET_DEBUG, "TCPSocket({}) handling retransmit", this);
@@ -677,43 +1216,63 @@ void TCPSocket::retransmit_packets()
         return;
 
     m_unacked_packets.with_exclusive([&](auto& unacked_packets) {
-        for (auto& packet : unacked_packets.packets) {
-            packet.tx_counter++;
-
-            if constexpr (TCP_SOCKET_DEBUG) {
-                auto& tcp_packet = *(const TCPPacket*)(packet.buffer->buffer->data() + packet.ipv4_payload_offset);
-                dbgln("Sending TCP packet from {}:{} to {}:{} with ({}{}{}{}) seq_no={}, ack_no={}, tx_counter={}",
-                    local_address(), local_port(),
-                    peer_address(), peer_port(),
-                    (tcp_packet.has_syn() ? "SYN " : ""),
-                    (tcp_packet.has_ack() ? "ACK " : ""),
-                    (tcp_packet.has_fin() ? "FIN " : ""),
-                    (tcp_packet.has_rst() ? "RST " : ""),
-                    tcp_packet.sequence_number(),
-                    tcp_packet.ack_number(),
-                    packet.tx_counter);
-            }
-
-            size_t ipv4_payload_offset = routing_decision.adapter->ipv4_payload_offset();
-            if (ipv4_payload_offset != packet.ipv4_payload_offset) {
-                // FIXME: Add support for this. This can happen if after a route change
-                // we ended up on another adapter which doesn't have the same layer 2 type
-                // like the previous adapter.
-                VERIFY_NOT_REACHED();
-            }
+        if (unacked_packets.packets.is_empty())
+            return;
 
-            auto packet_buffer = packet.buffer->bytes();
+        m_congestion_control->on_retransmit_timeout(unacked_packets.size, now);
 
-            routing_decision.adapter->fill_in_ipv4_header(*packet.buffer,
-                local_address(), routing_decision.next_hop, peer_address(),
-                IPv4Protocol::TCP, packet_buffer.size() - ipv4_payload_offset, type_of_service(), ttl());
-            routing_decision.adapter->send_packet(packet_buffer);
-            m_packets_out++;
-            m_bytes_out += packet_buffer.size();
+        // RFC 6675, 5.1: After a timeout, everything outstanding is considered lost. RFC 2018, 8:
+        // The peer may have thrown away data it SACKed, so we forget about that as well.
+        for (auto& packet : unacked_packets.packets) {
+            packet.sacked = false;
+            packet.lost = true;
+            packet.retransmitted = false;
         }
+        m_in_loss_recovery = true;
+        m_recovery_point = m_sequence_number;
+        m_duplicate_acks_received = 0;
+
+        update_scoreboard(unacked_packets);
+        send_pending_retransmissions(unacked_packets, routing_decision, true);
     });
 }
 
+void TCPSocket::retransmit_packet(OutgoingPacket& packet, RoutingDecision const& routing_decision)
+{
+    packet.tx_counter++;
+
+    if constexpr (TCP_SOCKET_DEBUG) {
+        auto& tcp_packet = *(const TCPPacket*)(packet.buffer->buffer->data() + packet.ipv4_payload_offset);
+        dbgln("Sending TCP packet from {}:{} to {}:{} with ({}{}{}{}) seq_no={}, ack_no={}, tx_counter={}",
+            local_address(), local_port(),
+            peer_address(), peer_port(),
+            (tcp_packet.has_syn() ? "SYN " : ""),
+            (tcp_packet.has_ack() ? "ACK " : ""),
+            (tcp_packet.has_fin() ? "FIN " : ""),
+            (tcp_packet.has_rst() ? "RST " : ""),
+            tcp_packet.sequence_number(),
+            tcp_packet.ack_number(),
+            packet.tx_counter);
+    }
+
+    size_t ipv4_payload_offset = routing_decision.adapter->ipv4_payload_offset();
+    if (ipv4_payload_offset != packet.ipv4_payload_offset) {
+        // FIXME: Add support for this. This can happen if after a route change
+        // we ended up on another adapter which doesn't have the same layer 2 type
+        // like the previous adapter.
+        VERIFY_NOT_REACHED();
+    }
+
+    auto packet_buffer = packet.buffer->buffer->bytes();
+
+    routing_decision.adapter->fill_in_ipv4_header(*packet.buffer,
+        local_address(), routing_decision.next_hop, peer_address(),
+        IPv4Protocol::TCP, packet_buffer.size() - ipv4_payload_offset, type_of_service(), ttl());
+    routing_decision.adapter->send_packet(packet_buffer, packet.offload);
+    m_packets_out++;
+    m_bytes_out += packet_buffer.size();
+}
+
 bool TCPSocket::can_write(OpenFileDescription const& file_description, u64 size) const
 {
     if (!IPv4Socket::can_write(file_description, size))
@@ -726,7 +1285,8 @@ bool TCPSocket::can_write(OpenFileDescription const& file_description, u64 size)
         return true;
 
     return m_unacked_packets.with_shared([&](auto& unacked_packets) {
-        return unacked_packets.size + size <= m_send_window_size;
+        return unacked_packets.size + size < m_send_window_size
+            && unacked_packets.bytes_in_flight < m_congestion_control->congestion_window();
     });
 }
 }
@@ -11,9 +11,13 @@
 #include <AK/HashMap.h>
 #include <AK/SinglyLinkedList.h>
 #include <AK/Time.h>
+#include <AK/Vector.h>
 #include <Kernel/Library/LockWeakPtr.h>
 #include <Kernel/Locking/MutexProtected.h>
 #include <Kernel/Net/IPv4Socket.h>
+#include <Kernel/Net/SocketTable.h>
+#include <Kernel/Net/TCP.h>
+#include <Kernel/Net/TCPCongestionControl.h>
 
 namespace Kernel {
 
@@ -144,12 +148,24 @@ public:
     ErrorOr<void> send_tcp_packet(u16 flags, UserOrKernelBuffer const* = nullptr, size_t = 0, RoutingDecision* = nullptr);
     void receive_tcp_packet(TCPPacket const&, u16 size);
 
+    // Picks up the options the peer sent along with its SYN, which decide what we use for the
+    // rest of the connection.
+    void process_syn_options(TCPPacket const&);
+
+    // Holds on to a segment that arrived ahead of the next one we expect, so that it doesn't have
+    // to be retransmitted, and so that we can tell the peer about it with a SACK option.
+    bool queue_out_of_order_segment(TCPPacket const&, size_t payload_size);
+    // Passes on queued segments that are now in order. Returns whether anything was delivered.
+    bool deliver_out_of_order_segments();
+    bool has_out_of_order_segments() const { return !m_out_of_order_ranges.is_empty(); }
+    bool is_sack_enabled() const { return m_sack_enabled; }
+
     bool should_delay_next_ack() const;
 
-    static MutexProtected<HashMap<IPv4SocketTuple, TCPSocket*>>& sockets_by_tuple();
+    static SocketTable<IPv4SocketTuple, TCPSocket*>& sockets_by_tuple();
     static RefPtr<TCPSocket> from_tuple(IPv4SocketTuple const& tuple);
 
-    static MutexProtected<HashMap<IPv4SocketTuple, RefPtr<TCPSocket>>>& closing_sockets();
+    static SocketTable<IPv4SocketTuple, RefPtr<TCPSocket>>& closing_sockets();
 
     ErrorOr<NonnullRefPtr<TCPSocket>> try_create_client(IPv4Address const& local_address, u16 local_port, IPv4Address const& peer_address, u16 peer_port);
     void set_originator(TCPSocket& originator) { m_originator = originator; }
@@ -172,22 +188,47 @@ protected:
     void set_direction(Direction direction) { m_direction = direction; }
 
 private:
-    explicit TCPSocket(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, NonnullOwnPtr<KBuffer> scratch_buffer);
+    explicit TCPSocket(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer, NonnullOwnPtr<TCPCongestionControl>);
     virtual StringView class_name() const override { return "TCPSocket"sv; }
 
     virtual void shut_down_for_writing() override;
 
-    virtual ErrorOr<size_t> protocol_receive(ReadonlyBytes raw_ipv4_packet, UserOrKernelBuffer& buffer, size_t buffer_size, int flags) override;
     virtual ErrorOr<size_t> protocol_send(UserOrKernelBuffer const&, size_t) override;
     virtual ErrorOr<void> protocol_connect(OpenFileDescription&) override;
     virtual ErrorOr<size_t> protocol_size(ReadonlyBytes raw_ipv4_packet) override;
     virtual bool protocol_is_disconnected() const override;
+    virtual void protocol_did_consume_receive_buffer() override;
     virtual ErrorOr<void> protocol_bind() override;
     virtual ErrorOr<void> protocol_listen() override;
 
     void enqueue_for_retransmit();
     void dequeue_for_retransmit();
 
+    struct OutgoingPacket;
+    struct UnackedPackets;
+
+    static constexpr size_t maximum_options_size = 40;
+    struct ReceivedOptions {
+        Optional<u16> maximum_segment_size;
+        Optional<u8> window_scale;
+        bool sack_permitted { false };
+        Optional<u32> timestamp_value;
+        u32 timestamp_echo_reply { 0 };
+        Vector<TCPSACKBlock, 4> sack_blocks;
+    };
+    static ReceivedOptions parse_options(TCPPacket const&);
+
+    u32 maximum_segment_size(NetworkAdapter const&) const;
+    size_t maximum_send_size(size_t maximum_segment_size) const;
+    u16 advertised_window(bool is_syn);
+    size_t write_options(u8* options, u16 flags, size_t payload_size, NetworkAdapter const&);
+
+    void process_ack(TCPPacket const&, ReceivedOptions const&, size_t payload_size);
+    void update_round_trip_time(Duration sample);
+    void update_scoreboard(UnackedPackets&);
+    void send_pending_retransmissions(UnackedPackets&, RoutingDecision const&, bool must_send_one);
+    void retransmit_packet(OutgoingPacket&, RoutingDecision const&);
+
     LockWeakPtr<TCPSocket> m_originator;
     HashMap<IPv4SocketTuple, NonnullRefPtr<TCPSocket>> m_pending_release_for_accept;
     Direction m_direction { Direction::Unspecified };
@@ -207,11 +248,22 @@ private:
         size_t ipv4_payload_offset;
         LockWeakPtr<NetworkAdapter> adapter;
         int tx_counter { 0 };
+        u32 sequence_number { 0 };
+        u32 payload_size { 0 };
+        MonotonicTime sent_time;
+        TransmitOffload offload;
+        // RFC 6675 scoreboard: whether the peer has told us it has this packet, whether we
+        // consider it lost, and whether we've retransmitted it since.
+        bool sacked { false };
+        bool lost { false };
+        bool retransmitted { false };
     };
 
     struct UnackedPackets {
         SinglyLinkedList<OutgoingPacket> packets;
         size_t size { 0 };
+        // RFC 6675 "pipe": The data we believe is still somewhere in the network.
+        size_t bytes_in_flight { 0 };
     };
 
     MutexProtected<UnackedPackets> m_unacked_packets;
@@ -223,12 +275,64 @@ private:
 
     // FIXME: Make this configurable (sysctl)
     static constexpr u32 maximum_retransmits = 5;
+    static constexpr Duration minimum_retransmit_timeout = Duration::from_seconds(1);
+    static constexpr Duration maximum_retransmit_timeout = Duration::from_seconds(60);
     MonotonicTime m_last_retransmit_time;
     u32 m_retransmit_attempts { 0 };
 
     // Default to maximum window size. receive_tcp_packet() will update from the
     // peer's advertised window size.
     u32 m_send_window_size { 64 * KiB };
+    u32 m_send_unacknowledged { 0 };
+
+    // RFC 9293, 3.7.1: Without an MSS option, the peer only guarantees to take segments this big.
+    static constexpr u32 default_maximum_segment_size = 536;
+    u32 m_peer_maximum_segment_size { default_maximum_segment_size };
+    u32 m_receive_maximum_segment_size { default_maximum_segment_size };
+
+    // Options from RFC 7323 and RFC 2018. For outgoing connections these are what we offer in
+    // our SYN, and process_syn_options() turns off whatever the peer doesn't support. Incoming
+    // connections only use what the peer offered.
+    bool m_window_scaling_enabled { false };
+    bool m_timestamps_enabled { false };
+    bool m_sack_enabled { false };
+    u8 m_send_window_scale { 0 };
+    // Our receive buffer can hold more than 64 KiB, so we need to scale our window to advertise it.
+    static constexpr u8 receive_window_scale = 3;
+    u32 m_last_advertised_window { 0 };
+    // RFC 7323, 4.3: The most recent timestamp to echo back to the peer.
+    u32 m_recent_timestamp { 0 };
+
+    // Out of order payload is kept in a ring indexed by sequence number, which is only allocated
+    // while there is something in it. Everything we hold has to fit into the ring and the receive
+    // buffer once it's in order, which bounds the memory a peer can make us hold on to.
+    static constexpr size_t out_of_order_buffer_size = 64 * KiB;
+    static_assert(is_power_of_two(out_of_order_buffer_size));
+    // Bounds the work per segment and per ACK, as every range is a hole the peer has left.
+    static constexpr size_t maximum_out_of_order_ranges = 16;
+
+    struct OutOfOrderRange {
+        u32 sequence_number { 0 };
+        u32 size { 0 };
+    };
+    OwnPtr<KBuffer> m_out_of_order_buffer;
+    // Sorted by sequence number, never overlapping, and adjacent ranges are merged.
+    Vector<OutOfOrderRange, maximum_out_of_order_ranges> m_out_of_order_ranges;
+    u32 m_last_out_of_order_sequence_number { 0 };
+
+    // Only replaced while holding both the socket mutex and the lock of m_unacked_packets.
+    NonnullOwnPtr<TCPCongestionControl> m_congestion_control;
+    // RFC 5681, 3.2: DupThresh
+    static constexpr u32 duplicate_ack_threshold = 3;
+    u32 m_duplicate_acks_received { 0 };
+    bool m_in_loss_recovery { false };
+    // Loss recovery ends once everything up to here has been acknowledged.
+    u32 m_recovery_point { 0 };
+
+    // RFC 6298 retransmission timer state.
+    Optional<Duration> m_smoothed_round_trip_time;
+    Duration m_round_trip_time_variance;
+    Duration m_retransmit_timeout { Duration::from_seconds(1) };
 
     bool m_no_delay { false };
 
@@ -26,6 +26,8 @@ public:
 
     u16 checksum() const { return m_checksum; }
     void set_checksum(u16 checksum) { m_checksum = checksum; }
+    // Where the checksum is, for adapters that fill it in for us.
+    static constexpr u16 checksum_offset = 6;
 
     void const* payload() const { return this + 1; }
     void* payload() { return this + 1; }
@@ -24,23 +24,21 @@ void UDPSocket::for_each(Function<void(UDPSocket const&)> callback)
 
 ErrorOr<void> UDPSocket::try_for_each(Function<ErrorOr<void>(UDPSocket const&)> callback)
 {
-    return sockets_by_port().with_shared([&](auto const& sockets) -> ErrorOr<void> {
-        for (auto& socket : sockets)
-            TRY(callback(*socket.value));
-        return {};
+    return sockets_by_port().try_for_each_shared([&](auto const& socket) -> ErrorOr<void> {
+        return callback(*socket.value);
     });
 }
 
-static Singleton<MutexProtected<HashMap<u16, UDPSocket*>>> s_map;
+static Singleton<SocketTable<u16, UDPSocket*>> s_map;
 
-MutexProtected<HashMap<u16, UDPSocket*>>& UDPSocket::sockets_by_port()
+SocketTable<u16, UDPSocket*>& UDPSocket::sockets_by_port()
 {
     return *s_map;
 }
 
 RefPtr<UDPSocket> UDPSocket::from_port(u16 port)
 {
-    return sockets_by_port().with_shared([&](auto const& table) -> RefPtr<UDPSocket> {
+    return sockets_by_port().shard_for(port).with_shared([&](auto const& table) -> RefPtr<UDPSocket> {
         auto it = table.find(port);
         if (it == table.end())
             return {};
@@ -49,13 +47,13 @@ RefPtr<UDPSocket> UDPSocket::from_port(u16 port)
 }
 
 UDPSocket::UDPSocket(int protocol, NonnullOwnPtr<DoubleBuffer> receive_buffer)
-    : IPv4Socket(SOCK_DGRAM, protocol, move(receive_buffer), {})
+    : IPv4Socket(SOCK_DGRAM, protocol, move(receive_buffer))
 {
 }
 
 UDPSocket::~UDPSocket()
 {
-    sockets_by_port().with_exclusive([&](auto& table) {
+    sockets_by_port().shard_for(local_port()).with_exclusive([&](auto& table) {
         table.remove(local_port());
     });
 }
@@ -102,7 +100,13 @@ ErrorOr<size_t> UDPSocket::protocol_send(UserOrKernelBuffer const& data, size_t
     SOCKET_TRY(data.read(udp_packet.payload(), data_length));
     routing_decision.adapter->fill_in_ipv4_header(*packet, local_address(), routing_decision.next_hop,
         peer_address(), IPv4Protocol::UDP, udp_buffer_size, type_of_service(), ttl());
-    routing_decision.adapter->send_packet(packet->bytes());
+    // The checksum is optional for UDP over IPv4, so we only bother with it if it's free.
+    TransmitOffload offload {};
+    if (routing_decision.adapter->has_offload(OffloadFeatures::UDPChecksum)) {
+        offload.checksum_start = ipv4_payload_offset;
+        offload.checksum_offset = UDPPacket::checksum_offset;
+    }
+    routing_decision.adapter->send_packet(packet->buffer->bytes(), offload);
     return data_length;
 }
 
@@ -123,26 +127,27 @@ ErrorOr<void> UDPSocket::protocol_bind()
         constexpr u16 ephemeral_port_range_size = last_ephemeral_port - first_ephemeral_port;
         u16 first_scan_port = first_ephemeral_port + get_good_random<u16>() % ephemeral_port_range_size;
 
-        return sockets_by_port().with_exclusive([&](auto& table) -> ErrorOr<void> {
-            u16 port = first_scan_port;
-            while (true) {
-                auto it = table.find(port);
-                if (it == table.end()) {
-                    set_local_port(port);
-                    table.set(port, this);
-                    return {};
-                }
-                ++port;
-                if (port > last_ephemeral_port)
-                    port = first_ephemeral_port;
-                if (port == first_scan_port)
-                    break;
-            }
-            return set_so_error(EADDRINUSE);
-        });
+        u16 port = first_scan_port;
+        while (true) {
+            bool claimed = sockets_by_port().shard_for(port).with_exclusive([&](auto& table) {
+                if (table.contains(port))
+                    return false;
+                set_local_port(port);
+                table.set(port, this);
+                return true;
+            });
+            if (claimed)
+                return {};
+            ++port;
+            if (port > last_ephemeral_port)
+                port = first_ephemeral_port;
+            if (port == first_scan_port)
+                break;
+        }
+        return set_so_error(EADDRINUSE);
     } else {
         // Verify that the user-supplied port is not already used by someone else.
-        return sockets_by_port().with_exclusive([&](auto& table) -> ErrorOr<void> {
+        return sockets_by_port().shard_for(local_port()).with_exclusive([&](auto& table) -> ErrorOr<void> {
             if (table.contains(local_port()))
                 return set_so_error(EADDRINUSE);
             table.set(local_port(), this);
@@ -137,9 +137,22 @@ UNMAP_AFTER_INIT ErrorOr<void> VirtIONetworkAdapter::initialize_virtio_resources
             negotiated |= VIRTIO_NET_F_SPEED_DUPLEX;
         if (is_feature_set(supported_features, VIRTIO_NET_F_MTU))
             negotiated |= VIRTIO_NET_F_MTU;
+        if (is_feature_set(supported_features, VIRTIO_NET_F_CSUM)) {
+            negotiated |= VIRTIO_NET_F_CSUM;
+            // The device may only offer segmentation along with checksum offload, but check anyway.
+            if (is_feature_set(supported_features, VIRTIO_NET_F_HOST_TSO4))
+                negotiated |= VIRTIO_NET_F_HOST_TSO4;
+        }
         return negotiated;
     }));
 
+    auto offload_features = OffloadFeatures::None;
+    if (is_feature_accepted(VIRTIO_NET_F_CSUM))
+        offload_features |= OffloadFeatures::TCPChecksum | OffloadFeatures::UDPChecksum;
+    if (is_feature_accepted(VIRTIO_NET_F_HOST_TSO4))
+        offload_features |= OffloadFeatures::TCPSegmentation;
+    set_offload_features(offload_features);
+
     TRY(handle_device_config_change());
     TRY(setup_queues(2)); // receive & transmit
 
@@ -255,7 +268,27 @@ static bool copy_data_to_chain(VirtIO::QueueChain& chain, Memory::RingBuffer& ri
 void VirtIONetworkAdapter::send_raw(ReadonlyBytes payload)
 {
     dbgln_if(VIRTIO_DEBUG, "VirtIONetworkAdapter: send_raw length={}", payload.size());
+    send_with_header({}, payload);
+}
 
+void VirtIONetworkAdapter::send_raw_with_offload(ReadonlyBytes payload, TransmitOffload const& offload)
+{
+    dbgln_if(VIRTIO_DEBUG, "VirtIONetworkAdapter: send_raw_with_offload length={} segment_size={}", payload.size(), offload.segment_size);
+
+    VirtIONetHdr hdr {};
+    hdr.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+    hdr.csum_start = offload.checksum_start;
+    hdr.csum_offset = offload.checksum_offset;
+    if (offload.needs_segmentation()) {
+        hdr.gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+        hdr.hdr_len = offload.header_size;
+        hdr.gso_size = offload.segment_size;
+    }
+    send_with_header(hdr, payload);
+}
+
+void VirtIONetworkAdapter::send_with_header(VirtIONetHdr const& hdr, ReadonlyBytes payload)
+{
     auto& queue = get_queue(TRANSMITQ);
     SpinlockLocker queue_lock(queue.lock());
     VirtIO::QueueChain chain(queue);
@@ -268,8 +301,7 @@ void VirtIONetworkAdapter::send_raw(ReadonlyBytes payload)
     }
 
     // FIXME: Handle errors from pushing to the chain and rewind the RingBuffer.
-    VirtIONetHdr hdr {};
-    VERIFY(copy_data_to_chain(chain, *m_tx_buffers, reinterpret_cast<u8*>(&hdr), sizeof(hdr)));
+    VERIFY(copy_data_to_chain(chain, *m_tx_buffers, reinterpret_cast<u8 const*>(&hdr), sizeof(hdr)));
     VERIFY(copy_data_to_chain(chain, *m_tx_buffers, payload.data(), payload.size()));
 
     supply_chain_and_notify(TRANSMITQ, chain);
@@ -12,6 +12,10 @@
 
 namespace Kernel {
 
+namespace VirtIO {
+struct VirtIONetHdr;
+}
+
 class VirtIONetworkAdapter
     : public VirtIO::Device
     , public NetworkAdapter {
@@ -42,6 +46,9 @@ private:
 
     // NetworkAdapter
     virtual void send_raw(ReadonlyBytes) override;
+    virtual void send_raw_with_offload(ReadonlyBytes, TransmitOffload const&) override;
+
+    void send_with_header(VirtIO::VirtIONetHdr const&, ReadonlyBytes payload);
 
 private:
     VirtIO::Configuration const* m_device_config { nullptr };
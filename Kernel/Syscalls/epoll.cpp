@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/ScopeGuard.h>
+#include <Kernel/Debug.h>
+#include <Kernel/FileSystem/EventPoll.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Tasks/Process.h>
+#include <Kernel/Time/TimeManagement.h>
+
+namespace Kernel {
+
+// Arbitrary limit on how many events we hand out per call, so that userspace can't make us
+// allocate an unbounded amount of memory. Anything left over will be reported by the next call.
+static constexpr size_t max_events_per_wait = 1024;
+
+ErrorOr<FlatPtr> Process::sys$epoll_create(int flags)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::stdio));
+
+    if ((flags & EPOLL_CLOEXEC) != flags)
+        return EINVAL;
+
+    auto event_poll = TRY(EventPoll::try_create());
+    auto description = TRY(OpenFileDescription::try_create(move(event_poll)));
+    description->set_readable(true);
+
+    return m_fds.with_exclusive([&](auto& fds) -> ErrorOr<FlatPtr> {
+        auto fd_allocation = TRY(fds.allocate());
+        fds[fd_allocation.fd].set(move(description), (flags & EPOLL_CLOEXEC) ? FD_CLOEXEC : 0);
+        return fd_allocation.fd;
+    });
+}
+
+ErrorOr<FlatPtr> Process::sys$epoll_ctl(int epoll_fd, int op, int fd, Userspace<epoll_event const*> user_event)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::stdio));
+
+    auto epoll_description = TRY(open_file_description(epoll_fd));
+    auto* event_poll = epoll_description->event_poll();
+    if (!event_poll)
+        return EINVAL;
+
+    auto description = TRY(open_file_description(fd));
+    if (description.ptr() == epoll_description.ptr())
+        return EINVAL;
+
+    switch (op) {
+    case EPOLL_CTL_ADD: {
+        auto event = TRY(copy_typed_from_user(user_event));
+        TRY(event_poll->add_interest(*description, fd, event));
+        return 0;
+    }
+    case EPOLL_CTL_MOD: {
+        auto event = TRY(copy_typed_from_user(user_event));
+        TRY(event_poll->modify_interest(*description, fd, event));
+        return 0;
+    }
+    case EPOLL_CTL_DEL:
+        TRY(event_poll->remove_interest(*description, fd));
+        return 0;
+    default:
+        return EINVAL;
+    }
+}
+
+ErrorOr<FlatPtr> Process::sys$epoll_wait(Userspace<Syscall::SC_epoll_wait_params const*> user_params)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::stdio));
+
+    auto params = TRY(copy_typed_from_user(user_params));
+    if (params.max_events <= 0)
+        return EINVAL;
+
+    auto description = TRY(open_file_description(params.epoll_fd));
+    auto* event_poll = description->event_poll();
+    if (!event_poll)
+        return EINVAL;
+
+    // Turn the timeout into a deadline, so that spurious wakeups don't extend it.
+    Thread::BlockTimeout timeout;
+    bool is_nonblocking = false;
+    if (params.timeout) {
+        auto timeout_time = TRY(copy_time_from_user(params.timeout));
+        if (timeout_time.is_zero()) {
+            is_nonblocking = true;
+        } else {
+            auto deadline = TimeManagement::the().current_time(CLOCK_MONOTONIC_COARSE) + timeout_time;
+            timeout = Thread::BlockTimeout(true, &deadline, nullptr, CLOCK_MONOTONIC_COARSE);
+        }
+    }
+
+    sigset_t sigmask = {};
+    if (params.sigmask)
+        TRY(copy_from_user(&sigmask, params.sigmask));
+
+    Vector<epoll_event> events;
+    TRY(events.try_resize(min(static_cast<size_t>(params.max_events), max_events_per_wait)));
+
+    auto* current_thread = Thread::current();
+
+    u32 previous_signal_mask = 0;
+    if (params.sigmask)
+        previous_signal_mask = current_thread->update_signal_mask(sigmask);
+    ScopeGuard rollback_signal_mask([&]() {
+        if (params.sigmask)
+            current_thread->update_signal_mask(previous_signal_mask);
+    });
+
+    size_t event_count = 0;
+    for (;;) {
+        event_count = event_poll->collect_ready_events(events.span());
+        if (event_count > 0 || is_nonblocking)
+            break;
+
+        // NOTE: The ready list may still contain interests that turn out not to be ready, so a
+        //       wakeup doesn't necessarily mean that we'll have something to report.
+        Thread::FileBlocker::BlockFlags unblock_flags = Thread::FileBlocker::BlockFlags::None;
+        auto result = current_thread->block<Thread::ReadBlocker>(timeout, *description, unblock_flags);
+        if (result.was_interrupted())
+            return EINTR;
+        if (result == Thread::BlockResult::InterruptedByTimeout)
+            is_nonblocking = true;
+    }
+
+    dbgln_if(POLL_SELECT_DEBUG, "epoll_wait on {} returned {} event(s)", params.epoll_fd, event_count);
+
+    if (event_count > 0)
+        TRY(copy_n_to_user(params.events, events.data(), event_count));
+    return event_count;
+}
+
+}
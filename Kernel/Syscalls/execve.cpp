@@ -620,7 +620,19 @@ ErrorOr<void> Process::do_exec(NonnullRefPtr<OpenFileDescription> main_program_d
     });
 
     auto* current_thread = Thread::current();
-    current_thread->reset_signals_for_exec();
+    new_main_thread = nullptr;
+    if (&current_thread->process() == this) {
+        new_main_thread = current_thread;
+    } else {
+        for_each_thread([&](auto& thread) {
+            new_main_thread = &thread;
+            return IterationDecision::Break;
+        });
+    }
+    VERIFY(new_main_thread);
+
+    // NOTE: When we're exec'ing on behalf of someone else (e.g. for posix_spawn()), the calling thread's signal state stays as it is.
+    new_main_thread->reset_signals_for_exec();
 
     clear_signal_handlers_for_exec();
 
@@ -638,17 +650,6 @@ ErrorOr<void> Process::do_exec(NonnullRefPtr<OpenFileDescription> main_program_d
         m_fds.with_exclusive([&](auto& fds) { fds[main_program_fd_allocation->fd].set(move(main_program_description), FD_CLOEXEC); });
     }
 
-    new_main_thread = nullptr;
-    if (&current_thread->process() == this) {
-        new_main_thread = current_thread;
-    } else {
-        for_each_thread([&](auto& thread) {
-            new_main_thread = &thread;
-            return IterationDecision::Break;
-        });
-    }
-    VERIFY(new_main_thread);
-
     auto credentials = this->credentials();
     auto auxv = generate_auxiliary_vector(load_result.load_base, load_result.entry_eip, credentials->uid(), credentials->euid(), credentials->gid(), credentials->egid(), path->view(), main_program_fd_allocation);
 
@@ -928,6 +929,24 @@ ErrorOr<void> Process::exec(NonnullOwnPtr<KString> path, Vector<NonnullOwnPtr<KS
     return do_exec(move(description), move(arguments), move(environment), move(interpreter_description), new_main_thread, previous_interrupts_state, *main_program_header, minimum_stack_size);
 }
 
+ErrorOr<void> Process::copy_string_list_from_user(Syscall::StringListArgument const& list, Vector<NonnullOwnPtr<KString>>& output)
+{
+    if (!list.length)
+        return {};
+    Checked<size_t> size = sizeof(*list.strings);
+    size *= list.length;
+    if (size.has_overflow())
+        return EOVERFLOW;
+    Vector<Syscall::StringArgument, 32> strings;
+    TRY(strings.try_resize(list.length));
+    TRY(copy_from_user(strings.data(), list.strings, size.value()));
+    for (size_t i = 0; i < list.length; ++i) {
+        auto string = TRY(try_copy_kstring_from_user(strings[i]));
+        TRY(output.try_append(move(string)));
+    }
+    return {};
+}
+
 ErrorOr<FlatPtr> Process::sys$execve(Userspace<Syscall::SC_execve_params const*> user_params)
 {
     VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
@@ -953,28 +972,11 @@ ErrorOr<FlatPtr> Process::sys$execve(Userspace<Syscall::SC_execve_params const*>
 
         auto path = TRY(get_syscall_path_argument(params.path));
 
-        auto copy_user_strings = [](auto const& list, auto& output) -> ErrorOr<void> {
-            if (!list.length)
-                return {};
-            Checked<size_t> size = sizeof(*list.strings);
-            size *= list.length;
-            if (size.has_overflow())
-                return EOVERFLOW;
-            Vector<Syscall::StringArgument, 32> strings;
-            TRY(strings.try_resize(list.length));
-            TRY(copy_from_user(strings.data(), list.strings, size.value()));
-            for (size_t i = 0; i < list.length; ++i) {
-                auto string = TRY(try_copy_kstring_from_user(strings[i]));
-                TRY(output.try_append(move(string)));
-            }
-            return {};
-        };
-
         Vector<NonnullOwnPtr<KString>> arguments;
-        TRY(copy_user_strings(params.arguments, arguments));
+        TRY(copy_string_list_from_user(params.arguments, arguments));
 
         Vector<NonnullOwnPtr<KString>> environment;
-        TRY(copy_user_strings(params.environment, environment));
+        TRY(copy_string_list_from_user(params.environment, environment));
 
         TRY(exec(move(path), move(arguments), move(environment), new_main_thread, previous_interrupts_state));
     }
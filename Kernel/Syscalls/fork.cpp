@@ -15,11 +15,8 @@
 
 namespace Kernel {
 
-ErrorOr<FlatPtr> Process::sys$fork(RegisterState& regs)
+ErrorOr<Process::ProcessAndFirstThread> Process::create_forked_child()
 {
-    VERIFY_NO_PROCESS_BIG_LOCK(this);
-    TRY(require_promise(Pledge::proc));
-
     auto credentials = this->credentials();
     auto child_and_first_thread = TRY(Process::create_with_forked_name(credentials->uid(), credentials->gid(), pid(), m_is_kernel_process, current_directory(), executable(), tty(), this));
     auto& child = child_and_first_thread.process;
@@ -119,6 +116,49 @@ ErrorOr<FlatPtr> Process::sys$fork(RegisterState& regs)
     child_first_thread->m_alternative_signal_stack = Thread::current()->m_alternative_signal_stack;
     child_first_thread->m_alternative_signal_stack_size = Thread::current()->m_alternative_signal_stack_size;
 
+    thread_finalizer_guard.disarm();
+    remove_from_jail_process_list.disarm();
+
+    return child_and_first_thread;
+}
+
+void Process::abandon_forked_child(ProcessAndFirstThread& child_and_first_thread)
+{
+    auto& child = child_and_first_thread.process;
+    m_jail_process_list.with([&](auto& list_ptr) {
+        if (list_ptr) {
+            list_ptr->attached_processes().with([&](auto& list) {
+                list.remove(*child);
+            });
+        }
+    });
+
+    SpinlockLocker lock(g_scheduler_lock);
+    child_and_first_thread.first_thread->detach();
+    child_and_first_thread.first_thread->set_state(Thread::State::Dying);
+}
+
+void Process::start_forked_child(ProcessAndFirstThread& child_and_first_thread)
+{
+    Process::register_new(*child_and_first_thread.process);
+
+    PerformanceManager::add_process_created_event(*child_and_first_thread.process);
+
+    SpinlockLocker lock(g_scheduler_lock);
+    child_and_first_thread.first_thread->set_affinity(Thread::current()->affinity());
+    child_and_first_thread.first_thread->set_state(Thread::State::Runnable);
+}
+
+ErrorOr<FlatPtr> Process::sys$fork(RegisterState& regs)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::proc));
+
+    auto child_and_first_thread = TRY(create_forked_child());
+    auto& child = child_and_first_thread.process;
+    auto& child_first_thread = child_and_first_thread.first_thread;
+    ArmedScopeGuard abandon_child_guard = [&] { abandon_forked_child(child_and_first_thread); };
+
     auto& child_regs = child_first_thread->m_regs;
 #if ARCH(X86_64)
     child_regs.rax = 0; // fork() returns 0 in the child :^)
@@ -164,7 +204,9 @@ ErrorOr<FlatPtr> Process::sys$fork(RegisterState& regs)
             for (auto& region : parent_space->region_tree().regions()) {
                 dbgln_if(FORK_DEBUG, "fork: cloning Region '{}' @ {}", region.name(), region.vaddr());
                 auto region_clone = TRY(region.try_clone());
-                TRY(region_clone->map(child_space->page_directory(), Memory::ShouldFlushTLB::No));
+                // NOTE: Most of what a child maps in is never touched before it calls exec(), so its pages are
+                //       only mapped when it faults on them. That also defers setting up its copy-on-write mappings.
+                region_clone->map_lazily(child_space->page_directory());
                 TRY(child_space->region_tree().place_specifically(*region_clone, region.range()));
                 auto* child_region = region_clone.leak_ptr();
 
@@ -175,19 +217,9 @@ ErrorOr<FlatPtr> Process::sys$fork(RegisterState& regs)
         });
     }));
 
-    thread_finalizer_guard.disarm();
-    remove_from_jail_process_list.disarm();
-
-    Process::register_new(*child);
-
-    PerformanceManager::add_process_created_event(*child);
-
-    SpinlockLocker lock(g_scheduler_lock);
-    child_first_thread->set_affinity(Thread::current()->affinity());
-    child_first_thread->set_state(Thread::State::Runnable);
-
-    auto child_pid = child->pid().value();
+    abandon_child_guard.disarm();
+    start_forked_child(child_and_first_thread);
 
-    return child_pid;
+    return child->pid().value();
 }
 }
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/FileSystem/IORing.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Tasks/Process.h>
+#include <Kernel/Time/TimeManagement.h>
+
+namespace Kernel {
+
+ErrorOr<FlatPtr> Process::sys$io_ring_setup(u32 entries, Userspace<io_ring_params*> user_params, int flags)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::stdio));
+
+    if ((flags & IO_RING_CLOEXEC) != flags)
+        return EINVAL;
+
+    auto ring = TRY(IORing::try_create(*this, entries));
+    auto params = ring->params();
+    TRY(copy_to_user(user_params, &params));
+
+    auto description = TRY(OpenFileDescription::try_create(move(ring)));
+    description->set_readable(true);
+    description->set_writable(true);
+
+    return m_fds.with_exclusive([&](auto& fds) -> ErrorOr<FlatPtr> {
+        auto fd_allocation = TRY(fds.allocate());
+        fds[fd_allocation.fd].set(move(description), (flags & IO_RING_CLOEXEC) ? FD_CLOEXEC : 0);
+        return fd_allocation.fd;
+    });
+}
+
+ErrorOr<FlatPtr> Process::sys$io_ring_enter(Userspace<Syscall::SC_io_ring_enter_params const*> user_params)
+{
+    VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
+    TRY(require_promise(Pledge::stdio));
+
+    auto params = TRY(copy_typed_from_user(user_params));
+
+    auto description = TRY(open_file_description(params.ring_fd));
+    auto* ring = description->io_ring();
+    if (!ring)
+        return EINVAL;
+    // The submissions point into the address space of the process that set up the ring.
+    if (ring->owner() != pid())
+        return EPERM;
+
+    // Turn the timeout into a deadline, so that spurious wakeups don't extend it.
+    Optional<Duration> deadline;
+    if (params.timeout) {
+        auto timeout = TRY(copy_time_from_user(params.timeout));
+        deadline = TimeManagement::the().current_time(CLOCK_MONOTONIC_COARSE) + timeout;
+    }
+
+    auto submitted = TRY(ring->submit(*this, params.to_submit));
+
+    for (;;) {
+        ring->complete_ready_operations(*this);
+        if (ring->available_completions() >= params.min_complete)
+            break;
+        if (deadline.has_value() && TimeManagement::the().current_time(CLOCK_MONOTONIC_COARSE) >= deadline.value())
+            break;
+
+        // Wake up for whichever comes first: our own deadline, or that of a parked timeout.
+        Thread::SelectBlocker::FDVector fds;
+        Optional<Duration> wake_up_time = deadline;
+        if (!ring->prepare_wait(fds, wake_up_time))
+            break;
+
+        Thread::BlockTimeout timeout;
+        if (wake_up_time.has_value())
+            timeout = Thread::BlockTimeout(true, &wake_up_time.value(), nullptr, CLOCK_MONOTONIC_COARSE);
+
+        // NOTE: Whatever woke us up might not be enough for an operation to complete, so we
+        //       simply go around again and let the ring sort it out.
+        if (Thread::current()->block<Thread::SelectBlocker>(timeout, fds).was_interrupted()) {
+            if (submitted > 0)
+                break;
+            return EINTR;
+        }
+    }
+
+    return submitted;
+}
+
+}
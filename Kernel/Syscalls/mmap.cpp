@@ -172,6 +172,7 @@ ErrorOr<FlatPtr> Process::sys$mmap(Userspace<Syscall::SC_mmap_params const*> use
     bool map_noreserve = flags & MAP_NORESERVE;
     bool map_randomized = flags & MAP_RANDOMIZED;
     bool map_fixed_noreplace = flags & MAP_FIXED_NOREPLACE;
+    bool map_hugepage = flags & MAP_HUGEPAGE;
 
     if (map_shared && map_private)
         return EINVAL;
@@ -187,6 +188,14 @@ ErrorOr<FlatPtr> Process::sys$mmap(Userspace<Syscall::SC_mmap_params const*> use
     if (map_stack && (!map_private || !map_anonymous))
         return EINVAL;
 
+    if (map_hugepage) {
+        if (!map_anonymous)
+            return EINVAL;
+        // Huge pages can only be used for the parts of a mapping that are aligned to their size.
+        if (rounded_size >= Memory::huge_page_size)
+            alignment = max(alignment, Memory::huge_page_size);
+    }
+
     Memory::VirtualRange requested_range { VirtualAddress { addr }, rounded_size };
     if (addr && !(map_fixed || map_fixed_noreplace)) {
         // If there's an address but MAP_FIXED wasn't specified, the address is just a hint.
@@ -257,6 +266,8 @@ ErrorOr<FlatPtr> Process::sys$mmap(Userspace<Syscall::SC_mmap_params const*> use
             region->set_shared(true);
         if (map_stack)
             region->set_stack(true);
+        if (map_hugepage)
+            region->set_wants_huge_pages(true);
         if (name)
             region->set_name(move(name));
 
@@ -435,6 +446,14 @@ ErrorOr<FlatPtr> Process::sys$madvise(Userspace<void*> address, size_t size, int
             TRY(vmobject.set_volatile(advice == MADV_SET_VOLATILE, was_purged));
             return was_purged ? 1 : 0;
         }
+        if (advice == MADV_HUGEPAGE || advice == MADV_NOHUGEPAGE) {
+            if (!region->vmobject().is_anonymous())
+                return EINVAL;
+            // NOTE: This only affects memory that's faulted in from now on. Huge pages that are
+            //       already mapped stay around until they're unmapped or copied on write.
+            region->set_wants_huge_pages(advice == MADV_HUGEPAGE);
+            return 0;
+        }
         return EINVAL;
     });
 }
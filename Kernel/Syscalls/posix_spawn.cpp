@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/ScopeGuard.h>
+#include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/VirtualFileSystem.h>
+#include <Kernel/Net/LocalSocket.h>
+#include <Kernel/Tasks/Process.h>
+
+namespace Kernel {
+
+ErrorOr<void> Process::apply_spawn_file_action(Syscall::SpawnFileAction const& action)
+{
+    auto validate_fd = [](int fd) -> ErrorOr<void> {
+        if (fd < 0 || static_cast<size_t>(fd) >= OpenFileDescriptions::max_open())
+            return EBADF;
+        return {};
+    };
+
+    switch (action.type) {
+    case Syscall::SpawnFileAction::Type::Open: {
+        TRY(validate_fd(action.fd));
+        auto path = TRY(get_syscall_path_argument(action.path));
+        auto description = TRY(VirtualFileSystem::the().open(credentials(), path->view(), action.flags, action.mode & 0777 & ~umask(), current_directory()));
+        if (description->inode() && description->inode()->bound_socket())
+            return ENXIO;
+        return m_fds.with_exclusive([&](auto& fds) -> ErrorOr<void> {
+            if (!fds.m_fds_metadatas[action.fd].is_allocated())
+                fds.m_fds_metadatas[action.fd].allocate();
+            fds[action.fd].set(move(description), (action.flags & O_CLOEXEC) ? FD_CLOEXEC : 0);
+            return {};
+        });
+    }
+    case Syscall::SpawnFileAction::Type::Close: {
+        auto description = TRY(open_file_description(action.fd));
+        auto result = description->close();
+        m_fds.with_exclusive([&](auto& fds) { fds[action.fd] = {}; });
+        return result;
+    }
+    case Syscall::SpawnFileAction::Type::Dup2:
+        TRY(validate_fd(action.fd));
+        return m_fds.with_exclusive([&](auto& fds) -> ErrorOr<void> {
+            auto description = TRY(fds.open_file_description(action.old_fd));
+            // POSIX wants FD_CLOEXEC to be cleared even if both are the same.
+            if (!fds.m_fds_metadatas[action.fd].is_allocated())
+                fds.m_fds_metadatas[action.fd].allocate();
+            fds[action.fd].set(move(description));
+            return {};
+        });
+    case Syscall::SpawnFileAction::Type::Chdir: {
+        auto path = TRY(get_syscall_path_argument(action.path));
+        RefPtr<Custody> new_directory = TRY(VirtualFileSystem::the().open_directory(credentials(), path->view(), current_directory()));
+        m_current_directory.with([&](auto& current_directory) {
+            swap(current_directory, new_directory);
+        });
+        return {};
+    }
+    case Syscall::SpawnFileAction::Type::Fchdir: {
+        auto description = TRY(open_file_description(action.fd));
+        if (!description->is_directory())
+            return ENOTDIR;
+        if (!description->metadata().may_execute(credentials()))
+            return EACCES;
+        m_current_directory.with([&](auto& current_directory) {
+            current_directory = description->custody();
+        });
+        return {};
+    }
+    }
+    return EINVAL;
+}
+
+ErrorOr<FlatPtr> Process::sys$posix_spawn(Userspace<Syscall::SC_posix_spawn_params const*> user_params)
+{
+    VERIFY_NO_PROCESS_BIG_LOCK(this);
+    TRY(require_promise(Pledge::proc));
+    TRY(require_promise(Pledge::exec));
+
+    auto params = TRY(copy_typed_from_user(user_params));
+
+    if (params.arguments.length > ARG_MAX || params.environment.length > ARG_MAX)
+        return E2BIG;
+
+    // NOTE: The caller is expected to always pass at least one argument by convention,
+    //       the program path that was passed as params.path.
+    if (params.arguments.length == 0)
+        return EINVAL;
+
+    if (params.file_actions_count > OpenFileDescriptions::max_open() * 2)
+        return EINVAL;
+
+    auto path = TRY(get_syscall_path_argument(params.path));
+
+    Vector<NonnullOwnPtr<KString>> arguments;
+    TRY(copy_string_list_from_user(params.arguments, arguments));
+
+    Vector<NonnullOwnPtr<KString>> environment;
+    TRY(copy_string_list_from_user(params.environment, environment));
+
+    Vector<Syscall::SpawnFileAction> file_actions;
+    TRY(file_actions.try_resize(params.file_actions_count));
+    TRY(copy_n_from_user(file_actions.data(), params.file_actions, params.file_actions_count));
+
+    // The file actions run in the child, but they need the same promises as if we were doing them ourselves.
+    for (auto const& action : file_actions) {
+        if (action.type == Syscall::SpawnFileAction::Type::Open) {
+            if (action.flags & (O_NOFOLLOW_NOERROR | O_UNLINK_INTERNAL))
+                return EINVAL;
+            if (action.flags & O_WRONLY)
+                TRY(require_promise(Pledge::wpath));
+            else if (action.flags & O_RDONLY)
+                TRY(require_promise(Pledge::rpath));
+            if (action.flags & O_CREAT)
+                TRY(require_promise(Pledge::cpath));
+        } else if (action.type == Syscall::SpawnFileAction::Type::Chdir) {
+            TRY(require_promise(Pledge::rpath));
+        }
+    }
+
+    // Unlike fork(), we don't copy any of our address space. The child goes straight to exec'ing the new program,
+    // which we do on its behalf right here.
+    auto child_and_first_thread = TRY(create_forked_child());
+    auto& child = child_and_first_thread.process;
+    ArmedScopeGuard abandon_child_guard = [&] { abandon_forked_child(child_and_first_thread); };
+
+    for (auto const& action : file_actions)
+        TRY(child->apply_spawn_file_action(action));
+
+    if (params.set_signal_mask)
+        child_and_first_thread.first_thread->update_signal_mask(params.signal_mask);
+    for (size_t signal = 1; signal < NSIG; ++signal) {
+        if (params.default_signals & (1u << (signal - 1)))
+            child->m_signal_action_data[signal] = {};
+    }
+
+    Thread* new_main_thread = nullptr;
+    InterruptsState previous_interrupts_state = InterruptsState::Enabled;
+    auto result = child->exec(move(path), move(arguments), move(environment), new_main_thread, previous_interrupts_state);
+
+    // NOTE: Loading the program switched us over to the child's address space.
+    Memory::MemoryManager::enter_process_address_space(*this);
+    if (result.is_error())
+        return result.release_error();
+
+    // exec() leaves us in a critical section with interrupts disabled, ready for a context switch into the new program.
+    // That's the child's business though, so we simply carry on.
+    VERIFY(new_main_thread == child_and_first_thread.first_thread.ptr());
+    Processor::restore_interrupts_state(previous_interrupts_state);
+    Processor::leave_critical();
+
+    abandon_child_guard.disarm();
+    start_forked_child(child_and_first_thread);
+
+    return child->pid().value();
+}
+
+}
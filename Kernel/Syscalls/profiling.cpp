@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/FileSystem/PerformanceEventStream.h>
 #include <Kernel/Tasks/Coredump.h>
 #include <Kernel/Tasks/PerformanceManager.h>
 #include <Kernel/Tasks/Process.h>
@@ -25,7 +27,7 @@ ErrorOr<FlatPtr> Process::sys$profiling_enable(pid_t pid, u64 event_mask)
 }
 
 // NOTE: This second entrypoint exists to allow the kernel to invoke the syscall to enable boot profiling.
-ErrorOr<FlatPtr> Process::profiling_enable(pid_t pid, u64 event_mask)
+ErrorOr<FlatPtr> Process::profiling_enable(pid_t pid, u64 event_mask, RefPtr<PerformanceEventStream> stream)
 {
     VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
 
@@ -33,12 +35,21 @@ ErrorOr<FlatPtr> Process::profiling_enable(pid_t pid, u64 event_mask)
         auto credentials = this->credentials();
         if (!credentials->is_superuser())
             return EPERM;
+        OwnPtr<PerformanceEventBuffer> previous_perf_events;
         ScopedCritical critical;
+        // A buffer can only be reused if it's going to be used the same way again.
+        bool can_reuse_buffer = g_global_perf_events && !stream && !g_global_perf_events->is_streaming();
+        if (g_global_perf_events && !can_reuse_buffer && g_profiling_all_threads)
+            return EBUSY;
         g_profiling_event_mask = PERF_EVENT_PROCESS_CREATE | PERF_EVENT_THREAD_CREATE | PERF_EVENT_MMAP;
-        if (g_global_perf_events) {
+        if (can_reuse_buffer) {
             g_global_perf_events->clear();
         } else {
-            g_global_perf_events = PerformanceEventBuffer::try_create_with_size(32 * MiB).leak_ptr();
+            previous_perf_events = adopt_own_if_nonnull(g_global_perf_events);
+            if (stream)
+                g_global_perf_events = PerformanceEventBuffer::try_create_for_stream(stream.release_nonnull()).leak_ptr();
+            else
+                g_global_perf_events = PerformanceEventBuffer::try_create_with_size(32 * MiB).leak_ptr();
             if (!g_global_perf_events) {
                 g_profiling_event_mask = 0;
                 return ENOMEM;
@@ -68,9 +79,17 @@ ErrorOr<FlatPtr> Process::profiling_enable(pid_t pid, u64 event_mask)
     if (!credentials->is_superuser() && profile_process_credentials->uid() != credentials->euid())
         return EPERM;
     SpinlockLocker lock(g_profiling_lock);
+    if (stream && process->is_profiling())
+        return EBUSY;
+    // Leftovers from an earlier streaming session are of no use to a regular profile.
+    if (!stream && process->perf_events() && process->perf_events()->is_streaming()) {
+        if (process->is_profiling())
+            return EBUSY;
+        process->delete_perf_events_buffer();
+    }
     g_profiling_event_mask = PERF_EVENT_PROCESS_CREATE | PERF_EVENT_THREAD_CREATE | PERF_EVENT_MMAP;
     process->set_profiling(true);
-    if (!process->create_perf_events_buffer_if_needed()) {
+    if (!process->create_perf_events_buffer_if_needed(move(stream))) {
         process->set_profiling(false);
         return ENOMEM;
     }
@@ -82,6 +101,33 @@ ErrorOr<FlatPtr> Process::profiling_enable(pid_t pid, u64 event_mask)
     return 0;
 }
 
+ErrorOr<FlatPtr> Process::sys$profiling_stream(pid_t pid, u64 event_mask)
+{
+    VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
+    TRY(require_no_promises());
+
+    auto credentials = this->credentials();
+    auto stream = TRY(PerformanceEventStream::try_create(credentials->is_superuser()));
+    auto description = TRY(OpenFileDescription::try_create(stream));
+    // The consumer has to map the rings writable, so that it can hand back the space it's done with.
+    description->set_readable(true);
+    description->set_writable(true);
+
+    // Install the descriptor first, so there's nothing to undo once profiling has been enabled.
+    auto fd = TRY(m_fds.with_exclusive([&](auto& fds) -> ErrorOr<int> {
+        auto fd_allocation = TRY(fds.allocate());
+        fds[fd_allocation.fd].set(move(description), FD_CLOEXEC);
+        return fd_allocation.fd;
+    }));
+
+    auto result = profiling_enable(pid, event_mask, move(stream));
+    if (result.is_error()) {
+        m_fds.with_exclusive([fd](auto& fds) { fds[fd] = {}; });
+        return result.release_error();
+    }
+    return fd;
+}
+
 ErrorOr<FlatPtr> Process::sys$profiling_disable(pid_t pid)
 {
     VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
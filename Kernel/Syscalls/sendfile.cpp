@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Checked.h>
+#include <AK/NumericLimits.h>
+#include <Kernel/Debug.h>
+#include <Kernel/FileSystem/Inode.h>
+#include <Kernel/FileSystem/OpenFileDescription.h>
+#include <Kernel/Library/KBuffer.h>
+#include <Kernel/Memory/AnonymousVMObject.h>
+#include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Tasks/Process.h>
+
+namespace Kernel {
+
+// Files with a page cache are sent straight out of the cached pages, which get mapped into the kernel this
+// many at a time. Anything else travels through a kernel bounce buffer of the same size instead, so that
+// it never has to round-trip through userspace.
+static constexpr size_t sendfile_chunk_size = 256 * KiB;
+static constexpr size_t sendfile_chunk_page_count = sendfile_chunk_size / PAGE_SIZE;
+
+// Maps the cached pages holding the given range of the file into the kernel, cutting `length` short to
+// what they hold if the range goes past the end of the file. Returns nullptr if there's nothing left to send.
+static ErrorOr<OwnPtr<Memory::Region>> map_cached_pages(Inode& inode, u64 offset, size_t& length)
+{
+    auto file_size = inode.size();
+    if (offset >= file_size)
+        return nullptr;
+    length = min(static_cast<u64>(length), file_size - offset);
+
+    // The pages are brought in one by one, so let the file system read ahead for all of them at once.
+    (void)inode.read_ahead(offset, length);
+
+    Vector<NonnullRefPtr<Memory::PhysicalPage>, sendfile_chunk_page_count> pages;
+    u64 end_page_index = ceil_div(offset + length, static_cast<u64>(PAGE_SIZE));
+    for (u64 page_index = offset / PAGE_SIZE; page_index < end_page_index; ++page_index) {
+        auto page = TRY(inode.cached_page_for_mapping(page_index));
+        // The file may have been truncated in the meantime.
+        if (!page)
+            break;
+        TRY(pages.try_append(page.release_nonnull()));
+    }
+    if (pages.is_empty())
+        return nullptr;
+    length = min(static_cast<u64>(length), (offset / PAGE_SIZE + pages.size()) * PAGE_SIZE - offset);
+
+    auto vmobject = TRY(Memory::AnonymousVMObject::try_create_with_physical_pages(pages.span()));
+    return TRY(MM.allocate_kernel_region_with_vmobject(*vmobject, pages.size() * PAGE_SIZE, "sendfile"sv, Memory::Region::Access::Read));
+}
+
+ErrorOr<FlatPtr> Process::sys$sendfile(int out_fd, int in_fd, Userspace<off_t*> user_offset, size_t count)
+{
+    VERIFY_PROCESS_BIG_LOCK_ACQUIRED(this);
+    TRY(require_promise(Pledge::stdio));
+    if (count == 0)
+        return 0;
+    if (count > NumericLimits<ssize_t>::max())
+        return EINVAL;
+
+    auto in_description = TRY(open_file_description(in_fd));
+    if (!in_description->is_readable())
+        return EBADF;
+    // NOTE: Like on other systems, we only send from regular files, which are served from the disk cache.
+    if (!in_description->inode() || !in_description->inode()->metadata().is_regular_file())
+        return EINVAL;
+
+    auto out_description = TRY(open_file_description(out_fd));
+    if (!out_description->is_writable())
+        return EBADF;
+
+    off_t start_offset;
+    if (user_offset) {
+        TRY(copy_from_user(&start_offset, user_offset));
+        if (start_offset < 0)
+            return EINVAL;
+    } else {
+        start_offset = in_description->offset();
+    }
+    // NOTE: This is what reading through in_description would fail with as well, just before sending anything.
+    if (Checked<off_t>::addition_would_overflow(start_offset, count))
+        return EOVERFLOW;
+
+    dbgln_if(IO_DEBUG, "sys$sendfile({}, {}, {}, {})", out_fd, in_fd, start_offset, count);
+
+    // NOTE: Both ways of getting at the data read at an explicit offset, and leave the file position alone until
+    //       everything has been sent. Only the permission to read in_description (checked above) is needed for either,
+    //       exactly as for pread(2).
+    auto& inode = *in_description->inode();
+    bool use_page_cache = inode.wants_page_cache() && !in_description->is_direct();
+    OwnPtr<KBuffer> bounce_buffer;
+    if (!use_page_cache)
+        bounce_buffer = TRY(KBuffer::try_create_with_size("sendfile"sv, min(count, sendfile_chunk_size)));
+
+    size_t total_sent = 0;
+    while (total_sent < count) {
+        u64 offset = start_offset + total_sent;
+        size_t chunk_length = min(count - total_sent, sendfile_chunk_size);
+        OwnPtr<Memory::Region> cached_pages_region;
+        Optional<UserOrKernelBuffer> chunk_buffer;
+        ErrorOr<size_t> nread_or_error = 0;
+        if (use_page_cache) {
+            // The chunk has to end on a page boundary, so that it fits into the pages we map.
+            chunk_length = min(chunk_length, sendfile_chunk_size - offset % PAGE_SIZE);
+            auto region_or_error = map_cached_pages(inode, offset, chunk_length);
+            if (region_or_error.is_error()) {
+                nread_or_error = region_or_error.release_error();
+            } else if (cached_pages_region = region_or_error.release_value(); cached_pages_region) {
+                chunk_buffer = UserOrKernelBuffer::for_kernel_buffer(cached_pages_region->vaddr().offset(offset % PAGE_SIZE).as_ptr());
+                nread_or_error = chunk_length;
+                // This is accounted for by InodeFile::read() otherwise.
+                Thread::current()->did_file_read(chunk_length);
+            }
+        } else {
+            chunk_buffer = UserOrKernelBuffer::for_kernel_buffer(bounce_buffer->data());
+            nread_or_error = in_description->read(*chunk_buffer, offset, chunk_length);
+        }
+        if (nread_or_error.is_error()) {
+            if (total_sent > 0)
+                break;
+            return nread_or_error.release_error();
+        }
+        auto nread = nread_or_error.release_value();
+        if (nread == 0)
+            break;
+
+        auto nwritten_or_error = do_write(*out_description, *chunk_buffer, nread);
+        if (nwritten_or_error.is_error()) {
+            if (total_sent > 0)
+                break;
+            return nwritten_or_error.release_error();
+        }
+        total_sent += nwritten_or_error.value();
+        // A short write means the destination can't take any more right now (e.g. a non-blocking socket).
+        if (nwritten_or_error.value() < nread)
+            break;
+    }
+
+    // NOTE: We only advance the file position by what was actually sent, not by what we read.
+    off_t end_offset = start_offset + total_sent;
+    if (user_offset)
+        TRY(copy_to_user(user_offset, &end_offset));
+    else
+        TRY(in_description->seek(end_offset, SEEK_SET));
+
+    return total_sent;
+}
+
+}
@@ -5,6 +5,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/Array.h>
 #include <AK/JsonArraySerializer.h>
 #include <AK/JsonObjectSerializer.h>
 #include <AK/ScopeGuard.h>
@@ -12,6 +13,7 @@
 #include <Kernel/Arch/SafeMem.h>
 #include <Kernel/Arch/SmapDisabler.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/PerformanceEventStream.h>
 #include <Kernel/Library/KBufferBuilder.h>
 #include <Kernel/Tasks/PerformanceEventBuffer.h>
 #include <Kernel/Tasks/Process.h>
@@ -24,6 +26,13 @@ PerformanceEventBuffer::PerformanceEventBuffer(NonnullOwnPtr<KBuffer> buffer)
 {
 }
 
+PerformanceEventBuffer::PerformanceEventBuffer(NonnullRefPtr<PerformanceEventStream> stream)
+    : m_stream(move(stream))
+{
+}
+
+PerformanceEventBuffer::~PerformanceEventBuffer() = default;
+
 NEVER_INLINE ErrorOr<void> PerformanceEventBuffer::append(int type, FlatPtr arg1, FlatPtr arg2, StringView arg3, Thread* current_thread, FilesystemEvent filesystem_event)
 {
     FlatPtr base_pointer = (FlatPtr)__builtin_frame_address(0);
@@ -76,7 +85,7 @@ ErrorOr<void> PerformanceEventBuffer::append_with_ip_and_bp(ProcessID pid, Threa
 ErrorOr<void> PerformanceEventBuffer::append_with_ip_and_bp(ProcessID pid, ThreadID tid,
     FlatPtr ip, FlatPtr bp, int type, u32 lost_samples, FlatPtr arg1, FlatPtr arg2, StringView arg3, FilesystemEvent filesystem_event)
 {
-    if (count() >= capacity())
+    if (!m_stream && count() >= capacity())
         return ENOBUFS;
 
     if ((g_profiling_event_mask & type) == 0)
@@ -93,6 +102,11 @@ ErrorOr<void> PerformanceEventBuffer::append_with_ip_and_bp(ProcessID pid, Threa
     if (enter_count > 0)
         return EINVAL;
 
+    if (m_stream) {
+        auto backtrace = raw_backtrace(bp, ip);
+        return append_to_stream(pid, tid, type, lost_samples, arg1, arg2, arg3, filesystem_event, backtrace.span());
+    }
+
     PerformanceEvent event;
     event.type = type;
     event.lost_samples = lost_samples;
@@ -178,6 +192,39 @@ ErrorOr<void> PerformanceEventBuffer::append_with_ip_and_bp(ProcessID pid, Threa
     return {};
 }
 
+ErrorOr<void> PerformanceEventBuffer::append_to_stream(ProcessID pid, ThreadID tid, int type, u32 lost_samples, FlatPtr arg1, FlatPtr arg2, StringView arg3, FilesystemEvent const& filesystem_event, ReadonlySpan<FlatPtr> stack)
+{
+    bool show_kernel_addresses = m_stream->show_kernel_addresses();
+    if (!show_kernel_addresses && (type == PERF_EVENT_KMALLOC || type == PERF_EVENT_KFREE))
+        return {};
+
+    // NOTE: Records carry the raw event arguments, rather than the per-type layout of
+    //       PerformanceEvent. Filesystem events are reduced to their duration and type, as the
+    //       string table their file names refer to isn't part of the stream.
+    PerformanceEventRecord record {};
+    record.type = type;
+    record.pid = pid.value();
+    record.tid = tid.value();
+    record.timestamp = TimeManagement::the().uptime_ms();
+    record.lost_samples = lost_samples;
+    record.arg1 = arg1;
+    record.arg2 = arg2;
+    if (type == PERF_EVENT_FILESYSTEM) {
+        record.arg1 = filesystem_event.durationNs;
+        record.arg2 = to_underlying(filesystem_event.type);
+    }
+
+    Array<FlatPtr, PerformanceEvent::max_stack_frame_count> sanitized_stack;
+    for (size_t i = 0; i < stack.size(); ++i) {
+        auto address = stack[i];
+        if (!show_kernel_addresses && !Memory::is_user_address(VirtualAddress { address }))
+            address = 0xdeadc0de;
+        sanitized_stack[i] = address;
+    }
+
+    return m_stream->append(record, sanitized_stack.span().trim(stack.size()), arg3);
+}
+
 PerformanceEvent& PerformanceEventBuffer::at(size_t index)
 {
     VERIFY(index < capacity());
@@ -373,6 +420,11 @@ OwnPtr<PerformanceEventBuffer> PerformanceEventBuffer::try_create_with_size(size
     return adopt_own_if_nonnull(new (nothrow) PerformanceEventBuffer(buffer_or_error.release_value()));
 }
 
+OwnPtr<PerformanceEventBuffer> PerformanceEventBuffer::try_create_for_stream(NonnullRefPtr<PerformanceEventStream> stream)
+{
+    return adopt_own_if_nonnull(new (nothrow) PerformanceEventBuffer(move(stream)));
+}
+
 ErrorOr<void> PerformanceEventBuffer::add_process(Process const& process, ProcessEventType event_type)
 {
     OwnPtr<KString> executable;
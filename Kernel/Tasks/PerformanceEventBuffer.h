@@ -13,6 +13,7 @@
 namespace Kernel {
 
 class KBufferBuilder;
+class PerformanceEventStream;
 struct RegisterState;
 
 struct [[gnu::packed]] MallocPerformanceEvent {
@@ -171,6 +172,12 @@ class PerformanceEventBuffer {
 public:
     static OwnPtr<PerformanceEventBuffer> try_create_with_size(size_t buffer_size);
 
+    // A streaming buffer doesn't keep any events itself, but appends them to the per-CPU rings
+    // of the given stream as they happen, for a profiler to pick up while it's still running.
+    static OwnPtr<PerformanceEventBuffer> try_create_for_stream(NonnullRefPtr<PerformanceEventStream>);
+
+    ~PerformanceEventBuffer();
+
     ErrorOr<void> append(int type, FlatPtr arg1, FlatPtr arg2, StringView arg3, Thread* current_thread = Thread::current(), FilesystemEvent filesystem_event = {});
     ErrorOr<void> append_with_ip_and_bp(ProcessID pid, ThreadID tid, FlatPtr eip, FlatPtr ebp,
         int type, u32 lost_samples, FlatPtr arg1, FlatPtr arg2, StringView arg3, FilesystemEvent filesystem_event = {});
@@ -182,7 +189,7 @@ public:
         m_count = 0;
     }
 
-    size_t capacity() const { return m_buffer->size() / sizeof(PerformanceEvent); }
+    size_t capacity() const { return m_buffer ? m_buffer->size() / sizeof(PerformanceEvent) : 0; }
     size_t count() const { return m_count; }
     PerformanceEvent const& at(size_t index) const
     {
@@ -195,8 +202,14 @@ public:
 
     ErrorOr<FlatPtr> register_string(NonnullOwnPtr<KString>);
 
+    bool is_streaming() const { return !m_stream.is_null(); }
+    PerformanceEventStream* stream() { return m_stream; }
+
 private:
     explicit PerformanceEventBuffer(NonnullOwnPtr<KBuffer>);
+    explicit PerformanceEventBuffer(NonnullRefPtr<PerformanceEventStream>);
+
+    ErrorOr<void> append_to_stream(ProcessID, ThreadID, int type, u32 lost_samples, FlatPtr arg1, FlatPtr arg2, StringView arg3, FilesystemEvent const&, ReadonlySpan<FlatPtr> stack);
 
     template<typename Serializer>
     ErrorOr<void> to_json_impl(Serializer&) const;
@@ -204,7 +217,8 @@ private:
     PerformanceEvent& at(size_t index);
 
     size_t m_count { 0 };
-    NonnullOwnPtr<KBuffer> m_buffer;
+    OwnPtr<KBuffer> m_buffer;
+    RefPtr<PerformanceEventStream> m_stream;
 
     SpinlockProtected<HashMap<NonnullOwnPtr<KString>, size_t>, LockRank::None> m_strings;
 };
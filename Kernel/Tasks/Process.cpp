@@ -818,9 +818,12 @@ void Process::finalize()
             }
         }
         if (m_perf_event_buffer) {
-            auto result = dump_perfcore();
-            if (result.is_error())
-                dmesgln("Failed to write perfcore for pid {}: {}", pid(), result.error());
+            // A streaming buffer has already handed all of its events to the profiler.
+            if (!m_perf_event_buffer->is_streaming()) {
+                auto result = dump_perfcore();
+                if (result.is_error())
+                    dmesgln("Failed to write perfcore for pid {}: {}", pid(), result.error());
+            }
             TimeManagement::the().disable_profile_timer();
         }
     }
@@ -1052,11 +1055,14 @@ void Process::tracer_trap(Thread& thread, RegisterState const& regs)
     thread.send_urgent_signal_to_self(SIGTRAP);
 }
 
-bool Process::create_perf_events_buffer_if_needed()
+bool Process::create_perf_events_buffer_if_needed(RefPtr<PerformanceEventStream> stream)
 {
-    if (m_perf_event_buffer)
+    if (m_perf_event_buffer && !stream)
         return true;
-    m_perf_event_buffer = PerformanceEventBuffer::try_create_with_size(4 * MiB);
+    if (stream)
+        m_perf_event_buffer = PerformanceEventBuffer::try_create_for_stream(stream.release_nonnull());
+    else
+        m_perf_event_buffer = PerformanceEventBuffer::try_create_with_size(4 * MiB);
     if (!m_perf_event_buffer)
         return false;
     return !m_perf_event_buffer->add_process(*this, ProcessEventType::Create).is_error();
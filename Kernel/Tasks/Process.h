@@ -361,6 +361,11 @@ public:
     ErrorOr<FlatPtr> sys$msync(Userspace<void*>, size_t, int flags);
     ErrorOr<FlatPtr> sys$purge(int mode);
     ErrorOr<FlatPtr> sys$poll(Userspace<Syscall::SC_poll_params const*>);
+    ErrorOr<FlatPtr> sys$epoll_create(int flags);
+    ErrorOr<FlatPtr> sys$epoll_ctl(int epoll_fd, int op, int fd, Userspace<epoll_event const*>);
+    ErrorOr<FlatPtr> sys$epoll_wait(Userspace<Syscall::SC_epoll_wait_params const*>);
+    ErrorOr<FlatPtr> sys$io_ring_setup(u32 entries, Userspace<io_ring_params*>, int flags);
+    ErrorOr<FlatPtr> sys$io_ring_enter(Userspace<Syscall::SC_io_ring_enter_params const*>);
     ErrorOr<FlatPtr> sys$get_dir_entries(int fd, Userspace<void*>, size_t);
     ErrorOr<FlatPtr> sys$getcwd(Userspace<char*>, size_t);
     ErrorOr<FlatPtr> sys$chdir(Userspace<char const*>, size_t);
@@ -376,6 +381,7 @@ public:
     ErrorOr<FlatPtr> sys$readlink(Userspace<Syscall::SC_readlink_params const*>);
     ErrorOr<FlatPtr> sys$fork(RegisterState&);
     ErrorOr<FlatPtr> sys$execve(Userspace<Syscall::SC_execve_params const*>);
+    ErrorOr<FlatPtr> sys$posix_spawn(Userspace<Syscall::SC_posix_spawn_params const*>);
     ErrorOr<FlatPtr> sys$dup2(int old_fd, int new_fd);
     ErrorOr<FlatPtr> sys$sigaction(int signum, Userspace<sigaction const*> act, Userspace<sigaction*> old_act);
     ErrorOr<FlatPtr> sys$sigaltstack(Userspace<stack_t const*> ss, Userspace<stack_t*> old_ss);
@@ -442,7 +448,8 @@ public:
     ErrorOr<FlatPtr> sys$getkeymap(Userspace<Syscall::SC_getkeymap_params const*>);
     ErrorOr<FlatPtr> sys$setkeymap(Userspace<Syscall::SC_setkeymap_params const*>);
     ErrorOr<FlatPtr> sys$profiling_enable(pid_t, u64);
-    ErrorOr<FlatPtr> profiling_enable(pid_t, u64 event_mask);
+    ErrorOr<FlatPtr> profiling_enable(pid_t, u64 event_mask, RefPtr<PerformanceEventStream> = {});
+    ErrorOr<FlatPtr> sys$profiling_stream(pid_t, u64);
     ErrorOr<FlatPtr> sys$profiling_disable(pid_t);
     ErrorOr<FlatPtr> sys$profiling_free_buffer(pid_t);
     ErrorOr<FlatPtr> sys$futex(Userspace<Syscall::SC_futex_params const*>);
@@ -453,6 +460,7 @@ public:
     ErrorOr<FlatPtr> sys$get_stack_bounds(Userspace<FlatPtr*> stack_base, Userspace<size_t*> stack_size);
     ErrorOr<FlatPtr> sys$ptrace(Userspace<Syscall::SC_ptrace_params const*>);
     ErrorOr<FlatPtr> sys$sendfd(int sockfd, int fd);
+    ErrorOr<FlatPtr> sys$sendfile(int out_fd, int in_fd, Userspace<off_t*> offset, size_t count);
     ErrorOr<FlatPtr> sys$recvfd(int sockfd, int options);
     ErrorOr<FlatPtr> sys$sysconf(int name);
     ErrorOr<FlatPtr> sys$disown(ProcessID);
@@ -655,13 +663,22 @@ private:
     static ErrorOr<ProcessAndFirstThread> create_with_forked_name(UserID, GroupID, ProcessID ppid, bool is_kernel_process, RefPtr<Custody> current_directory = nullptr, RefPtr<Custody> executable = nullptr, RefPtr<TTY> = nullptr, Process* fork_parent = nullptr);
     static ErrorOr<ProcessAndFirstThread> create(StringView name, UserID, GroupID, ProcessID ppid, bool is_kernel_process, RefPtr<Custody> current_directory = nullptr, RefPtr<Custody> executable = nullptr, RefPtr<TTY> = nullptr, Process* fork_parent = nullptr);
     ErrorOr<NonnullRefPtr<Thread>> attach_resources(NonnullOwnPtr<Memory::AddressSpace>&&, Process* fork_parent);
+
+    // Creates the child for fork() and posix_spawn(): a copy of this process with an empty address space, whose only
+    // thread is a clone of the calling thread. The caller has to either start it, or abandon it if anything goes wrong.
+    ErrorOr<ProcessAndFirstThread> create_forked_child();
+    void abandon_forked_child(ProcessAndFirstThread&);
+    void start_forked_child(ProcessAndFirstThread&);
+
+    static ErrorOr<void> copy_string_list_from_user(Syscall::StringListArgument const&, Vector<NonnullOwnPtr<KString>>&);
+    ErrorOr<void> apply_spawn_file_action(Syscall::SpawnFileAction const&);
     static ProcessID allocate_pid();
 
     void kill_threads_except_self();
     void kill_all_threads();
     ErrorOr<void> dump_core();
     ErrorOr<void> dump_perfcore();
-    bool create_perf_events_buffer_if_needed();
+    bool create_perf_events_buffer_if_needed(RefPtr<PerformanceEventStream> = {});
     void delete_perf_events_buffer();
 
     ErrorOr<void> do_exec(NonnullRefPtr<OpenFileDescription> main_program_description, Vector<NonnullOwnPtr<KString>> arguments, Vector<NonnullOwnPtr<KString>> environment, RefPtr<OpenFileDescription> interpreter_description, Thread*& new_main_thread, InterruptsState& previous_interrupts_state, Elf_Ehdr const& main_program_header, Optional<size_t> minimum_stack_size = {});
@@ -5,6 +5,7 @@
  */
 
 #include <AK/BuiltinWrappers.h>
+#include <AK/Optional.h>
 #include <AK/ScopeGuard.h>
 #include <AK/Singleton.h>
 #include <AK/Time.h>
@@ -44,9 +45,28 @@ struct ThreadReadyQueues {
     u32 mask {};
     static constexpr size_t count = sizeof(mask) * 8;
     Array<ThreadReadyQueue, count> queues;
+
+    Thread* find_runnable_thread(u32 affinity_mask);
+    void remove(Thread&);
+    void append(Thread&, u32 priority, u32 cpu);
+};
+
+// Every processor owns its own set of priority buckets. Threads are queued on
+// the processor they last ran on (if their affinity allows it), and an idle
+// processor steals work from the busiest queue it is allowed to run threads from.
+struct ProcessorReadyQueues {
+    SpinlockProtected<ThreadReadyQueues, LockRank::None> ready_queues {};
+    Atomic<size_t> depth { 0 };
+    Atomic<u64> steal_count { 0 };
+    Atomic<u64> balance_count { 0 };
+    u32 ticks_until_balance { 0 };
 };
 
-static Singleton<SpinlockProtected<ThreadReadyQueues, LockRank::None>> g_ready_queues;
+static Singleton<Array<ProcessorReadyQueues, MAX_CPU_COUNT>> s_processor_ready_queues;
+
+// Number of timer ticks between two attempts of a processor to even out its
+// ready queue with the busiest other processor.
+static constexpr u32 load_balance_interval_ticks = 25;
 
 static SpinlockProtected<TotalTimeScheduled, LockRank::None> g_total_time_scheduled {};
 
@@ -55,7 +75,7 @@ static void dump_thread_list(bool = false);
 static inline u32 thread_priority_to_priority_index(u32 thread_priority)
 {
     // Converts the priority in the range of THREAD_PRIORITY_MIN...THREAD_PRIORITY_MAX
-    // to a index into g_ready_queues where 0 is the highest priority bucket
+    // to a index into ThreadReadyQueues::queues where 0 is the highest priority bucket
     VERIFY(thread_priority >= THREAD_PRIORITY_MIN && thread_priority <= THREAD_PRIORITY_MAX);
     constexpr u32 thread_priority_count = THREAD_PRIORITY_MAX - THREAD_PRIORITY_MIN + 1;
     static_assert(thread_priority_count > 0);
@@ -64,73 +84,183 @@ static inline u32 thread_priority_to_priority_index(u32 thread_priority)
     return priority_bucket;
 }
 
-Thread& Scheduler::pull_next_runnable_thread()
+static inline u32 ready_queue_processor_count()
 {
-    auto affinity_mask = 1u << Processor::current_id();
-
-    return g_ready_queues->with([&](auto& ready_queues) -> Thread& {
-        auto priority_mask = ready_queues.mask;
-        while (priority_mask != 0) {
-            auto priority = bit_scan_forward(priority_mask);
-            VERIFY(priority > 0);
-            auto& ready_queue = ready_queues.queues[--priority];
-            for (auto& thread : ready_queue.thread_list) {
-                VERIFY(thread.m_runnable_priority == (int)priority);
-                if (thread.is_active())
-                    continue;
-                if (!(thread.affinity() & affinity_mask))
-                    continue;
-                thread.m_runnable_priority = -1;
-                ready_queue.thread_list.remove(thread);
-                if (ready_queue.thread_list.is_empty())
-                    ready_queues.mask &= ~(1u << priority);
-                // Mark it as active because we are using this thread. This is similar
-                // to comparing it with Processor::current_thread, but when there are
-                // multiple processors there's no easy way to check whether the thread
-                // is actually still needed. This prevents accidental finalization when
-                // a thread is no longer in Running state, but running on another core.
-
-                // We need to mark it active here so that this thread won't be
-                // scheduled on another core if it were to be queued before actually
-                // switching to it.
-                // FIXME: Figure out a better way maybe?
-                thread.set_active(true);
-                return thread;
-            }
-            priority_mask &= ~(1u << priority);
+    return clamp<u32>(Processor::count(), 1, MAX_CPU_COUNT);
+}
+
+static inline ProcessorReadyQueues& ready_queues_for(u32 cpu)
+{
+    VERIFY(cpu < MAX_CPU_COUNT);
+    return (*s_processor_ready_queues)[cpu];
+}
+
+Thread* ThreadReadyQueues::find_runnable_thread(u32 affinity_mask)
+{
+    auto priority_mask = mask;
+    while (priority_mask != 0) {
+        auto priority = bit_scan_forward(priority_mask);
+        VERIFY(priority > 0);
+        auto& ready_queue = queues[--priority];
+        for (auto& thread : ready_queue.thread_list) {
+            VERIFY(thread.m_runnable_priority == (int)priority);
+            if (thread.is_active())
+                continue;
+            if (!(thread.affinity() & affinity_mask))
+                continue;
+            return &thread;
         }
+        priority_mask &= ~(1u << priority);
+    }
+    return nullptr;
+}
+
+void ThreadReadyQueues::remove(Thread& thread)
+{
+    auto priority = thread.m_runnable_priority;
+    VERIFY(priority >= 0);
+    VERIFY(mask & (1u << priority));
+    auto& ready_queue = queues[priority];
+    thread.m_runnable_priority = -1;
+    ready_queue.thread_list.remove(thread);
+    if (ready_queue.thread_list.is_empty())
+        mask &= ~(1u << priority);
+}
 
-        auto* idle_thread = Processor::idle_thread();
-        idle_thread->set_active(true);
-        return *idle_thread;
+void ThreadReadyQueues::append(Thread& thread, u32 priority, u32 cpu)
+{
+    VERIFY(thread.m_runnable_priority < 0);
+    VERIFY(!thread.m_ready_queue_node.is_in_list());
+    thread.m_runnable_priority = (int)priority;
+    thread.m_ready_queue_cpu = cpu;
+    auto& ready_queue = queues[priority];
+    bool was_empty = ready_queue.thread_list.is_empty();
+    ready_queue.thread_list.append(thread);
+    if (was_empty)
+        mask |= (1u << priority);
+}
+
+static Thread* take_runnable_thread(ProcessorReadyQueues& processor_queues, u32 affinity_mask)
+{
+    return processor_queues.ready_queues.with([&](auto& ready_queues) -> Thread* {
+        auto* thread = ready_queues.find_runnable_thread(affinity_mask);
+        if (!thread)
+            return nullptr;
+        ready_queues.remove(*thread);
+        processor_queues.depth.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+        return thread;
     });
 }
 
-Thread* Scheduler::peek_next_runnable_thread()
+static void append_runnable_thread(ProcessorReadyQueues& processor_queues, Thread& thread, u32 cpu)
+{
+    auto priority = thread_priority_to_priority_index(thread.priority());
+    processor_queues.ready_queues.with([&](auto& ready_queues) {
+        ready_queues.append(thread, priority, cpu);
+    });
+    processor_queues.depth.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+}
+
+static Optional<u32> find_busiest_processor_except(u32 cpu, size_t minimum_depth)
+{
+    Optional<u32> busiest;
+    size_t busiest_depth = 0;
+    auto processor_count = ready_queue_processor_count();
+    for (u32 other_cpu = 0; other_cpu < processor_count; other_cpu++) {
+        if (other_cpu == cpu)
+            continue;
+        auto depth = ready_queues_for(other_cpu).depth.load(AK::MemoryOrder::memory_order_relaxed);
+        if (depth < minimum_depth || depth <= busiest_depth)
+            continue;
+        busiest = other_cpu;
+        busiest_depth = depth;
+    }
+    return busiest;
+}
+
+static u32 select_processor_for(Thread const& thread)
+{
+    auto affinity = thread.affinity();
+    auto processor_count = ready_queue_processor_count();
+
+    // Prefer the processor the thread last ran on to keep its caches warm,
+    // unless that processor is noticeably busier than the least loaded one.
+    Optional<u32> least_loaded;
+    size_t least_loaded_depth = NumericLimits<size_t>::max();
+    for (u32 cpu = 0; cpu < processor_count; cpu++) {
+        if (!(affinity & (1u << cpu)))
+            continue;
+        auto depth = ready_queues_for(cpu).depth.load(AK::MemoryOrder::memory_order_relaxed);
+        if (depth < least_loaded_depth) {
+            least_loaded = cpu;
+            least_loaded_depth = depth;
+        }
+    }
+
+    auto last_cpu = thread.cpu();
+    if (last_cpu < processor_count && (affinity & (1u << last_cpu))) {
+        auto last_cpu_depth = ready_queues_for(last_cpu).depth.load(AK::MemoryOrder::memory_order_relaxed);
+        if (!least_loaded.has_value() || last_cpu_depth <= least_loaded_depth + 1)
+            return last_cpu;
+    }
+
+    if (least_loaded.has_value())
+        return least_loaded.value();
+
+    // The affinity mask doesn't contain any processor that is up (yet), so
+    // queue the thread on the first processor it is allowed to run on.
+    VERIFY(affinity != 0);
+    auto first_allowed_cpu = bit_scan_forward(affinity) - 1;
+    VERIFY(first_allowed_cpu < (int)MAX_CPU_COUNT);
+    return first_allowed_cpu;
+}
+
+Thread& Scheduler::pull_next_runnable_thread()
 {
-    auto affinity_mask = 1u << Processor::current_id();
-
-    return g_ready_queues->with([&](auto& ready_queues) -> Thread* {
-        auto priority_mask = ready_queues.mask;
-        while (priority_mask != 0) {
-            auto priority = bit_scan_forward(priority_mask);
-            VERIFY(priority > 0);
-            auto& ready_queue = ready_queues.queues[--priority];
-            for (auto& thread : ready_queue.thread_list) {
-                VERIFY(thread.m_runnable_priority == (int)priority);
-                if (thread.is_active())
-                    continue;
-                if (!(thread.affinity() & affinity_mask))
-                    continue;
-                return &thread;
+    auto current_cpu = Processor::current_id();
+    auto affinity_mask = 1u << current_cpu;
+    auto& processor_queues = ready_queues_for(current_cpu);
+
+    auto* thread = take_runnable_thread(processor_queues, affinity_mask);
+    if (!thread) {
+        // Nothing to do locally, so try to take some work off the busiest processor
+        // instead of going idle.
+        if (auto victim_cpu = find_busiest_processor_except(current_cpu, 1); victim_cpu.has_value()) {
+            thread = take_runnable_thread(ready_queues_for(victim_cpu.value()), affinity_mask);
+            if (thread) {
+                processor_queues.steal_count.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+                dbgln_if(SCHEDULER_DEBUG, "Scheduler[{}]: Stole {} from processor {}", current_cpu, *thread, victim_cpu.value());
             }
-            priority_mask &= ~(1u << priority);
         }
+    }
 
-        // Unlike in pull_next_runnable_thread() we don't want to fall back to
-        // the idle thread. We just want to see if we have any other thread ready
-        // to be scheduled.
-        return nullptr;
+    if (!thread)
+        thread = Processor::idle_thread();
+
+    // Mark it as active because we are using this thread. This is similar
+    // to comparing it with Processor::current_thread, but when there are
+    // multiple processors there's no easy way to check whether the thread
+    // is actually still needed. This prevents accidental finalization when
+    // a thread is no longer in Running state, but running on another core.
+
+    // We need to mark it active here so that this thread won't be
+    // scheduled on another core if it were to be queued before actually
+    // switching to it.
+    // FIXME: Figure out a better way maybe?
+    thread->set_active(true);
+    return *thread;
+}
+
+Thread* Scheduler::peek_next_runnable_thread()
+{
+    auto current_cpu = Processor::current_id();
+    auto affinity_mask = 1u << current_cpu;
+
+    // Unlike in pull_next_runnable_thread() we neither want to fall back to
+    // the idle thread nor steal work from other processors. We just want to
+    // see if we have any other thread ready to be scheduled on this processor.
+    return ready_queues_for(current_cpu).ready_queues.with([&](auto& ready_queues) -> Thread* {
+        return ready_queues.find_runnable_thread(affinity_mask);
     });
 }
 
@@ -139,24 +269,20 @@ bool Scheduler::dequeue_runnable_thread(Thread& thread, bool check_affinity)
     if (thread.is_idle_thread())
         return true;
 
-    return g_ready_queues->with([&](auto& ready_queues) {
-        auto priority = thread.m_runnable_priority;
-        if (priority < 0) {
-            VERIFY(!thread.m_ready_queue_node.is_in_list());
-            return false;
-        }
+    if (thread.m_runnable_priority < 0) {
+        VERIFY(!thread.m_ready_queue_node.is_in_list());
+        return false;
+    }
 
-        if (check_affinity && !(thread.affinity() & (1 << Processor::current_id())))
-            return false;
+    if (check_affinity && !(thread.affinity() & (1 << Processor::current_id())))
+        return false;
 
-        VERIFY(ready_queues.mask & (1u << priority));
-        auto& ready_queue = ready_queues.queues[priority];
-        thread.m_runnable_priority = -1;
-        ready_queue.thread_list.remove(thread);
-        if (ready_queue.thread_list.is_empty())
-            ready_queues.mask &= ~(1u << priority);
-        return true;
+    auto& processor_queues = ready_queues_for(thread.m_ready_queue_cpu);
+    processor_queues.ready_queues.with([&](auto& ready_queues) {
+        ready_queues.remove(thread);
     });
+    processor_queues.depth.fetch_sub(1, AK::MemoryOrder::memory_order_relaxed);
+    return true;
 }
 
 void Scheduler::enqueue_runnable_thread(Thread& thread)
@@ -164,18 +290,51 @@ void Scheduler::enqueue_runnable_thread(Thread& thread)
     VERIFY(g_scheduler_lock.is_locked_by_current_processor());
     if (thread.is_idle_thread())
         return;
-    auto priority = thread_priority_to_priority_index(thread.priority());
 
-    g_ready_queues->with([&](auto& ready_queues) {
-        VERIFY(thread.m_runnable_priority < 0);
-        thread.m_runnable_priority = (int)priority;
-        VERIFY(!thread.m_ready_queue_node.is_in_list());
-        auto& ready_queue = ready_queues.queues[priority];
-        bool was_empty = ready_queue.thread_list.is_empty();
-        ready_queue.thread_list.append(thread);
-        if (was_empty)
-            ready_queues.mask |= (1u << priority);
-    });
+    auto cpu = select_processor_for(thread);
+    append_runnable_thread(ready_queues_for(cpu), thread, cpu);
+}
+
+void Scheduler::balance_ready_queues()
+{
+    VERIFY_INTERRUPTS_DISABLED();
+
+    auto current_cpu = Processor::current_id();
+    auto& processor_queues = ready_queues_for(current_cpu);
+    if (processor_queues.ticks_until_balance-- > 0)
+        return;
+    processor_queues.ticks_until_balance = load_balance_interval_ticks;
+
+    // Only bother migrating a thread if the busiest processor has at least
+    // two more threads waiting than we do, otherwise we'd just ping-pong it.
+    auto our_depth = processor_queues.depth.load(AK::MemoryOrder::memory_order_relaxed);
+    auto victim_cpu = find_busiest_processor_except(current_cpu, our_depth + 2);
+    if (!victim_cpu.has_value())
+        return;
+
+    SpinlockLocker scheduler_lock(g_scheduler_lock);
+    auto* thread = take_runnable_thread(ready_queues_for(victim_cpu.value()), 1u << current_cpu);
+    if (!thread)
+        return;
+    append_runnable_thread(processor_queues, *thread, current_cpu);
+    processor_queues.balance_count.fetch_add(1, AK::MemoryOrder::memory_order_relaxed);
+    dbgln_if(SCHEDULER_DEBUG, "Scheduler[{}]: Migrated {} from processor {}", current_cpu, *thread, victim_cpu.value());
+}
+
+ErrorOr<void> Scheduler::try_for_each_ready_queue_statistics(Function<ErrorOr<void>(ReadyQueueStatistics const&)> callback)
+{
+    auto processor_count = ready_queue_processor_count();
+    for (u32 cpu = 0; cpu < processor_count; cpu++) {
+        auto& processor_queues = ready_queues_for(cpu);
+        ReadyQueueStatistics statistics {
+            .processor = cpu,
+            .depth = processor_queues.depth.load(AK::MemoryOrder::memory_order_relaxed),
+            .steal_count = processor_queues.steal_count.load(AK::MemoryOrder::memory_order_relaxed),
+            .balance_count = processor_queues.balance_count.load(AK::MemoryOrder::memory_order_relaxed),
+        };
+        TRY(callback(statistics));
+    }
+    return {};
 }
 
 UNMAP_AFTER_INIT void Scheduler::start()
@@ -436,6 +595,8 @@ void Scheduler::timer_tick(RegisterState const& regs)
         return;
     }
 
+    balance_ready_queues();
+
     if (current_thread->tick())
         return;
 
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <AK/Assertions.h>
+#include <AK/Error.h>
 #include <AK/Function.h>
 #include <AK/IntrusiveList.h>
 #include <AK/Types.h>
@@ -29,6 +30,13 @@ struct TotalTimeScheduled {
     u64 total_kernel { 0 };
 };
 
+struct ReadyQueueStatistics {
+    u32 processor { 0 };
+    size_t depth { 0 };
+    u64 steal_count { 0 };
+    u64 balance_count { 0 };
+};
+
 class Scheduler {
 public:
     static void initialize();
@@ -51,6 +59,8 @@ public:
     static Thread* peek_next_runnable_thread();
     static bool dequeue_runnable_thread(Thread&, bool = false);
     static void enqueue_runnable_thread(Thread&);
+    static void balance_ready_queues();
+    static ErrorOr<void> try_for_each_ready_queue_statistics(Function<ErrorOr<void>(ReadyQueueStatistics const&)>);
     static void dump_scheduler_state(bool = false);
     static bool is_initialized();
     static TotalTimeScheduled get_total_time_scheduled();
@@ -5,6 +5,7 @@
  */
 
 #include <Kernel/FileSystem/VirtualFileSystem.h>
+#include <Kernel/Memory/MemoryManager.h>
 #include <Kernel/Sections.h>
 #include <Kernel/Tasks/Process.h>
 #include <Kernel/Tasks/SyncTask.h>
@@ -18,6 +19,10 @@ UNMAP_AFTER_INIT void SyncTask::spawn()
         dbgln("VFS SyncTask is running");
         while (!Process::current().is_dying()) {
             VirtualFileSystem::sync();
+            // NOTE: The physical page allocator can't reclaim cache memory itself, as it runs
+            //       with a spinlock held, so we check for memory pressure here instead.
+            if (MM.has_memory_pressure())
+                VirtualFileSystem::the().release_filesystem_cache_memory();
             (void)Thread::current()->sleep(Duration::from_seconds(1));
         }
         Process::current().sys$exit(0);
@@ -18,6 +18,7 @@ set(CFF_DEBUG ON)
 set(CMAKE_DEBUG ON)
 set(COMMIT_DEBUG ON)
 set(COMPOSE_DEBUG ON)
+set(COMPOSE_TIMING_DEBUG ON)
 set(CONTEXT_SWITCH_DEBUG ON)
 set(COPY_DEBUG ON)
 set(CPP_DEBUG ON)
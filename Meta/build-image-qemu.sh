@@ -173,6 +173,15 @@ cleanup() {
 }
 trap cleanup EXIT
 
+# A small, empty file system with extents enabled, which the kernel tests mount as scratch space (see Tests/Kernel/TestExt2FS.cpp).
+if [ "$(uname -s)" != "OpenBSD" ] && [ ! -f _extents_test_disk_image ]; then
+    printf "creating extents test disk image... "
+    qemu-img create -q -f raw _extents_test_disk_image 16M || die "could not create extents test disk image"
+    chown "$SUDO_UID":"$SUDO_GID" _extents_test_disk_image || die "could not adjust permissions on extents test disk image"
+    "${MKE2FS_PATH}" -q -t ext2 -O extent -b 1024 -I "${INODE_SIZE}" -L serenity-extents _extents_test_disk_image || die "could not create extents test filesystem"
+    echo "done"
+fi
+
 script_path=$(cd -P -- "$(dirname -- "$0")" && pwd -P)
 "$script_path/build-root-filesystem.sh"
 
@@ -252,10 +252,19 @@ else
     SERENITY_BOOT_DRIVE="-drive file=${SERENITY_DISK_IMAGE},format=raw,index=0,media=disk,id=disk"
 fi
 
+# Scratch disk for the kernel tests, created by build-image-qemu.sh.
+if [ "$SERENITY_ARCH" != 'aarch64' ] && [ -f _extents_test_disk_image ]; then
+    SERENITY_TEST_DRIVE="-drive file=_extents_test_disk_image,format=raw,if=none,id=extents-test-disk -device ide-hd,drive=extents-test-disk"
+fi
+
 if [ -n "${SERENITY_USE_SDCARD}" ] && [ "${SERENITY_USE_SDCARD}" -eq 1 ]; then
     SERENITY_BOOT_DRIVE="-device sdhci-pci -device sd-card,drive=sd-boot-drive -drive id=sd-boot-drive,if=none,format=raw,file=${SERENITY_DISK_IMAGE}"
     SERENITY_KERNEL_CMDLINE="$SERENITY_KERNEL_CMDLINE root=sd2:0:0"
 fi
+if [ -n "${SERENITY_USE_VIRTIO_BLK}" ] && [ "${SERENITY_USE_VIRTIO_BLK}" -eq 1 ]; then
+    SERENITY_BOOT_DRIVE="-drive file=${SERENITY_DISK_IMAGE},format=raw,if=none,id=disk -device virtio-blk-pci,drive=disk,num-queues=$SERENITY_CPUS"
+    SERENITY_KERNEL_CMDLINE="$SERENITY_KERNEL_CMDLINE root=virtio0:0:0"
+fi
 if [ -n "${SERENITY_USE_USBDRIVE}" ] && [ "${SERENITY_USE_USBDRIVE}" -eq 1 ]; then
     SERENITY_BOOT_DRIVE="-device usb-storage,drive=usbstick -drive if=none,id=usbstick,format=raw,file=${SERENITY_DISK_IMAGE}"
     # FIXME: Find a better way to address the usb drive
@@ -534,6 +543,7 @@ elif [ "$SERENITY_RUN" = "ci" ]; then
             $SERENITY_EXTRA_QEMU_ARGS \
             $SERENITY_VIRT_TECH_ARG \
             $SERENITY_BOOT_DRIVE \
+            $SERENITY_TEST_DRIVE \
             -m $SERENITY_RAM_SIZE \
             -cpu $SERENITY_QEMU_CPU \
             -d guest_errors \
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <LibTest/TestCase.h>
+
+#include <AK/Array.h>
+#include <AK/ScopeGuard.h>
+#include <AK/StringView.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr size_t transfer_size = 64 * MiB;
+
+static bool write_impairment_setting(StringView name, unsigned value)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/kernel/conf/%.*s", static_cast<int>(name.length()), name.characters_without_null_termination());
+    int fd = open(path, O_WRONLY);
+    if (fd < 0)
+        return false;
+    char buffer[16];
+    int length = snprintf(buffer, sizeof(buffer), "%u\n", value);
+    bool success = write(fd, buffer, length) == length;
+    close(fd);
+    return success;
+}
+
+static bool set_loopback_impairment(unsigned delay_in_milliseconds, unsigned loss_per_mille)
+{
+    return write_impairment_setting("loopback_delay_ms"sv, delay_in_milliseconds)
+        && write_impairment_setting("loopback_loss_per_mille"sv, loss_per_mille);
+}
+
+static void* receive_everything(void* argument)
+{
+    int fd = static_cast<int>(reinterpret_cast<uintptr_t>(argument));
+    static Array<u8, 256 * KiB> buffer;
+    size_t total_received = 0;
+    for (;;) {
+        ssize_t nread = read(fd, buffer.data(), buffer.size());
+        if (nread <= 0)
+            break;
+        total_received += nread;
+    }
+    return reinterpret_cast<void*>(total_received);
+}
+
+// Transfers a fixed amount of data over 127.0.0.1 with the given congestion control algorithm,
+// optionally with the loopback adapter delaying and dropping packets like a real network would.
+static void run_bulk_transfer(StringView algorithm, unsigned delay_in_milliseconds, unsigned loss_per_mille)
+{
+    if (delay_in_milliseconds || loss_per_mille) {
+        if (!set_loopback_impairment(delay_in_milliseconds, loss_per_mille)) {
+            warnln("Can't configure the loopback adapter (not root?), skipping");
+            return;
+        }
+    }
+    ScopeGuard reset_impairment = [&] {
+        if (delay_in_milliseconds || loss_per_mille)
+            set_loopback_impairment(0, 0);
+    };
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT(listen_fd >= 0);
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    EXPECT_EQ(bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    socklen_t address_size = sizeof(address);
+    EXPECT_EQ(getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address), &address_size), 0);
+    EXPECT_EQ(listen(listen_fd, 1), 0);
+
+    int client_fd = socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT(client_fd >= 0);
+    EXPECT_EQ(setsockopt(client_fd, IPPROTO_TCP, TCP_CONGESTION, algorithm.characters_without_null_termination(), algorithm.length()), 0);
+    EXPECT_EQ(connect(client_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    int server_fd = accept(listen_fd, nullptr, nullptr);
+    EXPECT(server_fd >= 0);
+    close(listen_fd);
+
+    pthread_t receiver;
+    EXPECT_EQ(pthread_create(&receiver, nullptr, receive_everything, reinterpret_cast<void*>(static_cast<uintptr_t>(server_fd))), 0);
+
+    static Array<u8, 64 * KiB> buffer;
+    buffer.fill(0x5a);
+    size_t total_sent = 0;
+    while (total_sent < transfer_size) {
+        ssize_t nwritten = write(client_fd, buffer.data(), min(buffer.size(), transfer_size - total_sent));
+        if (nwritten < 0) {
+            perror("write");
+            break;
+        }
+        total_sent += nwritten;
+    }
+    close(client_fd);
+
+    void* total_received = nullptr;
+    EXPECT_EQ(pthread_join(receiver, &total_received), 0);
+    close(server_fd);
+
+    EXPECT_EQ(total_sent, transfer_size);
+    EXPECT_EQ(reinterpret_cast<size_t>(total_received), transfer_size);
+}
+
+BENCHMARK_CASE(tcp_loopback_newreno)
+{
+    run_bulk_transfer("newreno"sv, 0, 0);
+}
+
+BENCHMARK_CASE(tcp_loopback_cubic)
+{
+    run_bulk_transfer("cubic"sv, 0, 0);
+}
+
+BENCHMARK_CASE(tcp_loopback_newreno_with_delay)
+{
+    run_bulk_transfer("newreno"sv, 20, 0);
+}
+
+BENCHMARK_CASE(tcp_loopback_cubic_with_delay)
+{
+    run_bulk_transfer("cubic"sv, 20, 0);
+}
+
+BENCHMARK_CASE(tcp_loopback_newreno_with_delay_and_loss)
+{
+    run_bulk_transfer("newreno"sv, 20, 5);
+}
+
+BENCHMARK_CASE(tcp_loopback_cubic_with_delay_and_loss)
+{
+    run_bulk_transfer("cubic"sv, 20, 5);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <LibTest/TestCase.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static void create_file(char const* path)
+{
+    int fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0644);
+    EXPECT(fd >= 0);
+    close(fd);
+}
+
+static bool exists(char const* path)
+{
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+TEST_CASE(negative_entries_are_invalidated_by_creation)
+{
+    // Look up the name a few times first, so that the failure is definitely cached.
+    for (int i = 0; i < 3; ++i) {
+        EXPECT(!exists("/tmp/dentry-cache-test-file"));
+        EXPECT_EQ(errno, ENOENT);
+    }
+
+    create_file("/tmp/dentry-cache-test-file");
+    EXPECT(exists("/tmp/dentry-cache-test-file"));
+
+    EXPECT_EQ(mkdir("/tmp/dentry-cache-test-directory", 0755), 0);
+    EXPECT(exists("/tmp/dentry-cache-test-directory"));
+
+    EXPECT_EQ(symlink("/tmp/dentry-cache-test-file", "/tmp/dentry-cache-test-symlink"), 0);
+    EXPECT(exists("/tmp/dentry-cache-test-symlink"));
+
+    unlink("/tmp/dentry-cache-test-symlink");
+    rmdir("/tmp/dentry-cache-test-directory");
+    unlink("/tmp/dentry-cache-test-file");
+}
+
+TEST_CASE(positive_entries_are_invalidated_by_removal)
+{
+    create_file("/tmp/dentry-cache-test-file");
+    EXPECT(exists("/tmp/dentry-cache-test-file"));
+    EXPECT_EQ(unlink("/tmp/dentry-cache-test-file"), 0);
+    EXPECT(!exists("/tmp/dentry-cache-test-file"));
+
+    EXPECT_EQ(mkdir("/tmp/dentry-cache-test-directory", 0755), 0);
+    create_file("/tmp/dentry-cache-test-directory/child");
+    EXPECT(exists("/tmp/dentry-cache-test-directory/child"));
+    EXPECT_EQ(unlink("/tmp/dentry-cache-test-directory/child"), 0);
+    EXPECT_EQ(rmdir("/tmp/dentry-cache-test-directory"), 0);
+    EXPECT(!exists("/tmp/dentry-cache-test-directory"));
+    EXPECT(!exists("/tmp/dentry-cache-test-directory/child"));
+
+    // A new directory with the same name must not see anything cached for the old one.
+    EXPECT_EQ(mkdir("/tmp/dentry-cache-test-directory", 0755), 0);
+    EXPECT(!exists("/tmp/dentry-cache-test-directory/child"));
+    EXPECT_EQ(rmdir("/tmp/dentry-cache-test-directory"), 0);
+}
+
+TEST_CASE(rename_updates_both_names)
+{
+    create_file("/tmp/dentry-cache-test-old");
+    EXPECT(exists("/tmp/dentry-cache-test-old"));
+    EXPECT(!exists("/tmp/dentry-cache-test-new"));
+
+    struct stat before;
+    EXPECT_EQ(stat("/tmp/dentry-cache-test-old", &before), 0);
+    EXPECT_EQ(rename("/tmp/dentry-cache-test-old", "/tmp/dentry-cache-test-new"), 0);
+
+    EXPECT(!exists("/tmp/dentry-cache-test-old"));
+    struct stat after;
+    EXPECT_EQ(stat("/tmp/dentry-cache-test-new", &after), 0);
+    EXPECT_EQ(before.st_ino, after.st_ino);
+
+    // Renaming over an existing file must make the name refer to the new inode.
+    create_file("/tmp/dentry-cache-test-old");
+    struct stat replacement;
+    EXPECT_EQ(stat("/tmp/dentry-cache-test-old", &replacement), 0);
+    EXPECT_EQ(rename("/tmp/dentry-cache-test-old", "/tmp/dentry-cache-test-new"), 0);
+    EXPECT_EQ(stat("/tmp/dentry-cache-test-new", &after), 0);
+    EXPECT_EQ(replacement.st_ino, after.st_ino);
+
+    unlink("/tmp/dentry-cache-test-new");
+}
+
+BENCHMARK_CASE(stat_deep_path)
+{
+    constexpr size_t iterations = 100'000;
+    char const* path = "/usr/share/man/man2/mkdir.md";
+    if (!exists(path)) {
+        warnln("{} doesn't exist, skipping", path);
+        return;
+    }
+
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < iterations; ++i) {
+        struct stat st;
+        EXPECT_EQ(stat(path, &st), 0);
+        EXPECT(!exists("/usr/share/man/man2/does-not-exist.md"));
+    }
+    timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    auto elapsed_ns = (end.tv_sec - start.tv_sec) * 1'000'000'000 + (end.tv_nsec - start.tv_nsec);
+    outln("stat() of an existing and a missing deep path: {} ns per iteration", elapsed_ns / iterations);
+}
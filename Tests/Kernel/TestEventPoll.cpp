@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <LibTest/TestCase.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+static void add_interest(int epoll_fd, int fd, u32 events)
+{
+    epoll_event event {};
+    event.events = events;
+    event.data.fd = fd;
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event), 0);
+}
+
+TEST_CASE(level_triggered)
+{
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    VERIFY(epoll_fd >= 0);
+    int pipe_fds[2];
+    VERIFY(pipe(pipe_fds) == 0);
+
+    add_interest(epoll_fd, pipe_fds[0], EPOLLIN);
+
+    epoll_event events[4];
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 0);
+
+    EXPECT_EQ(write(pipe_fds[1], "x", 1), 1);
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 1);
+    EXPECT_EQ(events[0].data.fd, pipe_fds[0]);
+    EXPECT(events[0].events & EPOLLIN);
+
+    // Nothing was read, so we should keep hearing about it.
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 1);
+
+    char c;
+    EXPECT_EQ(read(pipe_fds[0], &c, 1), 1);
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 0);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    close(epoll_fd);
+}
+
+TEST_CASE(edge_triggered)
+{
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    VERIFY(epoll_fd >= 0);
+    int pipe_fds[2];
+    VERIFY(pipe(pipe_fds) == 0);
+
+    add_interest(epoll_fd, pipe_fds[0], EPOLLIN | EPOLLET);
+
+    epoll_event events[4];
+    EXPECT_EQ(write(pipe_fds[1], "x", 1), 1);
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 1);
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 0);
+
+    EXPECT_EQ(write(pipe_fds[1], "y", 1), 1);
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 1);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    close(epoll_fd);
+}
+
+TEST_CASE(oneshot)
+{
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    VERIFY(epoll_fd >= 0);
+    int pipe_fds[2];
+    VERIFY(pipe(pipe_fds) == 0);
+
+    add_interest(epoll_fd, pipe_fds[0], EPOLLIN | EPOLLONESHOT);
+
+    epoll_event events[4];
+    EXPECT_EQ(write(pipe_fds[1], "x", 1), 1);
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 1);
+    EXPECT_EQ(write(pipe_fds[1], "y", 1), 1);
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 0);
+
+    // Re-arming it should report the pending data again.
+    epoll_event event {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = pipe_fds[0];
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, pipe_fds[0], &event), 0);
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 1);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    close(epoll_fd);
+}
+
+TEST_CASE(blocking_wait_and_timeout)
+{
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    VERIFY(epoll_fd >= 0);
+    int pipe_fds[2];
+    VERIFY(pipe(pipe_fds) == 0);
+
+    add_interest(epoll_fd, pipe_fds[0], EPOLLIN);
+
+    epoll_event events[4];
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 10), 0);
+
+    pid_t pid = fork();
+    VERIFY(pid >= 0);
+    if (pid == 0) {
+        usleep(10'000);
+        (void)write(pipe_fds[1], "x", 1);
+        _exit(0);
+    }
+
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, -1), 1);
+    EXPECT_EQ(events[0].data.fd, pipe_fds[0]);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    close(epoll_fd);
+}
+
+TEST_CASE(ctl_errors)
+{
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    VERIFY(epoll_fd >= 0);
+    int pipe_fds[2];
+    VERIFY(pipe(pipe_fds) == 0);
+
+    epoll_event event {};
+    event.events = EPOLLIN;
+
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, pipe_fds[0], &event), -1);
+    EXPECT_EQ(errno, ENOENT);
+
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pipe_fds[0], &event), 0);
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pipe_fds[0], &event), -1);
+    EXPECT_EQ(errno, EEXIST);
+
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, epoll_fd, &event), -1);
+    EXPECT_EQ(errno, EINVAL);
+
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pipe_fds[0], nullptr), 0);
+    EXPECT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pipe_fds[0], nullptr), -1);
+    EXPECT_EQ(errno, ENOENT);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    close(epoll_fd);
+}
+
+TEST_CASE(closing_the_last_fd_removes_the_interest)
+{
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    VERIFY(epoll_fd >= 0);
+    int pipe_fds[2];
+    VERIFY(pipe(pipe_fds) == 0);
+
+    add_interest(epoll_fd, pipe_fds[1], EPOLLOUT);
+
+    epoll_event events[4];
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 1);
+
+    close(pipe_fds[1]);
+    EXPECT_EQ(epoll_wait(epoll_fd, events, 4, 0), 0);
+
+    close(pipe_fds[0]);
+    close(epoll_fd);
+}
@@ -4,8 +4,14 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/DeprecatedString.h>
+#include <AK/Optional.h>
 #include <LibTest/TestCase.h>
+#include <dirent.h>
 #include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 TEST_CASE(test_uid_and_gid_high_bits_are_set)
@@ -29,3 +35,306 @@ TEST_CASE(test_uid_and_gid_high_bits_are_set)
     EXPECT_EQ(st.st_uid, 65536u);
     EXPECT_EQ(st.st_gid, 65536u);
 }
+
+TEST_CASE(test_shared_mappings_and_file_io_see_the_same_data)
+{
+    static constexpr auto TEST_FILE_PATH = "/home/anon/.ext2_page_cache_test";
+
+    auto fd = open(TEST_FILE_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    EXPECT(fd >= 0);
+    auto cleanup_guard = ScopeGuard([&] {
+        close(fd);
+        unlink(TEST_FILE_PATH);
+    });
+
+    char buffer[8192];
+    memset(buffer, 'a', sizeof(buffer));
+    EXPECT_EQ(write(fd, buffer, sizeof(buffer)), static_cast<ssize_t>(sizeof(buffer)));
+
+    auto* mapping = static_cast<char*>(mmap(nullptr, sizeof(buffer), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    EXPECT(mapping != MAP_FAILED);
+    EXPECT_EQ(mapping[4096], 'a');
+
+    // A write() shows up in the mapping right away, without having to remap anything.
+    EXPECT_EQ(pwrite(fd, "bcd", 3, 4096), 3);
+    EXPECT_EQ(memcmp(mapping + 4096, "bcd", 3), 0);
+
+    // ...and a store through the mapping is visible to read().
+    mapping[10] = 'z';
+    EXPECT_EQ(msync(mapping, sizeof(buffer), MS_SYNC), 0);
+    char c = 0;
+    EXPECT_EQ(pread(fd, &c, 1, 10), 1);
+    EXPECT_EQ(c, 'z');
+
+    EXPECT_EQ(munmap(mapping, sizeof(buffer)), 0);
+}
+
+TEST_CASE(test_truncated_data_reads_as_zeroes_after_growing_again)
+{
+    static constexpr auto TEST_FILE_PATH = "/home/anon/.ext2_truncate_test";
+
+    auto fd = open(TEST_FILE_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    EXPECT(fd >= 0);
+    auto cleanup_guard = ScopeGuard([&] {
+        close(fd);
+        unlink(TEST_FILE_PATH);
+    });
+
+    char buffer[6000];
+    memset(buffer, 'x', sizeof(buffer));
+    EXPECT_EQ(write(fd, buffer, sizeof(buffer)), static_cast<ssize_t>(sizeof(buffer)));
+    EXPECT_EQ(ftruncate(fd, 100), 0);
+    EXPECT_EQ(ftruncate(fd, sizeof(buffer)), 0);
+
+    EXPECT_EQ(pread(fd, buffer, sizeof(buffer), 0), static_cast<ssize_t>(sizeof(buffer)));
+    EXPECT_EQ(buffer[99], 'x');
+    for (size_t i = 100; i < sizeof(buffer); ++i) {
+        if (buffer[i] != 0) {
+            FAIL("Truncated data came back");
+            break;
+        }
+    }
+}
+
+TEST_CASE(test_large_directories_stay_consistent)
+{
+    static constexpr auto TEST_DIRECTORY_PATH = "/home/anon/.ext2_large_directory_test";
+    // Enough long names to need a few hundred blocks, which is well past what the root of a directory index holds.
+    static constexpr size_t file_count = 3000;
+
+    EXPECT_EQ(mkdir(TEST_DIRECTORY_PATH, 0755), 0);
+    auto path_for = [](StringView prefix, size_t i) {
+        return DeprecatedString::formatted("{}/{}-with-a-rather-long-name-{}", TEST_DIRECTORY_PATH, prefix, i);
+    };
+    auto cleanup_guard = ScopeGuard([&] {
+        for (size_t i = 0; i < file_count; ++i) {
+            unlink(path_for("file"sv, i).characters());
+            unlink(path_for("renamed"sv, i).characters());
+        }
+        rmdir(TEST_DIRECTORY_PATH);
+    });
+
+    for (size_t i = 0; i < file_count; ++i) {
+        auto fd = open(path_for("file"sv, i).characters(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+        EXPECT(fd >= 0);
+        close(fd);
+    }
+
+    struct stat st;
+    for (size_t i = 0; i < file_count; ++i)
+        EXPECT_EQ(stat(path_for("file"sv, i).characters(), &st), 0);
+    EXPECT_EQ(stat(path_for("missing"sv, 0).characters(), &st), -1);
+    EXPECT_EQ(open(path_for("file"sv, 0).characters(), O_CREAT | O_EXCL | O_WRONLY, 0644), -1);
+
+    for (size_t i = 0; i < file_count; i += 2)
+        EXPECT_EQ(unlink(path_for("file"sv, i).characters()), 0);
+    for (size_t i = 1; i < file_count; i += 4)
+        EXPECT_EQ(rename(path_for("file"sv, i).characters(), path_for("renamed"sv, i).characters()), 0);
+
+    for (size_t i = 0; i < file_count; ++i) {
+        bool should_exist = i % 2 == 1 && i % 4 != 1;
+        EXPECT_EQ(stat(path_for("file"sv, i).characters(), &st) == 0, should_exist);
+        EXPECT_EQ(stat(path_for("renamed"sv, i).characters(), &st) == 0, i % 4 == 1);
+    }
+
+    // Reading the directory must still see every entry exactly once.
+    auto* dir = opendir(TEST_DIRECTORY_PATH);
+    EXPECT(dir != nullptr);
+    size_t entry_count = 0;
+    while (auto* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+            ++entry_count;
+    }
+    closedir(dir);
+    EXPECT_EQ(entry_count, file_count / 2);
+}
+
+TEST_CASE(test_sequentially_written_file_reads_back_after_sync)
+{
+    static constexpr auto TEST_FILE_PATH = "/home/anon/.ext2_sequential_write_test";
+    // Big enough to need indirect blocks (or more than a handful of extents if allocation goes badly).
+    static constexpr size_t chunk_size = 3000;
+    static constexpr size_t chunk_count = 1000;
+
+    auto fd = open(TEST_FILE_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    EXPECT(fd >= 0);
+    auto cleanup_guard = ScopeGuard([&] {
+        close(fd);
+        unlink(TEST_FILE_PATH);
+    });
+
+    char buffer[chunk_size];
+    for (size_t i = 0; i < chunk_count; ++i) {
+        memset(buffer, 'a' + i % 26, sizeof(buffer));
+        EXPECT_EQ(write(fd, buffer, sizeof(buffer)), static_cast<ssize_t>(sizeof(buffer)));
+    }
+    EXPECT_EQ(fsync(fd), 0);
+
+    // Overwrite something in the middle, and leave a hole after the end.
+    memset(buffer, '!', 100);
+    EXPECT_EQ(pwrite(fd, buffer, 100, 12345), 100);
+    EXPECT_EQ(pwrite(fd, buffer, 1, chunk_size * chunk_count + 100000), 1);
+    EXPECT_EQ(fsync(fd), 0);
+
+    struct stat st;
+    EXPECT_EQ(fstat(fd, &st), 0);
+    EXPECT_EQ(st.st_size, static_cast<off_t>(chunk_size * chunk_count + 100001));
+    // The hole doesn't take up any space.
+    EXPECT(st.st_blocks * 512 < st.st_size);
+
+    for (size_t i = 0; i < chunk_count; ++i) {
+        EXPECT_EQ(pread(fd, buffer, sizeof(buffer), i * chunk_size), static_cast<ssize_t>(sizeof(buffer)));
+        for (size_t j = 0; j < sizeof(buffer); ++j) {
+            auto position = i * chunk_size + j;
+            char expected = position >= 12345 && position < 12445 ? '!' : 'a' + i % 26;
+            if (buffer[j] != expected) {
+                FAIL(DeprecatedString::formatted("Unexpected data at offset {}", position));
+                return;
+            }
+        }
+    }
+
+    EXPECT_EQ(pread(fd, buffer, sizeof(buffer), chunk_size * chunk_count), static_cast<ssize_t>(sizeof(buffer)));
+    for (size_t j = 0; j < sizeof(buffer); ++j) {
+        if (buffer[j] != 0) {
+            FAIL("Hole didn't read as zeroes");
+            break;
+        }
+    }
+}
+
+TEST_CASE(test_indirect_blocks_reach_the_disk_after_delayed_allocation)
+{
+    static constexpr auto TEST_FILE_PATH = "/home/anon/.ext2_indirect_block_test";
+    static constexpr auto RENAMED_TEST_FILE_PATH = "/home/anon/.ext2_indirect_block_test_renamed";
+    // Enough to need the doubly indirect block, even with 4 KiB blocks.
+    static constexpr size_t chunk_size = 4096;
+    static constexpr size_t chunk_count = 1536;
+
+    auto fd = open(TEST_FILE_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    EXPECT(fd >= 0);
+    auto cleanup_guard = ScopeGuard([&] {
+        unlink(TEST_FILE_PATH);
+        unlink(RENAMED_TEST_FILE_PATH);
+    });
+
+    char buffer[chunk_size];
+    for (size_t i = 0; i < chunk_count; ++i) {
+        memset(buffer, 1 + i % 251, sizeof(buffer));
+        EXPECT_EQ(write(fd, buffer, sizeof(buffer)), static_cast<ssize_t>(sizeof(buffer)));
+    }
+    EXPECT_EQ(fsync(fd), 0);
+    EXPECT_EQ(close(fd), 0);
+
+    // Renaming drops the cached path lookups, so that nothing keeps the inode alive and sync() evicts it.
+    // Opening it again then has to go through the block list that is on disk.
+    EXPECT_EQ(rename(TEST_FILE_PATH, RENAMED_TEST_FILE_PATH), 0);
+    sync();
+
+    fd = open(RENAMED_TEST_FILE_PATH, O_RDONLY);
+    EXPECT(fd >= 0);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        EXPECT_EQ(read(fd, buffer, sizeof(buffer)), static_cast<ssize_t>(sizeof(buffer)));
+        for (size_t j = 0; j < sizeof(buffer); ++j) {
+            if (buffer[j] != static_cast<char>(1 + i % 251)) {
+                FAIL(DeprecatedString::formatted("Unexpected data at offset {}", i * chunk_size + j));
+                close(fd);
+                return;
+            }
+        }
+    }
+    close(fd);
+}
+
+// Meta/build-image-qemu.sh creates a small scratch file system with extents enabled, which Meta/run.sh attaches as an
+// extra disk. The image that we boot from doesn't use extents, so this is the only way to get at them.
+static Optional<DeprecatedString> find_extents_test_device()
+{
+    for (char letter = 'a'; letter <= 'z'; ++letter) {
+        auto path = DeprecatedString::formatted("/dev/hd{}", letter);
+        auto fd = open(path.characters(), O_RDONLY);
+        if (fd < 0)
+            continue;
+        u8 super_block[1024];
+        auto nread = pread(fd, super_block, sizeof(super_block), 1024);
+        close(fd);
+        // s_magic is at offset 56, and s_volume_name at offset 120.
+        if (nread == sizeof(super_block) && super_block[56] == 0x53 && super_block[57] == 0xef && memcmp(super_block + 120, "serenity-extents", 16) == 0)
+            return path;
+    }
+    return {};
+}
+
+TEST_CASE(test_extent_mapped_file_reads_back_after_remount)
+{
+    static constexpr auto MOUNT_POINT = "/tmp/ext2_extents_test";
+    static constexpr auto TEST_FILE_PATH = "/tmp/ext2_extents_test/file";
+    // The scratch file system uses 1 KiB blocks. Writing every other block makes every one of them an extent of its
+    // own, and that's more than the inode and a single level of leaves can hold.
+    static constexpr size_t block_size = 1024;
+    static constexpr size_t written_block_count = 800;
+
+    auto device = find_extents_test_device();
+    if (!device.has_value()) {
+        warnln("Skipping, no scratch file system with extents is attached");
+        return;
+    }
+
+    auto mount_scratch_file_system = [&] {
+        auto fd = open(device->characters(), O_RDWR);
+        EXPECT(fd >= 0);
+        auto rc = mount(fd, MOUNT_POINT, "ext2", 0);
+        close(fd);
+        return rc;
+    };
+
+    EXPECT_EQ(mkdir(MOUNT_POINT, 0755), 0);
+    bool is_mounted = false;
+    auto cleanup_guard = ScopeGuard([&] {
+        if (is_mounted) {
+            unlink(TEST_FILE_PATH);
+            umount(MOUNT_POINT);
+        }
+        rmdir(MOUNT_POINT);
+    });
+
+    EXPECT_EQ(mount_scratch_file_system(), 0);
+    is_mounted = true;
+
+    auto fd = open(TEST_FILE_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    EXPECT(fd >= 0);
+    char buffer[block_size];
+    for (size_t i = 0; i < written_block_count; ++i) {
+        memset(buffer, 1 + i % 251, sizeof(buffer));
+        EXPECT_EQ(pwrite(fd, buffer, sizeof(buffer), 2 * i * block_size), static_cast<ssize_t>(sizeof(buffer)));
+    }
+    EXPECT_EQ(fsync(fd), 0);
+    EXPECT_EQ(close(fd), 0);
+
+    // Unmounting throws away everything that was cached, so the file has to come back from the extent tree on disk.
+    EXPECT_EQ(umount(MOUNT_POINT), 0);
+    is_mounted = false;
+    EXPECT_EQ(mount_scratch_file_system(), 0);
+    is_mounted = true;
+
+    fd = open(TEST_FILE_PATH, O_RDONLY);
+    EXPECT(fd >= 0);
+    struct stat st;
+    EXPECT_EQ(fstat(fd, &st), 0);
+    EXPECT_EQ(st.st_size, static_cast<off_t>((2 * written_block_count - 1) * block_size));
+    // The holes don't take up any space.
+    EXPECT(st.st_blocks * 512 < st.st_size);
+
+    for (size_t i = 0; i < 2 * written_block_count - 1; ++i) {
+        EXPECT_EQ(read(fd, buffer, sizeof(buffer)), static_cast<ssize_t>(sizeof(buffer)));
+        char expected = i % 2 == 0 ? static_cast<char>(1 + (i / 2) % 251) : 0;
+        for (size_t j = 0; j < sizeof(buffer); ++j) {
+            if (buffer[j] != expected) {
+                FAIL(DeprecatedString::formatted("Unexpected data at offset {}", i * block_size + j));
+                close(fd);
+                return;
+            }
+        }
+    }
+    close(fd);
+}
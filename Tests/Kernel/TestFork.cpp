@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <LibTest/TestCase.h>
+
+#include <AK/StringView.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static constexpr size_t heap_size = 1 * GiB;
+static constexpr size_t iterations = 32;
+
+// Maps an anonymous heap and touches every page of it, so that fork() has actual pages to deal with.
+static u8* make_touched_heap(size_t size)
+{
+    auto* heap = static_cast<u8*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0));
+    if (heap == MAP_FAILED)
+        return nullptr;
+    for (size_t offset = 0; offset < size; offset += PAGE_SIZE)
+        heap[offset] = static_cast<u8>(offset / PAGE_SIZE);
+    return heap;
+}
+
+static int wait_for_exit_status(pid_t pid)
+{
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid)
+        return -1;
+    if (!WIFEXITED(status))
+        return -1;
+    return WEXITSTATUS(status);
+}
+
+static u64 elapsed_microseconds(timespec const& start)
+{
+    timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1'000'000 + (end.tv_nsec - start.tv_nsec) / 1000;
+}
+
+TEST_CASE(child_sees_parent_memory_and_writes_stay_private)
+{
+    constexpr size_t size = 4 * MiB;
+    auto* heap = make_touched_heap(size);
+    EXPECT(heap != nullptr);
+
+    pid_t pid = fork();
+    EXPECT(pid >= 0);
+    if (pid == 0) {
+        for (size_t offset = 0; offset < size; offset += PAGE_SIZE) {
+            if (heap[offset] != static_cast<u8>(offset / PAGE_SIZE))
+                _exit(1);
+            heap[offset] = 0xff;
+        }
+        _exit(0);
+    }
+
+    EXPECT_EQ(wait_for_exit_status(pid), 0);
+    for (size_t offset = 0; offset < size; offset += PAGE_SIZE)
+        EXPECT_EQ(heap[offset], static_cast<u8>(offset / PAGE_SIZE));
+
+    // And the other way around: our writes after the fork must not show up in the child.
+    int pipe_fds[2];
+    EXPECT_EQ(pipe(pipe_fds), 0);
+    pid = fork();
+    EXPECT(pid >= 0);
+    if (pid == 0) {
+        char go;
+        (void)read(pipe_fds[0], &go, 1);
+        _exit(heap[0] == 0 ? 0 : 1);
+    }
+    heap[0] = 0x42;
+    EXPECT_EQ(write(pipe_fds[1], "x", 1), 1);
+    EXPECT_EQ(wait_for_exit_status(pid), 0);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    munmap(heap, size);
+}
+
+TEST_CASE(posix_spawn_file_actions)
+{
+    int pipe_fds[2];
+    EXPECT_EQ(pipe(pipe_fds), 0);
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_adddup2(&file_actions, pipe_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&file_actions, pipe_fds[0]);
+    posix_spawn_file_actions_addchdir(&file_actions, "/usr");
+
+    char const* argv[] = { "pwd", nullptr };
+    pid_t pid = -1;
+    EXPECT_EQ(posix_spawn(&pid, "/bin/pwd", &file_actions, nullptr, const_cast<char**>(argv), environ), 0);
+    posix_spawn_file_actions_destroy(&file_actions);
+    close(pipe_fds[1]);
+
+    char buffer[16] {};
+    EXPECT_EQ(read(pipe_fds[0], buffer, sizeof(buffer)), 5);
+    EXPECT_EQ(StringView(buffer, 5), "/usr\n"sv);
+    EXPECT_EQ(wait_for_exit_status(pid), 0);
+    close(pipe_fds[0]);
+
+    // Failures to exec are reported to the caller instead of showing up as an exit status of 127.
+    EXPECT_EQ(posix_spawn(&pid, "/this/does/not/exist", nullptr, nullptr, const_cast<char**>(argv), environ), ENOENT);
+}
+
+BENCHMARK_CASE(fork_with_1_gib_heap)
+{
+    auto* heap = make_touched_heap(heap_size);
+    if (!heap) {
+        warnln("Can't allocate a 1 GiB heap, skipping");
+        return;
+    }
+
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < iterations; ++i) {
+        pid_t pid = fork();
+        EXPECT(pid >= 0);
+        if (pid == 0)
+            _exit(0);
+        EXPECT_EQ(wait_for_exit_status(pid), 0);
+    }
+    outln("fork() + exit with a 1 GiB heap: {} us per iteration", elapsed_microseconds(start) / iterations);
+
+    munmap(heap, heap_size);
+}
+
+BENCHMARK_CASE(fork_with_1_gib_heap_and_child_writing_one_page)
+{
+    auto* heap = make_touched_heap(heap_size);
+    if (!heap) {
+        warnln("Can't allocate a 1 GiB heap, skipping");
+        return;
+    }
+
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < iterations; ++i) {
+        pid_t pid = fork();
+        EXPECT(pid >= 0);
+        if (pid == 0) {
+            heap[heap_size / 2] = 0xff;
+            _exit(0);
+        }
+        EXPECT_EQ(wait_for_exit_status(pid), 0);
+    }
+    outln("fork() + one write + exit with a 1 GiB heap: {} us per iteration", elapsed_microseconds(start) / iterations);
+
+    munmap(heap, heap_size);
+}
+
+BENCHMARK_CASE(fork_and_exec_vs_posix_spawn_with_1_gib_heap)
+{
+    auto* heap = make_touched_heap(heap_size);
+    if (!heap) {
+        warnln("Can't allocate a 1 GiB heap, skipping");
+        return;
+    }
+
+    char const* argv[] = { "true", nullptr };
+
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < iterations; ++i) {
+        pid_t pid = fork();
+        EXPECT(pid >= 0);
+        if (pid == 0) {
+            execve("/bin/true", const_cast<char**>(argv), environ);
+            _exit(127);
+        }
+        EXPECT_EQ(wait_for_exit_status(pid), 0);
+    }
+    outln("fork() + execve() with a 1 GiB heap: {} us per iteration", elapsed_microseconds(start) / iterations);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < iterations; ++i) {
+        pid_t pid = -1;
+        EXPECT_EQ(posix_spawn(&pid, "/bin/true", nullptr, nullptr, const_cast<char**>(argv), environ), 0);
+        EXPECT_EQ(wait_for_exit_status(pid), 0);
+    }
+    outln("posix_spawn() with a 1 GiB heap: {} us per iteration", elapsed_microseconds(start) / iterations);
+
+    munmap(heap, heap_size);
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/JsonArray.h>
+#include <AK/JsonObject.h>
+#include <AK/JsonValue.h>
+#include <LibCore/File.h>
+#include <LibTest/TestCase.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static constexpr size_t huge_page_size = 2 * MiB;
+
+static u8* map_huge(size_t size)
+{
+    auto* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGEPAGE, 0, 0);
+    if (ptr == MAP_FAILED)
+        return nullptr;
+    return static_cast<u8*>(ptr);
+}
+
+static void fill_pattern(u8* ptr, size_t size)
+{
+    for (size_t i = 0; i < size; i += PAGE_SIZE)
+        ptr[i] = static_cast<u8>(i / PAGE_SIZE);
+}
+
+static bool has_pattern(u8 const* ptr, size_t size, size_t offset = 0)
+{
+    for (size_t i = 0; i < size; i += PAGE_SIZE) {
+        if (ptr[i] != static_cast<u8>((offset + i) / PAGE_SIZE))
+            return false;
+    }
+    return true;
+}
+
+// Returns how many 2 MiB chunks of the region at `ptr` are mapped with huge pages, as reported by /proc/self/vm.
+static size_t huge_pages_of_region_at(void const* ptr)
+{
+    auto file = MUST(Core::File::open("/proc/self/vm"sv, Core::File::OpenMode::Read));
+    auto json = MUST(JsonValue::from_string(MUST(file->read_until_eof())));
+    for (auto const& value : json.as_array().values()) {
+        auto const& region = value.as_object();
+        if (region.get_addr("address"sv).value_or(0) == reinterpret_cast<FlatPtr>(ptr))
+            return region.get_u64("huge_pages"sv).value_or(0);
+    }
+    VERIFY_NOT_REACHED();
+}
+
+TEST_CASE(hugepage_mapping_is_aligned_and_zeroed)
+{
+    auto* ptr = map_huge(2 * huge_page_size);
+    VERIFY(ptr);
+    EXPECT_EQ(reinterpret_cast<FlatPtr>(ptr) % huge_page_size, 0u);
+
+    for (size_t i = 0; i < 2 * huge_page_size; i += 512)
+        EXPECT_EQ(ptr[i], 0);
+
+    fill_pattern(ptr, 2 * huge_page_size);
+    EXPECT(has_pattern(ptr, 2 * huge_page_size));
+    EXPECT_EQ(munmap(ptr, 2 * huge_page_size), 0);
+}
+
+TEST_CASE(hugepage_mapping_uses_huge_pages)
+{
+#if ARCH(X86_64)
+    auto* ptr = map_huge(2 * huge_page_size);
+    VERIFY(ptr);
+    EXPECT_EQ(huge_pages_of_region_at(ptr), 0u);
+
+    // Each 2 MiB chunk gets its huge page on the first write fault within it.
+    ptr[0] = 1;
+    EXPECT_EQ(huge_pages_of_region_at(ptr), 1u);
+    ptr[huge_page_size + PAGE_SIZE] = 1;
+    EXPECT_EQ(huge_pages_of_region_at(ptr), 2u);
+
+    EXPECT_EQ(munmap(ptr, 2 * huge_page_size), 0);
+#else
+    warnln("Skipping, huge pages are only supported on x86_64");
+#endif
+}
+
+TEST_CASE(hugepage_requires_anonymous_mapping)
+{
+    auto* ptr = mmap(nullptr, huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_HUGEPAGE, 0, 0);
+    EXPECT_EQ(ptr, MAP_FAILED);
+    EXPECT_EQ(errno, EINVAL);
+}
+
+TEST_CASE(hugepage_fork_is_copy_on_write)
+{
+    auto* ptr = map_huge(huge_page_size);
+    VERIFY(ptr);
+    fill_pattern(ptr, huge_page_size);
+
+    auto pid = fork();
+    VERIFY(pid >= 0);
+    if (pid == 0) {
+        if (!has_pattern(ptr, huge_page_size))
+            _exit(1);
+#if ARCH(X86_64)
+        // Reading doesn't break COW, so the child can keep using the same huge page as its parent.
+        if (huge_pages_of_region_at(ptr) != 1)
+            _exit(3);
+#endif
+        memset(ptr, 0xaa, huge_page_size);
+        _exit(ptr[huge_page_size - 1] == 0xaa ? 0 : 2);
+    }
+
+    int status = 0;
+    EXPECT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+
+    // The child's writes must not have leaked into our copy.
+    EXPECT(has_pattern(ptr, huge_page_size));
+#if ARCH(X86_64)
+    EXPECT_EQ(huge_pages_of_region_at(ptr), 1u);
+#endif
+    ptr[0] = 0x55;
+    EXPECT_EQ(ptr[0], 0x55);
+    EXPECT_EQ(munmap(ptr, huge_page_size), 0);
+}
+
+TEST_CASE(hugepage_partial_munmap)
+{
+    auto* ptr = map_huge(huge_page_size);
+    VERIFY(ptr);
+    fill_pattern(ptr, huge_page_size);
+
+    // Punch a hole into the middle of the huge page, the rest of it has to stay intact.
+    EXPECT_EQ(munmap(ptr + 16 * PAGE_SIZE, 4 * PAGE_SIZE), 0);
+    EXPECT(has_pattern(ptr, 16 * PAGE_SIZE));
+    EXPECT(has_pattern(ptr + 20 * PAGE_SIZE, huge_page_size - 20 * PAGE_SIZE, 20 * PAGE_SIZE));
+
+    EXPECT_EQ(munmap(ptr, 16 * PAGE_SIZE), 0);
+    EXPECT_EQ(munmap(ptr + 20 * PAGE_SIZE, huge_page_size - 20 * PAGE_SIZE), 0);
+}
+
+TEST_CASE(hugepage_partial_mprotect)
+{
+    auto* ptr = map_huge(huge_page_size);
+    VERIFY(ptr);
+    fill_pattern(ptr, huge_page_size);
+
+    EXPECT_EQ(mprotect(ptr + PAGE_SIZE, PAGE_SIZE, PROT_READ), 0);
+    EXPECT(has_pattern(ptr, huge_page_size));
+
+    // Everything but the read-only page is still writable.
+    ptr[0] = 0x12;
+    ptr[2 * PAGE_SIZE] = 0x34;
+    EXPECT_EQ(ptr[0], 0x12);
+    EXPECT_EQ(ptr[2 * PAGE_SIZE], 0x34);
+
+    EXPECT_EQ(mprotect(ptr + PAGE_SIZE, PAGE_SIZE, PROT_READ | PROT_WRITE), 0);
+    ptr[PAGE_SIZE] = 0x56;
+    EXPECT_EQ(ptr[PAGE_SIZE], 0x56);
+    EXPECT_EQ(munmap(ptr, huge_page_size), 0);
+}
+
+TEST_CASE(madvise_hugepage)
+{
+    size_t size = 2 * huge_page_size;
+    auto* ptr = static_cast<u8*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0));
+    VERIFY(ptr != MAP_FAILED);
+
+    EXPECT_EQ(madvise(ptr, size, MADV_HUGEPAGE), 0);
+    fill_pattern(ptr, size);
+    EXPECT(has_pattern(ptr, size));
+
+    EXPECT_EQ(madvise(ptr, size, MADV_NOHUGEPAGE), 0);
+    EXPECT_EQ(munmap(ptr, size), 0);
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <LibTest/TestCase.h>
+
+#include <AK/Atomic.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/io_ring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+class Ring {
+public:
+    explicit Ring(unsigned entries)
+    {
+        m_fd = io_ring_setup(entries, &m_params, IO_RING_CLOEXEC);
+        VERIFY(m_fd >= 0);
+        m_mapping = static_cast<u8*>(mmap(nullptr, m_params.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0));
+        VERIFY(m_mapping != MAP_FAILED);
+    }
+
+    ~Ring()
+    {
+        munmap(m_mapping, m_params.ring_size);
+        close(m_fd);
+    }
+
+    int fd() const { return m_fd; }
+    io_ring_params const& params() const { return m_params; }
+    io_ring_header& header() { return *reinterpret_cast<io_ring_header*>(m_mapping); }
+
+    void push(io_ring_submission const& submission)
+    {
+        auto* submissions = reinterpret_cast<io_ring_submission*>(m_mapping + m_params.sq_offset);
+        u32 tail = AK::atomic_load(&header().sq_tail, AK::MemoryOrder::memory_order_relaxed);
+        submissions[tail & (m_params.sq_entries - 1)] = submission;
+        AK::atomic_store(&header().sq_tail, tail + 1, AK::MemoryOrder::memory_order_release);
+    }
+
+    Optional<io_ring_completion> pop()
+    {
+        auto* completions = reinterpret_cast<io_ring_completion*>(m_mapping + m_params.cq_offset);
+        u32 head = AK::atomic_load(&header().cq_head, AK::MemoryOrder::memory_order_relaxed);
+        if (head == AK::atomic_load(&header().cq_tail, AK::MemoryOrder::memory_order_acquire))
+            return {};
+        auto completion = completions[head & (m_params.cq_entries - 1)];
+        AK::atomic_store(&header().cq_head, head + 1, AK::MemoryOrder::memory_order_release);
+        return completion;
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, timespec const* timeout = nullptr)
+    {
+        return io_ring_enter(m_fd, to_submit, min_complete, timeout);
+    }
+
+private:
+    int m_fd { -1 };
+    io_ring_params m_params {};
+    u8* m_mapping { nullptr };
+};
+
+static io_ring_submission make_submission(u8 opcode, int fd, u64 user_data)
+{
+    io_ring_submission submission {};
+    submission.opcode = opcode;
+    submission.fd = fd;
+    submission.offset = IO_RING_CURRENT_POSITION;
+    submission.user_data = user_data;
+    return submission;
+}
+
+TEST_CASE(setup)
+{
+    io_ring_params params {};
+    EXPECT_EQ(io_ring_setup(0, &params, 0), -1);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_EQ(io_ring_setup(IO_RING_MAX_ENTRIES + 1, &params, 0), -1);
+    EXPECT_EQ(errno, EINVAL);
+
+    Ring ring(5);
+    EXPECT_EQ(ring.params().sq_entries, 8u);
+    EXPECT_EQ(ring.params().cq_entries, 16u);
+
+    // A private mapping would never see the other side's updates.
+    EXPECT_EQ(mmap(nullptr, ring.params().ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, ring.fd(), 0), MAP_FAILED);
+}
+
+TEST_CASE(nop_and_invalid_operations)
+{
+    Ring ring(8);
+    ring.push(make_submission(IO_RING_OP_NOP, -1, 1));
+    ring.push(make_submission(0xff, -1, 2));
+    ring.push(make_submission(IO_RING_OP_READ, -1, 3));
+    EXPECT_EQ(ring.enter(3, 3), 3);
+
+    auto first = ring.pop();
+    EXPECT(first.has_value());
+    EXPECT_EQ(first->user_data, 1u);
+    EXPECT_EQ(first->result, 0);
+
+    auto second = ring.pop();
+    EXPECT(second.has_value());
+    EXPECT_EQ(second->user_data, 2u);
+    EXPECT_EQ(second->result, -EINVAL);
+
+    auto third = ring.pop();
+    EXPECT(third.has_value());
+    EXPECT_EQ(third->user_data, 3u);
+    EXPECT_EQ(third->result, -EBADF);
+
+    EXPECT(!ring.pop().has_value());
+}
+
+TEST_CASE(batched_pipe_io)
+{
+    int pipe_fds[2];
+    EXPECT_EQ(pipe(pipe_fds), 0);
+
+    Ring ring(8);
+    char read_buffer[16] {};
+    auto read = make_submission(IO_RING_OP_READ, pipe_fds[0], 1);
+    read.address = reinterpret_cast<FlatPtr>(read_buffer);
+    read.length = sizeof(read_buffer);
+    ring.push(read);
+
+    // The read can't complete yet, so it has to be parked instead of blocking the submission.
+    EXPECT_EQ(ring.enter(1, 0), 1);
+    EXPECT(!ring.pop().has_value());
+
+    char const message[] = "hello";
+    auto write = make_submission(IO_RING_OP_WRITE, pipe_fds[1], 2);
+    write.address = reinterpret_cast<FlatPtr>(message);
+    write.length = sizeof(message);
+    ring.push(write);
+    EXPECT_EQ(ring.enter(1, 2), 1);
+
+    size_t completed = 0;
+    for (auto completion = ring.pop(); completion.has_value(); completion = ring.pop()) {
+        EXPECT_EQ(completion->result, static_cast<i64>(sizeof(message)));
+        EXPECT(completion->user_data == 1 || completion->user_data == 2);
+        ++completed;
+    }
+    EXPECT_EQ(completed, 2u);
+    EXPECT_EQ(StringView(read_buffer, sizeof(message) - 1), "hello"sv);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+}
+
+TEST_CASE(timeout)
+{
+    Ring ring(8);
+    timespec timeout { 0, 50'000'000 };
+    auto submission = make_submission(IO_RING_OP_TIMEOUT, -1, 42);
+    submission.address = reinterpret_cast<FlatPtr>(&timeout);
+    ring.push(submission);
+
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    EXPECT_EQ(ring.enter(1, 1), 1);
+    timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    auto completion = ring.pop();
+    EXPECT(completion.has_value());
+    EXPECT_EQ(completion->user_data, 42u);
+    EXPECT_EQ(completion->result, -ETIMEDOUT);
+    auto elapsed_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1'000'000;
+    EXPECT(elapsed_ms >= 40);
+
+    // With nothing parked, waiting for more completions returns right away.
+    EXPECT_EQ(ring.enter(0, 1), 0);
+}
+
+TEST_CASE(accept_send_and_recv)
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT(listen_fd >= 0);
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    socklen_t address_size = sizeof(address);
+    EXPECT_EQ(getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address), &address_size), 0);
+    EXPECT_EQ(listen(listen_fd, 1), 0);
+
+    Ring ring(8);
+    ring.push(make_submission(IO_RING_OP_ACCEPT, listen_fd, 1));
+    EXPECT_EQ(ring.enter(1, 0), 1);
+
+    int client_fd = socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT(client_fd >= 0);
+    EXPECT_EQ(connect(client_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    EXPECT_EQ(ring.enter(0, 1), 0);
+    auto accepted = ring.pop();
+    EXPECT(accepted.has_value());
+    EXPECT_EQ(accepted->user_data, 1u);
+    EXPECT(accepted->result >= 0);
+    int server_fd = static_cast<int>(accepted->result);
+
+    char receive_buffer[8] {};
+    auto recv = make_submission(IO_RING_OP_RECV, server_fd, 2);
+    recv.address = reinterpret_cast<FlatPtr>(receive_buffer);
+    recv.length = sizeof(receive_buffer);
+    ring.push(recv);
+
+    char const message[] = "ping";
+    auto send = make_submission(IO_RING_OP_SEND, client_fd, 3);
+    send.address = reinterpret_cast<FlatPtr>(message);
+    send.length = sizeof(message);
+    ring.push(send);
+
+    EXPECT_EQ(ring.enter(2, 2), 2);
+    size_t completed = 0;
+    for (auto completion = ring.pop(); completion.has_value(); completion = ring.pop()) {
+        EXPECT_EQ(completion->result, static_cast<i64>(sizeof(message)));
+        ++completed;
+    }
+    EXPECT_EQ(completed, 2u);
+    EXPECT_EQ(StringView(receive_buffer, sizeof(message) - 1), "ping"sv);
+
+    close(server_fd);
+    close(client_fd);
+    close(listen_fd);
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <LibTest/TestCase.h>
+
+#include <AK/Atomic.h>
+#include <AK/Vector.h>
+#include <Kernel/API/PerformanceEventStream.h>
+#include <errno.h>
+#include <limits.h>
+#include <serenity.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+class ProfilingStream {
+public:
+    ProfilingStream()
+    {
+        m_fd = profiling_stream(getpid(), PERF_EVENT_SIGNPOST);
+        VERIFY(m_fd >= 0);
+
+        auto* header_page = mmap(nullptr, PAGE_SIZE, PROT_READ, MAP_SHARED, m_fd, 0);
+        VERIFY(header_page != MAP_FAILED);
+        m_header = *static_cast<Kernel::PerformanceEventStreamHeader const*>(header_page);
+        VERIFY(munmap(header_page, PAGE_SIZE) == 0);
+        VERIFY(m_header.magic == Kernel::performance_event_stream_magic);
+
+        auto* mapping = mmap(nullptr, m_header.total_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        VERIFY(mapping != MAP_FAILED);
+        m_mapping = static_cast<u8*>(mapping);
+    }
+
+    ~ProfilingStream()
+    {
+        profiling_disable(getpid());
+        munmap(m_mapping, m_header.total_size);
+        close(m_fd);
+    }
+
+    u32 cpu_count() const { return m_header.cpu_count; }
+    u64 data_size() const { return m_header.data_size; }
+
+    Kernel::PerformanceEventRingHeader& ring(u32 cpu)
+    {
+        return *reinterpret_cast<Kernel::PerformanceEventRingHeader*>(m_mapping + m_header.first_ring_offset + cpu * m_header.ring_stride);
+    }
+
+    u64 dropped_events()
+    {
+        u64 dropped_events = 0;
+        for (u32 cpu = 0; cpu < cpu_count(); ++cpu)
+            dropped_events += AK::atomic_load(&ring(cpu).dropped_events);
+        return dropped_events;
+    }
+
+    // Consumes everything in all rings, and returns the first argument of every signpost, per ring.
+    Vector<Vector<u64>> drain_signposts()
+    {
+        Vector<Vector<u64>> signposts;
+        for (u32 cpu = 0; cpu < cpu_count(); ++cpu) {
+            auto& ring_header = ring(cpu);
+            auto* data = reinterpret_cast<u8 const*>(&ring_header) + m_header.data_offset;
+            Vector<u64> ring_signposts;
+            u64 head = AK::atomic_load(&ring_header.head, AK::MemoryOrder::memory_order_acquire);
+            u64 tail = AK::atomic_load(&ring_header.tail, AK::MemoryOrder::memory_order_relaxed);
+            while (tail != head) {
+                auto const& record = *reinterpret_cast<Kernel::PerformanceEventRecord const*>(data + (tail & (data_size() - 1)));
+                VERIFY(record.size != 0 && record.size % 8 == 0);
+                if (record.type == PERF_EVENT_SIGNPOST)
+                    ring_signposts.append(record.arg1);
+                tail += record.size;
+            }
+            AK::atomic_store(&ring_header.tail, tail, AK::MemoryOrder::memory_order_release);
+            signposts.append(move(ring_signposts));
+        }
+        return signposts;
+    }
+
+private:
+    int m_fd { -1 };
+    Kernel::PerformanceEventStreamHeader m_header {};
+    u8* m_mapping { nullptr };
+};
+
+TEST_CASE(signposts_arrive_in_order)
+{
+    ProfilingStream stream;
+    (void)stream.drain_signposts();
+
+    static constexpr u64 signpost_count = 1000;
+    for (u64 i = 0; i < signpost_count; ++i)
+        EXPECT_EQ(perf_event(PERF_EVENT_SIGNPOST, i, 0), 0);
+
+    // We may have moved between CPUs, but each ring has to have its part in the order we sent it.
+    auto signposts = stream.drain_signposts();
+    Vector<bool> seen;
+    seen.resize(signpost_count);
+    size_t total = 0;
+    for (auto& ring_signposts : signposts) {
+        for (size_t i = 0; i < ring_signposts.size(); ++i) {
+            if (i > 0)
+                EXPECT(ring_signposts[i - 1] < ring_signposts[i]);
+            EXPECT(ring_signposts[i] < signpost_count);
+            if (ring_signposts[i] < signpost_count)
+                seen[ring_signposts[i]] = true;
+        }
+        total += ring_signposts.size();
+    }
+    EXPECT_EQ(total, signpost_count);
+    EXPECT(!seen.contains_slow(false));
+    EXPECT_EQ(stream.dropped_events(), 0u);
+}
+
+TEST_CASE(stalled_consumer_makes_events_drop)
+{
+    ProfilingStream stream;
+    (void)stream.drain_signposts();
+
+    // Every record takes up at least its fixed-size part, so this is more than all rings can hold.
+    u64 signpost_count = stream.cpu_count() * stream.data_size() / sizeof(Kernel::PerformanceEventRecord) + 1;
+    u64 failed_count = 0;
+    for (u64 i = 0; i < signpost_count; ++i) {
+        if (perf_event(PERF_EVENT_SIGNPOST, i, 0) < 0) {
+            EXPECT_EQ(errno, ENOBUFS);
+            ++failed_count;
+        }
+    }
+    EXPECT(failed_count > 0);
+    EXPECT_EQ(stream.dropped_events(), failed_count);
+
+    // Once the consumer catches up, events make it into the rings again.
+    (void)stream.drain_signposts();
+    EXPECT_EQ(perf_event(PERF_EVENT_SIGNPOST, 0, 0), 0);
+    size_t total = 0;
+    for (auto& ring_signposts : stream.drain_signposts())
+        total += ring_signposts.size();
+    EXPECT_EQ(total, 1u);
+}
+
+TEST_CASE(corrupted_tail_is_rejected)
+{
+    ProfilingStream stream;
+    (void)stream.drain_signposts();
+
+    // A tail ahead of the head would make the ring look like it has more room than it does.
+    Vector<u64> heads;
+    for (u32 cpu = 0; cpu < stream.cpu_count(); ++cpu) {
+        auto& ring = stream.ring(cpu);
+        heads.append(AK::atomic_load(&ring.head));
+        AK::atomic_store(&ring.tail, heads.last() + 64);
+    }
+
+    static constexpr u64 signpost_count = 100;
+    for (u64 i = 0; i < signpost_count; ++i) {
+        EXPECT_EQ(perf_event(PERF_EVENT_SIGNPOST, i, 0), -1);
+        EXPECT_EQ(errno, ENOBUFS);
+    }
+    EXPECT_EQ(stream.dropped_events(), signpost_count);
+
+    // Nothing was written for any of them.
+    for (u32 cpu = 0; cpu < stream.cpu_count(); ++cpu) {
+        auto& ring = stream.ring(cpu);
+        EXPECT_EQ(AK::atomic_load(&ring.head), heads[cpu]);
+        AK::atomic_store(&ring.tail, heads[cpu]);
+    }
+
+    EXPECT_EQ(perf_event(PERF_EVENT_SIGNPOST, 0, 0), 0);
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <LibTest/TestCase.h>
+
+#include <AK/NumericLimits.h>
+#include <AK/ScopeGuard.h>
+#include <AK/Vector.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+// Large enough to span several chunks in the kernel, and not a multiple of the page size.
+static constexpr size_t test_file_size = 1 * MiB + 1234;
+
+static u8 pattern_byte(size_t offset)
+{
+    return static_cast<u8>((offset * 7) ^ (offset >> 12));
+}
+
+// The source file lives on the ext2 root file system, so that it gets sent out of the page cache.
+static int create_source_file(char const* path)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    VERIFY(fd >= 0);
+    Vector<u8> data;
+    data.resize(test_file_size);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = pattern_byte(i);
+    VERIFY(write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+    VERIFY(lseek(fd, 0, SEEK_SET) == 0);
+    return fd;
+}
+
+static bool has_pattern(int fd, size_t source_offset, size_t length)
+{
+    Vector<u8> data;
+    data.resize(length);
+    if (pread(fd, data.data(), length, 0) != static_cast<ssize_t>(length))
+        return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (data[i] != pattern_byte(source_offset + i))
+            return false;
+    }
+    return true;
+}
+
+TEST_CASE(sendfile_to_regular_file_with_offset)
+{
+    static constexpr auto source_path = "/home/anon/.sendfile_source_test";
+    static constexpr auto destination_path = "/home/anon/.sendfile_destination_test";
+    int in_fd = create_source_file(source_path);
+    int out_fd = open(destination_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    VERIFY(out_fd >= 0);
+    ScopeGuard cleanup = [&] {
+        close(in_fd);
+        close(out_fd);
+        unlink(source_path);
+        unlink(destination_path);
+    };
+
+    // An unaligned start offset and a count that ends in the middle of a page.
+    off_t offset = 1000;
+    size_t count = 600 * KiB + 7;
+    EXPECT_EQ(sendfile(out_fd, in_fd, &offset, count), static_cast<ssize_t>(count));
+    EXPECT_EQ(offset, static_cast<off_t>(1000 + count));
+    // The file position of in_fd stays where it was.
+    EXPECT_EQ(lseek(in_fd, 0, SEEK_CUR), 0);
+    EXPECT_EQ(lseek(out_fd, 0, SEEK_CUR), static_cast<off_t>(count));
+    EXPECT(has_pattern(out_fd, 1000, count));
+}
+
+TEST_CASE(sendfile_stops_at_end_of_file)
+{
+    static constexpr auto source_path = "/home/anon/.sendfile_eof_test";
+    static constexpr auto destination_path = "/home/anon/.sendfile_eof_destination_test";
+    int in_fd = create_source_file(source_path);
+    int out_fd = open(destination_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    VERIFY(out_fd >= 0);
+    ScopeGuard cleanup = [&] {
+        close(in_fd);
+        close(out_fd);
+        unlink(source_path);
+        unlink(destination_path);
+    };
+
+    // Asking for more than is left only sends what's there.
+    off_t offset = test_file_size - 5000;
+    EXPECT_EQ(sendfile(out_fd, in_fd, &offset, 64 * KiB), 5000);
+    EXPECT_EQ(offset, static_cast<off_t>(test_file_size));
+    EXPECT(has_pattern(out_fd, test_file_size - 5000, 5000));
+
+    EXPECT_EQ(sendfile(out_fd, in_fd, &offset, 64 * KiB), 0);
+    EXPECT_EQ(offset, static_cast<off_t>(test_file_size));
+}
+
+TEST_CASE(sendfile_without_offset_advances_file_position)
+{
+    static constexpr auto source_path = "/home/anon/.sendfile_position_test";
+    int in_fd = create_source_file(source_path);
+    int pipe_fds[2];
+    VERIFY(pipe(pipe_fds) == 0);
+    ScopeGuard cleanup = [&] {
+        close(in_fd);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        unlink(source_path);
+    };
+
+    VERIFY(lseek(in_fd, 4000, SEEK_SET) == 4000);
+    EXPECT_EQ(sendfile(pipe_fds[1], in_fd, nullptr, 3000), 3000);
+    EXPECT_EQ(lseek(in_fd, 0, SEEK_CUR), 7000);
+
+    u8 buffer[3000];
+    size_t total_read = 0;
+    while (total_read < sizeof(buffer)) {
+        auto nread = read(pipe_fds[0], buffer + total_read, sizeof(buffer) - total_read);
+        if (nread <= 0)
+            break;
+        total_read += nread;
+    }
+    EXPECT_EQ(total_read, sizeof(buffer));
+    bool matches = true;
+    for (size_t i = 0; i < total_read; ++i)
+        matches &= buffer[i] == pattern_byte(4000 + i);
+    EXPECT(matches);
+}
+
+TEST_CASE(sendfile_rejects_bad_descriptors)
+{
+    int pipe_fds[2];
+    VERIFY(pipe(pipe_fds) == 0);
+    ScopeGuard cleanup = [&] {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+    };
+
+    // Only regular files can be sent from.
+    EXPECT_EQ(sendfile(pipe_fds[1], pipe_fds[0], nullptr, 16), -1);
+    EXPECT_EQ(errno, EINVAL);
+
+    int in_fd = open("/etc/passwd", O_RDONLY);
+    VERIFY(in_fd >= 0);
+    EXPECT_EQ(sendfile(pipe_fds[0], in_fd, nullptr, 16), -1);
+    EXPECT_EQ(errno, EBADF);
+    off_t offset = -1;
+    EXPECT_EQ(sendfile(pipe_fds[1], in_fd, &offset, 16), -1);
+    EXPECT_EQ(errno, EINVAL);
+    // The end of the range has to be a valid offset as well.
+    offset = NumericLimits<off_t>::max() - 8;
+    EXPECT_EQ(sendfile(pipe_fds[1], in_fd, &offset, 16), -1);
+    EXPECT_EQ(errno, EOVERFLOW);
+    EXPECT_EQ(offset, NumericLimits<off_t>::max() - 8);
+    close(in_fd);
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <LibTest/TestCase.h>
+
+#include <AK/Array.h>
+#include <AK/Optional.h>
+#include <AK/ScopeGuard.h>
+#include <AK/Span.h>
+#include <AK/Vector.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// These tests talk to the kernel's TCP stack through a raw socket, so that we get to see (and choose)
+// exactly what goes over the wire. Replies to our raw "client" land on a listening socket on the same
+// port, which ignores them instead of answering with a RST.
+
+namespace {
+
+enum Flags : u8 {
+    FIN = 0x01,
+    SYN = 0x02,
+    RST = 0x04,
+    PSH = 0x08,
+    ACK = 0x10,
+};
+
+enum OptionKind : u8 {
+    End = 0,
+    NoOperation = 1,
+    MaximumSegmentSize = 2,
+    WindowScale = 3,
+    SACKPermitted = 4,
+    SACK = 5,
+    Timestamp = 8,
+};
+
+struct Segment {
+    u16 source_port { 0 };
+    u16 destination_port { 0 };
+    u32 sequence_number { 0 };
+    u32 ack_number { 0 };
+    u8 flags { 0 };
+    u16 window { 0 };
+    Vector<u8> options;
+    Vector<u8> payload;
+
+    Optional<ReadonlyBytes> option(OptionKind kind) const
+    {
+        for (size_t offset = 0; offset < options.size();) {
+            if (options[offset] == OptionKind::End)
+                break;
+            if (options[offset] == OptionKind::NoOperation) {
+                ++offset;
+                continue;
+            }
+            if (offset + 1 >= options.size() || options[offset + 1] < 2)
+                break;
+            size_t length = options[offset + 1];
+            if (offset + length > options.size())
+                break;
+            if (options[offset] == kind)
+                return options.span().slice(offset + 2, length - 2);
+            offset += length;
+        }
+        return {};
+    }
+};
+
+}
+
+static void write_u16(u8* data, u16 value)
+{
+    data[0] = value >> 8;
+    data[1] = value;
+}
+
+static void write_u32(u8* data, u32 value)
+{
+    write_u16(data, value >> 16);
+    write_u16(data + 2, value);
+}
+
+static u16 read_u16(u8 const* data)
+{
+    return (data[0] << 8) | data[1];
+}
+
+static u32 read_u32(u8 const* data)
+{
+    return (read_u16(data) << 16) | read_u16(data + 2);
+}
+
+static u16 checksum(ReadonlyBytes tcp_segment)
+{
+    // The pseudo header for 127.0.0.1 -> 127.0.0.1.
+    u32 sum = 0x7f00 + 0x0001 + 0x7f00 + 0x0001 + IPPROTO_TCP + tcp_segment.size();
+    for (size_t i = 0; i < tcp_segment.size(); i += 2)
+        sum += i + 1 < tcp_segment.size() ? read_u16(tcp_segment.offset(i)) : tcp_segment[i] << 8;
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum;
+}
+
+static void send_segment(int raw_fd, Segment const& segment)
+{
+    VERIFY(segment.options.size() % 4 == 0);
+    size_t header_size = 20 + segment.options.size();
+    Vector<u8> data;
+    data.resize(header_size + segment.payload.size());
+    write_u16(&data[0], segment.source_port);
+    write_u16(&data[2], segment.destination_port);
+    write_u32(&data[4], segment.sequence_number);
+    write_u32(&data[8], segment.ack_number);
+    data[12] = (header_size / 4) << 4;
+    data[13] = segment.flags;
+    write_u16(&data[14], segment.window);
+    memcpy(&data[20], segment.options.data(), segment.options.size());
+    memcpy(&data[header_size], segment.payload.data(), segment.payload.size());
+    write_u16(&data[16], checksum(data.span()));
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(sendto(raw_fd, data.data(), data.size(), 0, reinterpret_cast<sockaddr*>(&address), sizeof(address)), static_cast<ssize_t>(data.size()));
+}
+
+// Waits for the next segment going from `source_port` to `destination_port`.
+static Optional<Segment> receive_segment(int raw_fd, u16 source_port, u16 destination_port)
+{
+    Array<u8, 2048> buffer;
+    for (;;) {
+        ssize_t nread = recv(raw_fd, buffer.data(), buffer.size(), 0);
+        if (nread < 0)
+            return {};
+        auto packet = buffer.span().trim(nread);
+        if (packet.size() < sizeof(struct ip))
+            continue;
+        size_t ip_header_size = (packet[0] & 0xf) * 4;
+        auto tcp_segment = packet.slice(ip_header_size);
+        if (tcp_segment.size() < 20)
+            continue;
+        size_t header_size = (tcp_segment[12] >> 4) * 4;
+        if (read_u16(tcp_segment.offset(0)) != source_port || read_u16(tcp_segment.offset(2)) != destination_port)
+            continue;
+
+        Segment segment;
+        segment.source_port = source_port;
+        segment.destination_port = destination_port;
+        segment.sequence_number = read_u32(tcp_segment.offset(4));
+        segment.ack_number = read_u32(tcp_segment.offset(8));
+        segment.flags = tcp_segment[13];
+        segment.window = read_u16(tcp_segment.offset(14));
+        auto options = tcp_segment.slice(20, header_size - 20);
+        auto payload = tcp_segment.slice(header_size);
+        segment.options.append(options.data(), options.size());
+        segment.payload.append(payload.data(), payload.size());
+        return segment;
+    }
+}
+
+static int create_listening_socket(u16& port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    VERIFY(fd >= 0);
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    VERIFY(bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    VERIFY(listen(fd, 1) == 0);
+    socklen_t address_size = sizeof(address);
+    VERIFY(getsockname(fd, reinterpret_cast<sockaddr*>(&address), &address_size) == 0);
+    port = ntohs(address.sin_port);
+    return fd;
+}
+
+struct Connection {
+    int raw_fd { -1 };
+    int listen_fd { -1 };
+    int decoy_fd { -1 };
+    u16 server_port { 0 };
+    u16 client_port { 0 };
+
+    ~Connection()
+    {
+        for (int fd : { raw_fd, listen_fd, decoy_fd }) {
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+};
+
+static bool set_up(Connection& connection)
+{
+    connection.raw_fd = socket(AF_INET, SOCK_RAW, IPPROTO_TCP);
+    if (connection.raw_fd < 0) {
+        warnln("Skipping, can't create a raw socket: {}", strerror(errno));
+        return false;
+    }
+    timeval timeout { 2, 0 };
+    VERIFY(setsockopt(connection.raw_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0);
+    connection.listen_fd = create_listening_socket(connection.server_port);
+    connection.decoy_fd = create_listening_socket(connection.client_port);
+    return true;
+}
+
+static Segment make_segment(Connection const& connection, u32 sequence_number, u32 ack_number, u8 flags)
+{
+    return { connection.client_port, connection.server_port, sequence_number, ack_number, flags, 0xffff, {}, {} };
+}
+
+TEST_CASE(syn_ack_confirms_offered_options)
+{
+    Connection connection;
+    if (!set_up(connection))
+        return;
+
+    auto syn = make_segment(connection, 5000, 0, Flags::SYN);
+    syn.options = {
+        OptionKind::MaximumSegmentSize, 4, 0x05, 0xb4,
+        OptionKind::SACKPermitted, 2,
+        OptionKind::Timestamp, 10, 0x12, 0x34, 0x56, 0x78, 0, 0, 0, 0,
+        OptionKind::NoOperation, OptionKind::WindowScale, 3, 7
+    };
+    send_segment(connection.raw_fd, syn);
+
+    auto syn_ack = receive_segment(connection.raw_fd, connection.server_port, connection.client_port);
+    VERIFY(syn_ack.has_value());
+    EXPECT_EQ(syn_ack->flags, Flags::SYN | Flags::ACK);
+    EXPECT_EQ(syn_ack->ack_number, 5001u);
+
+    auto window_scale = syn_ack->option(OptionKind::WindowScale);
+    EXPECT(window_scale.has_value() && window_scale->size() == 1);
+    EXPECT(syn_ack->option(OptionKind::SACKPermitted).has_value());
+
+    // RFC 7323, 3.2: The SYN-ACK echoes our timestamp.
+    auto timestamp = syn_ack->option(OptionKind::Timestamp);
+    EXPECT(timestamp.has_value() && timestamp->size() == 8);
+    if (timestamp.has_value() && timestamp->size() == 8)
+        EXPECT_EQ(read_u32(timestamp->offset(4)), 0x12345678u);
+
+    send_segment(connection.raw_fd, make_segment(connection, 5001, 0, Flags::RST));
+}
+
+TEST_CASE(syn_ack_only_confirms_what_was_offered)
+{
+    Connection connection;
+    if (!set_up(connection))
+        return;
+
+    auto syn = make_segment(connection, 7000, 0, Flags::SYN);
+    syn.options = { OptionKind::MaximumSegmentSize, 4, 0x05, 0xb4 };
+    send_segment(connection.raw_fd, syn);
+
+    auto syn_ack = receive_segment(connection.raw_fd, connection.server_port, connection.client_port);
+    VERIFY(syn_ack.has_value());
+    EXPECT_EQ(syn_ack->flags, Flags::SYN | Flags::ACK);
+    EXPECT(syn_ack->option(OptionKind::MaximumSegmentSize).has_value());
+    EXPECT(!syn_ack->option(OptionKind::WindowScale).has_value());
+    EXPECT(!syn_ack->option(OptionKind::SACKPermitted).has_value());
+    EXPECT(!syn_ack->option(OptionKind::Timestamp).has_value());
+
+    send_segment(connection.raw_fd, make_segment(connection, 7001, 0, Flags::RST));
+}
+
+TEST_CASE(out_of_order_segments_are_reassembled)
+{
+    Connection connection;
+    if (!set_up(connection))
+        return;
+
+    // Only SACK is negotiated, as that's what makes the receiver hold on to out of order data.
+    auto syn = make_segment(connection, 9000, 0, Flags::SYN);
+    syn.options = { OptionKind::MaximumSegmentSize, 4, 0x05, 0xb4, OptionKind::NoOperation, OptionKind::NoOperation, OptionKind::SACKPermitted, 2 };
+    send_segment(connection.raw_fd, syn);
+    auto syn_ack = receive_segment(connection.raw_fd, connection.server_port, connection.client_port);
+    VERIFY(syn_ack.has_value());
+    u32 server_sequence_number = syn_ack->sequence_number + 1;
+    send_segment(connection.raw_fd, make_segment(connection, 9001, server_sequence_number, Flags::ACK));
+
+    int accepted_fd = accept(connection.listen_fd, nullptr, nullptr);
+    VERIFY(accepted_fd >= 0);
+    ScopeGuard close_accepted_fd = [&] { close(accepted_fd); };
+
+    // The second half arrives first, which has to be acknowledged right away with a SACK block.
+    auto second_half = make_segment(connection, 9006, server_sequence_number, Flags::ACK | Flags::PSH);
+    second_half.payload = { '5', '6', '7', '8', '9' };
+    send_segment(connection.raw_fd, second_half);
+
+    auto duplicate_ack = receive_segment(connection.raw_fd, connection.server_port, connection.client_port);
+    VERIFY(duplicate_ack.has_value());
+    EXPECT_EQ(duplicate_ack->ack_number, 9001u);
+    auto sack = duplicate_ack->option(OptionKind::SACK);
+    EXPECT(sack.has_value() && sack->size() == 8);
+    if (sack.has_value() && sack->size() == 8) {
+        EXPECT_EQ(read_u32(sack->offset(0)), 9006u);
+        EXPECT_EQ(read_u32(sack->offset(4)), 9011u);
+    }
+
+    // Filling the hole acknowledges everything, and the application gets it all in order.
+    auto first_half = make_segment(connection, 9001, server_sequence_number, Flags::ACK | Flags::PSH);
+    first_half.payload = { '0', '1', '2', '3', '4' };
+    send_segment(connection.raw_fd, first_half);
+
+    auto ack = receive_segment(connection.raw_fd, connection.server_port, connection.client_port);
+    VERIFY(ack.has_value());
+    EXPECT_EQ(ack->ack_number, 9011u);
+
+    Array<char, 16> buffer {};
+    size_t total_read = 0;
+    while (total_read < 10) {
+        ssize_t nread = read(accepted_fd, buffer.data() + total_read, buffer.size() - total_read);
+        if (nread <= 0)
+            break;
+        total_read += nread;
+    }
+    EXPECT_EQ(StringView(buffer.data(), total_read), "0123456789"sv);
+
+    send_segment(connection.raw_fd, make_segment(connection, 9011, server_sequence_number, Flags::RST));
+}
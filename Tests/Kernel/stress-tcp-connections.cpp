@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Vector.h>
+#include <LibCore/ArgsParser.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Opens lots of loopback TCP connections from several processes at once, and keeps them all open
+// until every one of them got an echo back from the server. This hammers the socket lookup
+// tables: every packet has to find its socket among tens of thousands of others, while more
+// connections are being set up and torn down all the time.
+
+static int s_listen_fd = -1;
+// NOTE: Every connection holds two sockets at once: ours, and the one waiting in the backlog. With
+//       receive buffers that only grow once data piles up, each of them costs a few KiB, so the
+//       default fits comfortably into the 1 GiB that our test VMs get.
+static int s_connection_count = 20000;
+
+static void* serve_connections(void*)
+{
+    for (int i = 0; i < s_connection_count; ++i) {
+        int fd = accept(s_listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            perror("accept");
+            return reinterpret_cast<void*>(1);
+        }
+        char byte;
+        if (read(fd, &byte, 1) != 1 || write(fd, &byte, 1) != 1) {
+            perror("echo");
+            close(fd);
+            return reinterpret_cast<void*>(1);
+        }
+        close(fd);
+    }
+    return nullptr;
+}
+
+static bool run_client(sockaddr_in const& address, int first_connection, int connection_count)
+{
+    Vector<int> fds;
+    for (int i = 0; i < connection_count; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            perror("socket");
+            return false;
+        }
+        if (connect(fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) < 0) {
+            perror("connect");
+            close(fd);
+            return false;
+        }
+        char byte = static_cast<char>(first_connection + i);
+        if (write(fd, &byte, 1) != 1) {
+            perror("write");
+            close(fd);
+            return false;
+        }
+        fds.append(fd);
+    }
+
+    bool success = true;
+    for (int i = 0; i < connection_count; ++i) {
+        char byte;
+        if (read(fds[i], &byte, 1) != 1 || byte != static_cast<char>(first_connection + i)) {
+            fprintf(stderr, "Connection %d didn't get its echo back\n", first_connection + i);
+            success = false;
+        }
+        close(fds[i]);
+    }
+    return success;
+}
+
+int main(int argc, char** argv)
+{
+    Vector<StringView> arguments;
+    arguments.ensure_capacity(argc);
+    for (auto i = 0; i < argc; ++i)
+        arguments.append({ argv[i], strlen(argv[i]) });
+
+    int process_count = 40;
+
+    Core::ArgsParser args_parser;
+    args_parser.add_option(s_connection_count, "Number of connections to open", "number", 'n', "number");
+    args_parser.add_option(process_count, "Number of client processes to spread them over", "processes", 'p', "number");
+    args_parser.parse(arguments);
+
+    if (s_connection_count <= 0 || process_count <= 0) {
+        warnln("Need at least one connection and one process");
+        return EXIT_FAILURE;
+    }
+
+    s_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (s_listen_fd < 0) {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t address_size = sizeof(address);
+    if (bind(s_listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+        || getsockname(s_listen_fd, reinterpret_cast<sockaddr*>(&address), &address_size) < 0) {
+        perror("bind");
+        return EXIT_FAILURE;
+    }
+    // Connections that don't fit into the backlog would never be accepted.
+    if (listen(s_listen_fd, s_connection_count) < 0) {
+        perror("listen");
+        return EXIT_FAILURE;
+    }
+
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    Vector<pid_t> clients;
+    int connections_per_process = s_connection_count / process_count;
+    for (int i = 0; i < process_count; ++i) {
+        int first_connection = i * connections_per_process;
+        int connection_count = i == process_count - 1 ? s_connection_count - first_connection : connections_per_process;
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return EXIT_FAILURE;
+        }
+        if (pid == 0) {
+            close(s_listen_fd);
+            _exit(run_client(address, first_connection, connection_count) ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        clients.append(pid);
+    }
+
+    // NOTE: The server only starts once all clients are forked, so that none of them inherits a
+    //       lock held by it. The clients' connections wait in the backlog in the meantime.
+    pthread_t server;
+    if (pthread_create(&server, nullptr, serve_connections, nullptr) != 0) {
+        perror("pthread_create");
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_SUCCESS;
+    for (auto pid : clients) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+            result = EXIT_FAILURE;
+    }
+
+    // If a client gave up, the server would wait for its connections forever.
+    if (result == EXIT_SUCCESS) {
+        void* server_result = nullptr;
+        pthread_join(server, &server_result);
+        if (server_result)
+            result = EXIT_FAILURE;
+    }
+    close(s_listen_fd);
+
+    timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    auto elapsed_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1'000'000;
+    printf("%d connections from %d processes in %lld ms: %s\n", s_connection_count, process_count, static_cast<long long>(elapsed_ms), result == EXIT_SUCCESS ? "PASS" : "FAIL");
+    return result;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <LibTest/TestCase.h>
+
+#include <AK/Array.h>
+#include <AK/Vector.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+static constexpr size_t total_operation_count = 4'000'000;
+static constexpr size_t live_allocations_per_thread = 64;
+static constexpr Array<size_t, 8> allocation_sizes = { 8, 24, 40, 100, 200, 300, 700, 1000 };
+
+static void* churn(void*)
+{
+    Array<void*, live_allocations_per_thread> allocations {};
+    size_t const operation_count = total_operation_count / live_allocations_per_thread;
+    for (size_t i = 0; i < operation_count; ++i) {
+        for (size_t j = 0; j < live_allocations_per_thread; ++j) {
+            free(allocations[j]);
+            allocations[j] = malloc(allocation_sizes[(i + j) % allocation_sizes.size()]);
+            VERIFY(allocations[j]);
+        }
+    }
+    for (auto* allocation : allocations)
+        free(allocation);
+    return nullptr;
+}
+
+// Every thread performs the same amount of work, so with perfect scaling each of
+// these cases should take roughly the same amount of wall-clock time.
+static void run_churn_on_threads(size_t thread_count)
+{
+    Vector<pthread_t> threads;
+    threads.resize(thread_count);
+    for (auto& thread : threads)
+        EXPECT_EQ(pthread_create(&thread, nullptr, churn, nullptr), 0);
+    for (auto& thread : threads)
+        EXPECT_EQ(pthread_join(thread, nullptr), 0);
+}
+
+BENCHMARK_CASE(malloc_free_1_thread)
+{
+    run_churn_on_threads(1);
+}
+
+BENCHMARK_CASE(malloc_free_2_threads)
+{
+    run_churn_on_threads(2);
+}
+
+BENCHMARK_CASE(malloc_free_4_threads)
+{
+    run_churn_on_threads(4);
+}
+
+BENCHMARK_CASE(malloc_free_8_threads)
+{
+    run_churn_on_threads(8);
+}
+
+struct HandoffQueue {
+    static constexpr size_t capacity = 1024;
+
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t condition = PTHREAD_COND_INITIALIZER;
+    Array<void*, capacity> pointers {};
+    size_t count { 0 };
+    bool done { false };
+};
+
+static void* free_from_other_thread(void* argument)
+{
+    auto& queue = *static_cast<HandoffQueue*>(argument);
+    pthread_mutex_lock(&queue.mutex);
+    for (;;) {
+        while (queue.count == 0 && !queue.done)
+            pthread_cond_wait(&queue.condition, &queue.mutex);
+        if (queue.count == 0 && queue.done)
+            break;
+        while (queue.count > 0)
+            free(queue.pointers[--queue.count]);
+        pthread_cond_signal(&queue.condition);
+    }
+    pthread_mutex_unlock(&queue.mutex);
+    return nullptr;
+}
+
+// Allocates on one thread and frees on another, which exercises the path that
+// returns chunks from a full thread cache back to the shared blocks.
+BENCHMARK_CASE(malloc_here_free_there)
+{
+    HandoffQueue queue;
+    pthread_t consumer;
+    EXPECT_EQ(pthread_create(&consumer, nullptr, free_from_other_thread, &queue), 0);
+
+    for (size_t i = 0; i < total_operation_count / 4; ++i) {
+        auto* allocation = malloc(allocation_sizes[i % allocation_sizes.size()]);
+        VERIFY(allocation);
+        pthread_mutex_lock(&queue.mutex);
+        while (queue.count == HandoffQueue::capacity)
+            pthread_cond_wait(&queue.condition, &queue.mutex);
+        queue.pointers[queue.count++] = allocation;
+        pthread_cond_signal(&queue.condition);
+        pthread_mutex_unlock(&queue.mutex);
+    }
+
+    pthread_mutex_lock(&queue.mutex);
+    queue.done = true;
+    pthread_cond_signal(&queue.condition);
+    pthread_mutex_unlock(&queue.mutex);
+    EXPECT_EQ(pthread_join(consumer, nullptr), 0);
+}
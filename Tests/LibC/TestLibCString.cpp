@@ -5,6 +5,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/Array.h>
 #include <LibTest/TestCase.h>
 #include <errno.h>
 #include <string.h>
@@ -29,3 +30,46 @@ TEST_CASE(strtok_r_delimiters_only)
     // The string to which `saved_str` initially points to shouldn't be modified.
     EXPECT_EQ(strcmp(dummy, "a;"), 0);
 }
+
+// memcpy() and strlen() have several implementations that handle different sizes and alignments in different ways.
+static decltype(&memcpy) volatile s_memcpy = memcpy;
+static decltype(&strlen) volatile s_strlen = strlen;
+
+TEST_CASE(memcpy_sizes_and_alignments)
+{
+    Array<u8, 2048> source;
+    for (size_t i = 0; i < source.size(); ++i)
+        source[i] = static_cast<u8>(i * 7 + 3);
+
+    Array<u8, 2048 + 64> destination;
+    Array<u8, 2048 + 64> expected;
+    for (size_t source_offset = 0; source_offset < 32; source_offset += 5) {
+        for (size_t destination_offset = 0; destination_offset < 32; destination_offset += 3) {
+            for (size_t size = 0; size < source.size() - source_offset; size += size < 128 ? 1 : 61) {
+                // Everything around the copied bytes has to stay untouched.
+                destination.fill(0xaa);
+                expected.fill(0xaa);
+                for (size_t i = 0; i < size; ++i)
+                    expected[destination_offset + i] = static_cast<u8>((source_offset + i) * 7 + 3);
+
+                EXPECT_EQ(s_memcpy(destination.data() + destination_offset, source.data() + source_offset, size), destination.data() + destination_offset);
+                EXPECT_EQ(memcmp(destination.data(), expected.data(), destination.size()), 0);
+            }
+        }
+    }
+}
+
+TEST_CASE(strlen_lengths_and_alignments)
+{
+    Array<char, 256> buffer;
+    for (size_t offset = 0; offset < 64; ++offset) {
+        for (size_t length = 0; length < buffer.size() - offset - 1; ++length) {
+            // Put null bytes in front of the string, which must not be mistaken for its end.
+            buffer.fill('x');
+            for (size_t i = 0; i < offset; ++i)
+                buffer[i] = '\0';
+            buffer[offset + length] = '\0';
+            EXPECT_EQ(s_strlen(buffer.data() + offset), length);
+        }
+    }
+}
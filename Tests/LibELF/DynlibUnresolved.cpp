@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+// Nothing defines this, so binding it has to fail.
+extern "C" int dynlib_missing_function();
+
+extern "C" {
+int dynlib_unresolved_function();
+int dynlib_unresolved_function()
+{
+    return dynlib_missing_function();
+}
+}
@@ -6,6 +6,7 @@
 
 #include <LibTest/TestCase.h>
 #include <dlfcn.h>
+#include <string.h>
 
 TEST_CASE(test_dlopen)
 {
@@ -44,3 +45,14 @@ TEST_CASE(test_dlsym_rtld_default)
 
     dlclose(libd);
 }
+
+TEST_CASE(test_dlopen_rtld_now_with_unresolved_symbol)
+{
+    // Binding happens up front with RTLD_NOW, so the missing symbol has to make dlopen() fail (instead of taking down the process).
+    auto lib = dlopen("/usr/Tests/LibELF/libDynlibUnresolved.so", RTLD_NOW);
+    EXPECT_EQ(lib, nullptr);
+    auto* error = dlerror();
+    EXPECT_NE(error, nullptr);
+    if (error)
+        EXPECT(StringView(error, strlen(error)).contains("dynlib_missing_function"sv));
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/Array.h>
+#include <AK/DeprecatedString.h>
+#include <AK/StringBuilder.h>
+#include <LibELF/SymbolCache.h>
+#include <LibTest/TestCase.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static constexpr Array startup_benchmark_programs = {
+    "/bin/Browser"sv,
+    "/bin/FileManager"sv,
+    "/bin/HackStudio"sv,
+    "/bin/PixelPaint"sv,
+    "/bin/SystemMonitor"sv,
+    "/bin/Terminal"sv,
+    "/bin/TextEditor"sv,
+    "/bin/js"sv,
+    "/bin/ls"sv,
+};
+
+static constexpr size_t startup_benchmark_iterations = 5;
+
+// Runs `path` with the given symbol cache mode for the loader and returns what it wrote to stdout.
+static DeprecatedString run_program(StringView path, Vector<char const*> arguments, char const* symbol_cache_mode)
+{
+    int pipe_fds[2];
+    VERIFY(pipe(pipe_fds) == 0);
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_adddup2(&file_actions, pipe_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&file_actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    auto path_string = DeprecatedString { path };
+    arguments.prepend(path_string.characters());
+    arguments.append(nullptr);
+
+    char const* envp[] = { symbol_cache_mode, nullptr };
+    pid_t pid;
+    VERIFY(posix_spawn(&pid, path_string.characters(), &file_actions, nullptr, const_cast<char**>(arguments.data()), const_cast<char**>(envp)) == 0);
+    posix_spawn_file_actions_destroy(&file_actions);
+    close(pipe_fds[1]);
+
+    StringBuilder output;
+    char buffer[256];
+    ssize_t nread;
+    while ((nread = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+        output.append({ buffer, static_cast<size_t>(nread) });
+    close(pipe_fds[0]);
+
+    int status = 0;
+    VERIFY(waitpid(pid, &status, 0) == pid);
+    return output.to_deprecated_string();
+}
+
+static bool can_write_symbol_caches()
+{
+    if (geteuid() != 0 || access(DeprecatedString(ELF::SymbolCache::directory).characters(), W_OK) != 0) {
+        warnln("Skipping, only root can write symbol caches");
+        return false;
+    }
+    return true;
+}
+
+TEST_CASE(program_runs_with_symbol_cache)
+{
+    if (!can_write_symbol_caches())
+        return;
+
+    auto cache_path = ELF::SymbolCache::path_for_program("/bin/echo"sv);
+    run_program("/bin/echo"sv, {}, "_LOADER_SYMBOL_CACHE=update");
+    EXPECT_EQ(access(cache_path.characters(), F_OK), 0);
+
+    EXPECT_EQ(run_program("/bin/echo"sv, { "hello", "friends" }, "_LOADER_SYMBOL_CACHE=use"), "hello friends\n");
+    EXPECT_EQ(run_program("/bin/echo"sv, { "hello", "friends" }, "_LOADER_SYMBOL_CACHE=ignore"), "hello friends\n");
+
+    // A cache that doesn't make sense has to be ignored rather than trusted.
+    EXPECT_EQ(truncate(cache_path.characters(), 40), 0);
+    EXPECT_EQ(run_program("/bin/echo"sv, { "hello", "friends" }, "_LOADER_SYMBOL_CACHE=use"), "hello friends\n");
+
+    EXPECT_EQ(unlink(cache_path.characters()), 0);
+}
+
+static void run_startup_benchmark(char const* symbol_cache_mode)
+{
+    for (size_t i = 0; i < startup_benchmark_iterations; ++i) {
+        for (auto program : startup_benchmark_programs) {
+            if (access(DeprecatedString(program).characters(), X_OK) != 0)
+                continue;
+            run_program(program, { "--help" }, symbol_cache_mode);
+        }
+    }
+}
+
+BENCHMARK_CASE(startup_without_symbol_cache)
+{
+    run_startup_benchmark("_LOADER_SYMBOL_CACHE=ignore");
+}
+
+BENCHMARK_CASE(startup_with_symbol_cache)
+{
+    if (!can_write_symbol_caches())
+        return;
+
+    for (auto program : startup_benchmark_programs) {
+        if (access(DeprecatedString(program).characters(), X_OK) == 0)
+            run_program(program, {}, "_LOADER_SYMBOL_CACHE=update");
+    }
+
+    run_startup_benchmark("_LOADER_SYMBOL_CACHE=use");
+
+    for (auto program : startup_benchmark_programs)
+        unlink(ELF::SymbolCache::path_for_program(program).characters());
+}
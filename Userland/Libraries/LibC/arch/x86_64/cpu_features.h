@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+#include <cpuid.h>
+
+// Helpers for the IFUNC resolvers that pick the best implementation of a routine for the current CPU.
+// These run before LibC has been fully relocated, so they must not call any other LibC functions.
+
+namespace {
+
+constexpr u32 tcg_signature_ebx = 0x54474354;
+constexpr u32 tcg_signature_ecx = 0x43544743;
+constexpr u32 tcg_signature_edx = 0x47435447;
+
+// Bits 27 and 28 of ecx in cpuid[eax = 1] indicate support for XGETBV and AVX
+constexpr u32 cpuid_1_ecx_bit_osxsave = 1 << 27;
+constexpr u32 cpuid_1_ecx_bit_avx = 1 << 28;
+
+// Bit 5 of ebx in cpuid[eax = 7] indicates support for AVX2
+constexpr u32 cpuid_7_ebx_bit_avx2 = 1 << 5;
+
+// Bit 9 of ebx in cpuid[eax = 7] indicates support for "Enhanced REP MOVSB/STOSB"
+constexpr u32 cpuid_7_ebx_bit_erms = 1 << 9;
+
+// Bits 1 and 2 of XCR0 indicate that the kernel saves and restores the SSE and AVX registers
+constexpr u32 xcr0_sse_and_avx_state = (1 << 1) | (1 << 2);
+
+[[gnu::always_inline]] inline bool is_running_under_tcg()
+{
+    u32 eax, ebx, ecx, edx;
+    __cpuid(0x40000000, eax, ebx, ecx, edx);
+    return ebx == tcg_signature_ebx && ecx == tcg_signature_ecx && edx == tcg_signature_edx;
+}
+
+[[gnu::always_inline]] inline bool cpu_has_erms()
+{
+    u32 eax, ebx, ecx, edx;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return ebx & cpuid_7_ebx_bit_erms;
+}
+
+[[gnu::always_inline]] inline bool cpu_can_use_avx2()
+{
+    u32 eax, ebx, ecx, edx;
+    __cpuid(0, eax, ebx, ecx, edx);
+    if (eax < 7)
+        return false;
+
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (!(ecx & cpuid_1_ecx_bit_osxsave) || !(ecx & cpuid_1_ecx_bit_avx))
+        return false;
+
+    // The CPU supporting AVX isn't enough, the kernel also has to preserve the upper halves of the YMM registers.
+    u32 xcr0_low, xcr0_high;
+    asm volatile("xgetbv"
+                 : "=a"(xcr0_low), "=d"(xcr0_high)
+                 : "c"(0));
+    if ((xcr0_low & xcr0_sse_and_avx_state) != xcr0_sse_and_avx_state)
+        return false;
+
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return ebx & cpuid_7_ebx_bit_avx2;
+}
+
+}
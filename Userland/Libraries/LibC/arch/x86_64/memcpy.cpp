@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "cpu_features.h"
+#include <AK/Types.h>
+#include <string.h>
+
+extern "C" {
+
+extern void* memcpy_sse2(void*, void const*, size_t);
+extern void* memcpy_sse2_erms(void*, void const*, size_t);
+extern void* memcpy_avx2(void*, void const*, size_t);
+extern void* memcpy_avx2_erms(void*, void const*, size_t);
+
+namespace {
+[[gnu::used]] decltype(&memcpy) resolve_memcpy()
+{
+    // Like with memset, both rep movsb and the AVX2 instructions are slower than plain SSE copies on TCG.
+    if (is_running_under_tcg())
+        return memcpy_sse2;
+
+    bool has_erms = cpu_has_erms();
+    if (cpu_can_use_avx2())
+        return has_erms ? memcpy_avx2_erms : memcpy_avx2;
+    return has_erms ? memcpy_sse2_erms : memcpy_sse2;
+}
+}
+
+#if !defined(AK_COMPILER_CLANG) && !defined(_DYNAMIC_LOADER)
+[[gnu::ifunc("resolve_memcpy")]] void* memcpy(void*, void const*, size_t);
+#else
+// See memset.cpp for why this can't be an IFUNC here.
+void* memcpy(void* dest_ptr, void const* src_ptr, size_t n)
+{
+    static decltype(&memcpy) s_impl = nullptr;
+    if (s_impl == nullptr)
+        s_impl = resolve_memcpy();
+
+    return s_impl(dest_ptr, src_ptr, n);
+}
+#endif
+}
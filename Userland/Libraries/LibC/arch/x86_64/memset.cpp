@@ -4,8 +4,8 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include "cpu_features.h"
 #include <AK/Types.h>
-#include <cpuid.h>
 #include <string.h>
 
 extern "C" {
@@ -13,28 +13,15 @@ extern "C" {
 extern void* memset_sse2(void*, int, size_t);
 extern void* memset_sse2_erms(void*, int, size_t);
 
-constexpr u32 tcg_signature_ebx = 0x54474354;
-constexpr u32 tcg_signature_ecx = 0x43544743;
-constexpr u32 tcg_signature_edx = 0x47435447;
-
-// Bit 9 of ebx in cpuid[eax = 7] indicates support for "Enhanced REP MOVSB/STOSB"
-constexpr u32 cpuid_7_ebx_bit_erms = 1 << 9;
-
 namespace {
 [[gnu::used]] decltype(&memset) resolve_memset()
 {
-    u32 eax, ebx, ecx, edx;
-
-    __cpuid(0x40000000, eax, ebx, ecx, edx);
-    bool is_tcg = ebx == tcg_signature_ebx && ecx == tcg_signature_ecx && edx == tcg_signature_edx;
-
     // Although TCG reports ERMS support, testing shows that rep stosb performs strictly worse than
     // SSE copies on all data sizes except <= 4 bytes.
-    if (is_tcg)
+    if (is_running_under_tcg())
         return memset_sse2;
 
-    __cpuid_count(7, 0, eax, ebx, ecx, edx);
-    if (ebx & cpuid_7_ebx_bit_erms)
+    if (cpu_has_erms())
         return memset_sse2_erms;
 
     return memset_sse2;
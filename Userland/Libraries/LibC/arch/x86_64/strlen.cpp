@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "cpu_features.h"
+#include <AK/Types.h>
+#include <string.h>
+
+extern "C" {
+
+extern size_t strlen_sse2(char const*);
+extern size_t strlen_avx2(char const*);
+
+namespace {
+[[gnu::used]] decltype(&strlen) resolve_strlen()
+{
+    if (!is_running_under_tcg() && cpu_can_use_avx2())
+        return strlen_avx2;
+    return strlen_sse2;
+}
+}
+
+#if !defined(AK_COMPILER_CLANG) && !defined(_DYNAMIC_LOADER)
+[[gnu::ifunc("resolve_strlen")]] size_t strlen(char const*);
+#else
+// See memset.cpp for why this can't be an IFUNC here.
+size_t strlen(char const* str)
+{
+    static decltype(&strlen) s_impl = nullptr;
+    if (s_impl == nullptr)
+        s_impl = resolve_strlen();
+
+    return s_impl(str);
+}
+#endif
+}
@@ -115,6 +115,9 @@ struct MallocStats {
     size_t number_of_hot_keeps;
     size_t number_of_cold_keeps;
     size_t number_of_frees;
+
+    size_t number_of_thread_cache_refills;
+    size_t number_of_thread_cache_flushes;
 };
 static MallocStats g_malloc_stats = {};
 
@@ -153,6 +156,49 @@ static inline BigAllocator (&big_allocators())[1]
     return reinterpret_cast<BigAllocator(&)[1]>(g_big_allocators_storage);
 }
 
+#ifndef NO_TLS
+// Every thread keeps a small stack of free chunks for each of the smaller size classes,
+// so that a malloc()/free() pair on the same thread doesn't have to take s_malloc_mutex.
+// A chunk freed by another thread than the one that allocated it simply ends up in the
+// freeing thread's cache. Whenever a cache runs empty (or full), it is refilled from
+// (or half of it is returned to) the chunked blocks while holding the lock, which bounds
+// the amount of memory that can be stuck in thread caches.
+static constexpr size_t number_of_thread_cached_size_classes = 7;
+static constexpr size_t thread_cache_bin_capacity = 16;
+static_assert(number_of_thread_cached_size_classes <= num_size_classes);
+
+struct ThreadCacheBin {
+    size_t count { 0 };
+    void* chunks[thread_cache_bin_capacity] {};
+};
+
+struct ThreadCache {
+    bool is_destroyed { false };
+    ThreadCacheBin bins[number_of_thread_cached_size_classes];
+};
+
+static bool s_thread_caches_enabled = true;
+static __thread ThreadCache t_thread_cache;
+
+static ThreadCacheBin* thread_cache_bin_for_size_class(size_t size_class_index)
+{
+    if (!s_thread_caches_enabled || t_thread_cache.is_destroyed)
+        return nullptr;
+    if (size_class_index >= number_of_thread_cached_size_classes)
+        return nullptr;
+    return &t_thread_cache.bins[size_class_index];
+}
+
+static size_t size_class_index_for_chunk_size(size_t bytes_per_chunk)
+{
+    for (size_t i = 0; size_classes[i]; ++i) {
+        if (size_classes[i] == bytes_per_chunk)
+            return i;
+    }
+    VERIFY_NOT_REACHED();
+}
+#endif
+
 // --- BEGIN MATH ---
 // This stuff is only used for checking if there exists an aligned block in a
 // chunk. It has no bearing on the rest of the allocator, especially for
@@ -284,6 +330,82 @@ static void* try_allocate_chunk_aligned(size_t align, ChunkedBlock& block)
     return nullptr;
 }
 
+// NOTE: Must be called with s_malloc_mutex held.
+static ErrorOr<void*> allocate_chunk(Allocator& allocator, size_t good_size, size_t align)
+{
+    ChunkedBlock* block = nullptr;
+    void* ptr = nullptr;
+    for (auto& current : allocator.usable_blocks) {
+        if (current.free_chunks()) {
+            ptr = try_allocate_chunk_aligned(align, current);
+            if (ptr) {
+                block = &current;
+                break;
+            }
+        }
+    }
+
+    if (!block && s_hot_empty_block_count) {
+        g_malloc_stats.number_of_hot_empty_block_hits++;
+        block = s_hot_empty_blocks[--s_hot_empty_block_count];
+        if (block->m_size != good_size) {
+            new (block) ChunkedBlock(good_size);
+            ue_notify_chunk_size_changed(block, good_size);
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), "malloc: ChunkedBlock(%zu)", good_size);
+            set_mmap_name(block, ChunkedBlock::block_size, buffer);
+        }
+        allocator.usable_blocks.append(*block);
+    }
+
+    if (!block && s_cold_empty_block_count) {
+        g_malloc_stats.number_of_cold_empty_block_hits++;
+        block = s_cold_empty_blocks[--s_cold_empty_block_count];
+        int rc = madvise(block, ChunkedBlock::block_size, MADV_SET_NONVOLATILE);
+        bool this_block_was_purged = rc == 1;
+        if (rc < 0) {
+            perror("madvise");
+            VERIFY_NOT_REACHED();
+        }
+        rc = mprotect(block, ChunkedBlock::block_size, PROT_READ | PROT_WRITE);
+        if (rc < 0) {
+            perror("mprotect");
+            VERIFY_NOT_REACHED();
+        }
+        if (this_block_was_purged || block->m_size != good_size) {
+            if (this_block_was_purged)
+                g_malloc_stats.number_of_cold_empty_block_purge_hits++;
+            new (block) ChunkedBlock(good_size);
+            ue_notify_chunk_size_changed(block, good_size);
+        }
+        allocator.usable_blocks.append(*block);
+    }
+
+    if (!block) {
+        g_malloc_stats.number_of_block_allocs++;
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "malloc: ChunkedBlock(%zu)", good_size);
+        block = (ChunkedBlock*)TRY(os_alloc(ChunkedBlock::block_size, buffer));
+        new (block) ChunkedBlock(good_size);
+        allocator.usable_blocks.append(*block);
+        ++allocator.block_count;
+    }
+
+    if (!ptr) {
+        ptr = try_allocate_chunk_aligned(align, *block);
+    }
+
+    VERIFY(ptr);
+    if (block->is_full()) {
+        g_malloc_stats.number_of_blocks_full++;
+        dbgln_if(MALLOC_DEBUG, "Block {:p} is now full in size class {}", block, good_size);
+        allocator.usable_blocks.remove(*block);
+        allocator.full_blocks.append(*block);
+    }
+    dbgln_if(MALLOC_DEBUG, "LibC: allocated {:p} (chunk in block {:p}, size {})", ptr, block, block->bytes_per_chunk());
+    return ptr;
+}
+
 enum class CallerWillInitializeMemory {
     No,
     Yes,
@@ -321,9 +443,8 @@ static ErrorOr<void*> malloc_impl(size_t size, size_t align, CallerWillInitializ
     size_t good_size;
     auto* allocator = allocator_for_size(size, good_size, align);
 
-    PthreadMutexLocker locker(s_malloc_mutex);
-
     if (!allocator) {
+        PthreadMutexLocker locker(s_malloc_mutex);
         size_t real_size = round_up_to_power_of_two(sizeof(BigAllocationBlock) + size + ((align > 16) ? align : 0), ChunkedBlock::block_size);
         if (real_size < size) {
             dbgln_if(MALLOC_DEBUG, "LibC: Detected overflow trying to do big allocation of size {} for {}", real_size, size);
@@ -365,82 +486,91 @@ static ErrorOr<void*> malloc_impl(size_t size, size_t align, CallerWillInitializ
         return ptr;
     }
 
-    ChunkedBlock* block = nullptr;
-    void* ptr = nullptr;
-    for (auto& current : allocator->usable_blocks) {
-        if (current.free_chunks()) {
-            ptr = try_allocate_chunk_aligned(align, current);
-            if (ptr) {
-                block = &current;
-                break;
+#ifndef NO_TLS
+    if (align <= 16) {
+        auto size_class_index = allocator - &allocators()[0];
+        if (auto* bin = thread_cache_bin_for_size_class(size_class_index)) {
+            if (bin->count == 0) {
+                // Grab half a bin's worth of chunks, so the next few allocations of this size don't need the lock.
+                PthreadMutexLocker locker(s_malloc_mutex);
+                g_malloc_stats.number_of_thread_cache_refills++;
+                for (size_t i = 0; i < thread_cache_bin_capacity / 2; ++i) {
+                    auto chunk_or_error = allocate_chunk(*allocator, good_size, align);
+                    if (chunk_or_error.is_error()) {
+                        if (bin->count == 0)
+                            return chunk_or_error.release_error();
+                        break;
+                    }
+                    bin->chunks[bin->count++] = chunk_or_error.release_value();
+                }
             }
-        }
-    }
 
-    if (!block && s_hot_empty_block_count) {
-        g_malloc_stats.number_of_hot_empty_block_hits++;
-        block = s_hot_empty_blocks[--s_hot_empty_block_count];
-        if (block->m_size != good_size) {
-            new (block) ChunkedBlock(good_size);
-            ue_notify_chunk_size_changed(block, good_size);
-            char buffer[64];
-            snprintf(buffer, sizeof(buffer), "malloc: ChunkedBlock(%zu)", good_size);
-            set_mmap_name(block, ChunkedBlock::block_size, buffer);
-        }
-        allocator->usable_blocks.append(*block);
-    }
+            void* ptr = bin->chunks[--bin->count];
+            if (s_scrub_malloc && caller_will_initialize_memory == CallerWillInitializeMemory::No)
+                memset(ptr, MALLOC_SCRUB_BYTE, good_size);
 
-    if (!block && s_cold_empty_block_count) {
-        g_malloc_stats.number_of_cold_empty_block_hits++;
-        block = s_cold_empty_blocks[--s_cold_empty_block_count];
-        int rc = madvise(block, ChunkedBlock::block_size, MADV_SET_NONVOLATILE);
-        bool this_block_was_purged = rc == 1;
-        if (rc < 0) {
-            perror("madvise");
-            VERIFY_NOT_REACHED();
-        }
-        rc = mprotect(block, ChunkedBlock::block_size, PROT_READ | PROT_WRITE);
-        if (rc < 0) {
-            perror("mprotect");
-            VERIFY_NOT_REACHED();
-        }
-        if (this_block_was_purged || block->m_size != good_size) {
-            if (this_block_was_purged)
-                g_malloc_stats.number_of_cold_empty_block_purge_hits++;
-            new (block) ChunkedBlock(good_size);
-            ue_notify_chunk_size_changed(block, good_size);
+            ue_notify_malloc(ptr, size);
+            return ptr;
         }
-        allocator->usable_blocks.append(*block);
     }
+#endif
 
-    if (!block) {
-        g_malloc_stats.number_of_block_allocs++;
-        char buffer[64];
-        snprintf(buffer, sizeof(buffer), "malloc: ChunkedBlock(%zu)", good_size);
-        block = (ChunkedBlock*)TRY(os_alloc(ChunkedBlock::block_size, buffer));
-        new (block) ChunkedBlock(good_size);
-        allocator->usable_blocks.append(*block);
-        ++allocator->block_count;
-    }
+    PthreadMutexLocker locker(s_malloc_mutex);
+    void* ptr = TRY(allocate_chunk(*allocator, good_size, align));
 
-    if (!ptr) {
-        ptr = try_allocate_chunk_aligned(align, *block);
-    }
+    if (s_scrub_malloc && caller_will_initialize_memory == CallerWillInitializeMemory::No)
+        memset(ptr, MALLOC_SCRUB_BYTE, good_size);
+
+    ue_notify_malloc(ptr, size);
+    return ptr;
+}
+
+// NOTE: Must be called with s_malloc_mutex held.
+static void free_chunk(void* ptr)
+{
+    auto* block = (ChunkedBlock*)((FlatPtr)ptr & ChunkedBlock::block_mask);
+    VERIFY(block->m_magic == MAGIC_PAGE_HEADER);
+
+    auto* entry = (FreelistEntry*)ptr;
+    entry->next = block->m_freelist;
+    block->m_freelist = entry;
 
-    VERIFY(ptr);
     if (block->is_full()) {
-        g_malloc_stats.number_of_blocks_full++;
-        dbgln_if(MALLOC_DEBUG, "Block {:p} is now full in size class {}", block, good_size);
-        allocator->usable_blocks.remove(*block);
-        allocator->full_blocks.append(*block);
+        size_t good_size;
+        auto* allocator = allocator_for_size(block->m_size, good_size);
+        dbgln_if(MALLOC_DEBUG, "Block {:p} no longer full in size class {}", block, good_size);
+        g_malloc_stats.number_of_freed_full_blocks++;
+        allocator->full_blocks.remove(*block);
+        allocator->usable_blocks.prepend(*block);
     }
-    dbgln_if(MALLOC_DEBUG, "LibC: allocated {:p} (chunk in block {:p}, size {})", ptr, block, block->bytes_per_chunk());
 
-    if (s_scrub_malloc && caller_will_initialize_memory == CallerWillInitializeMemory::No)
-        memset(ptr, MALLOC_SCRUB_BYTE, block->m_size);
+    ++block->m_free_chunks;
 
-    ue_notify_malloc(ptr, size);
-    return ptr;
+    if (!block->used_chunks()) {
+        size_t good_size;
+        auto* allocator = allocator_for_size(block->m_size, good_size);
+        if (s_hot_empty_block_count < number_of_hot_chunked_blocks_to_keep_around) {
+            dbgln_if(MALLOC_DEBUG, "Keeping hot block {:p} around", block);
+            g_malloc_stats.number_of_hot_keeps++;
+            allocator->usable_blocks.remove(*block);
+            s_hot_empty_blocks[s_hot_empty_block_count++] = block;
+            return;
+        }
+        if (s_cold_empty_block_count < number_of_cold_chunked_blocks_to_keep_around) {
+            dbgln_if(MALLOC_DEBUG, "Keeping cold block {:p} around", block);
+            g_malloc_stats.number_of_cold_keeps++;
+            allocator->usable_blocks.remove(*block);
+            s_cold_empty_blocks[s_cold_empty_block_count++] = block;
+            mprotect(block, ChunkedBlock::block_size, PROT_NONE);
+            madvise(block, ChunkedBlock::block_size, MADV_SET_VOLATILE);
+            return;
+        }
+        dbgln_if(MALLOC_DEBUG, "Releasing block {:p} for size class {}", block, good_size);
+        g_malloc_stats.number_of_frees++;
+        allocator->usable_blocks.remove(*block);
+        --allocator->block_count;
+        os_free(block, ChunkedBlock::block_size);
+    }
 }
 
 static void free_impl(void* ptr)
@@ -459,9 +589,8 @@ static void free_impl(void* ptr)
     void* block_base = (void*)((FlatPtr)ptr & ChunkedBlock::ChunkedBlock::block_mask);
     size_t magic = *(size_t*)block_base;
 
-    PthreadMutexLocker locker(s_malloc_mutex);
-
     if (magic == MAGIC_BIGALLOC_HEADER) {
+        PthreadMutexLocker locker(s_malloc_mutex);
         auto* block = (BigAllocationBlock*)block_base;
 #ifdef RECYCLE_BIG_ALLOCATIONS
         if (auto* allocator = big_allocator_for_size(block->m_size)) {
@@ -494,46 +623,28 @@ static void free_impl(void* ptr)
     if (s_scrub_free)
         memset(ptr, FREE_SCRUB_BYTE, block->bytes_per_chunk());
 
-    auto* entry = (FreelistEntry*)ptr;
-    entry->next = block->m_freelist;
-    block->m_freelist = entry;
-
-    if (block->is_full()) {
-        size_t good_size;
-        auto* allocator = allocator_for_size(block->m_size, good_size);
-        dbgln_if(MALLOC_DEBUG, "Block {:p} no longer full in size class {}", block, good_size);
-        g_malloc_stats.number_of_freed_full_blocks++;
-        allocator->full_blocks.remove(*block);
-        allocator->usable_blocks.prepend(*block);
-    }
-
-    ++block->m_free_chunks;
-
-    if (!block->used_chunks()) {
-        size_t good_size;
-        auto* allocator = allocator_for_size(block->m_size, good_size);
-        if (s_hot_empty_block_count < number_of_hot_chunked_blocks_to_keep_around) {
-            dbgln_if(MALLOC_DEBUG, "Keeping hot block {:p} around", block);
-            g_malloc_stats.number_of_hot_keeps++;
-            allocator->usable_blocks.remove(*block);
-            s_hot_empty_blocks[s_hot_empty_block_count++] = block;
-            return;
-        }
-        if (s_cold_empty_block_count < number_of_cold_chunked_blocks_to_keep_around) {
-            dbgln_if(MALLOC_DEBUG, "Keeping cold block {:p} around", block);
-            g_malloc_stats.number_of_cold_keeps++;
-            allocator->usable_blocks.remove(*block);
-            s_cold_empty_blocks[s_cold_empty_block_count++] = block;
-            mprotect(block, ChunkedBlock::block_size, PROT_NONE);
-            madvise(block, ChunkedBlock::block_size, MADV_SET_VOLATILE);
+#ifndef NO_TLS
+    if (auto* bin = thread_cache_bin_for_size_class(size_class_index_for_chunk_size(block->bytes_per_chunk()))) {
+        if (bin->count < thread_cache_bin_capacity) {
+            bin->chunks[bin->count++] = ptr;
             return;
         }
-        dbgln_if(MALLOC_DEBUG, "Releasing block {:p} for size class {}", block, good_size);
-        g_malloc_stats.number_of_frees++;
-        allocator->usable_blocks.remove(*block);
-        --allocator->block_count;
-        os_free(block, ChunkedBlock::block_size);
+
+        // The bin is full, so hand the older half of it back to the chunked blocks.
+        PthreadMutexLocker locker(s_malloc_mutex);
+        g_malloc_stats.number_of_thread_cache_flushes++;
+        constexpr size_t chunks_to_flush = thread_cache_bin_capacity / 2;
+        for (size_t i = 0; i < chunks_to_flush; ++i)
+            free_chunk(bin->chunks[i]);
+        memmove(&bin->chunks[0], &bin->chunks[chunks_to_flush], (bin->count - chunks_to_flush) * sizeof(void*));
+        bin->count -= chunks_to_flush;
+        bin->chunks[bin->count++] = ptr;
+        return;
     }
+#endif
+
+    PthreadMutexLocker locker(s_malloc_mutex);
+    free_chunk(ptr);
 }
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/malloc.html
@@ -680,6 +791,28 @@ void __malloc_init()
     }
 
     new (&big_allocators()[0])(BigAllocator);
+
+#ifndef NO_TLS
+    // Chunks sitting in a thread cache look like live allocations to UE.
+    if (s_in_userspace_emulator)
+        s_thread_caches_enabled = false;
+#endif
+}
+
+void __malloc_destroy_thread_cache()
+{
+#ifndef NO_TLS
+    if (t_thread_cache.is_destroyed)
+        return;
+
+    PthreadMutexLocker locker(s_malloc_mutex);
+    for (auto& bin : t_thread_cache.bins) {
+        while (bin.count)
+            free_chunk(bin.chunks[--bin.count]);
+    }
+    // Any free() after this point (e.g. from late TLS destructors) goes straight to the chunked blocks.
+    t_thread_cache.is_destroyed = true;
+#endif
 }
 
 void serenity_dump_malloc_stats()
@@ -705,5 +838,8 @@ void serenity_dump_malloc_stats()
     dbgln("number of hot keeps: {}", g_malloc_stats.number_of_hot_keeps);
     dbgln("number of cold keeps: {}", g_malloc_stats.number_of_cold_keeps);
     dbgln("number of frees: {}", g_malloc_stats.number_of_frees);
+    dbgln();
+    dbgln("thread cache refills: {}", g_malloc_stats.number_of_thread_cache_refills);
+    dbgln("thread cache flushes: {}", g_malloc_stats.number_of_thread_cache_flushes);
 }
 }
@@ -38,6 +38,12 @@ int profiling_free_buffer(pid_t pid)
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
 
+int profiling_stream(pid_t pid, uint64_t event_mask)
+{
+    int rc = syscall(SC_profiling_stream, pid, event_mask);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
 int futex(uint32_t* userspace_address, int futex_op, uint32_t value, const struct timespec* timeout, uint32_t* userspace_address2, uint32_t value3)
 {
     int rc;
@@ -13,19 +13,101 @@
 
 #include <spawn.h>
 
-#include <AK/Function.h>
+#include <AK/DeprecatedString.h>
 #include <AK/Vector.h>
+#include <LibFileSystem/FileSystem.h>
+#include <alloca.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <syscall.h>
 #include <unistd.h>
 
 struct posix_spawn_file_actions_state {
-    Vector<Function<int()>, 4> actions;
+    Vector<Syscall::SpawnFileAction, 4> actions;
 };
 
+static int run_file_action(Syscall::SpawnFileAction const& action)
+{
+    switch (action.type) {
+    case Syscall::SpawnFileAction::Type::Open: {
+        int opened_fd = open(action.path.characters, action.flags, action.mode);
+        if (opened_fd < 0 || opened_fd == action.fd)
+            return opened_fd;
+        if (int rc = dup2(opened_fd, action.fd); rc < 0)
+            return rc;
+        return close(opened_fd);
+    }
+    case Syscall::SpawnFileAction::Type::Close:
+        return close(action.fd);
+    case Syscall::SpawnFileAction::Type::Dup2:
+        return dup2(action.old_fd, action.fd);
+    case Syscall::SpawnFileAction::Type::Chdir:
+        return chdir(action.path.characters);
+    case Syscall::SpawnFileAction::Type::Fchdir:
+        return fchdir(action.fd);
+    }
+    VERIFY_NOT_REACHED();
+}
+
+// Everything but signal setup has to happen in a forked child that runs the attribute actions itself.
+static bool can_spawn_in_kernel(posix_spawnattr_t const* attr)
+{
+    return !attr || (attr->flags & ~(POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK)) == 0;
+}
+
+// Asks the kernel to create the child and exec the program directly, so that none of our address space has to be copied.
+static int spawn_in_kernel(pid_t* out_pid, char const* path, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, char* const argv[], char* const envp[])
+{
+    size_t arg_count = 0;
+    for (size_t i = 0; argv[i]; ++i)
+        ++arg_count;
+
+    size_t env_count = 0;
+    for (size_t i = 0; envp[i]; ++i)
+        ++env_count;
+
+    auto copy_strings = [&](auto& vec, size_t count, auto& output) {
+        output.length = count;
+        for (size_t i = 0; vec[i]; ++i) {
+            output.strings[i].characters = vec[i];
+            output.strings[i].length = strlen(vec[i]);
+        }
+    };
+
+    Syscall::SC_posix_spawn_params params {};
+    params.arguments.strings = (Syscall::StringArgument*)alloca(arg_count * sizeof(Syscall::StringArgument));
+    params.environment.strings = (Syscall::StringArgument*)alloca(env_count * sizeof(Syscall::StringArgument));
+
+    params.path = { path, strlen(path) };
+    copy_strings(argv, arg_count, params.arguments);
+    copy_strings(envp, env_count, params.environment);
+
+    if (file_actions) {
+        params.file_actions = file_actions->state->actions.data();
+        params.file_actions_count = file_actions->state->actions.size();
+    }
+
+    if (attr) {
+        if (attr->flags & POSIX_SPAWN_SETSIGMASK) {
+            params.set_signal_mask = true;
+            params.signal_mask = attr->sigmask;
+        }
+        if (attr->flags & POSIX_SPAWN_SETSIGDEF)
+            params.default_signals = attr->sigdefault;
+    }
+
+    int rc = syscall(SC_posix_spawn, &params);
+    if (rc < 0)
+        return -rc;
+    *out_pid = rc;
+    return 0;
+}
+
 extern "C" {
 
 [[noreturn]] static void posix_spawn_child(char const* path, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, char* const argv[], char* const envp[], int (*exec)(char const*, char* const[], char* const[]))
@@ -86,7 +168,7 @@ extern "C" {
 
     if (file_actions) {
         for (auto const& action : file_actions->state->actions) {
-            if (action() < 0) {
+            if (run_file_action(action) < 0) {
                 perror("posix_spawn file action");
                 _exit(127);
             }
@@ -101,6 +183,9 @@ extern "C" {
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawn.html
 int posix_spawn(pid_t* out_pid, char const* path, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, char* const argv[], char* const envp[])
 {
+    if (can_spawn_in_kernel(attr))
+        return spawn_in_kernel(out_pid, path, file_actions, attr, argv, envp);
+
     pid_t child_pid = fork();
     if (child_pid < 0)
         return errno;
@@ -116,6 +201,24 @@ int posix_spawn(pid_t* out_pid, char const* path, posix_spawn_file_actions_t con
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawnp.html
 int posix_spawnp(pid_t* out_pid, char const* file, posix_spawn_file_actions_t const* file_actions, posix_spawnattr_t const* attr, char* const argv[], char* const envp[])
 {
+    if (can_spawn_in_kernel(attr)) {
+        if (strchr(file, '/'))
+            return spawn_in_kernel(out_pid, file, file_actions, attr, argv, envp);
+
+        // Same PATH search as execvpe(). The executable is looked up before spawning, so that the file actions
+        // only run once, in the one child we actually create.
+        DeprecatedString path = getenv("PATH");
+        if (path.is_empty())
+            path = DEFAULT_PATH;
+        for (auto& part : path.split(':')) {
+            auto candidate = DeprecatedString::formatted("{}/{}", part, file);
+            struct stat st;
+            if (stat(candidate.characters(), &st) == 0 && S_ISREG(st.st_mode) && access(candidate.characters(), X_OK) == 0)
+                return spawn_in_kernel(out_pid, candidate.characters(), file_actions, attr, argv, envp);
+        }
+        return ENOENT;
+    }
+
     pid_t child_pid = fork();
     if (child_pid < 0)
         return errno;
@@ -131,41 +234,34 @@ int posix_spawnp(pid_t* out_pid, char const* file, posix_spawn_file_actions_t co
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawn_file_actions_addchdir.html
 int posix_spawn_file_actions_addchdir(posix_spawn_file_actions_t* actions, char const* path)
 {
-    actions->state->actions.append([path]() { return chdir(path); });
+    actions->state->actions.append({ .type = Syscall::SpawnFileAction::Type::Chdir, .path = { path, strlen(path) } });
     return 0;
 }
 
 int posix_spawn_file_actions_addfchdir(posix_spawn_file_actions_t* actions, int fd)
 {
-    actions->state->actions.append([fd]() { return fchdir(fd); });
+    actions->state->actions.append({ .type = Syscall::SpawnFileAction::Type::Fchdir, .fd = fd });
     return 0;
 }
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawn_file_actions_addclose.html
 int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t* actions, int fd)
 {
-    actions->state->actions.append([fd]() { return close(fd); });
+    actions->state->actions.append({ .type = Syscall::SpawnFileAction::Type::Close, .fd = fd });
     return 0;
 }
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawn_file_actions_adddup2.html
 int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t* actions, int old_fd, int new_fd)
 {
-    actions->state->actions.append([old_fd, new_fd]() { return dup2(old_fd, new_fd); });
+    actions->state->actions.append({ .type = Syscall::SpawnFileAction::Type::Dup2, .fd = new_fd, .old_fd = old_fd });
     return 0;
 }
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/posix_spawn_file_actions_addopen.html
 int posix_spawn_file_actions_addopen(posix_spawn_file_actions_t* actions, int want_fd, char const* path, int flags, mode_t mode)
 {
-    actions->state->actions.append([want_fd, path, flags, mode]() {
-        int opened_fd = open(path, flags, mode);
-        if (opened_fd < 0 || opened_fd == want_fd)
-            return opened_fd;
-        if (int rc = dup2(opened_fd, want_fd); rc < 0)
-            return rc;
-        return close(opened_fd);
-    });
+    actions->state->actions.append({ .type = Syscall::SpawnFileAction::Type::Open, .fd = want_fd, .flags = flags, .mode = mode, .path = { path, strlen(path) } });
     return 0;
 }
 
@@ -50,6 +50,9 @@ size_t strcspn(char const* s, char const* reject)
 }
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/strlen.html
+// For x86-64, optimized ASM implementations are found in ./arch/x86_64/strlen.S
+#if ARCH(X86_64)
+#else
 size_t strlen(char const* str)
 {
     size_t len = 0;
@@ -57,6 +60,7 @@ size_t strlen(char const* str)
         ++len;
     return len;
 }
+#endif
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/strnlen.html
 size_t strnlen(char const* str, size_t maxlen)
@@ -134,22 +138,18 @@ int timingsafe_memcmp(void const* b1, void const* b2, size_t len)
 }
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/memcpy.html
-void* memcpy(void* dest_ptr, void const* src_ptr, size_t n)
-{
+// For x86-64, optimized ASM implementations are found in ./arch/x86_64/memcpy.S
 #if ARCH(X86_64)
-    void* original_dest = dest_ptr;
-    asm volatile(
-        "rep movsb"
-        : "+D"(dest_ptr), "+S"(src_ptr), "+c"(n)::"memory");
-    return original_dest;
 #else
+void* memcpy(void* dest_ptr, void const* src_ptr, size_t n)
+{
     u8* pd = (u8*)dest_ptr;
     u8 const* ps = (u8 const*)src_ptr;
     for (; n--;)
         *pd++ = *ps++;
     return dest_ptr;
-#endif
 }
+#endif
 
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/memccpy.html
 void* memccpy(void* dest_ptr, void const* src_ptr, int c, size_t n)
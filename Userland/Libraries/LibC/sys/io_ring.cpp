@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <bits/pthread_cancel.h>
+#include <errno.h>
+#include <sys/io_ring.h>
+#include <syscall.h>
+
+extern "C" {
+
+int io_ring_setup(unsigned entries, io_ring_params* params, int flags)
+{
+    int rc = syscall(SC_io_ring_setup, entries, params, flags);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
+int io_ring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, timespec const* timeout)
+{
+    // Waiting for completions can block indefinitely, just like the operations themselves.
+    if (min_complete > 0)
+        __pthread_maybe_cancel();
+
+    Syscall::SC_io_ring_enter_params params { ring_fd, to_submit, min_complete, timeout };
+    int rc = syscall(SC_io_ring_enter, &params);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+}
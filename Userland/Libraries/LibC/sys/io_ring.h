@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/API/POSIX/sys/io_ring.h>
+#include <sys/cdefs.h>
+#include <time.h>
+
+__BEGIN_DECLS
+
+int io_ring_setup(unsigned entries, struct io_ring_params* params, int flags);
+int io_ring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, const struct timespec* timeout);
+
+__END_DECLS
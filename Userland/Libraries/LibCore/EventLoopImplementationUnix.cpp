@@ -19,6 +19,10 @@
 #include <sys/select.h>
 #include <unistd.h>
 
+#ifdef AK_OS_SERENITY
+#    include <sys/epoll.h>
+#endif
+
 namespace Core {
 
 struct ThreadData;
@@ -53,6 +57,9 @@ struct ThreadData {
     {
         pid = getpid();
         initialize_wake_pipe();
+#ifdef AK_OS_SERENITY
+        initialize_event_poll();
+#endif
     }
 
     void initialize_wake_pipe()
@@ -73,10 +80,70 @@ struct ThreadData {
         VERIFY(rc == 0);
     }
 
+#ifdef AK_OS_SERENITY
+    void initialize_event_poll()
+    {
+        if (epoll_fd != -1)
+            close(epoll_fd);
+        notifiers_by_fd.clear();
+
+        // If we can't get an event poll instance for some reason, we'll just fall back to select().
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            epoll_fd = -1;
+            return;
+        }
+
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = wake_pipe_fds[0];
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_pipe_fds[0], &event) < 0) {
+            close(epoll_fd);
+            epoll_fd = -1;
+        }
+    }
+
+    // Tells the kernel which events we care about on the given fd, based on the notifiers that are registered for it.
+    void update_event_poll_interest(int fd)
+    {
+        VERIFY(epoll_fd != -1);
+
+        auto it = notifiers_by_fd.find(fd);
+        if (it == notifiers_by_fd.end()) {
+            // NOTE: This fails harmlessly if the fd was closed before its notifier was unregistered.
+            (void)epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            return;
+        }
+
+        epoll_event event {};
+        event.data.fd = fd;
+        for (auto* notifier : it->value) {
+            if (notifier->type() == Notifier::Type::Read)
+                event.events |= EPOLLIN;
+            if (notifier->type() == Notifier::Type::Write)
+                event.events |= EPOLLOUT;
+            if (notifier->type() == Notifier::Type::Exceptional)
+                TODO();
+        }
+
+        // The fd may have been closed and reused since we last told the kernel about it, in which case
+        // the old interest is gone, and we have to start over.
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) < 0 && errno == ENOENT)
+            (void)epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+#endif
+
     // Each thread has its own timers, notifiers and a wake pipe.
     HashMap<int, NonnullOwnPtr<EventLoopTimer>> timers;
     HashTable<Notifier*> notifiers;
 
+#ifdef AK_OS_SERENITY
+    // With an event poll instance, the kernel keeps track of our notifiers, so we don't have to pass them in
+    // again each time we wait for events. The kernel only knows about fds though, so we need to map back.
+    int epoll_fd { -1 };
+    HashMap<int, Vector<Notifier*, 1>> notifiers_by_fd;
+#endif
+
     // The wake pipe is used to notify another event loop that someone has called wake(), or a signal has been received.
     // wake() writes 0i32 into the pipe, signals write the signal number (guaranteed non-zero).
     int wake_pipe_fds[2] { -1, -1 };
@@ -143,6 +210,13 @@ void EventLoopManagerUnix::wait_for_events(EventLoopImplementation::PumpMode mod
 {
     auto& thread_data = ThreadData::the();
 
+#ifdef AK_OS_SERENITY
+    if (thread_data.epoll_fd != -1) {
+        wait_for_events_with_event_poll(mode);
+        return;
+    }
+#endif
+
     fd_set read_fds {};
     fd_set write_fds {};
 retry:
@@ -165,28 +239,14 @@ retry:
             TODO();
     }
 
-    bool has_pending_events = ThreadEventQueue::current().has_pending_events();
-
-    // Figure out how long to wait at maximum.
-    // This mainly depends on the PumpMode and whether we have pending events, but also the next expiring timer.
     struct timeval timeout = { 0, 0 };
-    bool should_wait_forever = false;
-    if (mode == EventLoopImplementation::PumpMode::WaitForEvents && !has_pending_events) {
-        auto next_timer_expiration = get_next_timer_expiration();
-        if (next_timer_expiration.has_value()) {
-            auto now = MonotonicTime::now_coarse();
-            auto computed_timeout = next_timer_expiration.value() - now;
-            if (computed_timeout.is_negative())
-                computed_timeout = Duration::zero();
-            timeout = computed_timeout.to_timeval();
-        } else {
-            should_wait_forever = true;
-        }
-    }
+    auto wait_timeout = compute_wait_timeout(mode);
+    if (wait_timeout.has_value())
+        timeout = wait_timeout->to_timeval();
 
 try_select_again:
     // select() and wait for file system events, calls to wake(), POSIX signals, or timer expirations.
-    int marked_fd_count = select(max_fd + 1, &read_fds, &write_fds, nullptr, should_wait_forever ? nullptr : &timeout);
+    int marked_fd_count = select(max_fd + 1, &read_fds, &write_fds, nullptr, wait_timeout.has_value() ? &timeout : nullptr);
     // Because POSIX, we might spuriously return from select() with EINTR; just select again.
     if (marked_fd_count < 0) {
         int saved_errno = errno;
@@ -199,58 +259,11 @@ try_select_again:
     // We woke up due to a call to wake() or a POSIX signal.
     // Handle signals and see whether we need to handle events as well.
     if (FD_ISSET(thread_data.wake_pipe_fds[0], &read_fds)) {
-        int wake_events[8];
-        ssize_t nread;
-        // We might receive another signal while read()ing here. The signal will go to the handle_signal properly,
-        // but we get interrupted. Therefore, just retry while we were interrupted.
-        do {
-            errno = 0;
-            nread = read(thread_data.wake_pipe_fds[0], wake_events, sizeof(wake_events));
-            if (nread == 0)
-                break;
-        } while (nread < 0 && errno == EINTR);
-        if (nread < 0) {
-            perror("EventLoopImplementationUnix::wait_for_events: read from wake pipe");
-            VERIFY_NOT_REACHED();
-        }
-        VERIFY(nread > 0);
-        bool wake_requested = false;
-        int event_count = nread / sizeof(wake_events[0]);
-        for (int i = 0; i < event_count; i++) {
-            if (wake_events[i] != 0)
-                dispatch_signal(wake_events[i]);
-            else
-                wake_requested = true;
-        }
-
-        if (!wake_requested && nread == sizeof(wake_events))
+        if (drain_wake_pipe())
             goto retry;
     }
 
-    // Handle expired timers.
-    if (!thread_data.timers.is_empty()) {
-        auto now = MonotonicTime::now_coarse();
-
-        for (auto& it : thread_data.timers) {
-            auto& timer = *it.value;
-            if (!timer.has_expired(now))
-                continue;
-            auto owner = timer.owner.strong_ref();
-            if (timer.fire_when_not_visible == TimerShouldFireWhenNotVisible::No
-                && owner && !owner->is_visible_for_timer_purposes()) {
-                continue;
-            }
-
-            if (owner)
-                ThreadEventQueue::current().post_event(*owner, make<TimerEvent>(timer.timer_id));
-            if (timer.should_reload) {
-                timer.reload(now);
-            } else {
-                // FIXME: Support removing expired timers that don't want to reload.
-                VERIFY_NOT_REACHED();
-            }
-        }
-    }
+    handle_expired_timers();
 
     if (!marked_fd_count)
         return;
@@ -266,6 +279,137 @@ try_select_again:
     }
 }
 
+#ifdef AK_OS_SERENITY
+void EventLoopManagerUnix::wait_for_events_with_event_poll(EventLoopImplementation::PumpMode mode)
+{
+    auto& thread_data = ThreadData::the();
+
+    // Unlike with select(), the kernel remembers which fds we are interested in, so all we need to do here
+    // is wait, and then look at whatever it tells us is ready.
+    epoll_event events[64];
+    int event_count;
+retry:
+    auto wait_timeout = compute_wait_timeout(mode);
+    timespec timeout {};
+    if (wait_timeout.has_value())
+        timeout = wait_timeout->to_timespec();
+
+    do {
+        event_count = epoll_pwait2(thread_data.epoll_fd, events, array_size(events), wait_timeout.has_value() ? &timeout : nullptr, nullptr);
+    } while (event_count < 0 && errno == EINTR);
+    if (event_count < 0) {
+        int saved_errno = errno;
+        dbgln("EventLoopImplementationUnix::wait_for_events: {} ({}: {})", event_count, saved_errno, strerror(saved_errno));
+        VERIFY_NOT_REACHED();
+    }
+
+    for (int i = 0; i < event_count; ++i) {
+        if (events[i].data.fd == thread_data.wake_pipe_fds[0]) {
+            if (drain_wake_pipe())
+                goto retry;
+            break;
+        }
+    }
+
+    handle_expired_timers();
+
+    for (int i = 0; i < event_count; ++i) {
+        int fd = events[i].data.fd;
+        if (fd == thread_data.wake_pipe_fds[0])
+            continue;
+        auto it = thread_data.notifiers_by_fd.find(fd);
+        if (it == thread_data.notifiers_by_fd.end())
+            continue;
+        // Like select(), report errors and hang-ups to both readers and writers, so that they get to find out about them.
+        bool is_readable = events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP);
+        bool is_writable = events[i].events & (EPOLLOUT | EPOLLERR);
+        for (auto* notifier : it->value) {
+            if ((notifier->type() == Notifier::Type::Read && is_readable) || (notifier->type() == Notifier::Type::Write && is_writable))
+                ThreadEventQueue::current().post_event(*notifier, make<NotifierActivationEvent>(fd));
+        }
+    }
+}
+#endif
+
+Optional<Duration> EventLoopManagerUnix::compute_wait_timeout(EventLoopImplementation::PumpMode mode)
+{
+    // Figure out how long to wait at maximum.
+    // This mainly depends on the PumpMode and whether we have pending events, but also the next expiring timer.
+    bool has_pending_events = ThreadEventQueue::current().has_pending_events();
+    if (mode != EventLoopImplementation::PumpMode::WaitForEvents || has_pending_events)
+        return Duration::zero();
+
+    auto next_timer_expiration = get_next_timer_expiration();
+    if (!next_timer_expiration.has_value())
+        return {};
+
+    auto now = MonotonicTime::now_coarse();
+    auto computed_timeout = next_timer_expiration.value() - now;
+    if (computed_timeout.is_negative())
+        computed_timeout = Duration::zero();
+    return computed_timeout;
+}
+
+bool EventLoopManagerUnix::drain_wake_pipe()
+{
+    auto& thread_data = ThreadData::the();
+
+    int wake_events[8];
+    ssize_t nread;
+    // We might receive another signal while read()ing here. The signal will go to the handle_signal properly,
+    // but we get interrupted. Therefore, just retry while we were interrupted.
+    do {
+        errno = 0;
+        nread = read(thread_data.wake_pipe_fds[0], wake_events, sizeof(wake_events));
+        if (nread == 0)
+            break;
+    } while (nread < 0 && errno == EINTR);
+    if (nread < 0) {
+        perror("EventLoopImplementationUnix::wait_for_events: read from wake pipe");
+        VERIFY_NOT_REACHED();
+    }
+    VERIFY(nread > 0);
+    bool wake_requested = false;
+    int event_count = nread / sizeof(wake_events[0]);
+    for (int i = 0; i < event_count; i++) {
+        if (wake_events[i] != 0)
+            dispatch_signal(wake_events[i]);
+        else
+            wake_requested = true;
+    }
+
+    return !wake_requested && nread == sizeof(wake_events);
+}
+
+void EventLoopManagerUnix::handle_expired_timers()
+{
+    auto& thread_data = ThreadData::the();
+    if (thread_data.timers.is_empty())
+        return;
+
+    auto now = MonotonicTime::now_coarse();
+
+    for (auto& it : thread_data.timers) {
+        auto& timer = *it.value;
+        if (!timer.has_expired(now))
+            continue;
+        auto owner = timer.owner.strong_ref();
+        if (timer.fire_when_not_visible == TimerShouldFireWhenNotVisible::No
+            && owner && !owner->is_visible_for_timer_purposes()) {
+            continue;
+        }
+
+        if (owner)
+            ThreadEventQueue::current().post_event(*owner, make<TimerEvent>(timer.timer_id));
+        if (timer.should_reload) {
+            timer.reload(now);
+        } else {
+            // FIXME: Support removing expired timers that don't want to reload.
+            VERIFY_NOT_REACHED();
+        }
+    }
+}
+
 class SignalHandlers : public RefCounted<SignalHandlers> {
     AK_MAKE_NONCOPYABLE(SignalHandlers);
     AK_MAKE_NONMOVABLE(SignalHandlers);
@@ -339,6 +483,10 @@ void EventLoopImplementationUnix::notify_forked_and_in_child()
     thread_data.timers.clear();
     thread_data.notifiers.clear();
     thread_data.initialize_wake_pipe();
+#ifdef AK_OS_SERENITY
+    // The event poll instance is shared with our parent, so we need our own one.
+    thread_data.initialize_event_poll();
+#endif
     if (auto* info = signals_info<false>()) {
         info->signal_handlers.clear();
         info->next_signal_id = 0;
@@ -505,12 +653,35 @@ bool EventLoopManagerUnix::unregister_timer(int timer_id)
 
 void EventLoopManagerUnix::register_notifier(Notifier& notifier)
 {
-    ThreadData::the().notifiers.set(&notifier);
+    auto& thread_data = ThreadData::the();
+    thread_data.notifiers.set(&notifier);
+
+#ifdef AK_OS_SERENITY
+    if (thread_data.epoll_fd != -1) {
+        auto& notifiers_for_fd = thread_data.notifiers_by_fd.ensure(notifier.fd());
+        if (!notifiers_for_fd.contains_slow(&notifier))
+            notifiers_for_fd.append(&notifier);
+        thread_data.update_event_poll_interest(notifier.fd());
+    }
+#endif
 }
 
 void EventLoopManagerUnix::unregister_notifier(Notifier& notifier)
 {
-    ThreadData::the().notifiers.remove(&notifier);
+    auto& thread_data = ThreadData::the();
+    thread_data.notifiers.remove(&notifier);
+
+#ifdef AK_OS_SERENITY
+    if (thread_data.epoll_fd != -1) {
+        auto it = thread_data.notifiers_by_fd.find(notifier.fd());
+        if (it == thread_data.notifiers_by_fd.end())
+            return;
+        it->value.remove_first_matching([&](auto* other) { return other == &notifier; });
+        if (it->value.is_empty())
+            thread_data.notifiers_by_fd.remove(it);
+        thread_data.update_event_poll_interest(notifier.fd());
+    }
+#endif
 }
 
 void EventLoopManagerUnix::did_post_event()
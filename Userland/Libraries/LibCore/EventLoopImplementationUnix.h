@@ -32,6 +32,16 @@ public:
     static Optional<MonotonicTime> get_next_timer_expiration();
 
 private:
+    // Returns the longest we may wait for events, or an empty Optional if we may wait forever.
+    static Optional<Duration> compute_wait_timeout(EventLoopImplementation::PumpMode);
+    // Returns true if there may be more to read from the wake pipe, and nothing asked us to wake up yet.
+    bool drain_wake_pipe();
+    static void handle_expired_timers();
+
+#ifdef AK_OS_SERENITY
+    void wait_for_events_with_event_poll(EventLoopImplementation::PumpMode);
+#endif
+
     void dispatch_signal(int signal_number);
     static void handle_signal(int signal_number);
 };
@@ -32,7 +32,7 @@ public:
 
     int fd() const { return m_fd; }
     Type type() const { return m_type; }
-    void set_type(Type type) { m_type = type; }
+    void set_type(Type);
 
     void event(Core::Event&) override;
 
@@ -41,6 +41,7 @@ private:
 
     int m_fd { -1 };
     Type m_type { Type::None };
+    bool m_is_enabled { false };
 };
 
 }
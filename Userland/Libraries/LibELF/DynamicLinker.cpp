@@ -22,6 +22,7 @@
 #include <LibELF/DynamicLoader.h>
 #include <LibELF/DynamicObject.h>
 #include <LibELF/Hashes.h>
+#include <LibELF/SymbolCache.h>
 #include <bits/dlfcn_integration.h>
 #include <bits/pthread_integration.h>
 #include <dlfcn.h>
@@ -61,22 +62,30 @@ static DeprecatedString s_cwd;
 
 static bool s_allowed_to_check_environment_variables { false };
 static bool s_do_breakpoint_trap_before_entry { false };
+static bool s_bind_now { false };
 static StringView s_ld_library_path;
 static StringView s_main_program_pledge_promises;
 static DeprecatedString s_loader_pledge_promises;
 
+enum class SymbolCacheMode {
+    Use,
+    Ignore,
+    Update,
+};
+static SymbolCacheMode s_symbol_cache_mode { SymbolCacheMode::Use };
+static OwnPtr<SymbolCache> s_symbol_cache;
+static OwnPtr<SymbolCache::Builder> s_symbol_cache_builder;
+
 static Result<void, DlErrorMessage> __dlclose(void* handle);
 static Result<void*, DlErrorMessage> __dlopen(char const* filename, int flags);
 static Result<void*, DlErrorMessage> __dlsym(void* handle, char const* symbol_name);
 static Result<void, DlErrorMessage> __dladdr(void const* addr, Dl_info* info);
 static void __call_fini_functions();
 
-Optional<DynamicObject::SymbolLookupResult> DynamicLinker::lookup_global_symbol(StringView name)
+static Optional<DynamicObject::SymbolLookupResult> lookup_symbol_in_global_objects(DynamicObject::HashSymbol const& symbol)
 {
     Optional<DynamicObject::SymbolLookupResult> weak_result;
 
-    auto symbol = DynamicObject::HashSymbol { name };
-
     for (auto& lib : s_global_objects) {
         auto res = lib.value->lookup_symbol(symbol);
         if (!res.has_value())
@@ -90,6 +99,23 @@ Optional<DynamicObject::SymbolLookupResult> DynamicLinker::lookup_global_symbol(
     return weak_result;
 }
 
+Optional<DynamicObject::SymbolLookupResult> DynamicLinker::lookup_global_symbol(StringView name)
+{
+    auto symbol = DynamicObject::HashSymbol { name };
+
+    // The symbol cache only knows about the objects that were loaded along with the program,
+    // anything that has been dlopen()ed since might take precedence over what it says.
+    if (s_symbol_cache && s_symbol_cache->object_count() == s_global_objects.size()) {
+        if (auto result = s_symbol_cache->lookup(symbol); result.has_value())
+            return result;
+    }
+
+    auto result = lookup_symbol_in_global_objects(symbol);
+    if (result.has_value() && s_symbol_cache_builder && s_symbol_cache_builder->object_count() == s_global_objects.size())
+        s_symbol_cache_builder->record(symbol, result.value());
+    return result;
+}
+
 static Result<NonnullRefPtr<DynamicLoader>, DlErrorMessage> map_library(DeprecatedString const& filepath, int fd)
 {
     VERIFY(filepath.starts_with('/'));
@@ -397,12 +423,8 @@ static Result<void, DlErrorMessage> link_main_library(DeprecatedString const& pa
     for (auto& loader : loaders)
         VERIFY(!loader->map());
 
-    for (auto& loader : loaders) {
-        bool success = loader->link(flags);
-        if (!success) {
-            return DlErrorMessage { DeprecatedString::formatted("Failed to link library {}", loader->filepath()) };
-        }
-    }
+    for (auto& loader : loaders)
+        TRY(loader->link(flags));
 
     for (auto& loader : loaders) {
         auto result = loader->load_stage_3(flags);
@@ -433,6 +455,10 @@ static Result<void, DlErrorMessage> link_main_library(DeprecatedString const& pa
 
     drop_loader_promise("prot_exec"sv);
 
+    // When we're only here to record the symbol cache, the program isn't going to run.
+    if (s_symbol_cache_mode == SymbolCacheMode::Update)
+        return {};
+
     for (auto& loader : loaders) {
         loader->load_stage_4();
     }
@@ -484,14 +510,35 @@ static Optional<DlErrorMessage> verify_tls_for_dlopen(DynamicLoader const& loade
     return DlErrorMessage("Using dlopen() with libraries that have non-zeroed TLS is currently not supported");
 }
 
+// Objects that failed to link are only partially relocated, so later lookups must not find them.
+// FIXME: Unmap them as well, once there is proper unload support.
+static void forget_objects_mapped_after(size_t object_count)
+{
+    Vector<DeprecatedString> paths;
+    size_t index = 0;
+    for (auto& it : s_global_objects) {
+        if (index++ >= object_count)
+            paths.append(it.key);
+    }
+    for (auto& path : paths) {
+        s_global_objects.remove(path);
+        s_loaders.remove(path);
+    }
+}
+
 static Result<void*, DlErrorMessage> __dlopen(char const* filename, int flags)
 {
-    // FIXME: RTLD_NOW and RTLD_LOCAL are not supported
-    flags &= ~RTLD_NOW;
-    flags |= RTLD_LAZY;
+    // FIXME: RTLD_LOCAL is not supported
     flags &= ~RTLD_LOCAL;
     flags |= RTLD_GLOBAL;
 
+    if (s_bind_now)
+        flags |= RTLD_NOW;
+    if (flags & RTLD_NOW)
+        flags &= ~RTLD_LAZY;
+    else
+        flags |= RTLD_LAZY;
+
     dbgln_if(DYNAMIC_LOAD_DEBUG, "__dlopen invoked, filename={}, flags={}", filename, flags);
 
     if (pthread_mutex_trylock(&s_loader_lock) != 0)
@@ -512,6 +559,7 @@ static Result<void*, DlErrorMessage> __dlopen(char const* filename, int flags)
         return *existing_elf_object;
     }
 
+    auto const object_count_before_dlopen = s_global_objects.size();
     auto loader = TRY(map_library(library_path.value()));
 
     if (auto error = verify_tls_for_dlopen(loader); error.has_value())
@@ -519,7 +567,10 @@ static Result<void*, DlErrorMessage> __dlopen(char const* filename, int flags)
 
     TRY(map_dependencies(loader->filepath()));
 
-    TRY(link_main_library(loader->filepath(), flags));
+    if (auto result = link_main_library(loader->filepath(), flags); result.is_error()) {
+        forget_objects_mapped_after(object_count_before_dlopen);
+        return result.release_error();
+    }
 
     s_total_tls_size += loader->tls_size_of_current_object() + loader->tls_alignment_of_current_object();
 
@@ -631,6 +682,24 @@ static void __call_fini_functions()
     }
 }
 
+static void set_up_symbol_cache(DeprecatedString const& main_program_path)
+{
+    if (s_symbol_cache_mode == SymbolCacheMode::Ignore)
+        return;
+
+    Vector<SymbolCache::Object> objects;
+    for (auto const& it : s_global_objects) {
+        auto loader = s_loaders.get(it.key);
+        VERIFY(loader.has_value());
+        objects.append({ it.value.ptr(), loader.value()->file_stat() });
+    }
+
+    if (s_symbol_cache_mode == SymbolCacheMode::Update)
+        s_symbol_cache_builder = make<SymbolCache::Builder>(move(objects));
+    else
+        s_symbol_cache = SymbolCache::open(SymbolCache::path_for_program(main_program_path), objects);
+}
+
 static void read_environment_variables()
 {
     for (char** env = s_envp; *env; ++env) {
@@ -639,6 +708,11 @@ static void read_environment_variables()
             s_do_breakpoint_trap_before_entry = true;
         }
 
+        constexpr auto bind_now_string = "LD_BIND_NOW="sv;
+        if (env_string.starts_with(bind_now_string) && env_string.length() > bind_now_string.length()) {
+            s_bind_now = true;
+        }
+
         constexpr auto library_path_string = "LD_LIBRARY_PATH="sv;
         if (env_string.starts_with(library_path_string)) {
             s_ld_library_path = env_string.substring_view(library_path_string.length());
@@ -653,6 +727,15 @@ static void read_environment_variables()
         if (env_string.starts_with(loader_pledge_promises_key)) {
             s_loader_pledge_promises = env_string.substring_view(loader_pledge_promises_key.length());
         }
+
+        constexpr auto symbol_cache_key = "_LOADER_SYMBOL_CACHE="sv;
+        if (env_string.starts_with(symbol_cache_key)) {
+            auto mode = env_string.substring_view(symbol_cache_key.length());
+            if (mode == "ignore"sv)
+                s_symbol_cache_mode = SymbolCacheMode::Ignore;
+            else if (mode == "update"sv)
+                s_symbol_cache_mode = SymbolCacheMode::Update;
+        }
     }
 }
 
@@ -720,13 +803,24 @@ Examples of static-pie ELF objects are ELF packers, and the system dynamic loade
 
     allocate_tls();
 
+    set_up_symbol_cache(main_program_path);
+
     auto entry_point_function = [&main_program_path] {
-        auto result = link_main_library(main_program_path, RTLD_GLOBAL | RTLD_LAZY);
+        auto result = link_main_library(main_program_path, RTLD_GLOBAL | (s_bind_now ? RTLD_NOW : RTLD_LAZY));
         if (result.is_error()) {
             warnln("{}", result.error().text);
             _exit(1);
         }
 
+        if (s_symbol_cache_builder) {
+            auto cache_path = SymbolCache::path_for_program(main_program_path);
+            if (!s_symbol_cache_builder->write(cache_path)) {
+                warnln("Failed to write symbol cache {}: {}", cache_path, strerror(errno));
+                _exit(1);
+            }
+            _exit(0);
+        }
+
         drop_loader_promise("rpath"sv);
 
         auto& main_executable_loader = *s_loaders.get(main_program_path);
@@ -736,6 +830,7 @@ Examples of static-pie ELF objects are ELF packers, and the system dynamic loade
         return (EntryPointFunction)(entry_point.as_ptr());
     }();
 
+    s_symbol_cache = nullptr;
     s_loaders.clear();
 
     int rc = syscall(SC_prctl, PR_SET_NO_NEW_SYSCALL_REGION_ANNOTATIONS, 1, 0, nullptr);
@@ -65,6 +65,7 @@ Result<NonnullRefPtr<DynamicLoader>, DlErrorMessage> DynamicLoader::try_create(i
     }
 
     auto loader = adopt_ref(*new DynamicLoader(fd, move(filepath), data, size));
+    loader->m_file_stat = stat;
     if (!loader->is_valid())
         return DlErrorMessage { "ELF image validation failed" };
     return loader;
@@ -164,12 +165,12 @@ RefPtr<DynamicObject> DynamicLoader::map()
     return m_dynamic_object;
 }
 
-bool DynamicLoader::link(unsigned flags)
+Result<void, DlErrorMessage> DynamicLoader::link(unsigned flags)
 {
     return load_stage_2(flags);
 }
 
-bool DynamicLoader::load_stage_2(unsigned flags)
+Result<void, DlErrorMessage> DynamicLoader::load_stage_2(unsigned flags)
 {
     VERIFY(flags & RTLD_GLOBAL);
 
@@ -180,32 +181,25 @@ bool DynamicLoader::load_stage_2(unsigned flags)
 
 #ifndef AK_OS_MACOS
             // Remap this text region as private.
-            if (mremap(text_segment.address().as_ptr(), text_segment.size(), text_segment.size(), MAP_PRIVATE) == MAP_FAILED) {
-                perror("mremap .text: MAP_PRIVATE");
-                return false;
-            }
+            if (mremap(text_segment.address().as_ptr(), text_segment.size(), text_segment.size(), MAP_PRIVATE) == MAP_FAILED)
+                return DlErrorMessage { DeprecatedString::formatted("mremap .text: MAP_PRIVATE: {}", strerror(errno)) };
 #endif
 
-            if (0 > mprotect(text_segment.address().as_ptr(), text_segment.size(), PROT_READ | PROT_WRITE)) {
-                perror("mprotect .text: PROT_READ | PROT_WRITE"); // FIXME: dlerror?
-                return false;
-            }
+            if (0 > mprotect(text_segment.address().as_ptr(), text_segment.size(), PROT_READ | PROT_WRITE))
+                return DlErrorMessage { DeprecatedString::formatted("mprotect .text: PROT_READ | PROT_WRITE: {}", strerror(errno)) };
         }
     } else {
         // .text needs to be executable while we process relocations because it might contain IFUNC resolvers.
         // We don't allow IFUNC resolvers in objects with textrels.
         for (auto& text_segment : m_text_segments) {
-            if (mprotect(text_segment.address().as_ptr(), text_segment.size(), PROT_READ | PROT_EXEC) < 0) {
-                perror("mprotect .text: PROT_READ | PROT_EXEC");
-                return false;
-            }
+            if (mprotect(text_segment.address().as_ptr(), text_segment.size(), PROT_READ | PROT_EXEC) < 0)
+                return DlErrorMessage { DeprecatedString::formatted("mprotect .text: PROT_READ | PROT_EXEC: {}", strerror(errno)) };
         }
     }
-    do_main_relocations();
-    return true;
+    return do_main_relocations(flags);
 }
 
-void DynamicLoader::do_main_relocations()
+Result<void, DlErrorMessage> DynamicLoader::do_main_relocations(unsigned flags)
 {
     do_relr_relocations();
 
@@ -233,25 +227,28 @@ void DynamicLoader::do_main_relocations()
             *((FlatPtr*)relocation.address().as_ptr()) += m_dynamic_object->base_address().get();
     };
 
+    Optional<DlErrorMessage> error;
     m_dynamic_object->plt_relocation_section().for_each_relocation([&](DynamicObject::Relocation const& relocation) {
         if (relocation.type() == R_X86_64_IRELATIVE || relocation.type() == R_AARCH64_IRELATIVE) {
             m_direct_ifunc_relocations.append(relocation);
-            return;
+            return IterationDecision::Continue;
         }
         if (relocation.type() == R_X86_64_TLSDESC || relocation.type() == R_AARCH64_TLSDESC) {
             // GNU ld for some reason puts TLSDESC relocations into .rela.plt
             // https://sourceware.org/bugzilla/show_bug.cgi?id=28387
 
             VERIFY(do_direct_relocation(relocation, cached_result, ShouldInitializeWeak::No, ShouldCallIfuncResolver::No) == RelocationResult::Success);
-            return;
+            return IterationDecision::Continue;
         }
 
-        // FIXME: Or LD_BIND_NOW is set?
-        if (m_dynamic_object->must_bind_now()) {
+        // Unless asked to bind everything up front, PLT entries are bound on their first call through _plt_trampoline.
+        // Most programs only ever call a small fraction of the functions they import, so this saves a lot of lookups.
+        if (m_dynamic_object->must_bind_now() || !(flags & RTLD_LAZY)) {
             switch (do_plt_relocation(relocation, ShouldCallIfuncResolver::No)) {
             case RelocationResult::Failed:
-                dbgln("Loader.so: {} unresolved symbol '{}'", m_filepath, relocation.symbol().name());
-                VERIFY_NOT_REACHED();
+                // With lazy binding, this would only have come up once the function is called. Let dlopen() fail instead.
+                error = DlErrorMessage { DeprecatedString::formatted("{}: unresolved symbol '{}'", m_filepath, relocation.symbol().name()) };
+                return IterationDecision::Break;
             case RelocationResult::ResolveLater:
                 VERIFY_NOT_REACHED();
             case RelocationResult::CallIfuncResolver:
@@ -265,13 +262,19 @@ void DynamicLoader::do_main_relocations()
         } else {
             fixup_trampoline_pointer(relocation);
         }
+        return IterationDecision::Continue;
     });
+
+    if (error.has_value())
+        return error.release_value();
+    return {};
 }
 
 Result<NonnullRefPtr<DynamicObject>, DlErrorMessage> DynamicLoader::load_stage_3(unsigned flags)
 {
     do_lazy_relocations();
-    if (flags & RTLD_LAZY) {
+    // IFUNC resolvers might need lazy binding, even if everything else has been bound already (see do_main_relocations()).
+    if ((flags & RTLD_LAZY) || !m_plt_ifunc_relocations.is_empty()) {
         if (m_dynamic_object->has_plt())
             setup_plt_trampoline();
     }
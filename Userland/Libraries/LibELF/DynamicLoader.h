@@ -16,6 +16,7 @@
 #include <LibELF/Image.h>
 #include <bits/dlfcn_integration.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace ELF {
 
@@ -53,6 +54,7 @@ public:
     ~DynamicLoader();
 
     DeprecatedString const& filepath() const { return m_filepath; }
+    struct stat const& file_stat() const { return m_file_stat; }
 
     bool is_valid() const { return m_valid; }
 
@@ -61,10 +63,10 @@ public:
     // Note that the DynamicObject will not be linked yet. Callers are responsible for calling link() to finish it.
     RefPtr<DynamicObject> map();
 
-    bool link(unsigned flags);
+    Result<void, DlErrorMessage> link(unsigned flags);
 
     // Stage 2 of loading: dynamic object loading and primary relocations
-    bool load_stage_2(unsigned flags);
+    Result<void, DlErrorMessage> load_stage_2(unsigned flags);
 
     // Stage 3 of loading: lazy relocations
     Result<NonnullRefPtr<DynamicObject>, DlErrorMessage> load_stage_3(unsigned flags);
@@ -124,7 +126,7 @@ private:
     void load_program_headers();
 
     // Stage 2
-    void do_main_relocations();
+    Result<void, DlErrorMessage> do_main_relocations(unsigned flags);
 
     // Stage 3
     void do_lazy_relocations();
@@ -155,6 +157,7 @@ private:
 
     DeprecatedString m_filepath;
     size_t m_file_size { 0 };
+    struct stat m_file_stat {};
     int m_image_fd { -1 };
     void* m_file_data { nullptr };
     OwnPtr<ELF::Image> m_elf_image;
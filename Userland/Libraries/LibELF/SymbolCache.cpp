@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/ByteBuffer.h>
+#include <AK/NumericLimits.h>
+#include <AK/ScopeGuard.h>
+#include <AK/StringBuilder.h>
+#include <LibELF/SymbolCache.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ELF {
+
+// The cache is only ever read on the machine that wrote it, so everything is stored in host byte order.
+//
+// Layout: SymbolCacheHeader, followed by one SymbolCacheObject per object (in load order), the buckets
+// of an open-addressed hash table keyed by the GNU hash of the symbol name, and the object paths.
+static constexpr u32 symbol_cache_magic = 0x4d595343; // "CSYM"
+static constexpr u32 symbol_cache_version = 1;
+static constexpr u32 empty_bucket = NumericLimits<u32>::max();
+
+struct SymbolCacheHeader {
+    u32 magic;
+    u32 version;
+    u32 object_count;
+    u32 bucket_count;
+    u32 objects_offset;
+    u32 buckets_offset;
+    u32 strings_offset;
+    u32 strings_size;
+};
+static_assert(AssertSize<SymbolCacheHeader, 32>());
+
+struct SymbolCacheObject {
+    u64 device;
+    u64 inode;
+    u64 size;
+    i64 modification_time;
+    i64 change_time;
+    u32 path_offset;
+    u32 path_length;
+};
+static_assert(AssertSize<SymbolCacheObject, 48>());
+
+// A bucket points at the symbol table entry that a lookup of the name resolved to. Entries with
+// the same hash are told apart by comparing the name of that symbol to the one being looked up.
+struct SymbolCacheBucket {
+    u32 name_hash;
+    u32 object_index;
+    u32 symbol_index;
+};
+static_assert(AssertSize<SymbolCacheBucket, 12>());
+
+static SymbolCacheObject identity_of(struct stat const& file_stat)
+{
+    return SymbolCacheObject {
+        .device = static_cast<u64>(file_stat.st_dev),
+        .inode = static_cast<u64>(file_stat.st_ino),
+        .size = static_cast<u64>(file_stat.st_size),
+        .modification_time = static_cast<i64>(file_stat.st_mtime),
+        .change_time = static_cast<i64>(file_stat.st_ctime),
+        .path_offset = 0,
+        .path_length = 0,
+    };
+}
+
+DeprecatedString SymbolCache::path_for_program(StringView program_path)
+{
+    VERIFY(program_path.starts_with('/'));
+    return DeprecatedString::formatted("{}/{}.symbols", directory, program_path.substring_view(1).replace("/"sv, "%"sv, ReplaceMode::All));
+}
+
+SymbolCache::SymbolCache(u8 const* data, size_t size, Vector<DynamicObject const*> objects)
+    : m_data(data)
+    , m_size(size)
+    , m_objects(move(objects))
+{
+}
+
+SymbolCache::~SymbolCache()
+{
+    munmap(const_cast<u8*>(m_data), m_size);
+}
+
+OwnPtr<SymbolCache> SymbolCache::open(DeprecatedString const& path, Vector<Object> const& objects)
+{
+    int fd = ::open(path.characters(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return {};
+    ScopeGuard close_fd = [fd] { close(fd); };
+
+    struct stat cache_stat;
+    if (fstat(fd, &cache_stat) < 0)
+        return {};
+
+    // Whoever can write the cache decides where every lookup ends up, so only trust caches that root wrote.
+    if (!S_ISREG(cache_stat.st_mode) || cache_stat.st_uid != 0 || (cache_stat.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+        return {};
+
+    auto size = static_cast<size_t>(cache_stat.st_size);
+    if (size < sizeof(SymbolCacheHeader))
+        return {};
+
+    auto* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+        return {};
+
+    ScopeGuard unmap_data = [&] {
+        if (data)
+            munmap(data, size);
+    };
+
+    auto const* bytes = static_cast<u8 const*>(data);
+    auto const& header = *reinterpret_cast<SymbolCacheHeader const*>(bytes);
+    if (header.magic != symbol_cache_magic || header.version != symbol_cache_version)
+        return {};
+    if (header.object_count != objects.size() || header.bucket_count == 0 || !is_power_of_two(header.bucket_count))
+        return {};
+
+    auto fits = [size](u64 offset, u64 length) { return offset <= size && length <= size - offset; };
+    if (header.objects_offset % alignof(SymbolCacheObject) != 0 || !fits(header.objects_offset, static_cast<u64>(header.object_count) * sizeof(SymbolCacheObject)))
+        return {};
+    if (header.buckets_offset % alignof(SymbolCacheBucket) != 0 || !fits(header.buckets_offset, static_cast<u64>(header.bucket_count) * sizeof(SymbolCacheBucket)))
+        return {};
+    if (!fits(header.strings_offset, header.strings_size))
+        return {};
+
+    auto const* cached_objects = reinterpret_cast<SymbolCacheObject const*>(bytes + header.objects_offset);
+    auto const* strings = reinterpret_cast<char const*>(bytes + header.strings_offset);
+
+    Vector<DynamicObject const*> dynamic_objects;
+    dynamic_objects.ensure_capacity(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        auto const& cached = cached_objects[i];
+        if (static_cast<u64>(cached.path_offset) + cached.path_length > header.strings_size)
+            return {};
+
+        auto const& object = objects[i];
+        StringView cached_path { strings + cached.path_offset, cached.path_length };
+        if (cached_path != object.dynamic_object->filepath())
+            return {};
+
+        auto identity = identity_of(object.file_stat);
+        if (cached.device != identity.device || cached.inode != identity.inode || cached.size != identity.size
+            || cached.modification_time != identity.modification_time || cached.change_time != identity.change_time)
+            return {};
+
+        dynamic_objects.unchecked_append(object.dynamic_object);
+    }
+
+    auto cache = adopt_own_if_nonnull(new (nothrow) SymbolCache(bytes, size, move(dynamic_objects)));
+    if (cache)
+        data = nullptr;
+    return cache;
+}
+
+Optional<DynamicObject::SymbolLookupResult> SymbolCache::lookup(DynamicObject::HashSymbol const& symbol) const
+{
+    auto const& header = *reinterpret_cast<SymbolCacheHeader const*>(m_data);
+    auto const* buckets = reinterpret_cast<SymbolCacheBucket const*>(m_data + header.buckets_offset);
+
+    u32 hash = symbol.gnu_hash();
+    u32 mask = header.bucket_count - 1;
+    for (u32 probe = 0, index = hash & mask; probe < header.bucket_count; ++probe, index = (index + 1) & mask) {
+        auto const& bucket = buckets[index];
+        if (bucket.object_index == empty_bucket)
+            return {};
+        if (bucket.name_hash != hash || bucket.object_index >= m_objects.size())
+            continue;
+
+        auto const& object = *m_objects[bucket.object_index];
+        auto candidate = object.symbol(bucket.symbol_index);
+        if (candidate.is_undefined() || candidate.name() != symbol.name())
+            continue;
+        return DynamicObject::SymbolLookupResult { candidate.value(), candidate.size(), candidate.address(), candidate.bind(), candidate.type(), &object };
+    }
+    return {};
+}
+
+SymbolCache::Builder::Builder(Vector<Object> objects)
+    : m_objects(move(objects))
+{
+    for (size_t i = 0; i < m_objects.size(); ++i)
+        m_object_indices.set(m_objects[i].dynamic_object, i);
+}
+
+void SymbolCache::Builder::record(DynamicObject::HashSymbol const& symbol, DynamicObject::SymbolLookupResult const& result)
+{
+    auto object_index = m_object_indices.get(result.dynamic_object);
+    if (!object_index.has_value())
+        return;
+
+    // Lookup results don't say where in the symbol table the symbol is, so ask its defining object once more.
+    auto defined_symbol = result.dynamic_object->hash_section().lookup_symbol(symbol);
+    if (!defined_symbol.has_value())
+        return;
+
+    m_entries.set(symbol.name(), Entry { symbol.gnu_hash(), object_index.value(), defined_symbol->index() });
+}
+
+bool SymbolCache::Builder::write(DeprecatedString const& path) const
+{
+    u32 bucket_count = 16;
+    while (bucket_count < m_entries.size() * 2)
+        bucket_count *= 2;
+
+    Vector<SymbolCacheBucket> buckets;
+    buckets.resize(bucket_count);
+    for (auto& bucket : buckets)
+        bucket = { 0, empty_bucket, 0 };
+    for (auto const& it : m_entries) {
+        auto const& entry = it.value;
+        u32 index = entry.name_hash & (bucket_count - 1);
+        while (buckets[index].object_index != empty_bucket)
+            index = (index + 1) & (bucket_count - 1);
+        buckets[index] = { entry.name_hash, entry.object_index, entry.symbol_index };
+    }
+
+    StringBuilder strings;
+    Vector<SymbolCacheObject> objects;
+    for (auto const& object : m_objects) {
+        auto cached = identity_of(object.file_stat);
+        cached.path_offset = strings.length();
+        cached.path_length = object.dynamic_object->filepath().length();
+        strings.append(object.dynamic_object->filepath());
+        objects.append(cached);
+    }
+
+    SymbolCacheHeader header {
+        .magic = symbol_cache_magic,
+        .version = symbol_cache_version,
+        .object_count = static_cast<u32>(objects.size()),
+        .bucket_count = bucket_count,
+        .objects_offset = sizeof(SymbolCacheHeader),
+        .buckets_offset = static_cast<u32>(sizeof(SymbolCacheHeader) + objects.size() * sizeof(SymbolCacheObject)),
+        .strings_offset = static_cast<u32>(sizeof(SymbolCacheHeader) + objects.size() * sizeof(SymbolCacheObject) + buckets.size() * sizeof(SymbolCacheBucket)),
+        .strings_size = static_cast<u32>(strings.length()),
+    };
+
+    ByteBuffer buffer;
+    if (buffer.try_append(&header, sizeof(header)).is_error()
+        || buffer.try_append(objects.data(), objects.size() * sizeof(SymbolCacheObject)).is_error()
+        || buffer.try_append(buckets.data(), buckets.size() * sizeof(SymbolCacheBucket)).is_error()
+        || buffer.try_append(strings.string_view().bytes()).is_error())
+        return false;
+
+    // Write the new cache next to the old one and swap it in at once, so that programs starting
+    // up in the meantime see either of the two, but never a partially written one.
+    auto temporary_path = DeprecatedString::formatted("{}.{}", path, getpid());
+    int fd = ::open(temporary_path.characters(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    auto remaining = buffer.bytes();
+    while (!remaining.is_empty()) {
+        auto nwritten = ::write(fd, remaining.data(), remaining.size());
+        if (nwritten <= 0) {
+            close(fd);
+            unlink(temporary_path.characters());
+            return false;
+        }
+        remaining = remaining.slice(nwritten);
+    }
+
+    if (close(fd) < 0 || rename(temporary_path.characters(), path.characters()) < 0) {
+        unlink(temporary_path.characters());
+        return false;
+    }
+    return true;
+}
+
+}
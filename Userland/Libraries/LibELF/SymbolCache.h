@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <AK/DeprecatedString.h>
+#include <AK/HashMap.h>
+#include <AK/OwnPtr.h>
+#include <AK/Vector.h>
+#include <LibELF/DynamicObject.h>
+#include <sys/stat.h>
+
+namespace ELF {
+
+// A persistent record of how the global symbol lookups of one program were resolved.
+//
+// Without it, every lookup walks the hash tables of all loaded objects until one of them defines the
+// symbol, which adds up to tens of thousands of hash table probes for the larger GUI applications.
+// The cache turns each of those into a single probe. It is only valid for exactly the set of objects
+// (in load order) it was recorded for, which is why it records the identity of every object's file and
+// is ignored as soon as any of them changes.
+class SymbolCache {
+public:
+    static constexpr StringView directory = "/var/cache/ld"sv;
+
+    struct Object {
+        DynamicObject const* dynamic_object { nullptr };
+        struct stat file_stat;
+    };
+
+    static DeprecatedString path_for_program(StringView program_path);
+
+    // Maps the cache at `path`, if there is one that was recorded for exactly `objects`.
+    static OwnPtr<SymbolCache> open(DeprecatedString const& path, Vector<Object> const& objects);
+    ~SymbolCache();
+
+    size_t object_count() const { return m_objects.size(); }
+    Optional<DynamicObject::SymbolLookupResult> lookup(DynamicObject::HashSymbol const&) const;
+
+    class Builder {
+    public:
+        explicit Builder(Vector<Object> objects);
+
+        void record(DynamicObject::HashSymbol const&, DynamicObject::SymbolLookupResult const&);
+        bool write(DeprecatedString const& path) const;
+
+        size_t object_count() const { return m_objects.size(); }
+
+    private:
+        struct Entry {
+            u32 name_hash { 0 };
+            u32 object_index { 0 };
+            u32 symbol_index { 0 };
+        };
+
+        Vector<Object> m_objects;
+        HashMap<DynamicObject const*, u32> m_object_indices;
+        HashMap<DeprecatedString, Entry> m_entries;
+    };
+
+private:
+    SymbolCache(u8 const* data, size_t size, Vector<DynamicObject const*> objects);
+
+    u8 const* m_data { nullptr };
+    size_t m_size { 0 };
+    Vector<DynamicObject const*> m_objects;
+};
+
+}
@@ -18,12 +18,14 @@
 #include <AK/Memory.h>
 #include <AK/ScopeGuard.h>
 #include <AK/TemporaryChange.h>
+#include <LibCore/ElapsedTimer.h>
 #include <LibCore/Timer.h>
 #include <LibGfx/AntiAliasingPainter.h>
 #include <LibGfx/Font/Font.h>
 #include <LibGfx/Painter.h>
 #include <LibGfx/StylePainter.h>
 #include <LibThreading/BackgroundAction.h>
+#include <unistd.h>
 
 namespace WindowServer {
 
@@ -69,6 +71,17 @@ Compositor::Compositor()
                                     .release_value_but_fixme_should_propagate_errors();
     m_compose_timer->start();
 
+    // The main thread paints tiles as well, so it only needs help with them from the other processors.
+    auto processor_count = static_cast<size_t>(max(sysconf(_SC_NPROCESSORS_ONLN), 1l));
+    for (size_t i = 1; i < min(processor_count, max_compose_thread_count); ++i) {
+        auto worker_or_error = Threading::WorkerThread<Error>::create("Compositor"sv);
+        if (worker_or_error.is_error()) {
+            dbgln("Failed to create compositing thread: {}", worker_or_error.error());
+            break;
+        }
+        m_compose_workers.append(worker_or_error.release_value());
+    }
+
     init_bitmaps();
 }
 
@@ -107,6 +120,9 @@ void CompositorScreenData::init_bitmaps(Compositor& compositor, Screen& screen)
     m_flush_rects.clear_with_capacity();
     m_flush_transparent_rects.clear_with_capacity();
     m_flush_special_rects.clear_with_capacity();
+    for (auto& damage : m_buffer_damage)
+        damage.clear_with_capacity();
+    m_new_damage.clear_with_capacity();
 
     auto size = screen.size();
     m_front_bitmap = nullptr;
@@ -127,6 +143,16 @@ void CompositorScreenData::init_bitmaps(Compositor& compositor, Screen& screen)
     m_temp_painter = make<Gfx::Painter>(*m_temp_bitmap);
     m_temp_painter->translate(-screen.rect().location());
 
+    m_tile_painters.clear();
+    for (size_t i = 0; i < compositor.compose_thread_count(); ++i) {
+        auto create_painter = [&](Gfx::Bitmap& bitmap) {
+            auto painter = make<Gfx::Painter>(bitmap);
+            painter->translate(-screen.rect().location());
+            return painter;
+        };
+        m_tile_painters.append({ create_painter(*m_back_bitmap), create_painter(*m_front_bitmap), create_painter(*m_temp_bitmap) });
+    }
+
     clear_wallpaper_bitmap();
 }
 
@@ -182,6 +208,9 @@ void Compositor::compose()
         return;
     }
 
+    Core::ElapsedTimer frame_timer { true };
+    frame_timer.start();
+
     if (m_occlusions_dirty) {
         m_occlusions_dirty = false;
         recompute_occlusions();
@@ -192,6 +221,24 @@ void Compositor::compose()
 
     auto dirty_screen_rects = move(m_dirty_screen_rects);
 
+    // The buffers we are about to draw into are still missing whatever was composed since they were last shown
+    Gfx::DisjointIntRectSet catch_up_rects;
+    Screen::for_each([&](auto& screen) {
+        auto& screen_data = screen.compositor_screen_data();
+        if (!screen_data.m_screen_can_set_buffer)
+            return IterationDecision::Continue;
+        auto damage = screen_data.take_back_buffer_damage();
+        if (!damage.is_empty()) {
+            catch_up_rects.add(damage);
+            m_invalidated_window = true;
+        }
+        return IterationDecision::Continue;
+    });
+
+    // Only what changes in this frame is missing from the other buffers. The catch-up damage came from
+    // those buffers in the first place, and passing it back would keep it bouncing between them forever.
+    auto new_damage = dirty_screen_rects.clone();
+
     bool window_stack_transition_in_progress = m_transitioning_to_window_stack != nullptr;
 
     // Mark window regions as dirty that need to be re-rendered
@@ -211,6 +258,22 @@ void Compositor::compose()
         window.prepare_dirty_rects();
         if (window_stack_transition_in_progress)
             window.dirty_rects().translate_by(transition_offset);
+        new_damage.add(window.dirty_rects());
+
+        // The dirty rects are in screen coordinates now, so the catch-up damage can be added as is.
+        for (auto& catch_up_rect : catch_up_rects.rects()) {
+            auto dirty_rect = catch_up_rect.intersected(frame_rect_on_screen);
+            if (!dirty_rect.is_empty())
+                window.dirty_rects().add(dirty_rect);
+        }
+        return IterationDecision::Continue;
+    });
+    dirty_screen_rects.add(catch_up_rects);
+
+    Screen::for_each([&](auto& screen) {
+        auto& screen_data = screen.compositor_screen_data();
+        if (screen_data.m_screen_can_set_buffer)
+            screen_data.m_new_damage = new_damage.intersected(screen.rect());
         return IterationDecision::Continue;
     });
 
@@ -330,60 +393,151 @@ void Compositor::compose()
         }
     };
 
-    {
-        // Paint any desktop wallpaper rects that are not somehow underneath any window transparency
-        // rects and outside of any opaque window areas
-        m_opaque_wallpaper_rects.for_each_intersected(dirty_screen_rects, [&](auto& render_rect) {
-            Screen::for_each([&](auto& screen) {
-                auto screen_rect = screen.rect();
-                auto screen_render_rect = screen_rect.intersected(render_rect);
-                if (!screen_render_rect.is_empty()) {
-                    dbgln_if(COMPOSE_DEBUG, "  render wallpaper opaque: {} on screen #{}", screen_render_rect, screen.index());
-                    prepare_rect(screen, render_rect);
-                    auto& back_painter = *screen.compositor_screen_data().m_back_painter;
-                    paint_wallpaper(screen, back_painter, render_rect, screen_rect);
+    // Figure out what needs to be flushed on each screen first. All the bookkeeping happens
+    // here, so that the actual painting below can be split up into tiles painted in parallel.
+    m_opaque_wallpaper_rects.for_each_intersected(dirty_screen_rects, [&](auto& render_rect) {
+        Screen::for_each([&](auto& screen) {
+            auto screen_render_rect = screen.rect().intersected(render_rect);
+            if (!screen_render_rect.is_empty()) {
+                dbgln_if(COMPOSE_DEBUG, "  render wallpaper opaque: {} on screen #{}", screen_render_rect, screen.index());
+                prepare_rect(screen, render_rect);
+            }
+            return IterationDecision::Continue;
+        });
+        return IterationDecision::Continue;
+    });
+    m_transparent_wallpaper_rects.for_each_intersected(dirty_screen_rects, [&](auto& render_rect) {
+        Screen::for_each([&](auto& screen) {
+            auto screen_render_rect = screen.rect().intersected(render_rect);
+            if (!screen_render_rect.is_empty()) {
+                dbgln_if(COMPOSE_DEBUG, "  render wallpaper transparent: {} on screen #{}", screen_render_rect, screen.index());
+                prepare_transparency_rect(screen, render_rect);
+            }
+            return IterationDecision::Continue;
+        });
+        return IterationDecision::Continue;
+    });
+
+    // Everything about a window that painting its tiles needs to know, but can't figure out on
+    // the compositing threads themselves (as that involves referencing the current palette).
+    struct WindowToCompose {
+        Window* window { nullptr };
+        Gfx::IntPoint transition_offset;
+        Gfx::IntRect frame_render_rect;
+        Gfx::IntRect unconstrained_frame_render_rect;
+        ResizeDirection resize_direction { ResizeDirection::None };
+        bool is_unresponsive { false };
+    };
+    Vector<WindowToCompose, 32> windows_to_compose;
+
+    auto prepare_window = [&](Window& window) {
+        windows_to_compose.append({ .window = &window });
+        auto& window_to_compose = windows_to_compose.last();
+        if (window.screens().is_empty()) {
+            // This window doesn't intersect with any screens, so there's nothing to render
+            return;
+        }
+
+        auto& dirty_rects = window.dirty_rects();
+        if (dirty_rects.is_empty())
+            return;
+
+        window_to_compose.transition_offset = window_transition_offset(window);
+        window_to_compose.frame_render_rect = window.frame().render_rect();
+        window_to_compose.unconstrained_frame_render_rect = window.frame().unconstrained_render_rect();
+        window_to_compose.resize_direction = wm.resize_direction_of_window(window);
+        window_to_compose.is_unresponsive = window.client() && window.client()->is_unresponsive();
+
+        if constexpr (COMPOSE_DEBUG) {
+            dbgln("  window {} frame rect: {}", window.title(), window_to_compose.frame_render_rect.translated(window_to_compose.transition_offset));
+            for (auto& dirty_rect : dirty_rects.rects())
+                dbgln("    dirty: {}", dirty_rect);
+            for (auto& r : window.opaque_rects().rects())
+                dbgln("    opaque: {}", r);
+            for (auto& r : window.transparency_rects().rects())
+                dbgln("    transparent: {}", r);
+        }
+
+        auto for_each_screen_render_rect = [&](Gfx::DisjointIntRectSet const& rects, auto callback) {
+            rects.for_each_intersected(dirty_rects, [&](Gfx::IntRect const& render_rect) {
+                for (auto* screen : window.screens()) {
+                    auto screen_render_rect = render_rect.intersected(screen->rect());
+                    if (!screen_render_rect.is_empty())
+                        callback(*screen, screen_render_rect);
                 }
                 return IterationDecision::Continue;
             });
-            return IterationDecision::Continue;
-        });
-        m_transparent_wallpaper_rects.for_each_intersected(dirty_screen_rects, [&](auto& render_rect) {
+        };
+        for_each_screen_render_rect(window.opaque_rects(), prepare_rect);
+        for_each_screen_render_rect(window.transparency_wallpaper_rects(), prepare_transparency_rect);
+        for_each_screen_render_rect(window.transparency_rects(), prepare_transparency_rect);
+
+        // The frame is painted from its cache, which must not be (re-)rendered while painting tiles
+        if (!window.is_fullscreen()) {
+            for (auto* screen : window.screens())
+                window.frame().render_to_cache(*screen);
+        }
+    };
+
+    if (m_invalidated_window) {
+        auto* fullscreen_window = wm.active_fullscreen_window();
+        // FIXME: Remove the !WindowSwitcher::the().is_visible() check when WindowSwitcher is an overlay
+        if (fullscreen_window && fullscreen_window->is_opaque() && !WindowSwitcher::the().is_visible()) {
+            prepare_window(*fullscreen_window);
+        } else {
+            wm.for_each_visible_window_from_back_to_front([&](Window& window) {
+                prepare_window(window);
+                return IterationDecision::Continue;
+            });
+        }
+
+        // Check that there are no overlapping transparent and opaque flush rectangles
+        VERIFY(![&]() {
+            bool is_overlapping = false;
             Screen::for_each([&](auto& screen) {
-                auto screen_rect = screen.rect();
-                auto screen_render_rect = screen_rect.intersected(render_rect);
-                if (!screen_render_rect.is_empty()) {
-                    dbgln_if(COMPOSE_DEBUG, "  render wallpaper transparent: {} on screen #{}", screen_render_rect, screen.index());
-                    prepare_transparency_rect(screen, render_rect);
-                    auto& temp_painter = *screen.compositor_screen_data().m_temp_painter;
-                    paint_wallpaper(screen, temp_painter, render_rect, screen_rect);
+                auto& screen_data = screen.compositor_screen_data();
+                auto& flush_transparent_rects = screen_data.m_flush_transparent_rects;
+                auto& flush_rects = screen_data.m_flush_rects;
+                for (auto& rect_transparent : flush_transparent_rects.rects()) {
+                    for (auto& rect_opaque : flush_rects.rects()) {
+                        if (rect_opaque.intersects(rect_transparent)) {
+                            dbgln("Transparent rect {} overlaps opaque rect: {}: {}", rect_transparent, rect_opaque, rect_opaque.intersected(rect_transparent));
+                            is_overlapping = true;
+                            return IterationDecision::Break;
+                        }
+                    }
                 }
                 return IterationDecision::Continue;
             });
-            return IterationDecision::Continue;
-        });
+            return is_overlapping;
+        }());
     }
 
-    auto compose_window = [&](Window& window) -> IterationDecision {
-        if (window.screens().is_empty()) {
-            // This window doesn't intersect with any screens, so there's nothing to render
-            return IterationDecision::Continue;
-        }
-        auto transition_offset = window_transition_offset(window);
-        auto frame_rect = window.frame().render_rect().translated(transition_offset);
+    // NOTE: Everything below until the tiles have been painted may run on any of the compositing threads,
+    //       so it must neither modify any shared state nor create references to ref-counted objects.
+    auto window_background_color = wm.palette().window();
+
+    auto compose_window = [&](WindowToCompose const& window_to_compose, Screen& screen, Gfx::IntRect const& tile, CompositorScreenData::TilePainters& painters) {
+        auto& window = *window_to_compose.window;
+        auto& dirty_rects = window.dirty_rects();
+        if (dirty_rects.is_empty() || !window.screens().contains_slow(&screen))
+            return;
+        auto transition_offset = window_to_compose.transition_offset;
+        auto frame_rect = window_to_compose.frame_render_rect.translated(transition_offset);
         auto window_rect = window.rect().translated(transition_offset);
         auto frame_rects = frame_rect.shatter(window_rect);
 
-        dbgln_if(COMPOSE_DEBUG, "  window {} frame rect: {}", window.title(), frame_rect);
-
-        RefPtr<Gfx::Bitmap> backing_store = window.backing_store();
-        auto compose_window_rect = [&](Screen& screen, Gfx::Painter& painter, const Gfx::IntRect& rect) {
-            if (!window.is_fullscreen()) {
-                rect.for_each_intersected(frame_rects, [&](const Gfx::IntRect& intersected_rect) {
+        auto* backing_store = window.backing_store();
+        auto compose_window_rect = [&](Gfx::Painter& painter, Gfx::IntRect const& rect) {
+            // The frame's cache was already rendered while preparing the window, so this only looks it up
+            auto* frame_cache = !window.is_fullscreen() ? window.frame().render_to_cache(screen) : nullptr;
+            if (frame_cache) {
+                rect.for_each_intersected(frame_rects, [&](Gfx::IntRect const& intersected_rect) {
                     Gfx::PainterStateSaver saver(painter);
                     painter.add_clip_rect(intersected_rect);
                     painter.translate(transition_offset);
                     dbgln_if(COMPOSE_DEBUG, "    render frame: {}", intersected_rect);
-                    window.frame().paint(screen, painter, intersected_rect.translated(-transition_offset));
+                    frame_cache->paint(window.frame(), painter, intersected_rect.translated(-transition_offset), window_to_compose.unconstrained_frame_render_rect);
                     return IterationDecision::Continue;
                 });
             }
@@ -392,8 +546,8 @@ void Compositor::compose()
             if (update_window_rect.is_empty())
                 return;
 
-            auto clear_window_rect = [&](const Gfx::IntRect& clear_rect) {
-                painter.fill_rect(clear_rect, wm.palette().window());
+            auto clear_window_rect = [&](Gfx::IntRect const& clear_rect) {
+                painter.fill_rect(clear_rect, window_background_color);
             };
 
             if (!backing_store) {
@@ -411,7 +565,7 @@ void Compositor::compose()
             // background color.
             Gfx::IntRect backing_rect;
             backing_rect.set_size(window.backing_store_visible_size());
-            switch (WindowManager::the().resize_direction_of_window(window)) {
+            switch (window_to_compose.resize_direction) {
             case ResizeDirection::None:
             case ResizeDirection::Right:
             case ResizeDirection::Down:
@@ -443,7 +597,7 @@ void Compositor::compose()
             if (!dirty_rect_in_backing_coordinates.is_empty()) {
                 auto dst = backing_rect.location().translated(dirty_rect_in_backing_coordinates.location());
 
-                if (window.client() && window.client()->is_unresponsive()) {
+                if (window_to_compose.is_unresponsive) {
                     painter.blit_filtered(dst, *backing_store, dirty_rect_in_backing_coordinates, [](Color src) {
                         return src.to_grayscale().darkened(0.75f);
                     });
@@ -456,127 +610,104 @@ void Compositor::compose()
                 clear_window_rect(background_rect);
         };
 
-        auto& dirty_rects = window.dirty_rects();
-
-        if constexpr (COMPOSE_DEBUG) {
-            for (auto& dirty_rect : dirty_rects.rects())
-                dbgln("    dirty: {}", dirty_rect);
-            for (auto& r : window.opaque_rects().rects())
-                dbgln("    opaque: {}", r);
-            for (auto& r : window.transparency_rects().rects())
-                dbgln("    transparent: {}", r);
-        }
-
         // Render opaque portions directly to the back buffer
-        auto& opaque_rects = window.opaque_rects();
-        if (!opaque_rects.is_empty()) {
-            opaque_rects.for_each_intersected(dirty_rects, [&](const Gfx::IntRect& render_rect) {
-                for (auto* screen : window.screens()) {
-                    auto screen_render_rect = render_rect.intersected(screen->rect());
-                    if (screen_render_rect.is_empty())
-                        continue;
-                    dbgln_if(COMPOSE_DEBUG, "    render opaque: {} on screen #{}", screen_render_rect, screen->index());
-
-                    prepare_rect(*screen, screen_render_rect);
-                    auto& back_painter = *screen->compositor_screen_data().m_back_painter;
-                    Gfx::PainterStateSaver saver(back_painter);
-                    back_painter.add_clip_rect(screen_render_rect);
-                    compose_window_rect(*screen, back_painter, screen_render_rect);
-                }
+        window.opaque_rects().for_each_intersected(dirty_rects, [&](Gfx::IntRect const& render_rect) {
+            auto tile_render_rect = render_rect.intersected(tile);
+            if (tile_render_rect.is_empty())
                 return IterationDecision::Continue;
-            });
-        }
+            dbgln_if(COMPOSE_DEBUG, "    render opaque: {} on screen #{}", tile_render_rect, screen.index());
+
+            auto& back_painter = *painters.back_painter;
+            Gfx::PainterStateSaver saver(back_painter);
+            back_painter.add_clip_rect(tile_render_rect);
+            compose_window_rect(back_painter, tile_render_rect);
+            return IterationDecision::Continue;
+        });
 
         // Render the wallpaper for any transparency directly covering
         // the wallpaper
-        auto& transparency_wallpaper_rects = window.transparency_wallpaper_rects();
-        if (!transparency_wallpaper_rects.is_empty()) {
-            transparency_wallpaper_rects.for_each_intersected(dirty_rects, [&](const Gfx::IntRect& render_rect) {
-                for (auto* screen : window.screens()) {
-                    auto screen_rect = screen->rect();
-                    auto screen_render_rect = render_rect.intersected(screen_rect);
-                    if (screen_render_rect.is_empty())
-                        continue;
-                    dbgln_if(COMPOSE_DEBUG, "    render wallpaper: {} on screen #{}", screen_render_rect, screen->index());
-
-                    auto& temp_painter = *screen->compositor_screen_data().m_temp_painter;
-                    prepare_transparency_rect(*screen, screen_render_rect);
-                    paint_wallpaper(*screen, temp_painter, screen_render_rect, screen_rect);
-                }
+        window.transparency_wallpaper_rects().for_each_intersected(dirty_rects, [&](Gfx::IntRect const& render_rect) {
+            auto tile_render_rect = render_rect.intersected(tile);
+            if (tile_render_rect.is_empty())
                 return IterationDecision::Continue;
-            });
-        }
-        auto& transparency_rects = window.transparency_rects();
-        if (!transparency_rects.is_empty()) {
-            transparency_rects.for_each_intersected(dirty_rects, [&](const Gfx::IntRect& render_rect) {
-                for (auto* screen : window.screens()) {
-                    auto screen_rect = screen->rect();
-                    auto screen_render_rect = render_rect.intersected(screen_rect);
-                    if (screen_render_rect.is_empty())
-                        continue;
-                    dbgln_if(COMPOSE_DEBUG, "    render transparent: {} on screen #{}", screen_render_rect, screen->index());
-
-                    prepare_transparency_rect(*screen, screen_render_rect);
-                    auto& temp_painter = *screen->compositor_screen_data().m_temp_painter;
-                    Gfx::PainterStateSaver saver(temp_painter);
-                    temp_painter.add_clip_rect(screen_render_rect);
-                    compose_window_rect(*screen, temp_painter, screen_render_rect);
-                }
+            dbgln_if(COMPOSE_DEBUG, "    render wallpaper: {} on screen #{}", tile_render_rect, screen.index());
+
+            paint_wallpaper(screen, *painters.temp_painter, tile_render_rect, screen.rect());
+            return IterationDecision::Continue;
+        });
+
+        window.transparency_rects().for_each_intersected(dirty_rects, [&](Gfx::IntRect const& render_rect) {
+            auto tile_render_rect = render_rect.intersected(tile);
+            if (tile_render_rect.is_empty())
                 return IterationDecision::Continue;
-            });
-        }
-        return IterationDecision::Continue;
+            dbgln_if(COMPOSE_DEBUG, "    render transparent: {} on screen #{}", tile_render_rect, screen.index());
+
+            auto& temp_painter = *painters.temp_painter;
+            Gfx::PainterStateSaver saver(temp_painter);
+            temp_painter.add_clip_rect(tile_render_rect);
+            compose_window_rect(temp_painter, tile_render_rect);
+            return IterationDecision::Continue;
+        });
     };
 
-    // Paint the window stack.
-    if (m_invalidated_window) {
-        auto* fullscreen_window = wm.active_fullscreen_window();
-        // FIXME: Remove the !WindowSwitcher::the().is_visible() check when WindowSwitcher is an overlay
-        if (fullscreen_window && fullscreen_window->is_opaque() && !WindowSwitcher::the().is_visible()) {
-            compose_window(*fullscreen_window);
-            fullscreen_window->clear_dirty_rects();
-        } else {
-            wm.for_each_visible_window_from_back_to_front([&](Window& window) {
-                compose_window(window);
-                window.clear_dirty_rects();
-                return IterationDecision::Continue;
-            });
+    // Copy anything rendered to the temporary buffer to the back buffer
+    auto copy_transparent_rects_to_back_buffer = [&](Screen& screen, Gfx::IntRect const& tile, CompositorScreenData::TilePainters& painters) {
+        auto screen_rect = screen.rect();
+        auto& screen_data = screen.compositor_screen_data();
+        for (auto& rect : screen_data.m_flush_transparent_rects.rects()) {
+            auto tile_rect = rect.intersected(tile);
+            if (!tile_rect.is_empty())
+                painters.back_painter->blit(tile_rect.location(), *screen_data.m_temp_bitmap, tile_rect.translated(-screen_rect.location()));
         }
+    };
 
-        // Check that there are no overlapping transparent and opaque flush rectangles
-        VERIFY(![&]() {
-            bool is_overlapping = false;
-            Screen::for_each([&](auto& screen) {
-                auto& screen_data = screen.compositor_screen_data();
-                auto& flush_transparent_rects = screen_data.m_flush_transparent_rects;
-                auto& flush_rects = screen_data.m_flush_rects;
-                for (auto& rect_transparent : flush_transparent_rects.rects()) {
-                    for (auto& rect_opaque : flush_rects.rects()) {
-                        if (rect_opaque.intersects(rect_transparent)) {
-                            dbgln("Transparent rect {} overlaps opaque rect: {}: {}", rect_transparent, rect_opaque, rect_opaque.intersected(rect_transparent));
-                            is_overlapping = true;
-                            return IterationDecision::Break;
-                        }
-                    }
-                }
-                return IterationDecision::Continue;
-            });
-            return is_overlapping;
-        }());
+    // Overlays are rendered into their own bitmaps on demand, which can't happen on the compositing threads.
+    // So if there are any, we paint everything below them first, render them and only then copy the
+    // transparent areas to the back buffer.
+    bool has_overlays = m_invalidated_window && !m_overlay_list.is_empty();
+
+    auto paint_tile = [&](Screen& screen, Gfx::IntRect const& tile, CompositorScreenData::TilePainters& painters) {
+        Gfx::PainterStateSaver back_saver(*painters.back_painter);
+        Gfx::PainterStateSaver temp_saver(*painters.temp_painter);
+        painters.back_painter->add_clip_rect(tile);
+        painters.temp_painter->add_clip_rect(tile);
 
-        if (!m_overlay_list.is_empty()) {
+        // Paint any desktop wallpaper rects that are not somehow underneath any window transparency
+        // rects and outside of any opaque window areas
+        m_opaque_wallpaper_rects.for_each_intersected(dirty_screen_rects, [&](auto& render_rect) {
+            auto tile_render_rect = render_rect.intersected(tile);
+            if (!tile_render_rect.is_empty())
+                paint_wallpaper(screen, *painters.back_painter, tile_render_rect, screen.rect());
+            return IterationDecision::Continue;
+        });
+        m_transparent_wallpaper_rects.for_each_intersected(dirty_screen_rects, [&](auto& render_rect) {
+            auto tile_render_rect = render_rect.intersected(tile);
+            if (!tile_render_rect.is_empty())
+                paint_wallpaper(screen, *painters.temp_painter, tile_render_rect, screen.rect());
+            return IterationDecision::Continue;
+        });
+
+        // Paint the window stack.
+        if (!m_invalidated_window)
+            return;
+        for (auto& window_to_compose : windows_to_compose)
+            compose_window(window_to_compose, screen, tile, painters);
+        if (!has_overlays)
+            copy_transparent_rects_to_back_buffer(screen, tile, painters);
+    };
+
+    auto tiles = tiles_to_paint();
+    paint_tiles_in_parallel(tiles, move(paint_tile));
+
+    if (m_invalidated_window) {
+        if (has_overlays) {
             // Render everything to the temporary buffer before we copy it back
             render_overlays();
+            paint_tiles_in_parallel(tiles, move(copy_transparent_rects_to_back_buffer));
         }
 
-        // Copy anything rendered to the temporary buffer to the back buffer
-        Screen::for_each([&](auto& screen) {
-            auto screen_rect = screen.rect();
-            auto& screen_data = screen.compositor_screen_data();
-            for (auto& rect : screen_data.m_flush_transparent_rects.rects())
-                screen_data.m_back_painter->blit(rect.location(), *screen_data.m_temp_bitmap, rect.translated(-screen_rect.location()));
-            return IterationDecision::Continue;
-        });
+        for (auto& window_to_compose : windows_to_compose)
+            window_to_compose.window->clear_dirty_rects();
     }
 
     m_invalidated_any = false;
@@ -601,10 +732,81 @@ void Compositor::compose()
         screen_data.draw_cursor(cursor_screen, cursor_rect);
     }
 
+    auto compose_time_us = frame_timer.elapsed_time().to_microseconds();
     Screen::for_each([&](auto& screen) {
         flush(screen);
         return IterationDecision::Continue;
     });
+    update_frame_statistics(compose_time_us, frame_timer.elapsed_time().to_microseconds() - compose_time_us);
+}
+
+Vector<Compositor::Tile> Compositor::tiles_to_paint() const
+{
+    Vector<Tile> tiles;
+    Screen::for_each([&](auto& screen) {
+        auto& screen_data = screen.compositor_screen_data();
+        auto screen_rect = screen.rect();
+        for (int y = screen_rect.top(); y < screen_rect.bottom(); y += tile_size) {
+            for (int x = screen_rect.left(); x < screen_rect.right(); x += tile_size) {
+                auto tile = Gfx::IntRect { x, y, tile_size, tile_size }.intersected(screen_rect);
+                if (screen_data.m_flush_rects.intersects(tile) || screen_data.m_flush_transparent_rects.intersects(tile))
+                    tiles.append({ &screen, tile });
+            }
+        }
+        return IterationDecision::Continue;
+    });
+    return tiles;
+}
+
+void Compositor::paint_tiles_in_parallel(Vector<Tile> const& tiles, Function<void(Screen&, Gfx::IntRect const&, CompositorScreenData::TilePainters&)> const& paint_tile)
+{
+    if (tiles.is_empty())
+        return;
+
+    // Tiles are handed out one at a time, so threads that happen to get cheap ones just end up painting more of them.
+    Atomic<size_t> next_tile_index { 0 };
+    auto paint_tiles = [&](size_t thread_index) {
+        for (size_t i = next_tile_index.fetch_add(1); i < tiles.size(); i = next_tile_index.fetch_add(1)) {
+            auto& tile = tiles[i];
+            paint_tile(*tile.screen, tile.rect, tile.screen->compositor_screen_data().m_tile_painters[thread_index]);
+        }
+    };
+
+    auto worker_count = min(m_compose_workers.size(), tiles.size() - 1);
+    for (size_t i = 0; i < worker_count; ++i) {
+        VERIFY(m_compose_workers[i]->start_task([&paint_tiles, thread_index = i + 1]() -> ErrorOr<void> {
+            paint_tiles(thread_index);
+            return {};
+        }));
+    }
+    paint_tiles(0);
+    for (size_t i = 0; i < worker_count; ++i)
+        MUST(m_compose_workers[i]->wait_until_task_is_finished());
+}
+
+void Compositor::update_frame_statistics(i64 compose_time_us, i64 flush_time_us)
+{
+    if constexpr (!COMPOSE_TIMING_DEBUG)
+        return;
+
+    static constexpr size_t frames_per_report = 60;
+
+    dbgln("COMPOSE: frame composed in {}us, flushed in {}us", compose_time_us, flush_time_us);
+
+    auto& statistics = m_frame_statistics;
+    ++statistics.frame_count;
+    statistics.total_compose_time_us += compose_time_us;
+    statistics.max_compose_time_us = max(statistics.max_compose_time_us, compose_time_us);
+    statistics.total_flush_time_us += flush_time_us;
+    statistics.max_flush_time_us = max(statistics.max_flush_time_us, flush_time_us);
+    if (statistics.frame_count < frames_per_report)
+        return;
+
+    dbgln("COMPOSE: last {} frames: compose avg {}us max {}us, flush avg {}us max {}us",
+        statistics.frame_count,
+        statistics.total_compose_time_us / static_cast<i64>(statistics.frame_count), statistics.max_compose_time_us,
+        statistics.total_flush_time_us / static_cast<i64>(statistics.frame_count), statistics.max_flush_time_us);
+    statistics = {};
 }
 
 void Compositor::flush(Screen& screen)
@@ -663,6 +865,7 @@ void Compositor::flush(Screen& screen)
     }
 
     if (screen_data.m_screen_can_set_buffer) {
+        screen_data.add_back_buffer_damage_to_other_buffers();
         screen_data.flip_buffers(screen);
         screen_data.m_has_flipped = true;
     }
@@ -682,8 +885,9 @@ void Compositor::flush(Screen& screen)
         // NOTE: The meaning of a flush depends on whether we can flip buffers or not.
         //
         //       If flipping is supported, flushing means that we've flipped, and now we
-        //       copy the changed bits from the front buffer to the back buffer, to keep
-        //       them in sync.
+        //       copy what was drawn outside of composition (the cursor and animations)
+        //       from the front buffer to the back buffer. Everything we composed gets
+        //       composed into the back buffer again instead, see m_buffer_damage.
         //
         //       If flipping is not supported, flushing means that we copy the changed
         //       rects from the backing bitmap to the display framebuffer.
@@ -711,10 +915,12 @@ void Compositor::flush(Screen& screen)
             screen.queue_flush_display_rect(rect);
         }
     };
-    for (auto& rect : screen_data.m_flush_rects.rects())
-        do_flush(rect);
-    for (auto& rect : screen_data.m_flush_transparent_rects.rects())
-        do_flush(rect);
+    if (!screen_data.m_screen_can_set_buffer) {
+        for (auto& rect : screen_data.m_flush_rects.rects())
+            do_flush(rect);
+        for (auto& rect : screen_data.m_flush_transparent_rects.rects())
+            do_flush(rect);
+    }
     for (auto& rect : screen_data.m_flush_special_rects.rects())
         do_flush(rect);
     if (device_can_flush_buffers && !screen_data.m_screen_can_set_buffer) {
@@ -874,11 +1080,30 @@ void CompositorScreenData::clear_wallpaper_bitmap()
     m_wallpaper_bitmap = nullptr;
 }
 
+Gfx::DisjointIntRectSet CompositorScreenData::take_back_buffer_damage()
+{
+    VERIFY(m_screen_can_set_buffer);
+    return exchange(m_buffer_damage[back_buffer_index()], {});
+}
+
+void CompositorScreenData::add_back_buffer_damage_to_other_buffers()
+{
+    VERIFY(m_screen_can_set_buffer);
+    auto new_damage = move(m_new_damage);
+    for (size_t i = 0; i < m_buffer_damage.size(); ++i) {
+        if (i == back_buffer_index())
+            continue;
+        m_buffer_damage[i].add(new_damage);
+    }
+}
+
 void CompositorScreenData::flip_buffers(Screen& screen)
 {
     VERIFY(m_screen_can_set_buffer);
     swap(m_front_bitmap, m_back_bitmap);
     swap(m_front_painter, m_back_painter);
+    for (auto& painters : m_tile_painters)
+        swap(painters.front_painter, painters.back_painter);
     screen.set_buffer(m_buffers_are_flipped ? 0 : 1);
     m_buffers_are_flipped = !m_buffers_are_flipped;
 }
@@ -6,12 +6,14 @@
 
 #pragma once
 
+#include <AK/Array.h>
 #include <AK/OwnPtr.h>
 #include <AK/RefPtr.h>
 #include <LibCore/EventReceiver.h>
 #include <LibGfx/Color.h>
 #include <LibGfx/DisjointRectSet.h>
 #include <LibGfx/Font/Font.h>
+#include <LibThreading/WorkerThread.h>
 #include <WindowServer/Overlays.h>
 
 namespace WindowServer {
@@ -55,9 +57,29 @@ struct CompositorScreenData {
     Gfx::DisjointIntRectSet m_flush_transparent_rects;
     Gfx::DisjointIntRectSet m_flush_special_rects;
 
+    // When flipping buffers, the areas composed into the other buffer since this one was last drawn
+    // into, indexed like Screen::set_buffer(). Rather than copying them over from the front buffer
+    // after every flip, they get composed once more the next time this buffer is drawn into.
+    Array<Gfx::DisjointIntRectSet, 2> m_buffer_damage;
+    // What was newly dirtied in the frame being composed, as opposed to damage the back buffer is catching up on.
+    Gfx::DisjointIntRectSet m_new_damage;
+
+    // Painters for each of the compositing threads to paint tiles with. These are created up front, as
+    // bitmaps can't be referenced from other threads (their reference counts aren't atomic).
+    struct TilePainters {
+        NonnullOwnPtr<Gfx::Painter> back_painter;
+        NonnullOwnPtr<Gfx::Painter> front_painter;
+        NonnullOwnPtr<Gfx::Painter> temp_painter;
+    };
+    Vector<TilePainters> m_tile_painters;
+
     Gfx::Painter& overlay_painter() { return *m_temp_painter; }
 
+    size_t back_buffer_index() const { return m_buffers_are_flipped ? 0 : 1; }
+
     void init_bitmaps(Compositor&, Screen&);
+    Gfx::DisjointIntRectSet take_back_buffer_damage();
+    void add_back_buffer_damage_to_other_buffers();
     void flip_buffers(Screen&);
     void draw_cursor(Screen&, Gfx::IntRect const&);
     bool restore_cursor_back(Screen&, Gfx::IntRect&);
@@ -189,7 +211,17 @@ public:
         return adopt_own(*new CompositorScreenData());
     }
 
+    size_t compose_thread_count() const { return m_compose_workers.size() + 1; }
+
 private:
+    static constexpr size_t max_compose_thread_count = 4;
+    static constexpr int tile_size = 256;
+
+    struct Tile {
+        Screen* screen { nullptr };
+        Gfx::IntRect rect;
+    };
+
     Compositor();
     void init_bitmaps();
     void invalidate_current_screen_number_rects();
@@ -204,7 +236,10 @@ private:
     void recompute_overlay_rects();
     void recompute_occlusions();
     void change_cursor(Cursor const*);
+    Vector<Tile> tiles_to_paint() const;
+    void paint_tiles_in_parallel(Vector<Tile> const&, Function<void(Screen&, Gfx::IntRect const&, CompositorScreenData::TilePainters&)> const&);
     void flush(Screen&);
+    void update_frame_statistics(i64 compose_time_us, i64 flush_time_us);
     Gfx::IntPoint window_transition_offset(Window&);
     void update_animations(Screen&, Gfx::DisjointIntRectSet& flush_rects);
     void create_window_stack_switch_overlay(WindowStack&);
@@ -251,6 +286,17 @@ private:
     Optional<Gfx::Color> m_custom_background_color;
 
     HashTable<Animation*> m_animations;
+
+    Vector<NonnullOwnPtr<Threading::WorkerThread<Error>>> m_compose_workers;
+
+    struct FrameStatistics {
+        size_t frame_count { 0 };
+        i64 total_compose_time_us { 0 };
+        i64 max_compose_time_us { 0 };
+        i64 total_flush_time_us { 0 };
+        i64 max_flush_time_us { 0 };
+    };
+    FrameStatistics m_frame_statistics;
 };
 
 }
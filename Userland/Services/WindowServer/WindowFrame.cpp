@@ -345,12 +345,13 @@ void WindowFrame::paint_normal_frame(Gfx::Painter& painter)
 void WindowFrame::paint(Screen& screen, Gfx::Painter& painter, Gfx::IntRect const& rect)
 {
     if (auto* cached = render_to_cache(screen))
-        cached->paint(*this, painter, rect);
+        cached->paint(*this, painter, rect, unconstrained_render_rect());
 }
 
-void WindowFrame::PerScaleRenderedCache::paint(WindowFrame& frame, Gfx::Painter& painter, Gfx::IntRect const& rect)
+// NOTE: This may be called from any of the compositing threads, which is why it takes the frame's
+//       unconstrained render rect rather than figuring it out itself.
+void WindowFrame::PerScaleRenderedCache::paint(WindowFrame& frame, Gfx::Painter& painter, Gfx::IntRect const& rect, Gfx::IntRect const& frame_rect)
 {
-    auto frame_rect = frame.unconstrained_render_rect();
     auto window_rect = frame.window().rect();
     if (m_top_bottom) {
         auto top_bottom_height = frame_rect.height() - window_rect.height();
@@ -29,7 +29,7 @@ public:
         friend class WindowFrame;
 
     public:
-        void paint(WindowFrame&, Gfx::Painter&, Gfx::IntRect const&);
+        void paint(WindowFrame&, Gfx::Painter&, Gfx::IntRect const&, Gfx::IntRect const& frame_rect);
         void render(WindowFrame&, Screen&);
         Optional<HitTestResult> hit_test(WindowFrame&, Gfx::IntPoint, Gfx::IntPoint);
 
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2023, the SerenityOS developers.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <AK/LexicalPath.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/DirIterator.h>
+#include <LibCore/MappedFile.h>
+#include <LibCore/System.h>
+#include <LibELF/Image.h>
+#include <LibELF/SymbolCache.h>
+#include <LibMain/Main.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static bool is_dynamically_linked_program(StringView path)
+{
+    auto file_or_error = Core::MappedFile::map(path);
+    if (file_or_error.is_error())
+        return false;
+
+    ELF::Image elf_image(file_or_error.value()->bytes());
+    if (!elf_image.is_valid())
+        return false;
+
+    bool has_interpreter = false;
+    elf_image.for_each_program_header([&has_interpreter](ELF::Image::ProgramHeader const& program_header) {
+        if (program_header.type() == PT_INTERP)
+            has_interpreter = true;
+    });
+    return has_interpreter;
+}
+
+static ErrorOr<void> update_symbol_cache(DeprecatedString const& path)
+{
+    // The loader links the program as usual, records how its symbols were resolved and exits before running it.
+    Vector<char const*> environment;
+    for (char** env = environ; *env; ++env) {
+        if (!StringView { *env, strlen(*env) }.starts_with("_LOADER_SYMBOL_CACHE="sv))
+            environment.append(*env);
+    }
+    environment.append("_LOADER_SYMBOL_CACHE=update");
+    environment.append(nullptr);
+
+    char const* argv[] = { path.characters(), nullptr };
+    auto pid = TRY(Core::System::posix_spawn(path, nullptr, nullptr, const_cast<char**>(argv), const_cast<char**>(environment.data())));
+    auto result = TRY(Core::System::waitpid(pid));
+    if (!WIFEXITED(result.status) || WEXITSTATUS(result.status) != 0)
+        return Error::from_string_literal("Loader failed to record the symbol cache");
+    return {};
+}
+
+ErrorOr<int> serenity_main(Main::Arguments arguments)
+{
+    TRY(Core::System::pledge("stdio rpath cpath proc exec"));
+
+    bool remove = false;
+    Vector<DeprecatedString> paths;
+
+    Core::ArgsParser args_parser;
+    args_parser.set_general_help("Record how the symbols of dynamically linked programs are resolved, so that they start up faster.");
+    args_parser.add_option(remove, "Remove the symbol caches instead", "remove", 'r');
+    args_parser.add_positional_argument(paths, "Programs to update the symbol cache of (all programs in /bin by default)", "path", Core::ArgsParser::Required::No);
+    args_parser.parse(arguments);
+
+    if (geteuid() != 0) {
+        warnln("{} has to be run as root", arguments.strings[0]);
+        return 1;
+    }
+
+    if (paths.is_empty()) {
+        Core::DirIterator it("/bin", Core::DirIterator::Flags::SkipDots);
+        while (it.has_next())
+            paths.append(it.next_full_path());
+    }
+
+    auto cwd = TRY(Core::System::getcwd());
+    int exit_code = 0;
+    for (auto& path : paths) {
+        path = LexicalPath::absolute_path(cwd, path);
+        auto cache_path = ELF::SymbolCache::path_for_program(path);
+
+        if (remove) {
+            if (auto result = Core::System::unlink(cache_path); result.is_error() && result.error().code() != ENOENT) {
+                warnln("{}: {}", cache_path, result.error());
+                exit_code = 1;
+            }
+            continue;
+        }
+
+        if (!is_dynamically_linked_program(path))
+            continue;
+
+        if (auto result = update_symbol_cache(path); result.is_error()) {
+            warnln("{}: {}", path, result.error());
+            exit_code = 1;
+        }
+    }
+    return exit_code;
+}
@@ -4,14 +4,22 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <AK/Atomic.h>
+#include <Kernel/API/PerformanceEventStream.h>
 #include <LibCore/ArgsParser.h>
+#include <LibCore/File.h>
 #include <LibCore/System.h>
 #include <LibMain/Main.h>
+#include <limits.h>
+#include <poll.h>
 #include <serenity.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 static Optional<pid_t> determine_pid_to_profile(StringView pid_argument, bool all_processes);
+static ErrorOr<void> stream_events(pid_t, u64 event_mask, StringView output_path);
 
 ErrorOr<int> serenity_main(Main::Arguments arguments)
 {
@@ -24,6 +32,7 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
     bool enable = false;
     bool disable = false;
     bool all_processes = false;
+    StringView stream_path {};
     u64 event_mask = PERF_EVENT_MMAP | PERF_EVENT_MUNMAP | PERF_EVENT_PROCESS_CREATE
         | PERF_EVENT_PROCESS_EXEC | PERF_EVENT_PROCESS_EXIT | PERF_EVENT_THREAD_CREATE | PERF_EVENT_THREAD_EXIT
         | PERF_EVENT_SIGNPOST;
@@ -35,6 +44,7 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
     args_parser.add_option(disable, "Disable", nullptr, 'd');
     args_parser.add_option(free, "Free the profiling buffer for the associated process(es).", nullptr, 'f');
     args_parser.add_option(wait, "Enable profiling and wait for user input to disable.", nullptr, 'w');
+    args_parser.add_option(stream_path, "Enable profiling, and stream events to a file until user input.", "stream", 's', "path");
     args_parser.add_option(Core::ArgsParser::Option {
         Core::ArgsParser::OptionArgumentMode::Required,
         "Enable tracking specific event type", nullptr, 't', "event_type",
@@ -83,8 +93,9 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
         event_mask |= PERF_EVENT_SAMPLE;
 
     if (!pid_argument.is_empty() || all_processes) {
-        if (!(enable ^ disable ^ wait ^ free)) {
-            warnln("-a and -p <PID> requires -e xor -d xor -w xor -f.");
+        bool stream = !stream_path.is_empty();
+        if (!(enable ^ disable ^ wait ^ free ^ stream)) {
+            warnln("-a and -p <PID> requires -e xor -d xor -w xor -f xor -s.");
             return 1;
         }
 
@@ -95,6 +106,11 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
         }
 
         pid_t pid = pid_opt.value();
+        if (stream) {
+            TRY(stream_events(pid, event_mask, stream_path));
+            return 0;
+        }
+
         if (wait || enable) {
             TRY(Core::System::profiling_enable(pid, event_mask));
 
@@ -132,3 +148,82 @@ static Optional<pid_t> determine_pid_to_profile(StringView pid_argument, bool al
     // pid_argument is guaranteed to have a value
     return pid_argument.to_int();
 }
+
+static ErrorOr<void> stream_events(pid_t pid, u64 event_mask, StringView output_path)
+{
+    auto output = TRY(Core::OutputBufferedFile::create(TRY(Core::File::open(output_path, Core::File::OpenMode::Write | Core::File::OpenMode::Truncate))));
+    int stream_fd = TRY(Core::System::profiling_stream(pid, event_mask));
+
+    // Map the first page to find out how large the whole thing is.
+    auto* header_page = TRY(Core::System::mmap(nullptr, PAGE_SIZE, PROT_READ, MAP_SHARED, stream_fd, 0));
+    auto header = *reinterpret_cast<Kernel::PerformanceEventStreamHeader const*>(header_page);
+    TRY(Core::System::munmap(header_page, PAGE_SIZE));
+    if (header.magic != Kernel::performance_event_stream_magic || header.version != Kernel::performance_event_stream_version)
+        return Error::from_string_literal("Unsupported performance event stream");
+
+    auto* mapping = static_cast<u8*>(TRY(Core::System::mmap(nullptr, header.total_size, PROT_READ | PROT_WRITE, MAP_SHARED, stream_fd, 0)));
+
+    Kernel::PerformanceEventStreamFileHeader file_header {
+        .magic = Kernel::performance_event_stream_file_magic,
+        .version = Kernel::performance_event_stream_version,
+        .cpu_count = header.cpu_count,
+    };
+    TRY(output->write_until_depleted({ &file_header, sizeof(file_header) }));
+
+    auto ring_at = [&](u32 cpu) -> u8* {
+        return mapping + header.first_ring_offset + cpu * header.ring_stride;
+    };
+
+    u64 event_count = 0;
+    auto drain_rings = [&]() -> ErrorOr<void> {
+        for (u32 cpu = 0; cpu < header.cpu_count; ++cpu) {
+            auto& ring = *reinterpret_cast<Kernel::PerformanceEventRingHeader*>(ring_at(cpu));
+            auto* data = ring_at(cpu) + header.data_offset;
+
+            u64 head = AK::atomic_load(&ring.head, AK::MemoryOrder::memory_order_acquire);
+            u64 tail = AK::atomic_load(&ring.tail, AK::MemoryOrder::memory_order_relaxed);
+            while (tail != head) {
+                size_t offset = tail & (header.data_size - 1);
+                u32 record_size;
+                u32 record_type;
+                memcpy(&record_size, data + offset, sizeof(record_size));
+                memcpy(&record_type, data + offset + sizeof(record_size), sizeof(record_type));
+                if (record_size == 0 || record_size % 8 != 0 || record_size > header.data_size - offset)
+                    return Error::from_string_literal("Corrupt performance event record");
+
+                if (record_type != 0) {
+                    TRY(output->write_until_depleted({ data + offset, record_size }));
+                    ++event_count;
+                }
+                tail += record_size;
+            }
+
+            // Hand the space back to the kernel only after we're done copying out of it.
+            AK::atomic_store(&ring.tail, tail, AK::MemoryOrder::memory_order_release);
+        }
+        return {};
+    };
+
+    outln("Streaming events to {}, waiting for user input to stop...", output_path);
+    for (;;) {
+        TRY(drain_rings());
+        // There's no wakeup when events arrive, so check back often enough to keep the rings from filling up.
+        struct pollfd stdin_fd { .fd = STDIN_FILENO, .events = POLLIN, .revents = 0 };
+        if (TRY(Core::System::poll({ &stdin_fd, 1 }, 10)) > 0)
+            break;
+    }
+
+    TRY(Core::System::profiling_disable(pid));
+    TRY(drain_rings());
+
+    u64 dropped_events = 0;
+    for (u32 cpu = 0; cpu < header.cpu_count; ++cpu)
+        dropped_events += AK::atomic_load(&reinterpret_cast<Kernel::PerformanceEventRingHeader*>(ring_at(cpu))->dropped_events, AK::MemoryOrder::memory_order_relaxed);
+
+    TRY(Core::System::munmap(mapping, header.total_size));
+    TRY(Core::System::close(stream_fd));
+    TRY(Core::System::profiling_free_buffer(pid));
+
+    outln("Wrote {} event(s) to {}, {} event(s) dropped", event_count, output_path, dropped_events);
+    return {};
+}